@@ -0,0 +1,747 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+// Command line driver of the headless benchmarks, which is NOT part of RSC.vcxproj.
+// Build it with any C++20 compiler, the DirectXMath headers and the DirectX-Headers package
+// (only the declarations of d3d12.h are needed by graphics/vmesh.h), for example:
+//
+// g++ -std=c++20 -O2 -pthread -Icppsrc -I<DirectXMath>/Inc -I<DirectX-Headers>/include/wsl/stubs
+//     -I<DirectX-Headers>/include/directx cppsrc/benchmark/*.cpp cppsrc/modifier/wave-solver.cpp
+//     cppsrc/utils/geometry-utils.cpp cppsrc/utils/math-utils.cpp cppsrc/utils/mesh-file-utils.cpp
+//     cppsrc/utils/mesh-optimize-utils.cpp cppsrc/utils/packed-vertex-utils.cpp
+//     cppsrc/utils/cmd-stream-recorder.cpp cppsrc/utils/draw-list-utils.cpp cppsrc/utils/free-list-allocator.cpp
+//     cppsrc/utils/dirty-seat-set.cpp cppsrc/utils/obj-consts-utils.cpp cppsrc/utils/ring-allocator.cpp
+//     cppsrc/utils/geometry-dedup-utils.cpp cppsrc/utils/culling-utils.cpp cppsrc/utils/bvh-utils.cpp
+//     cppsrc/utils/ray-cast-utils.cpp cppsrc/utils/thread-utils.cpp cppsrc/utils/postprocess-graph-utils.cpp
+//     cppsrc/postprocessing/image-filter.cpp -o rs-bench
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bvh-benchmark.h"
+#include "culling-benchmark.h"
+#include "draw-list-benchmark.h"
+#include "frame-cpu-benchmark.h"
+#include "free-list-benchmark.h"
+#include "geometry-dedup-benchmark.h"
+#include "image-filter-benchmark.h"
+#include "instancing-benchmark.h"
+#include "mesh-load-benchmark.h"
+#include "mesh-optimize-benchmark.h"
+#include "obj-consts-benchmark.h"
+#include "postprocess-graph-benchmark.h"
+#include "ray-cast-benchmark.h"
+#include "ring-alloc-benchmark.h"
+#include "subdivision-benchmark.h"
+#include "vertex-pack-benchmark.h"
+#include "wave-benchmark.h"
+
+static const char* USAGE =
+    "Usage: %s <benchmark> [options]\n"
+    "  wave      [--sizes 64,256,1024,4096] [--steps 100] [--seed 0] [--reference]\n"
+    "  subdivide [--levels 0-8] [--repeat 3]\n"
+    "  mesh-load <text mesh file> [--generate <grid half size>] [--repeat 3]\n"
+    "  mesh-opt  [text mesh file]\n"
+    "  vertex-pack [text mesh file]\n"
+    "  ring-alloc [--capacity 4194304] [--frames 100000] [--max-size 65536] [--latency 3] [--seed 0]\n"
+    "  free-list [--vertices 524288] [--indices 2097152] [--ops 1000000] [--max-mesh 8192] [--seed 0]\n"
+    "  draw-list [--items 10000,30000,100000] [--pooled 0.9] [--repeat 20] [--seed 0]\n"
+    "  frame-cpu [--items 1000,10000,100000] [--pooled 0.9] [--passes 1] [--frames 100] [--seed 0]\n"
+    "  obj-consts [--items 10000,100000] [--churn 0.01] [--max-seats 2] [--frames 200] [--seed 0]\n"
+    "  instancing [--copies 1,64,1024] [--frames 100]\n"
+    "  geo-dedup [--copies 1] [--subdivide 6] [--repeat 20]\n"
+    "  cull      [--boxes 10000,100000,1000000] [--cameras 8] [--repeat 10] [--seed 0]\n"
+    "  bvh       [--items 100000,300000,1000000] [--leaf 4] [--cameras 8] [--far 1000] [--rays 100000] [--overlaps 10000] [--verify 100] [--seed 0]\n"
+    "  ray-cast  [text mesh file] [--spheres 3,5,7] [--leaf 4] [--image 512] [--rays 262144] [--verify 1000] [--seed 0]\n"
+    "  blur      [--radii 2,5,16] [--grade 0] [--count 1] [--repeat 3] [--seed 0] [--reference]\n"
+    "  box-blur  [--radii 5,10,25,50,100,200] [--float] [--min-psnr 30] [--repeat 3] [--seed 0]\n"
+    "  bilateral [--radii 2,5,10] [--distance-grade 0] [--gray-grade 0.1] [--float] [--min-psnr 30]\n"
+    "            [--repeat 3] [--seed 0]\n"
+    "  sobel     [--white-on-black] [--repeat 5] [--seed 0] [--reference]\n"
+    "  post-graph [--nodes 10,100,1000] [--graphs 100] [--repeat 10] [--seed 0]\n";
+
+static std::vector<uint32_t> parseSizes(const char* arg) {
+    std::vector<uint32_t> sizes = {};
+    std::string text = arg;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) comma = text.size();
+        sizes.push_back((uint32_t)std::strtoul(text.substr(pos, comma - pos).c_str(), nullptr, 10));
+        pos = comma + 1;
+    }
+    return sizes;
+}
+
+static int runWave(int argc, char** argv) {
+    WaveBenchmarkDesc desc = {};
+    std::vector<uint32_t> sizes = { 64, 256, 1024, 4096 };
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--sizes") && hasValue) sizes = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--steps") && hasValue) desc.stepCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--reference")) desc.useReference = true;
+        else {
+            fprintf(stderr, "Unknown option of wave benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%-12s %8s %12s %14s %12s %18s\n", "grid", "steps", "ns/cell", "Mcells/s", "GB/s", "checksum");
+    for (auto size : sizes) {
+        desc.M = desc.N = size;
+        auto report = runWaveBenchmark(desc);
+        char grid[32];
+        snprintf(grid, sizeof(grid), "%ux%u", size, size);
+        printf("%-12s %8u %12.3f %14.2f %12.2f %016llx\n", grid, desc.stepCount,
+            report.nsPerCell, report.cellsPerSec * 1e-6, report.bytesPerSec * 1e-9,
+            (unsigned long long)report.checksum);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runSubdivide(int argc, char** argv) {
+    int minLevel = 0, maxLevel = 8, repeatCount = 3;
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--levels") && hasValue) {
+            ++i;
+            if (sscanf(argv[i], "%d-%d", &minLevel, &maxLevel) == 1) maxLevel = minLevel;
+        }
+        else if (!strcmp(argv[i], "--repeat") && hasValue) repeatCount = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Unknown option of subdivide benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%-6s %-8s %12s %12s %12s %12s %16s\n", "level", "mode", "vertices", "indices", "MB", "ms", "checksum");
+    for (auto& report : runSubdivisionBenchmark(minLevel, maxLevel, repeatCount)) {
+        printf("%-6d %-8s %12zu %12zu %12.2f %12.3f %016llx\n", report.level,
+            report.indexed ? "indexed" : "flat", report.vertexCount, report.indexCount,
+            report.byteSize / (1024.0 * 1024.0), report.buildSecs * 1e3,
+            (unsigned long long)report.checksum);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runMeshLoad(int argc, char** argv) {
+    if (argc < 1) {
+        fprintf(stderr, "The text mesh file of mesh-load benchmark is not specified.\n");
+        return EXIT_FAILURE;
+    }
+    std::string path = argv[0];
+    int repeatCount = 3;
+    uint32_t generateSize = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--generate") && hasValue) generateSize = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) repeatCount = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Unknown option of mesh-load benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (generateSize > 0 && !generateGridTextMeshFile(path, generateSize, generateSize)) {
+        fprintf(stderr, "Failed to generate %s\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    auto report = runMeshLoadBenchmark(path, repeatCount);
+    if (!report.isLoaded) {
+        fprintf(stderr, "Failed to load %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("vertices: %zu, indices: %zu\n", report.vertexCount, report.indexCount);
+    printf("%-16s %12s %12s\n", "format", "MB", "ms");
+    printf("%-16s %12.2f %12.3f\n", "text (iostream)", report.textFileSize / (1024.0 * 1024.0), report.textReferenceLoadSecs * 1e3);
+    printf("%-16s %12.2f %12.3f\n", "text", report.textFileSize / (1024.0 * 1024.0), report.textLoadSecs * 1e3);
+    printf("%-16s %12.2f %12.3f\n", "binary (copy)", report.binaryFileSize / (1024.0 * 1024.0), report.binaryLoadSecs * 1e3);
+    printf("%-16s %12.2f %12.3f\n", "binary (map)", report.binaryFileSize / (1024.0 * 1024.0), report.binaryMapSecs * 1e3);
+    printf("text parsers: %s\n", report.isParserEqual ? "equal" : "DIFFERENT");
+    printf("round trip: %s\n", report.isRoundTripEqual ? "equal" : "DIFFERENT");
+    printf("bad submesh range: %s\n", report.isBadSubmeshRejected ? "rejected" : "ACCEPTED");
+    return report.isParserEqual && report.isRoundTripEqual && report.isBadSubmeshRejected ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runMeshOptimize(int argc, char** argv) {
+    std::string path = argc >= 1 ? argv[0] : "";
+
+    bool isAllPassed = true;
+    printf("%-24s %10s %10s %10s %10s %8s %8s %8s %8s %10s\n", "mesh", "triangles", "vertices", "welded", "vertices'",
+        "ACMR", "ACMR'", "ATVR", "ATVR'", "ms");
+    for (auto& report : runMeshOptimizeBenchmark(path)) {
+        auto& opt = report.optimizeReport;
+        // A triangle soup must lose vertices to welding, and no mesh may get a worse vertex cache.
+        bool isWelded = !report.hasDuplicateVertices ||
+            (opt.weldedVertexCount > 0 && opt.vertexCountAfter < opt.vertexCountBefore);
+        bool isCacheKept = opt.after.acmr <= opt.before.acmr;
+        printf("%-24s %10zu %10zu %10zu %10zu %8.3f %8.3f %8.3f %8.3f %10.3f%s%s%s\n", report.meshName.c_str(),
+            report.triangleCount, opt.vertexCountBefore, opt.weldedVertexCount, opt.vertexCountAfter,
+            opt.before.acmr, opt.after.acmr, opt.before.atvr, opt.after.atvr, report.optimizeSecs * 1e3,
+            report.isTriangleSetKept ? "" : "  TRIANGLES CHANGED", isWelded ? "" : "  NOT WELDED",
+            isCacheKept ? "" : "  ACMR INCREASED");
+        isAllPassed = isAllPassed && report.isTriangleSetKept && isWelded && isCacheKept;
+    }
+    return isAllPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runVertexPack(int argc, char** argv) {
+    std::string path = argc >= 1 ? argv[0] : "";
+
+    bool isAllInBound = true;
+    printf("%-24s %10s %10s %10s %8s %10s %12s %12s %12s\n", "mesh", "vertices", "full MB", "packed MB",
+        "ratio", "ms", "pos err", "normal err", "uv err");
+    for (auto& report : runVertexPackBenchmark(path)) {
+        auto& e = report.error;
+        float posError = (std::max)((std::max)(e.pos.x, e.pos.y), e.pos.z);
+        float uvError = (std::max)(e.uv.x, e.uv.y);
+        printf("%-24s %10zu %10.2f %10.2f %8.3f %10.3f %12.3e %12.3e %12.3e%s\n", report.meshName.c_str(),
+            report.vertexCount, report.fullBytes / (1024.0 * 1024.0), report.packedBytes / (1024.0 * 1024.0),
+            (double)report.packedBytes / report.fullBytes, report.packSecs * 1e3, posError, e.normalAngle, uvError,
+            report.isInBound ? "" : "  OUT OF BOUND");
+        isAllInBound = isAllInBound && report.isInBound;
+    }
+    return isAllInBound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int runRingAlloc(int argc, char** argv) {
+    RingAllocBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--capacity") && hasValue) desc.capacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--frames") && hasValue) desc.frameCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--max-size") && hasValue) desc.maxAllocSize = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--latency") && hasValue) desc.maxLatency = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of ring-alloc benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runRingAllocBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Ring allocator check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("allocations: %llu (%.2f MB), wraps: %llu, stalls: %llu, rejects: %llu, max used: %.2f / %.2f MB\n",
+        (unsigned long long)report.allocCount, report.allocBytes / (1024.0 * 1024.0),
+        (unsigned long long)report.wrapCount, (unsigned long long)report.stallCount, (unsigned long long)report.rejectCount,
+        report.maxUsedSize / (1024.0 * 1024.0), desc.capacity / (1024.0 * 1024.0));
+    printf("%.3f ms, %.1f ns per allocation (checks included)\n", report.secs * 1e3, report.secs * 1e9 / (std::max)(report.allocCount, (uint64_t)1));
+    return EXIT_SUCCESS;
+}
+
+static int runFreeList(int argc, char** argv) {
+    FreeListBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--vertices") && hasValue) desc.vertexCapacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--indices") && hasValue) desc.indexCapacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--ops") && hasValue) desc.opCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--max-mesh") && hasValue) desc.maxMeshVertexCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of free-list benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runFreeListBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Free list allocator check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("stream in: %llu, stream out: %llu, pool full: %llu (at %.1f%% vertices allocated), max free blocks: %zu\n",
+        (unsigned long long)report.allocCount, (unsigned long long)report.freeCount,
+        (unsigned long long)report.failCount, report.avgFillRatioAtFail * 100.0, report.maxFreeBlockCount);
+    uint64_t opCount = report.allocCount + report.freeCount + report.failCount;
+    printf("%.3f ms, %.1f ns per operation (checks included)\n", report.secs * 1e3, report.secs * 1e9 / (std::max)(opCount, (uint64_t)1));
+    return EXIT_SUCCESS;
+}
+
+static int runDrawList(int argc, char** argv) {
+    DrawListBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--items") && hasValue) desc.itemCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--pooled") && hasValue) desc.pooledRatio = std::strtof(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of draw-list benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (desc.itemCounts.empty() || desc.repeatCount <= 0) {
+        fprintf(stderr, "Invalid options of draw-list benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    auto report = runDrawListBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Draw list check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%8s %14s %14s %14s %9s %16s %16s\n", "items", "legacy(ms)", "compile(ms)", "compiled(ms)", "speedup", "legacy states", "compiled states");
+    for (auto& r : report.results) {
+        printf("%8u %14.3f %14.3f %14.3f %8.2fx %16llu %16llu\n", r.itemCount,
+            r.legacySecs * 1e3, r.compileSecs * 1e3, r.compiledSecs * 1e3, r.legacySecs / r.compiledSecs,
+            (unsigned long long)r.legacyStateChangeCount, (unsigned long long)r.compiledStateChangeCount);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runFrameCpu(int argc, char** argv) {
+    FrameCpuBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--items") && hasValue) desc.itemCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--pooled") && hasValue) desc.pooledRatio = std::strtof(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--passes") && hasValue) desc.postPassCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && hasValue) desc.frameCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of frame-cpu benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (desc.itemCounts.empty() || desc.postPassCount < 0 || desc.frameCount <= 0) {
+        fprintf(stderr, "Invalid options of frame-cpu benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    auto report = runFrameCpuBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Frame check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%8s %12s %12s %10s %8s %8s %9s %8s %10s %9s %18s\n", "items", "record(us)", "replay(us)",
+        "KB/frame", "cmds", "states", "bindings", "draws", "dispatches", "barriers", "stream hash");
+    for (auto& r : report.results) {
+        printf("%8u %12.1f %12.1f %10.1f %8llu %8llu %9llu %8llu %10llu %9llu   %016llx\n", r.itemCount,
+            r.recordSecs * 1e6, r.replaySecs * 1e6, r.streamByteSize / 1024.0,
+            (unsigned long long)r.cmdCount, (unsigned long long)r.stateChangeCount, (unsigned long long)r.rootBindingCount,
+            (unsigned long long)r.drawCount, (unsigned long long)r.dispatchCount, (unsigned long long)r.barrierCount,
+            (unsigned long long)r.streamHash);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runObjConsts(int argc, char** argv) {
+    ObjConstsBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--items") && hasValue) desc.itemCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--churn") && hasValue) desc.churnRatio = std::strtof(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--max-seats") && hasValue) desc.maxSeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && hasValue) desc.frameCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of obj-consts benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (desc.itemCounts.empty() || desc.churnRatio < 0.0f || desc.churnRatio > 1.0f) {
+        fprintf(stderr, "Invalid options of obj-consts benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    auto report = runObjConstsBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Object constants check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%8s %8s %12s %12s %9s %14s %14s %14s\n", "items", "seats", "legacy(us)", "dirty(us)", "speedup",
+        "legacy seats", "dirty seats", "dirty ranges");
+    for (auto& r : report.results) {
+        printf("%8u %8u %12.1f %12.1f %8.2fx %14.1f %14.1f %14.1f\n", r.itemCount, r.seatCount,
+            r.legacySecs * 1e6, r.dirtySecs * 1e6, r.legacySecs / r.dirtySecs,
+            r.legacySeatWrites, r.dirtySeatWrites, r.dirtyRangeWrites);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runInstancing(int argc, char** argv) {
+    InstancingBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--copies") && hasValue) desc.copyCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && hasValue) desc.frameCount = std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Unknown option of instancing benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (desc.copyCounts.empty() || desc.frameCount <= 0) {
+        fprintf(stderr, "Invalid options of instancing benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    auto report = runInstancingBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Instancing check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%8s %14s %14s %14s %14s %14s %14s %14s %14s\n", "objects", "per-object(us)", "instanced(us)",
+        "per-obj bytes", "inst bytes", "per-obj draws", "inst draws", "per-obj binds", "inst binds");
+    for (auto& r : report.results) {
+        printf("%8u %14.1f %14.1f %14llu %14llu %14llu %14llu %14llu %14llu\n", r.objectCount,
+            r.perObjectSecs * 1e6, r.instancedSecs * 1e6,
+            (unsigned long long)r.perObjectByteSize, (unsigned long long)r.instancedByteSize,
+            (unsigned long long)r.perObjectDrawCount, (unsigned long long)r.instancedDrawCount,
+            (unsigned long long)r.perObjectRootBindingCount, (unsigned long long)r.instancedRootBindingCount);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runGeometryDedup(int argc, char** argv) {
+    GeometryDedupBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--copies") && hasValue) desc.copyCount = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--subdivide") && hasValue) desc.hashSubdivisionLevel = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Unknown option of geo-dedup benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runGeometryDedupBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Geometry dedup check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("objects: %u, meshes: %u\n", report.objectCount, report.meshCount);
+    printf("mesh memory: %.1f KB baked, %.1f KB dedup, %.1f KB saved (%.1f%%)\n",
+        report.bakedByteSize / 1024.0, report.dedupByteSize / 1024.0, report.savedByteSize / 1024.0,
+        100.0 * report.savedByteSize / report.bakedByteSize);
+    printf("max position error: %g, max normal error: %g\n", report.maxPositionError, report.maxNormalError);
+    printf("lookup: %.2f us per object\n", report.lookupSecs * 1e6);
+    printf("hash: %.1f KB in %.1f us, %.2f GB/s\n", report.hashByteSize / 1024.0, report.hashSecs * 1e6,
+        report.hashByteSize / report.hashSecs / 1e9);
+    return EXIT_SUCCESS;
+}
+
+static int runCulling(int argc, char** argv) {
+    CullingBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--boxes") && hasValue) desc.boxCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--cameras") && hasValue) desc.cameraCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of cull benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runCullingBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Culling check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%8s %12s %12s %9s %14s %9s\n", "boxes", "scalar(us)", "simd(us)", "speedup", "Mboxes/s", "visible");
+    for (auto& r : report.results) {
+        printf("%8u %12.1f %12.1f %8.2fx %14.1f %8.1f%%\n", r.boxCount, r.scalarSecs * 1e6, r.simdSecs * 1e6,
+            r.scalarSecs / r.simdSecs, r.boxCount / r.simdSecs / 1e6, r.visibleRatio * 100.0);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runBvh(int argc, char** argv) {
+    BvhBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--items") && hasValue) desc.itemCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--leaf") && hasValue) desc.maxLeafSize = (uint32_t)std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cameras") && hasValue) desc.cameraCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--far") && hasValue) desc.farZ = (float)std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--rays") && hasValue) desc.rayCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--overlaps") && hasValue) desc.overlapCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--verify") && hasValue) desc.verifyCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of bvh benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runBvhBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "BVH check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%u threads, the queries are timed after the refit\n", report.threadCount);
+    printf("%8s %9s %10s %10s %9s %9s %10s %10s %9s %10s %8s %11s %11s\n", "items", "nodes", "build(ms)", "refit(ms)",
+        "SAH", "refit SAH", "flat(us)", "bvh(us)", "visible", "Mrays/s", "hit", "sphere(us)", "box(us)");
+    for (auto& r : report.results) {
+        printf("%8u %9zu %10.2f %10.2f %9.2f %9.2f %10.1f %10.1f %8.2f%% %10.2f %7.1f%% %11.2f %11.2f\n", r.itemCount, r.nodeCount,
+            r.buildSecs * 1e3, r.refitSecs * 1e3, r.sahCost, r.refitSahCost, r.flatCullSecs * 1e6, r.bvhCullSecs * 1e6,
+            r.visibleRatio * 100.0, 1e-6 / r.raySecs, r.rayHitRatio * 100.0, r.sphereSecs * 1e6, r.boxSecs * 1e6);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runRayCast(int argc, char** argv) {
+    RayCastBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--spheres") && hasValue) desc.sphereLevels = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--leaf") && hasValue) desc.maxLeafSize = (uint32_t)std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--image") && hasValue) desc.imageSize = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rays") && hasValue) desc.randomRayCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--verify") && hasValue) desc.verifyCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] != '-' && desc.textPath.empty()) desc.textPath = argv[i];
+        else {
+            fprintf(stderr, "Unknown option of ray-cast benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runRayCastBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Ray cast check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("Mrays/s on a single thread, except the last column on %u threads\n", report.threadCount);
+    printf("%-24s %9s %8s %10s %6s %8s %9s %6s %9s %9s %9s %9s %9s\n", "mesh", "triangles", "nodes", "build(ms)",
+        "SAH", "rays", "set", "hit", "closest", "packet", "any", "any pkt", "parallel");
+    for (auto& r : report.results) {
+        for (auto set : { &r.primary, &r.random }) {
+            printf("%-24s %9zu %8zu %10.2f %6.1f %8zu %9s %5.1f%% %9.2f %9.2f %9.2f %9.2f %9.2f\n", r.meshName.c_str(),
+                r.triangleCount, r.nodeCount, r.buildSecs * 1e3, r.sahCost, set->rayCount, set == &r.primary ? "primary" : "random",
+                set->hitRatio * 100.0, 1e-6 * set->rayCount / set->closestSecs, 1e-6 * set->rayCount / set->packetClosestSecs,
+                1e-6 * set->rayCount / set->anySecs, 1e-6 * set->rayCount / set->packetAnySecs,
+                1e-6 * set->rayCount / set->parallelPacketSecs);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runBlur(int argc, char** argv) {
+    BlurBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--radii") && hasValue) desc.radii = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--grade") && hasValue) desc.blurGrade = (float)std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--count") && hasValue) desc.blurCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--reference")) desc.useReference = true;
+        else {
+            fprintf(stderr, "Unknown option of blur benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runBlurBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Blur check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%u threads, %d blur pass(es) per run\n", report.threadCount, desc.blurCount);
+    printf("%-10s %-8s %7s %10s %12s %12s %18s\n", "image", "format", "radius", "ms", "Mpixels/s", "ref Mpix/s", "checksum");
+    for (auto& r : report.results) {
+        char image[32];
+        snprintf(image, sizeof(image), "%ux%u", r.width, r.height);
+        double pixelCount = (double)r.width * r.height * desc.blurCount;
+        printf("%-10s %-8s %7d %10.2f %12.2f %12.2f %016llx\n", image,
+            r.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? "rgba32f" : "rgba8", r.radius, r.secs * 1e3,
+            pixelCount * 1e-6 / r.secs, r.referenceSecs > 0.0 ? pixelCount * 1e-6 / r.referenceSecs : 0.0,
+            (unsigned long long)r.checksum);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runBoxBlur(int argc, char** argv) {
+    BoxBlurBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--radii") && hasValue) desc.radii = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--float")) desc.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        else if (!strcmp(argv[i], "--min-psnr") && hasValue) desc.minPsnr = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of box-blur benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runBoxBlurBenchmark(desc);
+    printf("%u threads, %ux%u %s\n", report.threadCount, report.width, report.height,
+        desc.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? "rgba32f" : "rgba8");
+    printf("%7s %8s %14s %12s %12s %12s %12s %10s\n", "radius", "sigma", "box radii", "direct(ms)", "box(ms)",
+        "direct Mpx/s", "box Mpx/s", "PSNR(dB)");
+    for (auto& r : report.results) {
+        char boxRadii[32];
+        snprintf(boxRadii, sizeof(boxRadii), "%d,%d,%d", r.boxRadii[0], r.boxRadii[1], r.boxRadii[2]);
+        double pixelCount = (double)report.width * report.height;
+        printf("%7d %8.2f %14s %12.2f %12.2f %12.2f %12.2f %10.2f\n", r.radius, r.sigma, boxRadii, r.directSecs * 1e3,
+            r.boxSecs * 1e3, pixelCount * 1e-6 / r.directSecs, pixelCount * 1e-6 / r.boxSecs, r.psnr);
+    }
+    if (!report.isValid) {
+        fprintf(stderr, "Box blur check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runBilateral(int argc, char** argv) {
+    BilateralBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--radii") && hasValue) desc.radii = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--distance-grade") && hasValue) desc.distanceGrade = (float)std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--gray-grade") && hasValue) desc.grayGrade = (float)std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--float")) desc.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        else if (!strcmp(argv[i], "--min-psnr") && hasValue) desc.minPsnr = std::atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of bilateral benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runBilateralBenchmark(desc);
+    printf("%u threads, %ux%u %s\n", report.threadCount, report.width, report.height,
+        desc.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? "rgba32f" : "rgba8");
+    printf("%7s %14s %12s %12s %12s %12s %10s\n", "radius", "grid", "brute(ms)", "grid(ms)",
+        "brute Mpx/s", "grid Mpx/s", "PSNR(dB)");
+    for (auto& r : report.results) {
+        char grid[32];
+        snprintf(grid, sizeof(grid), "%ux%ux%u", r.gridWidth, r.gridHeight, r.gridDepth);
+        double pixelCount = (double)report.width * report.height;
+        printf("%7d %14s %12.2f %12.2f %12.2f %12.2f %10.2f\n", r.radius, grid, r.bruteForceSecs * 1e3,
+            r.gridSecs * 1e3, pixelCount * 1e-6 / r.bruteForceSecs, pixelCount * 1e-6 / r.gridSecs, r.psnr);
+    }
+    if (!report.isValid) {
+        fprintf(stderr, "Bilateral check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runSobel(int argc, char** argv) {
+    SobelBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--white-on-black")) desc.isWhiteOnBlack = true;
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--reference")) desc.useReference = true;
+        else {
+            fprintf(stderr, "Unknown option of sobel benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runSobelBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Sobel check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("%u threads, %s\n", report.threadCount,
+        desc.isWhiteOnBlack ? "white on black" : "black on white");
+    printf("%-10s %-8s %10s %12s %12s %18s\n", "image", "format", "ms", "Mpixels/s", "ref Mpix/s", "checksum");
+    for (auto& r : report.results) {
+        char image[32];
+        snprintf(image, sizeof(image), "%ux%u", r.width, r.height);
+        double pixelCount = (double)r.width * r.height;
+        printf("%-10s %-8s %10.2f %12.2f %12.2f %016llx\n", image,
+            r.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? "rgba32f" : "rgba8", r.secs * 1e3,
+            pixelCount * 1e-6 / r.secs, r.referenceSecs > 0.0 ? pixelCount * 1e-6 / r.referenceSecs : 0.0,
+            (unsigned long long)r.checksum);
+    }
+    return EXIT_SUCCESS;
+}
+
+static int runPostProcessGraph(int argc, char** argv) {
+    PostProcessGraphBenchmarkDesc desc = {};
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--nodes") && hasValue) desc.nodeCounts = parseSizes(argv[++i]);
+        else if (!strcmp(argv[i], "--graphs") && hasValue) desc.graphCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && hasValue) desc.repeatCount = std::atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue) desc.seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "Unknown option of post-graph benchmark: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto report = runPostProcessGraphBenchmark(desc);
+    if (!report.isValid) {
+        fprintf(stderr, "Post-processing graph check failed: %s\n", report.errorMessage.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("The fixed graphs passed, the counts are averaged over %d random graphs\n", desc.graphCount);
+    printf("%8s %8s %10s %10s %8s %8s %8s %9s %12s %13s\n", "nodes", "passes", "transients", "textures",
+        "copies", "dead", "fused", "barriers", "compile(us)", "validate(us)");
+    for (auto& r : report.results) {
+        printf("%8u %8.1f %10.1f %10.1f %8.1f %8.1f %8.1f %9.1f %12.2f %13.2f\n", r.nodeCount, r.passCount,
+            r.transientResourceCount, r.transientTextureCount, r.droppedCopyCount, r.droppedNodeCount, r.fusedNodeCount,
+            r.barrierCount, r.compileSecs * 1e6, r.validateSecs * 1e6);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && !strcmp(argv[1], "wave")) return runWave(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "subdivide")) return runSubdivide(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "mesh-load")) return runMeshLoad(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "mesh-opt")) return runMeshOptimize(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "vertex-pack")) return runVertexPack(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "ring-alloc")) return runRingAlloc(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "free-list")) return runFreeList(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "draw-list")) return runDrawList(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "frame-cpu")) return runFrameCpu(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "obj-consts")) return runObjConsts(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "instancing")) return runInstancing(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "geo-dedup")) return runGeometryDedup(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "cull")) return runCulling(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "bvh")) return runBvh(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "ray-cast")) return runRayCast(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "blur")) return runBlur(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "box-blur")) return runBoxBlur(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "bilateral")) return runBilateral(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "sobel")) return runSobel(argc - 2, argv + 2);
+    if (argc >= 2 && !strcmp(argv[1], "post-graph")) return runPostProcessGraph(argc - 2, argv + 2);
+
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,41 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "bench-utils.h"
+
+// SplitMix64, which is tiny, fast and good enough to drive the random disturbances.
+static uint64_t nextBenchRandom(BenchRandom* rng) {
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void seedBenchRandom(uint64_t seed, BenchRandom* rng) {
+    rng->state = seed;
+}
+
+int benchRandint(int min, int max, BenchRandom* rng) {
+    uint64_t range = (uint64_t)((int64_t)max - min + 1);
+    return (int)(min + (int64_t)(nextBenchRandom(rng) % range));
+}
+
+float benchRandfloat(float min, float max, BenchRandom* rng) {
+    // Take the high 24 bits, which can be represented exactly by a float.
+    float r01 = (float)(nextBenchRandom(rng) >> 40) / (float)(1 << 24);
+    return r01 * (max - min) + min;
+}
+
+uint64_t fnv1a64(const void* data, size_t byteSize, uint64_t hash) {
+    auto bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < byteSize; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
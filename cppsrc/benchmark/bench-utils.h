@@ -0,0 +1,41 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+// Deterministic helpers shared by the headless benchmarks.
+// They do not depend on D3DCore or any Windows API, so the benchmarks can run on a GPU-less box.
+
+// Unlike rand() used by math-utils, the sequence only depends on the seed, and the results of
+// std::xxx_distribution are implementation-defined, so the numbers are mapped to ranges manually
+// to keep the replays identical on every platform.
+struct BenchRandom {
+    uint64_t state = 0;
+};
+
+void seedBenchRandom(uint64_t seed, BenchRandom* rng);
+
+// Uniform integer in [min, max].
+int benchRandint(int min, int max, BenchRandom* rng);
+
+// Uniform float in [min, max].
+float benchRandfloat(float min, float max, BenchRandom* rng);
+
+// 64-bit FNV-1a hash, which is used to dump the checksum of the final results.
+constexpr uint64_t FNV1A_64_INIT = 0xcbf29ce484222325ull;
+
+uint64_t fnv1a64(const void* data, size_t byteSize, uint64_t hash = FNV1A_64_INIT);
+
+using BenchClock = std::chrono::steady_clock;
+
+inline double secsBetween(BenchClock::time_point start, BenchClock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
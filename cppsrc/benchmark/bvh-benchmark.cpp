@@ -0,0 +1,248 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cfloat>
+
+#include "bench-utils.h"
+#include "bvh-benchmark.h"
+#include "utils/bvh-utils.h"
+#include "utils/culling-utils.h"
+#include "utils/thread-utils.h"
+
+namespace {
+
+constexpr float SCENE_HALF_SIZE = 500.0f;
+constexpr float SCENE_HALF_HEIGHT = 50.0f;
+
+XMFLOAT3 randomScenePoint(BenchRandom* rng) {
+    return { benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, rng),
+        benchRandfloat(-SCENE_HALF_HEIGHT, SCENE_HALF_HEIGHT, rng), benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, rng) };
+}
+
+// Same cameras as the cull benchmark except the far plane.
+XMMATRIX randomViewProj(float farZ, BenchRandom* rng) {
+    XMFLOAT3 eye = randomScenePoint(rng);
+    XMVECTOR target = XMVectorSet(benchRandfloat(-100.0f, 100.0f, rng), 0.0f, benchRandfloat(-100.0f, 100.0f, rng), 1.0f);
+    XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, farZ);
+    return view * proj;
+}
+
+struct Ray {
+    XMFLOAT3 origin = {}, dir = {};
+};
+
+struct OverlapQuery {
+    XMFLOAT3 center = {};
+    float radius = 0.0f; // Also the extents of the box query.
+};
+
+// Same arithmetic as the slab test of pickBvh, so the nearest distances must be equal.
+bool pickBruteForce(const BoundsSoA& bounds, const Ray& ray, float* pDist) {
+    float o[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    float invDir[3] = { 1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z };
+    bool isHit = false;
+    float nearestDist = FLT_MAX;
+    for (size_t i = 0; i < bounds.count; ++i) {
+        if (!(bounds.extentX[i] < FLT_MAX && bounds.extentY[i] < FLT_MAX && bounds.extentZ[i] < FLT_MAX)) continue;
+        float c[3] = { bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+        float e[3] = { bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+        float t0 = 0.0f, t1 = nearestDist;
+        for (int a = 0; a < 3; ++a) {
+            float tNear = ((c[a] - e[a]) - o[a]) * invDir[a];
+            float tFar = ((c[a] + e[a]) - o[a]) * invDir[a];
+            if (tNear > tFar) std::swap(tNear, tFar);
+            t0 = (std::max)(t0, tNear);
+            t1 = (std::min)(t1, tFar);
+        }
+        if (t0 <= t1 && (!isHit || t0 < nearestDist)) {
+            isHit = true;
+            nearestDist = t0;
+        }
+    }
+    *pDist = nearestDist;
+    return isHit;
+}
+
+void overlapBruteForce(const BoundsSoA& bounds, const OverlapQuery& query, bool isSphere, std::vector<UINT>* result) {
+    result->clear();
+    float q[3] = { query.center.x, query.center.y, query.center.z };
+    for (size_t i = 0; i < bounds.count; ++i) {
+        float c[3] = { bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+        float e[3] = { bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+        bool isOverlapped = true;
+        float distSq = 0.0f;
+        for (int a = 0; a < 3; ++a) {
+            float boxMin = c[a] - e[a], boxMax = c[a] + e[a];
+            if (isSphere) {
+                float gap = (std::max)((std::max)(boxMin - q[a], q[a] - boxMax), 0.0f);
+                distSq += gap * gap;
+            }
+            else if (boxMin > q[a] + query.radius || boxMax < q[a] - query.radius) isOverlapped = false;
+        }
+        if (isSphere ? distSq <= query.radius * query.radius : isOverlapped) result->push_back((UINT)i);
+    }
+}
+
+bool isSameIdxSet(std::vector<UINT> a, std::vector<UINT> b) {
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+// Time the queries of the tree, and check them as described in BvhBenchmarkDesc.
+bool runQueries(const BvhBenchmarkDesc& desc, const BoundsSoA& bounds, const Bvh& bvh, BenchRandom* rng,
+    BvhBenchmarkResult* result, std::string* errorMessage)
+{
+    std::vector<UINT> flatIdx(bounds.centerX.size()), bvhIdx(bounds.count);
+    for (int c = 0; c < desc.cameraCount; ++c) {
+        Frustum frustum;
+        extractFrustumPlanes(randomViewProj(desc.farZ, rng), &frustum);
+        auto t0 = BenchClock::now();
+        size_t flatCount = cullBoundsSoA(frustum, bounds, flatIdx.data());
+        auto t1 = BenchClock::now();
+        size_t bvhCount = cullBvh(bvh, frustum, bvhIdx.data());
+        auto t2 = BenchClock::now();
+        result->flatCullSecs += secsBetween(t0, t1) / desc.cameraCount;
+        result->bvhCullSecs += secsBetween(t1, t2) / desc.cameraCount;
+        result->visibleRatio += (double)bvhCount / bounds.count / desc.cameraCount;
+
+        if (!isSameIdxSet(std::vector<UINT>(flatIdx.begin(), flatIdx.begin() + flatCount),
+            std::vector<UINT>(bvhIdx.begin(), bvhIdx.begin() + bvhCount)))
+        {
+            *errorMessage = "camera " + std::to_string(c) + ": the visible boxes differ from the flat culling";
+            return false;
+        }
+    }
+
+    std::vector<Ray> rays(desc.rayCount);
+    for (auto& ray : rays) {
+        ray.origin = randomScenePoint(rng);
+        XMVECTOR dir = XMVectorSet(benchRandfloat(-1.0f, 1.0f, rng), benchRandfloat(-1.0f, 1.0f, rng), benchRandfloat(-1.0f, 1.0f, rng), 0.0f);
+        XMStoreFloat3(&ray.dir, XMVector3Normalize(dir));
+    }
+    std::vector<UINT> hitIdx(rays.size());
+    std::vector<float> hitDist(rays.size(), -1.0f);
+    size_t hitCount = 0;
+    auto t0 = BenchClock::now();
+    for (size_t i = 0; i < rays.size(); ++i) {
+        if (pickBvh(bvh, XMLoadFloat3(&rays[i].origin), XMLoadFloat3(&rays[i].dir), &hitIdx[i], &hitDist[i])) ++hitCount;
+    }
+    auto t1 = BenchClock::now();
+    result->raySecs = secsBetween(t0, t1) / (std::max)(desc.rayCount, 1);
+    result->rayHitRatio = (double)hitCount / (std::max)(desc.rayCount, 1);
+    for (int i = 0; i < (std::min)(desc.verifyCount, desc.rayCount); ++i) {
+        float dist;
+        bool isHit = pickBruteForce(bounds, rays[i], &dist);
+        // The ties (e.g. the origin inside several boxes) may be broken differently, so only the distances are compared.
+        if (isHit != (hitDist[i] >= 0.0f) || (isHit && dist != hitDist[i])) {
+            *errorMessage = "ray " + std::to_string(i) + ": the nearest hit differs from brute force";
+            return false;
+        }
+    }
+
+    std::vector<OverlapQuery> queries(desc.overlapCount);
+    for (auto& query : queries) {
+        query.center = randomScenePoint(rng);
+        query.radius = benchRandfloat(2.0f, 20.0f, rng);
+    }
+    std::vector<UINT> found = {}, expected = {};
+    for (int pass = 0; pass < 2; ++pass) {
+        bool isSphere = pass == 0;
+        auto start = BenchClock::now();
+        for (auto& query : queries) {
+            if (isSphere) queryBvhSphere(bvh, query.center, query.radius, &found);
+            else {
+                XMFLOAT3 boxMin = { query.center.x - query.radius, query.center.y - query.radius, query.center.z - query.radius };
+                XMFLOAT3 boxMax = { query.center.x + query.radius, query.center.y + query.radius, query.center.z + query.radius };
+                queryBvhBox(bvh, boxMin, boxMax, &found);
+            }
+        }
+        auto end = BenchClock::now();
+        (isSphere ? result->sphereSecs : result->boxSecs) = secsBetween(start, end) / (std::max)(desc.overlapCount, 1);
+
+        for (int i = 0; i < (std::min)(desc.verifyCount, desc.overlapCount); ++i) {
+            auto& query = queries[i];
+            if (isSphere) queryBvhSphere(bvh, query.center, query.radius, &found);
+            else {
+                XMFLOAT3 boxMin = { query.center.x - query.radius, query.center.y - query.radius, query.center.z - query.radius };
+                XMFLOAT3 boxMax = { query.center.x + query.radius, query.center.y + query.radius, query.center.z + query.radius };
+                queryBvhBox(bvh, boxMin, boxMax, &found);
+            }
+            overlapBruteForce(bounds, query, isSphere, &expected);
+            if (!isSameIdxSet(found, expected)) {
+                *errorMessage = std::string(isSphere ? "sphere" : "box") + " query " + std::to_string(i) + ": the boxes differ from brute force";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+BvhBenchmarkReport runBvhBenchmark(const BvhBenchmarkDesc& desc) {
+    BvhBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    if (desc.cameraCount <= 0 || desc.maxLeafSize == 0) {
+        report.errorMessage = "camera count and leaf size must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    for (uint32_t itemCount : desc.itemCounts) {
+        BoundsSoA bounds = {};
+        resizeBoundsSoA(itemCount, &bounds);
+        for (uint32_t i = 0; i < itemCount; ++i) {
+            XMFLOAT3 extents = { benchRandfloat(0.1f, 2.0f, &rng), benchRandfloat(0.1f, 2.0f, &rng), benchRandfloat(0.1f, 2.0f, &rng) };
+            setBoundsSoAEntry(i, randomScenePoint(&rng), extents, &bounds);
+        }
+
+        BvhBenchmarkResult result = {};
+        result.itemCount = itemCount;
+        Bvh bvh = {};
+        auto t0 = BenchClock::now();
+        buildBvh(bounds, desc.maxLeafSize, &bvh);
+        auto t1 = BenchClock::now();
+        result.buildSecs = secsBetween(t0, t1);
+        result.nodeCount = bvh.nodes.size();
+        result.sahCost = calcBvhSahCost(bvh);
+
+        BvhBenchmarkResult builtResult = result;
+        std::string errorMessage = {};
+        if (!runQueries(desc, bounds, bvh, &rng, &builtResult, &errorMessage)) {
+            report.errorMessage = std::to_string(itemCount) + " items after the build, " + errorMessage;
+            return report;
+        }
+
+        // Every box moves a little, as if the scene were animated for a frame.
+        for (uint32_t i = 0; i < itemCount; ++i) {
+            bounds.centerX[i] += benchRandfloat(-2.0f, 2.0f, &rng);
+            bounds.centerY[i] += benchRandfloat(-2.0f, 2.0f, &rng);
+            bounds.centerZ[i] += benchRandfloat(-2.0f, 2.0f, &rng);
+        }
+        auto t2 = BenchClock::now();
+        bool isRefit = refitBvh(bounds, &bvh);
+        auto t3 = BenchClock::now();
+        if (!isRefit) {
+            report.errorMessage = std::to_string(itemCount) + " items: the refit is rejected";
+            return report;
+        }
+        result.refitSecs = secsBetween(t2, t3);
+        result.refitSahCost = calcBvhSahCost(bvh);
+        if (!runQueries(desc, bounds, bvh, &rng, &result, &errorMessage)) {
+            report.errorMessage = std::to_string(itemCount) + " items after the refit, " + errorMessage;
+            return report;
+        }
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
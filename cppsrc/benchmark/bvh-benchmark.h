@@ -0,0 +1,55 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Build a BVH (See utils/bvh-utils.h) over random boxes scattered around the origin, refit it after every box
+// moves a little, and time the queries on both trees: the frustum culling against the flat cullBoundsSoA,
+// the ray picking and the sphere and box overlap queries. The frustum results must equal the flat culling,
+// and the first verifyCount rays and overlap queries are checked against brute force, otherwise an error is
+// reported.
+struct BvhBenchmarkDesc {
+    std::vector<uint32_t> itemCounts = { 100000, 300000, 1000000 };
+    uint32_t maxLeafSize = 4;
+    int cameraCount = 8;
+    float farZ = 1000.0f; // Far plane of the cameras, the scene is 1000 x 100 x 1000.
+    int rayCount = 100000;
+    int overlapCount = 10000;
+    int verifyCount = 100;
+    uint64_t seed = 0;
+};
+
+struct BvhBenchmarkResult {
+    uint32_t itemCount = 0;
+    size_t nodeCount = 0;
+    double buildSecs = 0.0;
+    double refitSecs = 0.0;
+    float sahCost = 0.0f; // After the build.
+    float refitSahCost = 0.0f; // After the refit.
+
+    // Per query, after the refit.
+    double flatCullSecs = 0.0;
+    double bvhCullSecs = 0.0;
+    double visibleRatio = 0.0;
+    double raySecs = 0.0;
+    double rayHitRatio = 0.0;
+    double sphereSecs = 0.0;
+    double boxSecs = 0.0;
+};
+
+struct BvhBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    std::vector<BvhBenchmarkResult> results = {};
+};
+
+BvhBenchmarkReport runBvhBenchmark(const BvhBenchmarkDesc& desc);
@@ -0,0 +1,99 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "bench-utils.h"
+#include "culling-benchmark.h"
+#include "utils/culling-utils.h"
+
+namespace {
+
+constexpr float SCENE_HALF_SIZE = 500.0f;
+
+// Same projection as updateCameraProjTrans with a 16:9 view.
+XMMATRIX randomViewProj(BenchRandom* rng) {
+    XMVECTOR eye = XMVectorSet(benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, rng),
+        benchRandfloat(-50.0f, 50.0f, rng), benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, rng), 1.0f);
+    XMVECTOR target = XMVectorSet(benchRandfloat(-100.0f, 100.0f, rng), 0.0f, benchRandfloat(-100.0f, 100.0f, rng), 1.0f);
+    XMMATRIX view = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+    return view * proj;
+}
+
+// Every box whose center is inside the clip volume intersects the frustum.
+bool checkCentersVisible(FXMMATRIX viewProj, const BoundsSoA& bounds, const std::vector<UINT32>& visibleIdx, size_t visibleCount) {
+    std::vector<bool> isVisible(bounds.count, false);
+    for (size_t i = 0; i < visibleCount; ++i) isVisible[visibleIdx[i]] = true;
+    for (size_t i = 0; i < bounds.count; ++i) {
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i], 1.0f), viewProj));
+        // A small margin keeps the rounding of the plane extraction out of the check.
+        float w = clip.w * 0.999f;
+        bool isCenterInside = clip.x >= -w && clip.x <= w && clip.y >= -w && clip.y <= w && clip.z >= 0.001f * clip.w && clip.z <= w;
+        if (isCenterInside && !isVisible[i]) return false;
+    }
+    return true;
+}
+
+}
+
+CullingBenchmarkReport runCullingBenchmark(const CullingBenchmarkDesc& desc) {
+    CullingBenchmarkReport report = {};
+    if (desc.cameraCount <= 0 || desc.repeatCount <= 0) {
+        report.errorMessage = "camera count and repeat count must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    for (uint32_t boxCount : desc.boxCounts) {
+        BoundsSoA bounds = {};
+        resizeBoundsSoA(boxCount, &bounds);
+        for (uint32_t i = 0; i < boxCount; ++i) {
+            XMFLOAT3 center = { benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, &rng),
+                benchRandfloat(-50.0f, 50.0f, &rng), benchRandfloat(-SCENE_HALF_SIZE, SCENE_HALF_SIZE, &rng) };
+            XMFLOAT3 extents = { benchRandfloat(0.1f, 5.0f, &rng), benchRandfloat(0.1f, 5.0f, &rng), benchRandfloat(0.1f, 5.0f, &rng) };
+            setBoundsSoAEntry(i, center, extents, &bounds);
+        }
+
+        CullingBenchmarkResult result = {};
+        result.boxCount = boxCount;
+        std::vector<UINT32> scalarIdx(bounds.centerX.size()), simdIdx(bounds.centerX.size());
+        for (int c = 0; c < desc.cameraCount; ++c) {
+            XMMATRIX viewProj = randomViewProj(&rng);
+            Frustum frustum;
+            extractFrustumPlanes(viewProj, &frustum);
+
+            size_t scalarCount = 0, simdCount = 0;
+            auto start = BenchClock::now();
+            for (int r = 0; r < desc.repeatCount; ++r) scalarCount = cullBoundsSoAScalar(frustum, bounds, scalarIdx.data());
+            auto mid = BenchClock::now();
+            for (int r = 0; r < desc.repeatCount; ++r) simdCount = cullBoundsSoA(frustum, bounds, simdIdx.data());
+            auto end = BenchClock::now();
+            result.scalarSecs += secsBetween(start, mid);
+            result.simdSecs += secsBetween(mid, end);
+            result.visibleRatio += (double)simdCount / boxCount;
+
+            if (simdCount != scalarCount || !std::equal(simdIdx.begin(), simdIdx.begin() + simdCount, scalarIdx.begin())) {
+                report.errorMessage = std::to_string(boxCount) + " boxes, camera " + std::to_string(c) +
+                    ": the visible lists differ from the scalar reference";
+                return report;
+            }
+            if (!checkCentersVisible(viewProj, bounds, simdIdx, simdCount)) {
+                report.errorMessage = std::to_string(boxCount) + " boxes, camera " + std::to_string(c) +
+                    ": a box with the center in the frustum is culled";
+                return report;
+            }
+        }
+        result.scalarSecs /= (double)desc.cameraCount * desc.repeatCount;
+        result.simdSecs /= (double)desc.cameraCount * desc.repeatCount;
+        result.visibleRatio /= desc.cameraCount;
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
@@ -0,0 +1,38 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cull random boxes scattered around the origin against the frusta of cameras looking from random positions,
+// once with cullBoundsSoA (8 boxes per iteration) and once with the scalar reference cullBoundsSoAScalar.
+// The visible lists of both must be identical, and every box whose center projects into the clip volume must
+// be visible (the test is conservative), otherwise an error is reported.
+struct CullingBenchmarkDesc {
+    std::vector<uint32_t> boxCounts = { 10000, 100000, 1000000 };
+    int cameraCount = 8;
+    int repeatCount = 10;
+    uint64_t seed = 0;
+};
+
+struct CullingBenchmarkResult {
+    uint32_t boxCount = 0;
+    double scalarSecs = 0.0; // Per frustum.
+    double simdSecs = 0.0; // Per frustum.
+    double visibleRatio = 0.0; // Averaged over the cameras.
+};
+
+struct CullingBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<CullingBenchmarkResult> results = {};
+};
+
+CullingBenchmarkReport runCullingBenchmark(const CullingBenchmarkDesc& desc);
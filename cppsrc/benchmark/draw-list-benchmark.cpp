@@ -0,0 +1,233 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+#include "draw-list-benchmark.h"
+#include "utils/draw-list-utils.h"
+
+namespace {
+
+constexpr UINT OBJ_CONST_SEAT_SIZE = 256;
+constexpr D3D12_GPU_VIRTUAL_ADDRESS OBJ_CONST_BUFF_ADDR = 0x10000000;
+
+struct RecordedDraw {
+    D3D12_GPU_VIRTUAL_ADDRESS objConstBuffAddr = 0;
+    UINT indexCount = 0;
+    UINT startIndexLocation = 0;
+    INT baseVertexLocation = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS vertexBuffLocation = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS indexBuffLocation = 0;
+    ID3D12DescriptorHeap* descHeap = nullptr;
+
+    bool operator<(const RecordedDraw& other) const {
+        return std::tie(objConstBuffAddr, indexCount, startIndexLocation, baseVertexLocation, vertexBuffLocation, indexBuffLocation, descHeap) <
+            std::tie(other.objConstBuffAddr, other.indexCount, other.startIndexLocation, other.baseVertexLocation,
+                other.vertexBuffLocation, other.indexBuffLocation, other.descHeap);
+    }
+    bool operator!=(const RecordedDraw& other) const { return *this < other || other < *this; }
+};
+
+// Same methods as ID3D12GraphicsCommandList used by the draw loops. It keeps the bound states and records
+// them into every draw, which is about as cheap as writing the commands into a real command allocator.
+struct RecordingCmdList {
+    D3D12_GPU_VIRTUAL_ADDRESS vertexBuffLocation = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS indexBuffLocation = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS objConstBuffAddr = 0;
+    ID3D12DescriptorHeap* descHeap = nullptr;
+
+    uint64_t stateChangeCount = 0;
+    std::vector<RecordedDraw> draws = {};
+
+    void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW* views) {
+        vertexBuffLocation = views[0].BufferLocation;
+        ++stateChangeCount;
+    }
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+        indexBuffLocation = view->BufferLocation;
+        ++stateChangeCount;
+    }
+    void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY) {
+        ++stateChangeCount;
+    }
+    void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS addr) {
+        objConstBuffAddr = addr;
+    }
+    void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const* heaps) {
+        descHeap = heaps[0];
+        ++stateChangeCount;
+    }
+    void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) {}
+    void SetGraphicsRoot32BitConstant(UINT, UINT, UINT) {}
+    void DrawIndexedInstanced(UINT indexCount, UINT, UINT startIndexLocation, INT baseVertexLocation, UINT) {
+        draws.push_back({ objConstBuffAddr, indexCount, startIndexLocation, baseVertexLocation, vertexBuffLocation, indexBuffLocation, descHeap });
+    }
+};
+
+}
+
+// Same as drawRenderItemsInLayer and drawRenderItems in frame-async-utils.cpp, but with the stub.
+static void drawRenderItemsInLayerLegacy(RecordingCmdList* cmdList, const std::string& layerName,
+    RenderItem** ppRitem, UINT ritemCount, ID3D12DescriptorHeap* mainDescHeap)
+{
+    std::vector<UINT> seatIdxOffsetList;
+    for (UINT i = 0; i < ritemCount; ++i) {
+        seatIdxOffsetList.push_back(ppRitem[i]->boundLayerSeatOffsetTable[layerName]);
+    }
+    for (UINT i = 0; i < ritemCount; ++i) {
+        if (!ppRitem[i]->isVisible) continue;
+
+        UINT seatIdxOffset = seatIdxOffsetList[i];
+
+        Vmesh* targetMesh = ppRitem[i]->isDynamic ? ppRitem[i]->dynamicMesh : ppRitem[i]->mesh.get();
+        cmdList->IASetVertexBuffers(0, 1, &targetMesh->vertexBuffView);
+        cmdList->IASetIndexBuffer(&targetMesh->indexBuffView);
+        cmdList->IASetPrimitiveTopology(ppRitem[i]->topologyType);
+
+        UINT currSeatIdx = ppRitem[i]->objConstBuffStartIdx + seatIdxOffset;
+        cmdList->SetGraphicsRootConstantBufferView(0, OBJ_CONST_BUFF_ADDR + currSeatIdx * OBJ_CONST_SEAT_SIZE);
+
+        if (ppRitem[i]->displacementAndNormalMapDescHeap != nullptr) {
+            ID3D12DescriptorHeap* tmpDescHeaps[] = { ppRitem[i]->displacementAndNormalMapDescHeap };
+            cmdList->SetDescriptorHeaps(1, tmpDescHeaps);
+
+            if (ppRitem[i]->hasDisplacementMap) cmdList->SetGraphicsRootDescriptorTable(4, ppRitem[i]->displacementMapHandle);
+            if (ppRitem[i]->hasNormalMap) cmdList->SetGraphicsRootDescriptorTable(5, ppRitem[i]->normalMapHandle);
+
+            ID3D12DescriptorHeap* descHeaps[] = { mainDescHeap };
+            cmdList->SetDescriptorHeaps(1, descHeaps);
+        }
+
+        Vsubmesh ritemMain = ppRitem[i]->mesh->objects["main"];
+        cmdList->DrawIndexedInstanced(ritemMain.indexCount, 1, ritemMain.startIndexLocation, ritemMain.baseVertexLocation, 0);
+    }
+}
+
+void createRandomRenderItems(uint32_t itemCount, float pooledRatio, float descHeapRatio,
+    ID3D12DescriptorHeap* const* mapDescHeaps, int mapDescHeapCount, BenchRandom* rng,
+    std::vector<std::unique_ptr<RenderItem>>* ritems)
+{
+    ritems->resize(itemCount);
+    D3D12_GPU_VIRTUAL_ADDRESS nextBuffAddr = 0x100000000ull;
+    for (uint32_t i = 0; i < itemCount; ++i) {
+        auto ritem = std::make_unique<RenderItem>();
+        ritem->objConstBuffStartIdx = i * 2;
+        ritem->objConstBuffSeatCount = 2;
+        ritem->boundLayerSeatOffsetTable = { { "solid", 0 }, { "wireframe", 1 } };
+
+        ritem->mesh = std::make_unique<Vmesh>();
+        bool isPooled = benchRandfloat(0.0f, 1.0f, rng) < pooledRatio;
+        D3D12_GPU_VIRTUAL_ADDRESS vertexBuffAddr = isPooled ? 0x1000 : (nextBuffAddr += 0x10000);
+        D3D12_GPU_VIRTUAL_ADDRESS indexBuffAddr = isPooled ? 0x2000 : (nextBuffAddr += 0x10000);
+        ritem->mesh->vertexBuffView = { vertexBuffAddr, isPooled ? (1u << 24) : 0x10000u, (UINT)sizeof(Vertex) };
+        ritem->mesh->indexBuffView = { indexBuffAddr, isPooled ? (1u << 23) : 0x10000u, DXGI_FORMAT_R32_UINT };
+        Vsubmesh ritemMain = {};
+        ritemMain.indexCount = (UINT)benchRandint(36, 6000, rng);
+        ritemMain.startIndexLocation = isPooled ? (UINT)benchRandint(0, 1 << 20, rng) : 0;
+        ritemMain.baseVertexLocation = isPooled ? benchRandint(0, 1 << 18, rng) : 0;
+        ritem->mesh->objects["main"] = ritemMain;
+
+        if (benchRandfloat(0.0f, 1.0f, rng) < descHeapRatio) {
+            ritem->displacementAndNormalMapDescHeap = mapDescHeaps[benchRandint(0, mapDescHeapCount - 1, rng)];
+            ritem->hasDisplacementMap = ritem->hasNormalMap = 1;
+        }
+        ritem->isVisible = benchRandfloat(0.0f, 1.0f, rng) < 0.95f;
+
+        (*ritems)[i] = std::move(ritem);
+    }
+}
+
+DrawListBenchmarkReport runDrawListBenchmark(const DrawListBenchmarkDesc& desc) {
+    DrawListBenchmarkReport report = {};
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    // Only the addresses of the heaps are used.
+    ID3D12DescriptorHeap heaps[5] = {};
+    ID3D12DescriptorHeap* mainDescHeap = &heaps[0];
+    ID3D12DescriptorHeap* mapDescHeaps[] = { &heaps[1], &heaps[2], &heaps[3], &heaps[4] };
+    const std::string layerName = "solid";
+
+    for (uint32_t itemCount : desc.itemCounts) {
+        std::vector<std::unique_ptr<RenderItem>> ritems = {};
+        createRandomRenderItems(itemCount, desc.pooledRatio, desc.descHeapRatio, mapDescHeaps, _countof(mapDescHeaps), &rng, &ritems);
+        std::vector<RenderItem*> layer(itemCount);
+        for (uint32_t i = 0; i < itemCount; ++i) layer[i] = ritems[i].get();
+
+        DrawListBenchmarkResult result = {};
+        result.itemCount = itemCount;
+
+        RecordingCmdList legacyCmdList = {};
+        legacyCmdList.draws.reserve(itemCount);
+        auto start = BenchClock::now();
+        for (int r = 0; r < desc.repeatCount; ++r) {
+            legacyCmdList.draws.clear();
+            legacyCmdList.stateChangeCount = 0;
+            drawRenderItemsInLayerLegacy(&legacyCmdList, layerName, layer.data(), itemCount, mainDescHeap);
+        }
+        result.legacySecs = secsBetween(start, BenchClock::now()) / desc.repeatCount;
+        result.legacyStateChangeCount = legacyCmdList.stateChangeCount;
+
+        DrawList drawList = {};
+        start = BenchClock::now();
+        compileDrawList(layerName, layer.data(), layer.size(), OBJ_CONST_SEAT_SIZE, &drawList);
+        result.compileSecs = secsBetween(start, BenchClock::now());
+
+        RecordingCmdList compiledCmdList = {};
+        compiledCmdList.draws.reserve(itemCount);
+        start = BenchClock::now();
+        for (int r = 0; r < desc.repeatCount; ++r) {
+            compiledCmdList.draws.clear();
+            compiledCmdList.stateChangeCount = 0;
+            compiledCmdList.descHeap = mainDescHeap;
+            submitDrawList(&compiledCmdList, drawList, OBJ_CONST_BUFF_ADDR, mainDescHeap);
+        }
+        result.compiledSecs = secsBetween(start, BenchClock::now()) / desc.repeatCount;
+        result.compiledStateChangeCount = compiledCmdList.stateChangeCount;
+
+        // No heap is bound before the first render item with maps in the legacy loop.
+        for (auto& draw : legacyCmdList.draws) if (draw.descHeap == nullptr) draw.descHeap = mainDescHeap;
+
+        // A blended layer must be drawn in the order of the render items, i.e. the same as the legacy loop.
+        DrawList blendedDrawList = {};
+        compileDrawList("alpha", layer.data(), layer.size(), OBJ_CONST_SEAT_SIZE, &blendedDrawList);
+        RecordingCmdList blendedCmdList = {};
+        blendedCmdList.descHeap = mainDescHeap;
+        submitDrawList(&blendedCmdList, blendedDrawList, OBJ_CONST_BUFF_ADDR, mainDescHeap);
+        if (blendedCmdList.draws.size() != legacyCmdList.draws.size() ||
+            !std::equal(blendedCmdList.draws.begin(), blendedCmdList.draws.end(), legacyCmdList.draws.begin(),
+                [](const RecordedDraw& a, const RecordedDraw& b) { return !(a != b); }))
+        {
+            report.errorMessage = std::to_string(itemCount) + " items: the blended layer is not drawn in the order of the items";
+            return report;
+        }
+
+        std::sort(legacyCmdList.draws.begin(), legacyCmdList.draws.end());
+        std::sort(compiledCmdList.draws.begin(), compiledCmdList.draws.end());
+        if (legacyCmdList.draws.size() != compiledCmdList.draws.size()) {
+            report.errorMessage = std::to_string(itemCount) + " items: " + std::to_string(compiledCmdList.draws.size()) +
+                " draws recorded, expected " + std::to_string(legacyCmdList.draws.size());
+            return report;
+        }
+        for (size_t k = 0; k < legacyCmdList.draws.size(); ++k) {
+            if (legacyCmdList.draws[k] != compiledCmdList.draws[k]) {
+                report.errorMessage = std::to_string(itemCount) + " items: draw " + std::to_string(k) + " differs from the legacy loop";
+                return report;
+            }
+        }
+        if (compiledCmdList.descHeap != mainDescHeap) {
+            report.errorMessage = std::to_string(itemCount) + " items: the main descriptor heap is not bound at last";
+            return report;
+        }
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
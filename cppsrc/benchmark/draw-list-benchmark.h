@@ -0,0 +1,52 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <d3d12.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench-utils.h"
+#include "d3dcore/frame-async.h"
+
+// Draw a layer of random render items with a recording stub of the command list, once through the draw loop
+// of drawRenderItemsInLayer (per-item hash lookups and bindings) and once through the compiled draw list
+// (see utils/draw-list-utils.h). The draws recorded by both paths are compared (object constants, index
+// range and the bound buffers and heap of every draw), so a wrong state skip is reported as an error.
+struct DrawListBenchmarkDesc {
+    std::vector<uint32_t> itemCounts = { 10000, 30000, 100000 };
+    float pooledRatio = 0.9f; // Ratio of the meshes in the shared geometry pool, the others have their own buffers.
+    float descHeapRatio = 0.01f; // Ratio of the render items with displacement and normal maps.
+    int repeatCount = 20;
+    uint64_t seed = 0;
+};
+
+struct DrawListBenchmarkResult {
+    uint32_t itemCount = 0;
+    double legacySecs = 0.0; // Per frame.
+    double compileSecs = 0.0;
+    double compiledSecs = 0.0; // Per frame.
+    uint64_t legacyStateChangeCount = 0; // Vertex/index buffers, topologies and descriptor heaps set per frame.
+    uint64_t compiledStateChangeCount = 0;
+};
+
+struct DrawListBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<DrawListBenchmarkResult> results = {};
+};
+
+DrawListBenchmarkReport runDrawListBenchmark(const DrawListBenchmarkDesc& desc);
+
+// Random render items of the benchmark, which are bound to the layers "solid" and "wireframe". The render items
+// with maps use one of mapDescHeaps, and only the addresses of the heaps and buffers are meaningful.
+void createRandomRenderItems(uint32_t itemCount, float pooledRatio, float descHeapRatio,
+    ID3D12DescriptorHeap* const* mapDescHeaps, int mapDescHeapCount, BenchRandom* rng,
+    std::vector<std::unique_ptr<RenderItem>>* ritems);
@@ -0,0 +1,258 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <memory>
+
+#include "bench-utils.h"
+#include "draw-list-benchmark.h"
+#include "frame-cpu-benchmark.h"
+#include "utils/cmd-stream-recorder.h"
+#include "utils/draw-list-utils.h"
+
+namespace {
+
+constexpr UINT OBJ_CONST_SEAT_SIZE = 256;
+constexpr UINT WAVE_GRID_SIZE = 256;
+constexpr UINT TEX_WIDTH = 1280, TEX_HEIGHT = 720;
+
+// Only the addresses of the objects are recorded, so they are never created by any device.
+struct FrameObjects {
+    ID3D12DescriptorHeap descHeaps[6] = {}; // Main, wave simulator, Sobel operator and the maps of the render items.
+    ID3D12RootSignature rootSigs[3] = {}; // Main, wave simulator and Sobel operator.
+    ID3D12PipelineState PSOs[6] = {}; // Solid, wireframe, disturb wave, calc displacement, calc normal and Sobel operator.
+    ID3D12Resource resources[8] = {}; // MSAA back buffer, back buffer, resolved, crests (prev, curr, next) and Sobel A, B.
+
+    D3D12_GPU_VIRTUAL_ADDRESS objConstBuffAddr = 0x10000000;
+    D3D12_GPU_VIRTUAL_ADDRESS procConstBuffAddr = 0x20000000;
+    D3D12_GPU_VIRTUAL_ADDRESS matStructBuffAddr = 0x30000000;
+
+    DrawList solidDrawList = {};
+    DrawList wireframeDrawList = {};
+};
+
+D3D12_RESOURCE_BARRIER transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource = resource;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter = after;
+    return barrier;
+}
+
+// Same as copyStatedResource in d3dcore.cpp.
+void copyStatedResource(CmdRecorder* recorder,
+    ID3D12Resource* dest, D3D12_RESOURCE_STATES destState,
+    ID3D12Resource* src, D3D12_RESOURCE_STATES srcState)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier = transition(src, srcState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    recorder->ResourceBarrier(1, &barrier);
+    barrier = transition(dest, destState, D3D12_RESOURCE_STATE_COPY_DEST);
+    recorder->ResourceBarrier(1, &barrier);
+
+    recorder->CopyResource(dest, src);
+
+    barrier = transition(src, D3D12_RESOURCE_STATE_COPY_SOURCE, srcState);
+    recorder->ResourceBarrier(1, &barrier);
+    barrier = transition(dest, D3D12_RESOURCE_STATE_COPY_DEST, destState);
+    recorder->ResourceBarrier(1, &barrier);
+}
+
+// Same commands as WaveSimulator::updateWithComputeShaderOptimized when both the disturb and the update are due.
+void recordWaveUpdate(CmdRecorder* recorder, FrameObjects* objs) {
+    recorder->SetComputeRootSignature(&objs->rootSigs[1]);
+    ID3D12DescriptorHeap* descHeaps[] = { &objs->descHeaps[1] };
+    recorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    recorder->SetComputeRootDescriptorTable(2, { 0x1001 });
+
+    float h = 0.5f;
+    int x = WAVE_GRID_SIZE / 2, y = WAVE_GRID_SIZE / 3;
+    recorder->SetComputeRoot32BitConstants(0, 1, &h, 4);
+    recorder->SetComputeRoot32BitConstants(0, 1, &x, 7);
+    recorder->SetComputeRoot32BitConstants(0, 1, &y, 8);
+    recorder->SetPipelineState(&objs->PSOs[2]);
+    recorder->Dispatch(1, 1, 1);
+
+    float coefficients[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    for (UINT i = 0; i < 4; ++i) recorder->SetComputeRoot32BitConstants(0, 1, &coefficients[i], i);
+    UINT gridSize = WAVE_GRID_SIZE;
+    recorder->SetComputeRoot32BitConstants(0, 1, &gridSize, 5);
+    recorder->SetComputeRoot32BitConstants(0, 1, &gridSize, 6);
+    recorder->SetComputeRootDescriptorTable(1, { 0x1000 });
+    recorder->SetComputeRootDescriptorTable(3, { 0x1002 });
+    recorder->SetComputeRootDescriptorTable(4, { 0x1003 });
+    recorder->SetComputeRootDescriptorTable(5, { 0x1004 });
+
+    UINT groupCount = (WAVE_GRID_SIZE + 31) / 32;
+    recorder->SetPipelineState(&objs->PSOs[3]);
+    recorder->Dispatch(groupCount, groupCount, 1);
+    recorder->SetPipelineState(&objs->PSOs[4]);
+    recorder->Dispatch(groupCount, groupCount, 1);
+
+    copyStatedResource(recorder, &objs->resources[3], D3D12_RESOURCE_STATE_GENERIC_READ,
+        &objs->resources[4], D3D12_RESOURCE_STATE_GENERIC_READ);
+    copyStatedResource(recorder, &objs->resources[4], D3D12_RESOURCE_STATE_GENERIC_READ,
+        &objs->resources[5], D3D12_RESOURCE_STATE_GENERIC_READ);
+}
+
+// Same commands as SobelOperator::process.
+void recordSobelPass(CmdRecorder* recorder, FrameObjects* objs, ID3D12Resource* flatOrigin) {
+    ID3D12DescriptorHeap* descHeaps[] = { &objs->descHeaps[2] };
+    recorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    recorder->SetComputeRootSignature(&objs->rootSigs[2]);
+
+    ID3D12Resource* texA = &objs->resources[6];
+    ID3D12Resource* texB = &objs->resources[7];
+    D3D12_RESOURCE_BARRIER barriers[] = {
+        transition(flatOrigin, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        transition(texA, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+        transition(flatOrigin, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+        transition(texA, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ),
+        transition(texB, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        transition(texA, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COMMON),
+        transition(texB, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON)
+    };
+    recorder->ResourceBarrier(1, &barriers[0]);
+    recorder->ResourceBarrier(1, &barriers[1]);
+    recorder->CopyResource(texA, flatOrigin);
+    for (int i = 2; i < 5; ++i) recorder->ResourceBarrier(1, &barriers[i]);
+
+    recorder->SetPipelineState(&objs->PSOs[5]);
+    recorder->SetComputeRootDescriptorTable(0, { 0x2000 });
+    recorder->SetComputeRootDescriptorTable(1, { 0x2001 });
+    recorder->SetComputeRoot32BitConstant(2, 0, 0);
+    recorder->Dispatch((TEX_WIDTH + 31) / 32, (TEX_HEIGHT + 31) / 32, 1);
+
+    recorder->ResourceBarrier(1, &barriers[5]);
+    recorder->ResourceBarrier(1, &barriers[6]);
+}
+
+// Same commands as dev_drawCoreElems with the key '4' down, i.e. the Sobel operator enabled.
+void recordFrame(CmdRecorder* recorder, FrameObjects* objs, int postPassCount) {
+    D3D12_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)TEX_WIDTH, (FLOAT)TEX_HEIGHT, 0.0f, 1.0f };
+    D3D12_RECT scissorRect = { 0, 0, (long)TEX_WIDTH, (long)TEX_HEIGHT };
+    recorder->RSSetViewports(1, &viewport);
+    recorder->RSSetScissorRects(1, &scissorRect);
+
+    ID3D12DescriptorHeap* mainDescHeap = &objs->descHeaps[0];
+    recorder->SetDescriptorHeaps(1, &mainDescHeap);
+    recorder->SetGraphicsRootSignature(&objs->rootSigs[0]);
+    recorder->SetGraphicsRootConstantBufferView(1, objs->procConstBuffAddr);
+    recorder->SetGraphicsRootShaderResourceView(2, objs->matStructBuffAddr);
+    recorder->SetGraphicsRootDescriptorTable(3, { 0x100 });
+
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = { 0x200 }, dsvHandle = { 0x300 };
+    recorder->OMSetRenderTargets(1, &rtvHandle, TRUE, &dsvHandle);
+    const FLOAT clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    recorder->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+    recorder->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+
+    recorder->SetPipelineState(&objs->PSOs[0]);
+    submitDrawList(recorder, objs->solidDrawList, objs->objConstBuffAddr, mainDescHeap);
+    recorder->SetPipelineState(&objs->PSOs[1]);
+    submitDrawList(recorder, objs->wireframeDrawList, objs->objConstBuffAddr, mainDescHeap);
+
+    recordWaveUpdate(recorder, objs);
+
+    // Same commands as BasicProcess::process.
+    ID3D12Resource* msaaBackBuff = &objs->resources[0];
+    ID3D12Resource* resolved = &objs->resources[2];
+    D3D12_RESOURCE_BARRIER barriers[] = {
+        transition(msaaBackBuff, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE),
+        transition(resolved, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RESOLVE_DEST),
+        transition(msaaBackBuff, D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
+        transition(resolved, D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_COMMON)
+    };
+    recorder->ResourceBarrier(1, &barriers[0]);
+    recorder->ResourceBarrier(1, &barriers[1]);
+    recorder->ResolveSubresource(resolved, 0, msaaBackBuff, 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+    recorder->ResourceBarrier(1, &barriers[2]);
+    recorder->ResourceBarrier(1, &barriers[3]);
+
+    ID3D12Resource* processedOutput = resolved;
+    for (int i = 0; i < postPassCount; ++i) {
+        recordSobelPass(recorder, objs, processedOutput);
+        processedOutput = &objs->resources[7];
+    }
+
+    copyStatedResource(recorder, &objs->resources[1], D3D12_RESOURCE_STATE_PRESENT,
+        processedOutput, D3D12_RESOURCE_STATE_COMMON);
+
+    // Unbind the mesh buffers, so the replay is also checked with the null views.
+    recorder->IASetVertexBuffers(0, 1, nullptr);
+    recorder->IASetIndexBuffer(nullptr);
+}
+
+}
+
+FrameCpuBenchmarkReport runFrameCpuBenchmark(const FrameCpuBenchmarkDesc& desc) {
+    FrameCpuBenchmarkReport report = {};
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    auto objs = std::make_unique<FrameObjects>();
+    ID3D12DescriptorHeap* mapDescHeaps[] = { &objs->descHeaps[1], &objs->descHeaps[3], &objs->descHeaps[4], &objs->descHeaps[5] };
+
+    for (uint32_t itemCount : desc.itemCounts) {
+        std::vector<std::unique_ptr<RenderItem>> ritems = {};
+        createRandomRenderItems(itemCount, desc.pooledRatio, desc.descHeapRatio, mapDescHeaps, _countof(mapDescHeaps), &rng, &ritems);
+        // Every render item is solid, and every 10th one is also drawn in wireframe.
+        std::vector<RenderItem*> solidLayer = {}, wireframeLayer = {};
+        for (uint32_t i = 0; i < itemCount; ++i) {
+            solidLayer.push_back(ritems[i].get());
+            if (i % 10 == 0) wireframeLayer.push_back(ritems[i].get());
+        }
+        compileDrawList("solid", solidLayer.data(), solidLayer.size(), OBJ_CONST_SEAT_SIZE, &objs->solidDrawList);
+        compileDrawList("wireframe", wireframeLayer.data(), wireframeLayer.size(), OBJ_CONST_SEAT_SIZE, &objs->wireframeDrawList);
+
+        FrameCpuBenchmarkResult result = {};
+        result.itemCount = itemCount;
+
+        // Record one frame first, so the stream is large enough for the timed frames.
+        CmdStreamRecorder recorder = {};
+        recordFrame(&recorder, objs.get(), desc.postPassCount);
+        result.streamHash = recorder.hash();
+        result.streamByteSize = recorder.byteSize();
+
+        auto start = BenchClock::now();
+        for (int f = 0; f < desc.frameCount; ++f) {
+            recorder.reset();
+            recordFrame(&recorder, objs.get(), desc.postPassCount);
+        }
+        result.recordSecs = secsBetween(start, BenchClock::now()) / desc.frameCount;
+        if (recorder.hash() != result.streamHash || recorder.byteSize() != result.streamByteSize) {
+            report.errorMessage = std::to_string(itemCount) + " items: the frames are recorded differently";
+            return report;
+        }
+
+        CmdStreamRecorder replayRecorder(recorder.byteSize());
+        start = BenchClock::now();
+        for (int f = 0; f < desc.frameCount; ++f) {
+            replayRecorder.reset();
+            recorder.replay(&replayRecorder);
+        }
+        result.replaySecs = secsBetween(start, BenchClock::now()) / desc.frameCount;
+        if (replayRecorder.hash() != result.streamHash || replayRecorder.byteSize() != result.streamByteSize) {
+            report.errorMessage = std::to_string(itemCount) + " items: the replayed frame differs from the recorded one";
+            return report;
+        }
+
+        auto& stats = recorder.stats();
+        result.cmdCount = stats.cmdCount;
+        result.stateChangeCount = stats.stateChangeCount;
+        result.rootBindingCount = stats.rootBindingCount;
+        result.drawCount = stats.drawCount;
+        result.dispatchCount = stats.dispatchCount;
+        result.barrierCount = stats.barrierCount;
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
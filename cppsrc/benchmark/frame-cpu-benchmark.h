@@ -0,0 +1,52 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Record frames of random render items into CmdStreamRecorder (see utils/cmd-stream-recorder.h) to measure
+// the CPU cost of a frame without any device. A frame has the same commands as dev_drawCoreElems: the global
+// bindings, the layers "solid" and "wireframe" drawn with the compiled draw lists (see utils/draw-list-utils.h),
+// a wave simulator update, the MSAA resolve, the Sobel passes and the final copy to the back buffer.
+//
+// Every frame must give the same stream, and replaying it into another recorder must give the same stream
+// again, otherwise the benchmark fails.
+struct FrameCpuBenchmarkDesc {
+    std::vector<uint32_t> itemCounts = { 1000, 10000, 100000 };
+    float pooledRatio = 0.9f; // Same as DrawListBenchmarkDesc.
+    float descHeapRatio = 0.01f;
+    int postPassCount = 1; // Sobel passes after the resolve.
+    int frameCount = 100;
+    uint64_t seed = 0;
+};
+
+struct FrameCpuBenchmarkResult {
+    uint32_t itemCount = 0;
+    double recordSecs = 0.0; // Per frame.
+    double replaySecs = 0.0; // Per frame.
+    uint64_t streamByteSize = 0; // Per frame.
+    // Per frame, see CmdStreamRecorder::Stats.
+    uint64_t cmdCount = 0;
+    uint64_t stateChangeCount = 0;
+    uint64_t rootBindingCount = 0;
+    uint64_t drawCount = 0;
+    uint64_t dispatchCount = 0;
+    uint64_t barrierCount = 0;
+    // The pointers are recorded, so the hash is only comparable within one run.
+    uint64_t streamHash = 0;
+};
+
+struct FrameCpuBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<FrameCpuBenchmarkResult> results = {};
+};
+
+FrameCpuBenchmarkReport runFrameCpuBenchmark(const FrameCpuBenchmarkDesc& desc);
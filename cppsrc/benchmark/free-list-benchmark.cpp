@@ -0,0 +1,140 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "bench-utils.h"
+#include "free-list-benchmark.h"
+#include "utils/free-list-allocator.h"
+
+namespace {
+
+struct LiveMesh {
+    uint64_t vertexOffset = 0;
+    uint64_t vertexCount = 0;
+    uint64_t indexOffset = 0;
+    uint64_t indexCount = 0;
+};
+
+}
+
+// Return an empty string if the region does not break any rule, otherwise the error message.
+static std::string checkRegion(const std::map<uint64_t, uint64_t>& live,
+    uint64_t offset, uint64_t size, uint64_t capacity, const char* name)
+{
+    auto describe = [&](uint64_t o, uint64_t s) {
+        return std::string(name) + " [" + std::to_string(o) + ", " + std::to_string(o + s) + ")";
+    };
+    if (offset + size > capacity) return describe(offset, size) + " out of bound";
+    auto next = live.lower_bound(offset);
+    if (next != live.end() && next->first < offset + size) {
+        return describe(offset, size) + " overlaps " + describe(next->first, next->second);
+    }
+    if (next != live.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second > offset) return describe(offset, size) + " overlaps " + describe(prev->first, prev->second);
+    }
+    return "";
+}
+
+FreeListBenchmarkReport runFreeListBenchmark(const FreeListBenchmarkDesc& desc) {
+    FreeListBenchmarkReport report = {};
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    FreeListAllocator vertexAllocator(desc.vertexCapacity);
+    FreeListAllocator indexAllocator(desc.indexCapacity);
+    std::vector<LiveMesh> meshes = {};
+    // Keyed by the offsets, and mapped to the sizes.
+    std::map<uint64_t, uint64_t> liveVertices = {}, liveIndices = {};
+    uint64_t liveVertexCount = 0, liveIndexCount = 0;
+    double fillRatioSumAtFail = 0.0;
+
+    auto start = BenchClock::now();
+    for (uint32_t op = 0; op < desc.opCount; ++op) {
+        // Stream out more often when the pool is fuller, which keeps the pool about half full.
+        double fillRatio = (double)liveVertexCount / desc.vertexCapacity;
+        bool isStreamOut = !meshes.empty() && benchRandfloat(0.0f, 1.0f, &rng) < fillRatio;
+
+        if (isStreamOut) {
+            size_t k = (size_t)benchRandint(0, (int)meshes.size() - 1, &rng);
+            LiveMesh mesh = meshes[k];
+            meshes[k] = meshes.back();
+            meshes.pop_back();
+
+            vertexAllocator.free(mesh.vertexOffset, mesh.vertexCount);
+            indexAllocator.free(mesh.indexOffset, mesh.indexCount);
+            liveVertices.erase(mesh.vertexOffset);
+            liveIndices.erase(mesh.indexOffset);
+            liveVertexCount -= mesh.vertexCount;
+            liveIndexCount -= mesh.indexCount;
+            ++report.freeCount;
+        }
+        else {
+            LiveMesh mesh = {};
+            mesh.vertexCount = (uint64_t)benchRandint(3, (int)desc.maxMeshVertexCount, &rng);
+            mesh.indexCount = mesh.vertexCount * (uint64_t)benchRandint(1, 6, &rng);
+
+            // Same as the geometry pool: the vertex region is given back if the index region does not fit.
+            mesh.vertexOffset = vertexAllocator.allocate(mesh.vertexCount);
+            mesh.indexOffset = FreeListAllocator::INVALID_OFFSET;
+            if (mesh.vertexOffset != FreeListAllocator::INVALID_OFFSET) {
+                mesh.indexOffset = indexAllocator.allocate(mesh.indexCount);
+                if (mesh.indexOffset == FreeListAllocator::INVALID_OFFSET) {
+                    vertexAllocator.free(mesh.vertexOffset, mesh.vertexCount);
+                }
+            }
+            if (mesh.indexOffset == FreeListAllocator::INVALID_OFFSET) {
+                ++report.failCount;
+                fillRatioSumAtFail += fillRatio;
+            }
+            else {
+                std::string error = checkRegion(liveVertices, mesh.vertexOffset, mesh.vertexCount, desc.vertexCapacity, "vertices");
+                if (error.empty()) error = checkRegion(liveIndices, mesh.indexOffset, mesh.indexCount, desc.indexCapacity, "indices");
+                if (!error.empty()) {
+                    report.errorMessage = "op " + std::to_string(op) + ": " + error;
+                    return report;
+                }
+                liveVertices[mesh.vertexOffset] = mesh.vertexCount;
+                liveIndices[mesh.indexOffset] = mesh.indexCount;
+                liveVertexCount += mesh.vertexCount;
+                liveIndexCount += mesh.indexCount;
+                meshes.push_back(mesh);
+                ++report.allocCount;
+            }
+        }
+
+        if (vertexAllocator.freeSize() + liveVertexCount != desc.vertexCapacity ||
+            indexAllocator.freeSize() + liveIndexCount != desc.indexCapacity)
+        {
+            report.errorMessage = "op " + std::to_string(op) + ": free sizes do not match the live regions";
+            return report;
+        }
+        report.maxFreeBlockCount = (std::max)(report.maxFreeBlockCount, vertexAllocator.freeBlockCount());
+    }
+
+    for (auto& mesh : meshes) {
+        vertexAllocator.free(mesh.vertexOffset, mesh.vertexCount);
+        indexAllocator.free(mesh.indexOffset, mesh.indexCount);
+    }
+    report.secs = secsBetween(start, BenchClock::now());
+
+    // All free blocks must be merged back into one.
+    if (vertexAllocator.freeBlockCount() != 1 || vertexAllocator.largestFreeBlockSize() != desc.vertexCapacity ||
+        indexAllocator.freeBlockCount() != 1 || indexAllocator.largestFreeBlockSize() != desc.indexCapacity)
+    {
+        report.errorMessage = "free blocks are not merged after all meshes are freed";
+        return report;
+    }
+    report.avgFillRatioAtFail = report.failCount > 0 ? fillRatioSumAtFail / report.failCount : 0.0;
+    report.isValid = true;
+    return report;
+}
@@ -0,0 +1,36 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Stream random meshes in and out of a pair of FreeListAllocator (see utils/free-list-allocator.h), i.e.
+// the vertex and index allocators of the geometry pool. Every region is checked against the live ones
+// (bounds and overlap) and the free sizes are checked after every operation, so any broken offset math
+// or block merging is reported as an error.
+struct FreeListBenchmarkDesc {
+    uint64_t vertexCapacity = 1ull << 19;
+    uint64_t indexCapacity = 1ull << 21;
+    uint32_t opCount = 1000000;
+    uint32_t maxMeshVertexCount = 8192;
+    uint64_t seed = 0;
+};
+
+struct FreeListBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    uint64_t allocCount = 0;
+    uint64_t freeCount = 0;
+    uint64_t failCount = 0; // Meshes which do not fit into the pool.
+    double avgFillRatioAtFail = 0.0; // Allocated vertices / vertex capacity when a mesh does not fit.
+    size_t maxFreeBlockCount = 0;
+    double secs = 0.0;
+};
+
+FreeListBenchmarkReport runFreeListBenchmark(const FreeListBenchmarkDesc& desc);
@@ -0,0 +1,169 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "bench-utils.h"
+#include "geometry-dedup-benchmark.h"
+#include "utils/geometry-dedup-utils.h"
+
+namespace {
+
+// One render item of the demo scene built with initRitemWithDedupGeoInfo, i.e. the arguments of createCubeObject.
+// The pillars, the balls (instanced) and the skull (packed) have meshes of their own and are not looked up.
+struct SceneObject {
+    XMFLOAT3 pos = {};
+    XMFLOAT3 xyz = {};
+};
+
+// Same as createCubeObject, i.e. a unit cube sized and moved by the world matrix.
+void generateAtOrigin(ObjectGeometry* geo) {
+    generateCube({ 1.0f, 1.0f, 1.0f }, geo);
+}
+
+XMMATRIX calcWorldTrans(const SceneObject& obj) {
+    return XMMatrixScaling(obj.xyz.x, obj.xyz.y, obj.xyz.z) * XMMatrixTranslation(obj.pos.x, obj.pos.y, obj.pos.z);
+}
+
+// Same as createCubeObject before the dedup, i.e. the size and the translation are baked into the vertices.
+void generateBaked(const SceneObject& obj, ObjectGeometry* geo) {
+    generateCube(obj.xyz, geo);
+    translateObjectGeometry(obj.pos.x, obj.pos.y, obj.pos.z, geo);
+}
+
+std::vector<SceneObject> demoSceneObjects(uint32_t copyCount) {
+    std::vector<SceneObject> objs = {};
+    for (uint32_t c = 0; c < copyCount; ++c) {
+        float x = 50.0f * c;
+        objs.push_back({ { x, 0.0f, 0.0f }, { 20.0f, 1.0f, 20.0f } }); // floor
+        objs.push_back({ { x, 3.0f, 0.0f }, { 2.0f, 2.0f, 2.0f } }); // stage
+    }
+    return objs;
+}
+
+bool checkXXHash64(std::string* errorMessage) {
+    const char* texts[] = { "", "abc", "Nobody inspects the spammish repetition" };
+    const UINT64 expected[] = { 0xef46db3751d8e999ull, 0x44bc2cf5ad770999ull, 0xfbcea83c8a378bf1ull };
+    for (int i = 0; i < 3; ++i) {
+        if (calcXXHash64(texts[i], strlen(texts[i])) != expected[i]) {
+            *errorMessage = "calcXXHash64 does not match XXH64 of \"" + std::string(texts[i]) + "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+GeometryDedupBenchmarkReport runGeometryDedupBenchmark(const GeometryDedupBenchmarkDesc& desc) {
+    GeometryDedupBenchmarkReport report = {};
+    if (desc.copyCount == 0 || desc.repeatCount <= 0 || desc.hashSubdivisionLevel < 0) {
+        report.errorMessage = "copy count and repeat count must be positive";
+        return report;
+    }
+    if (!checkXXHash64(&report.errorMessage)) return report;
+
+    // Same as initRitemWithDedupGeoInfo, but the meshes are not uploaded.
+    auto objs = demoSceneObjects(desc.copyCount);
+    std::vector<std::shared_ptr<Vmesh>> ritemMeshes(objs.size());
+    double lookupSecs = 0.0;
+    for (int r = 0; r < desc.repeatCount; ++r) {
+        GeometryDedupTable table = {};
+        ritemMeshes.assign(objs.size(), nullptr);
+        report.meshCount = 0;
+        for (size_t i = 0; i < objs.size(); ++i) {
+            ObjectGeometry geo = {};
+            generateAtOrigin(&geo);
+
+            auto start = BenchClock::now();
+            UINT64 hash = calcObjectGeometryHash(&geo);
+            auto mesh = findDedupMesh(&geo, hash, &table);
+            if (mesh == nullptr) {
+                mesh = std::make_shared<Vmesh>();
+                addDedupMesh(&geo, hash, mesh, &table);
+                report.dedupByteSize += geo.vertexDataSize() + geo.indexDataSize();
+                ++report.meshCount;
+            }
+            lookupSecs += secsBetween(start, BenchClock::now());
+            ritemMeshes[i] = mesh;
+        }
+        report.savedByteSize = table.savedByteSize;
+    }
+    report.dedupByteSize /= desc.repeatCount;
+    report.objectCount = (uint32_t)objs.size();
+    report.lookupSecs = lookupSecs / desc.repeatCount / objs.size();
+
+    // The floor and the stage share the unit cube.
+    if (report.meshCount != 1) {
+        report.errorMessage = std::to_string(report.meshCount) + " meshes are left instead of 1";
+        return report;
+    }
+    for (size_t i = 1; i < objs.size(); ++i) {
+        if (ritemMeshes[i] != ritemMeshes[0]) {
+            report.errorMessage = "object " + std::to_string(i) + " does not share the unit cube";
+            return report;
+        }
+    }
+
+    // The shared vertices moved by the world matrix (see setRitemWorldTrans) must be the baked ones, and so must
+    // the normals transformed by the inverse transpose as the shaders do.
+    for (auto& obj : objs) {
+        ObjectGeometry local = {}, baked = {};
+        generateAtOrigin(&local);
+        generateBaked(obj, &baked);
+        report.bakedByteSize += baked.vertexDataSize() + baked.indexDataSize();
+        if (local.vertices.size() != baked.vertices.size() || local.indices != baked.indices) {
+            report.errorMessage = "the baked geometry differs in topology";
+            return report;
+        }
+        XMMATRIX world = calcWorldTrans(obj);
+        XMVECTOR det = XMMatrixDeterminant(world);
+        XMMATRIX invTrWorld = XMMatrixTranspose(XMMatrixInverse(&det, world));
+        for (size_t v = 0; v < local.vertices.size(); ++v) {
+            XMFLOAT3 p = {}, n = {};
+            XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&local.vertices[v].pos), world));
+            XMStoreFloat3(&n, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&local.vertices[v].normal), invTrWorld)));
+            const XMFLOAT3& q = baked.vertices[v].pos;
+            const XMFLOAT3& m = baked.vertices[v].normal;
+            double error = (std::max)({ fabs(p.x - q.x), fabs(p.y - q.y), fabs(p.z - q.z) });
+            report.maxPositionError = (std::max)(report.maxPositionError, error);
+            error = (std::max)({ fabs(n.x - m.x), fabs(n.y - m.y), fabs(n.z - m.z) });
+            report.maxNormalError = (std::max)(report.maxNormalError, error);
+        }
+    }
+    if (report.maxPositionError > 1e-4) {
+        report.errorMessage = "the world matrices move the vertices off by " + std::to_string(report.maxPositionError);
+        return report;
+    }
+    if (report.maxNormalError > 1e-4) {
+        report.errorMessage = "the inverse transposed world matrices turn the normals off by " + std::to_string(report.maxNormalError);
+        return report;
+    }
+    if (report.bakedByteSize - report.dedupByteSize != report.savedByteSize) {
+        report.errorMessage = "the saved bytes counted by the table are wrong";
+        return report;
+    }
+
+    ObjectGeometry hashGeo = {};
+    generateGeoSphere(1.0f, desc.hashSubdivisionLevel, &hashGeo);
+    report.hashByteSize = hashGeo.vertexDataSize() + hashGeo.indexDataSize();
+    UINT64 hash = 0;
+    auto start = BenchClock::now();
+    for (int r = 0; r < desc.repeatCount; ++r) hash ^= calcObjectGeometryHash(&hashGeo);
+    report.hashSecs = secsBetween(start, BenchClock::now()) / desc.repeatCount;
+    if (hash == 0 && desc.repeatCount % 2 == 1) {
+        report.errorMessage = "the geometry hash is 0";
+        return report;
+    }
+
+    report.isValid = true;
+    return report;
+}
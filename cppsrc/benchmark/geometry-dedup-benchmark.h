@@ -0,0 +1,41 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Build the geometry of the render items that dev_initCoreElems creates with initRitemWithDedupGeoInfo (the floor
+// and the stage, see createCubeObject), and look every geometry up in a GeometryDedupTable just like
+// initRitemWithDedupGeoInfo. The meshes are never uploaded, so it runs without a device. The check fails if the
+// cubes do not share one mesh, if the world matrices do not put the shared vertices and normals where the baked
+// size and translation did, or if calcXXHash64 does not match the reference values of XXH64.
+struct GeometryDedupBenchmarkDesc {
+    uint32_t copyCount = 1; // Copies of the floor and the stage.
+    int hashSubdivisionLevel = 6; // Of the geosphere hashed to measure the throughput.
+    int repeatCount = 20;
+};
+
+struct GeometryDedupBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+
+    uint32_t objectCount = 0;
+    uint32_t meshCount = 0; // Unique meshes after the dedup.
+    uint64_t bakedByteSize = 0; // Vertex and index bytes with one mesh per object.
+    uint64_t dedupByteSize = 0;
+    uint64_t savedByteSize = 0; // Counted by the table.
+    double maxPositionError = 0.0; // Between the baked vertices and the shared ones moved by the world matrix.
+    double maxNormalError = 0.0;
+
+    uint64_t hashByteSize = 0;
+    double hashSecs = 0.0; // Per calcObjectGeometryHash.
+    double lookupSecs = 0.0; // Per object, hashing and comparing included.
+};
+
+GeometryDedupBenchmarkReport runGeometryDedupBenchmark(const GeometryDedupBenchmarkDesc& desc);
@@ -0,0 +1,284 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+
+#include "bench-utils.h"
+#include "image-filter-benchmark.h"
+#include "postprocessing/image-filter.h"
+#include "utils/math-utils.h"
+#include "utils/thread-utils.h"
+
+namespace {
+
+// A gradient with squares of 97 pixels and noise on top, and the float images go beyond 1 like the HDR targets.
+void generateImage(DXGI_FORMAT format, UINT width, UINT height, BenchRandom* rng, CpuImage* image) {
+    initCpuImage(format, width, height, image);
+    for (UINT y = 0; y < height; ++y) {
+        for (UINT x = 0; x < width; ++x) {
+            size_t offset = (size_t)x + (size_t)y * width;
+            float base[4] = { (float)x / width, (float)y / height, 0.5f, 1.0f };
+            float square = ((x / 97 + y / 97) & 1) ? 0.25f : 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                float value = base[c] * 0.25f + square + benchRandfloat(0.0f, 0.5f, rng);
+                if (format == DXGI_FORMAT_R32G32B32A32_FLOAT) ((float*)image->data.data())[offset * 4 + c] = 2.0f * value;
+                else image->data[offset * 4 + c] = (BYTE)(value * 255.0f);
+            }
+        }
+    }
+}
+
+// Empty if the radius is out of range (See isValidBlurRadius).
+std::vector<float> calcWeights(const BlurBenchmarkDesc& desc, int radius) {
+    if (!isValidBlurRadius(radius)) return {};
+    float grade = desc.blurGrade > 0.0f ? desc.blurGrade : (std::max)(radius * 0.5f, 0.5f);
+    return calcGaussianBlurWeight((uint8_t)radius, grade);
+}
+
+const char* formatName(DXGI_FORMAT format) {
+    return format == DXGI_FORMAT_R32G32B32A32_FLOAT ? "rgba32f" : "rgba8";
+}
+
+} // namespace
+
+BlurBenchmarkReport runBlurBenchmark(const BlurBenchmarkDesc& desc) {
+    BlurBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    if (desc.blurCount <= 0 || desc.repeatCount <= 0) {
+        report.errorMessage = "blur count and repeat count must be positive";
+        return report;
+    }
+    for (uint32_t radius : desc.radii) {
+        if (radius > (uint32_t)MAX_BLUR_RADIUS) {
+            report.errorMessage = "radius must not be greater than " + std::to_string(MAX_BLUR_RADIUS);
+            return report;
+        }
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT };
+    for (auto format : formats) {
+        for (uint32_t radius : desc.radii) {
+            auto weights = calcWeights(desc, radius);
+            CpuImage image = {}, reference = {};
+            generateImage(format, 253, 131, &rng, &image);
+            reference = image;
+            separableFilterImage(weights, 2, &image);
+            separableFilterImageReference(weights, 2, &reference);
+            if (image.data != reference.data) {
+                report.errorMessage = std::string(formatName(format)) + " radius " + std::to_string(radius) +
+                    " differs from the scalar reference";
+                return report;
+            }
+        }
+    }
+
+    const UINT sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (auto& size : sizes) {
+        for (auto format : formats) {
+            CpuImage source = {};
+            generateImage(format, size[0], size[1], &rng, &source);
+            for (uint32_t radius : desc.radii) {
+                auto weights = calcWeights(desc, radius);
+                BlurBenchmarkResult result = {};
+                result.width = size[0];
+                result.height = size[1];
+                result.format = format;
+                result.radius = radius;
+
+                CpuImage image = {};
+                for (int i = 0; i < desc.repeatCount; ++i) {
+                    image = source;
+                    auto start = BenchClock::now();
+                    separableFilterImage(weights, desc.blurCount, &image);
+                    double secs = secsBetween(start, BenchClock::now());
+                    result.secs = i == 0 ? secs : (std::min)(result.secs, secs);
+                }
+                result.checksum = fnv1a64(image.data.data(), image.data.size());
+
+                if (desc.useReference) {
+                    image = source;
+                    auto start = BenchClock::now();
+                    separableFilterImageReference(weights, desc.blurCount, &image);
+                    result.referenceSecs = secsBetween(start, BenchClock::now());
+                }
+                report.results.push_back(result);
+            }
+        }
+    }
+    report.isValid = true;
+    return report;
+}
+
+BoxBlurBenchmarkReport runBoxBlurBenchmark(const BoxBlurBenchmarkDesc& desc) {
+    BoxBlurBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    report.width = 1920;
+    report.height = 1080;
+    if (desc.repeatCount <= 0) {
+        report.errorMessage = "repeat count must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    CpuImage source = {};
+    generateImage(desc.format, report.width, report.height, &rng, &source);
+    float peak = desc.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? 2.0f : 1.0f;
+    for (uint32_t radius : desc.radii) {
+        if (radius == 0 || radius > 255) {
+            report.errorMessage = "radius must be in [1, 255]";
+            return report;
+        }
+        BoxBlurBenchmarkResult result = {};
+        result.radius = radius;
+        auto weights = calcGaussianBlurWeight((uint8_t)radius, radius / 3.0f);
+        result.sigma = calcFilterWeightSigma(weights);
+        calcBoxCascadeRadii(result.sigma, result.boxRadii);
+
+        CpuImage direct = source;
+        auto start = BenchClock::now();
+        separableFilterImage(weights, 1, &direct);
+        result.directSecs = secsBetween(start, BenchClock::now());
+
+        CpuImage box = {};
+        for (int i = 0; i < desc.repeatCount; ++i) {
+            box = source;
+            start = BenchClock::now();
+            boxCascadeBlurImage(result.sigma, &box);
+            double secs = secsBetween(start, BenchClock::now());
+            result.boxSecs = i == 0 ? secs : (std::min)(result.boxSecs, secs);
+        }
+
+        result.psnr = calcImagePsnr(box, direct, peak);
+        report.results.push_back(result);
+        if (result.psnr < desc.minPsnr) {
+            report.errorMessage = "PSNR of radius " + std::to_string(radius) + " is " + std::to_string(result.psnr) + " dB";
+            return report;
+        }
+    }
+    report.isValid = true;
+    return report;
+}
+
+BilateralBenchmarkReport runBilateralBenchmark(const BilateralBenchmarkDesc& desc) {
+    BilateralBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    report.width = 1280;
+    report.height = 720;
+    if (desc.repeatCount <= 0 || desc.grayGrade <= 0.0f) {
+        report.errorMessage = "repeat count and gray grade must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    // Opaque like the swap chain buffers, since the grid keeps the alpha whereas the brute force blurs it.
+    CpuImage source = {};
+    generateImage(desc.format, report.width, report.height, &rng, &source);
+    for (size_t i = 0; i < (size_t)report.width * report.height; ++i) {
+        if (desc.format == DXGI_FORMAT_R32G32B32A32_FLOAT) ((float*)source.data.data())[i * 4 + 3] = 1.0f;
+        else source.data[i * 4 + 3] = 255;
+    }
+    float peak = desc.format == DXGI_FORMAT_R32G32B32A32_FLOAT ? 2.0f : 1.0f;
+    for (uint32_t radius : desc.radii) {
+        if (radius == 0 || radius > (uint32_t)MAX_BLUR_RADIUS) {
+            report.errorMessage = "radius must be in [1, " + std::to_string(MAX_BLUR_RADIUS) + "]";
+            return report;
+        }
+        BilateralBenchmarkResult result = {};
+        result.radius = radius;
+        float distanceGrade = desc.distanceGrade > 0.0f ? desc.distanceGrade : radius * 0.5f;
+        // The gray range of the RGBA8 images, which the float images of generateImage only go beyond.
+        BilateralGridLayout layout = {};
+        calcBilateralGridLayout(radius, distanceGrade, desc.grayGrade, report.width, report.height, 0.0f, 1.0f, &layout);
+        result.gridWidth = layout.width;
+        result.gridHeight = layout.height;
+        result.gridDepth = layout.depth;
+
+        CpuImage bruteForce = source;
+        auto start = BenchClock::now();
+        bilateralBlurImage(radius, distanceGrade, desc.grayGrade, 1, &bruteForce);
+        result.bruteForceSecs = secsBetween(start, BenchClock::now());
+
+        CpuImage grid = {};
+        for (int i = 0; i < desc.repeatCount; ++i) {
+            grid = source;
+            start = BenchClock::now();
+            bilateralGridBlurImage(radius, distanceGrade, desc.grayGrade, 1, &grid);
+            double secs = secsBetween(start, BenchClock::now());
+            result.gridSecs = i == 0 ? secs : (std::min)(result.gridSecs, secs);
+        }
+
+        result.psnr = calcImagePsnr(grid, bruteForce, peak);
+        report.results.push_back(result);
+        if (result.psnr < desc.minPsnr) {
+            report.errorMessage = "PSNR of radius " + std::to_string(radius) + " is " + std::to_string(result.psnr) + " dB";
+            return report;
+        }
+    }
+    report.isValid = true;
+    return report;
+}
+
+SobelBenchmarkReport runSobelBenchmark(const SobelBenchmarkDesc& desc) {
+    SobelBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    if (desc.repeatCount <= 0) {
+        report.errorMessage = "repeat count must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT };
+    for (auto format : formats) {
+        CpuImage source = {}, output = {}, reference = {};
+        generateImage(format, 253, 131, &rng, &source);
+        for (int colorMode : { SOBEL_BLACK_ON_WHITE, SOBEL_WHITE_ON_BLACK }) {
+            sobelOperatorImage(source, colorMode, &output);
+            sobelOperatorImageReference(source, colorMode, &reference);
+            if (output.data != reference.data) {
+                report.errorMessage = std::string(formatName(format)) + " color mode " + std::to_string(colorMode) +
+                    " differs from the scalar reference";
+                return report;
+            }
+        }
+    }
+
+    int colorMode = desc.isWhiteOnBlack ? SOBEL_WHITE_ON_BLACK : SOBEL_BLACK_ON_WHITE;
+    const UINT sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (auto& size : sizes) {
+        for (auto format : formats) {
+            CpuImage source = {}, output = {};
+            generateImage(format, size[0], size[1], &rng, &source);
+            SobelBenchmarkResult result = {};
+            result.width = size[0];
+            result.height = size[1];
+            result.format = format;
+
+            for (int i = 0; i < desc.repeatCount; ++i) {
+                auto start = BenchClock::now();
+                sobelOperatorImage(source, colorMode, &output);
+                double secs = secsBetween(start, BenchClock::now());
+                result.secs = i == 0 ? secs : (std::min)(result.secs, secs);
+            }
+            result.checksum = fnv1a64(output.data.data(), output.data.size());
+
+            if (desc.useReference) {
+                auto start = BenchClock::now();
+                sobelOperatorImageReference(source, colorMode, &output);
+                result.referenceSecs = secsBetween(start, BenchClock::now());
+            }
+            report.results.push_back(result);
+        }
+    }
+    report.isValid = true;
+    return report;
+}
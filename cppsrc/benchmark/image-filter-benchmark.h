@@ -0,0 +1,131 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <d3d12.h>
+#include <string>
+#include <vector>
+
+// Blur random 1080p and 4K images with gaussianBlurImage (See postprocessing/image-filter.h) in both formats.
+// Before timing, a small image of odd size (so the last strip is partial) is blurred by both gaussianBlurImage and
+// the scalar reference, which must be bit-for-bit identical, otherwise an error is reported.
+struct BlurBenchmarkDesc {
+    std::vector<uint32_t> radii = { 2, 5, 16 };
+    float blurGrade = 0.0f; // Sigma of the weights, 0 for radius / 2.
+    int blurCount = 1;
+    int repeatCount = 3;
+    uint64_t seed = 0;
+    bool useReference = false; // TRUE to time the scalar reference on the full images too.
+};
+
+struct BlurBenchmarkResult {
+    UINT width = 0, height = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    int radius = 0;
+    double secs = 0.0; // Best of the repeats.
+    double referenceSecs = 0.0; // Only if useReference.
+    uint64_t checksum = 0; // FNV-1a of the blurred image.
+};
+
+struct BlurBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    std::vector<BlurBenchmarkResult> results = {};
+};
+
+BlurBenchmarkReport runBlurBenchmark(const BlurBenchmarkDesc& desc);
+
+// Blur a random 1080p image with the box cascade (boxCascadeBlurImage in postprocessing/image-filter.h) and with the
+// direct convolution of the Gaussian weights it approximates, i.e. calcGaussianBlurWeight(radius, radius / 3).
+// The box cascade must reach minPsnr against the direct convolution, otherwise an error is reported.
+struct BoxBlurBenchmarkDesc {
+    std::vector<uint32_t> radii = { 5, 10, 25, 50, 100, 200 };
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    double minPsnr = 30.0;
+    int repeatCount = 3;
+    uint64_t seed = 0;
+};
+
+struct BoxBlurBenchmarkResult {
+    int radius = 0;
+    float sigma = 0.0f;
+    int boxRadii[3] = {};
+    double directSecs = 0.0; // Of a single run, since it takes long at large radii.
+    double boxSecs = 0.0; // Best of the repeats.
+    double psnr = 0.0; // Of the box cascade against the direct convolution, in dB.
+};
+
+struct BoxBlurBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    UINT width = 0, height = 0;
+    std::vector<BoxBlurBenchmarkResult> results = {};
+};
+
+BoxBlurBenchmarkReport runBoxBlurBenchmark(const BoxBlurBenchmarkDesc& desc);
+
+// Blur a random 720p image with the bilateral grid (bilateralGridBlurImage in postprocessing/image-filter.h) and with
+// the brute force bilateralBlurImage it approximates. The grid must reach minPsnr against the brute force, otherwise
+// an error is reported.
+struct BilateralBenchmarkDesc {
+    std::vector<uint32_t> radii = { 2, 5, 10 };
+    float distanceGrade = 0.0f; // 0 for radius / 2.
+    float grayGrade = 0.1f;
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    double minPsnr = 30.0;
+    int repeatCount = 3;
+    uint64_t seed = 0;
+};
+
+struct BilateralBenchmarkResult {
+    int radius = 0;
+    UINT gridWidth = 0, gridHeight = 0, gridDepth = 0;
+    double bruteForceSecs = 0.0; // Of a single run, since it takes long at large radii.
+    double gridSecs = 0.0; // Best of the repeats.
+    double psnr = 0.0; // Of the grid against the brute force, in dB.
+};
+
+struct BilateralBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    UINT width = 0, height = 0;
+    std::vector<BilateralBenchmarkResult> results = {};
+};
+
+BilateralBenchmarkReport runBilateralBenchmark(const BilateralBenchmarkDesc& desc);
+
+// Run sobelOperatorImage (See postprocessing/image-filter.h) on random 1080p and 4K images in both formats.
+// Before timing, a small image of odd size (so the last block is partial) goes through both sobelOperatorImage and
+// the scalar reference in both color modes, which must be bit-for-bit identical, otherwise an error is reported.
+struct SobelBenchmarkDesc {
+    bool isWhiteOnBlack = false; // FALSE for SOBEL_BLACK_ON_WHITE.
+    int repeatCount = 5;
+    uint64_t seed = 0;
+    bool useReference = false; // TRUE to time the scalar reference on the full images too.
+};
+
+struct SobelBenchmarkResult {
+    UINT width = 0, height = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    double secs = 0.0; // Best of the repeats.
+    double referenceSecs = 0.0; // Only if useReference.
+    uint64_t checksum = 0; // FNV-1a of the output image.
+};
+
+struct SobelBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    std::vector<SobelBenchmarkResult> results = {};
+};
+
+SobelBenchmarkReport runSobelBenchmark(const SobelBenchmarkDesc& desc);
@@ -0,0 +1,240 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "bench-utils.h"
+#include "instancing-benchmark.h"
+#include "utils/cmd-stream-recorder.h"
+#include "utils/draw-list-utils.h"
+#include "utils/obj-consts-utils.h"
+
+namespace {
+
+constexpr UINT OBJ_CONST_SEAT_SIZE = 256;
+constexpr UINT OBJECT_COUNT_PER_COPY = 16;
+
+// Only the addresses of the objects are recorded, so they are never created by any device.
+struct SceneObjects {
+    ID3D12DescriptorHeap mainDescHeap = {};
+    ID3D12PipelineState PSOs[2] = {}; // Solid and alpha, or the instanced ones.
+
+    D3D12_GPU_VIRTUAL_ADDRESS objConstBuffAddr = 0x10000000;
+    D3D12_GPU_VIRTUAL_ADDRESS instStructBuffAddr = 0x20000000;
+
+    DrawList solidDrawList = {};
+    DrawList alphaDrawList = {};
+};
+
+// One path of the benchmark, i.e. the render items, the shadow and the buffers of the frame resources.
+struct ScenePath {
+    std::vector<std::unique_ptr<RenderItem>> ritems = {};
+    ObjConstsShadow shadow = {};
+    std::vector<BYTE> buffs[NUM_FRAME_RESOURCES] = {};
+    DirtySeatSet seatSets[NUM_FRAME_RESOURCES] = {};
+    DirtySeatSet* ppSeatSet[NUM_FRAME_RESOURCES] = {};
+    SceneObjects objs = {};
+    CmdStreamRecorder recorder = {};
+};
+
+// Both meshes are in the shared geometry pool, just like the meshes created with a SceneBuilder.
+// The index counts are the same as the cylinder (30 slices, 10 stacks) and the sphere (3 subdivisions).
+void initSceneMesh(bool isPillar, Vmesh* mesh) {
+    mesh->vertexBuffView = { 0x1000, 1u << 24, (UINT)sizeof(Vertex) };
+    mesh->indexBuffView = { 0x2000, 1u << 23, DXGI_FORMAT_R32_UINT };
+    Vsubmesh ritemMain = {};
+    ritemMain.indexCount = isPillar ? 2160 : 3840;
+    ritemMain.startIndexLocation = isPillar ? 0 : 2160;
+    ritemMain.baseVertexLocation = isPillar ? 0 : 372;
+    mesh->objects["main"] = ritemMain;
+}
+
+// Same positions as dev_initCoreElems, and every copy is moved along the x axis. The objects bob up and down.
+XMFLOAT3 scenePosition(uint32_t objectIdx, int frame) {
+    uint32_t copyIdx = objectIdx / OBJECT_COUNT_PER_COPY;
+    uint32_t k = objectIdx % 8;
+    bool isPillar = objectIdx % OBJECT_COUNT_PER_COPY < 8;
+    int i = (k / 4) * 2, j = k % 4;
+    float bob = 0.5f * sinf(0.1f * frame + 0.3f * objectIdx);
+    return XMFLOAT3(10.0f * (i - 1) + 30.0f * copyIdx, (isPillar ? 4.0f : 8.0f) + bob,
+        (j / 3.0f) * -16.0f + (1.0f - j / 3.0f) * 16.0f);
+}
+
+// Same as setInstanceWorldTrans with a translation, which is written without DirectXMath.
+void setTranslation(XMFLOAT3 pos, XMFLOAT4X4* worldTrans, XMFLOAT4X4* invTrWorldTrans) {
+    *worldTrans = makeIdentityFloat4x4();
+    worldTrans->_14 = pos.x;
+    worldTrans->_24 = pos.y;
+    worldTrans->_34 = pos.z;
+    *invTrWorldTrans = makeIdentityFloat4x4();
+    invTrWorldTrans->_41 = -pos.x;
+    invTrWorldTrans->_42 = -pos.y;
+    invTrWorldTrans->_43 = -pos.z;
+}
+
+void initScenePath(uint32_t objectCount, bool isInstanced, ScenePath* path) {
+    std::vector<RenderItem*> solidLayer = {}, alphaLayer = {};
+    if (isInstanced) {
+        for (int m = 0; m < 2; ++m) {
+            auto ritem = std::make_unique<RenderItem>();
+            ritem->mesh = std::make_unique<Vmesh>();
+            initSceneMesh(m == 0, ritem->mesh.get());
+            ritem->instances.resize(objectCount / 2);
+            ritem->instBuffStartIdx = m * (objectCount / 2);
+            (m == 0 ? solidLayer : alphaLayer).push_back(ritem.get());
+            path->ritems.push_back(std::move(ritem));
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            auto ritem = std::make_unique<RenderItem>();
+            ritem->mesh = std::make_unique<Vmesh>();
+            bool isPillar = i % OBJECT_COUNT_PER_COPY < 8;
+            initSceneMesh(isPillar, ritem->mesh.get());
+            ritem->objConstBuffStartIdx = i;
+            ritem->objConstBuffSeatCount = 1;
+            ritem->constData.resize(1);
+            (isPillar ? solidLayer : alphaLayer).push_back(ritem.get());
+            path->ritems.push_back(std::move(ritem));
+        }
+    }
+    compileDrawList(isInstanced ? "solid_instanced" : "solid", solidLayer.data(), solidLayer.size(),
+        OBJ_CONST_SEAT_SIZE, &path->objs.solidDrawList);
+    compileDrawList(isInstanced ? "alpha_instanced" : "alpha", alphaLayer.data(), alphaLayer.size(),
+        OBJ_CONST_SEAT_SIZE, &path->objs.alphaDrawList);
+
+    // Same as createFrameResources.
+    UINT seatCount = isInstanced ? 0 : objectCount;
+    UINT instanceCount = isInstanced ? objectCount : 0;
+    size_t buffSize = isInstanced ? instanceCount * sizeof(InstanceData) : (size_t)seatCount * OBJ_CONST_SEAT_SIZE;
+    for (int i = 0; i < NUM_FRAME_RESOURCES; ++i) {
+        path->buffs[i].assign(buffSize, 0);
+        path->seatSets[i].reset(isInstanced ? instanceCount : seatCount);
+        path->ppSeatSet[i] = &path->seatSets[i];
+    }
+    initObjConstsShadow(seatCount, OBJ_CONST_SEAT_SIZE, instanceCount, &path->shadow);
+}
+
+// Same as dev_updateCoreObjConsts and dev_drawCoreElems, i.e. move the objects, update the buffers of
+// the current frame resource and record the layers. Return the bytes written.
+uint64_t updateAndRecordFrame(uint32_t objectCount, bool isInstanced, int frame, ScenePath* path) {
+    if (isInstanced) {
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            auto& ritem = path->ritems[i < objectCount / 2 ? 0 : 1];
+            // The pillars of all copies come first, then the balls.
+            uint32_t copyIdx = (i % (objectCount / 2)) / 8;
+            uint32_t objectIdx = copyIdx * OBJECT_COUNT_PER_COPY + (i < objectCount / 2 ? 0 : 8) + i % 8;
+            auto& instance = ritem->instances[i - ritem->instBuffStartIdx];
+            setTranslation(scenePosition(objectIdx, frame), &instance.worldTrans, &instance.invTrWorldTrans);
+        }
+        for (auto& ritem : path->ritems) queueRitemObjConsts(ritem.get(), &path->shadow);
+    }
+    else {
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            auto& consts = path->ritems[i]->constData[0];
+            setTranslation(scenePosition(i, frame), &consts.worldTrans, &consts.invTrWorldTrans);
+            queueRitemObjConsts(path->ritems[i].get(), &path->shadow);
+        }
+    }
+
+    int resourceIdx = frame % NUM_FRAME_RESOURCES;
+    ObjConstsWriteStats stats = {};
+    if (isInstanced) {
+        flushObjConstsShadow(&path->shadow, nullptr, path->ppSeatSet, NUM_FRAME_RESOURCES);
+        stats = writeDirtyInstances(path->shadow, &path->seatSets[resourceIdx], path->buffs[resourceIdx].data());
+    }
+    else {
+        flushObjConstsShadow(&path->shadow, path->ppSeatSet, nullptr, NUM_FRAME_RESOURCES);
+        stats = writeDirtyObjConsts(path->shadow, &path->seatSets[resourceIdx], path->buffs[resourceIdx].data());
+    }
+
+    SceneObjects* objs = &path->objs;
+    CmdRecorder* recorder = &path->recorder;
+    ID3D12DescriptorHeap* mainDescHeap = &objs->mainDescHeap;
+    recorder->SetDescriptorHeaps(1, &mainDescHeap);
+    if (isInstanced) recorder->SetGraphicsRootShaderResourceView(6, objs->instStructBuffAddr);
+    recorder->SetPipelineState(&objs->PSOs[0]);
+    submitDrawList(recorder, objs->solidDrawList, objs->objConstBuffAddr, mainDescHeap);
+    recorder->SetPipelineState(&objs->PSOs[1]);
+    submitDrawList(recorder, objs->alphaDrawList, objs->objConstBuffAddr, mainDescHeap);
+    return stats.byteSize;
+}
+
+bool runCopyCount(const InstancingBenchmarkDesc& desc, uint32_t copyCount,
+    InstancingBenchmarkResult* result, std::string* errorMessage)
+{
+    uint32_t objectCount = copyCount * OBJECT_COUNT_PER_COPY;
+    auto perObject = std::make_unique<ScenePath>();
+    auto instanced = std::make_unique<ScenePath>();
+    initScenePath(objectCount, false, perObject.get());
+    initScenePath(objectCount, true, instanced.get());
+
+    double perObjectSecs = 0.0, instancedSecs = 0.0;
+    for (int frame = 0; frame < desc.frameCount; ++frame) {
+        perObject->recorder.reset();
+        instanced->recorder.reset();
+
+        auto t0 = BenchClock::now();
+        uint64_t perObjectByteSize = updateAndRecordFrame(objectCount, false, frame, perObject.get());
+        auto t1 = BenchClock::now();
+        uint64_t instancedByteSize = updateAndRecordFrame(objectCount, true, frame, instanced.get());
+        auto t2 = BenchClock::now();
+        perObjectSecs += secsBetween(t0, t1);
+        instancedSecs += secsBetween(t1, t2);
+
+        // The instances are in the order of the pillars of all copies and then the balls.
+        int resourceIdx = frame % NUM_FRAME_RESOURCES;
+        const BYTE* seats = perObject->buffs[resourceIdx].data();
+        auto instances = (const InstanceData*)instanced->buffs[resourceIdx].data();
+        for (uint32_t i = 0; i < objectCount; ++i) {
+            uint32_t copyIdx = (i % (objectCount / 2)) / 8;
+            uint32_t objectIdx = copyIdx * OBJECT_COUNT_PER_COPY + (i < objectCount / 2 ? 0 : 8) + i % 8;
+            auto consts = (const ObjConsts*)(seats + (size_t)objectIdx * OBJ_CONST_SEAT_SIZE);
+            if (memcmp(&consts->worldTrans, &instances[i].worldTrans, 2 * sizeof(XMFLOAT4X4)) != 0) {
+                *errorMessage = "world matrices differ at frame " + std::to_string(frame) +
+                    " of " + std::to_string(objectCount) + " objects";
+                return false;
+            }
+        }
+
+        result->perObjectByteSize = perObjectByteSize;
+        result->instancedByteSize = instancedByteSize;
+    }
+
+    result->objectCount = objectCount;
+    result->perObjectSecs = perObjectSecs / desc.frameCount;
+    result->instancedSecs = instancedSecs / desc.frameCount;
+    result->perObjectDrawCount = perObject->recorder.stats().drawCount;
+    result->instancedDrawCount = instanced->recorder.stats().drawCount;
+    result->perObjectRootBindingCount = perObject->recorder.stats().rootBindingCount;
+    result->instancedRootBindingCount = instanced->recorder.stats().rootBindingCount;
+    return true;
+}
+
+} // namespace
+
+InstancingBenchmarkReport runInstancingBenchmark(const InstancingBenchmarkDesc& desc) {
+    InstancingBenchmarkReport report = {};
+    if (desc.frameCount <= 0) {
+        report.errorMessage = "frame count must be positive";
+        return report;
+    }
+
+    for (uint32_t copyCount : desc.copyCounts) {
+        InstancingBenchmarkResult result = {};
+        if (copyCount == 0 || !runCopyCount(desc, copyCount, &result, &report.errorMessage)) {
+            if (report.errorMessage.empty()) report.errorMessage = "copy count must be positive";
+            return report;
+        }
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
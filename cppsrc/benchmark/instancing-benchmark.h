@@ -0,0 +1,46 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Move the pillars and balls of dev_initCoreElems (8 identical cylinders and 8 identical spheres) every frame,
+// drawn once as one render item per object (a 256-byte object constants seat and a draw call each) and once as
+// 2 instanced render items (a 208-byte InstanceData each, and a draw call per mesh, see RenderItem::instances).
+// The scene can be copied to scale it up. Both paths update the buffers of NUM_FRAME_RESOURCES frame
+// resources (plain memory here) and record the draw lists with CmdStreamRecorder, and the world matrices
+// written by both paths are compared every frame.
+struct InstancingBenchmarkDesc {
+    std::vector<uint32_t> copyCounts = { 1, 64, 1024 };
+    int frameCount = 100;
+};
+
+struct InstancingBenchmarkResult {
+    uint32_t objectCount = 0;
+    // Per frame, the buffer updates and the recording included.
+    double perObjectSecs = 0.0;
+    double instancedSecs = 0.0;
+    // Bytes of the object constants or instances uploaded per frame.
+    uint64_t perObjectByteSize = 0;
+    uint64_t instancedByteSize = 0;
+    // Recorded per frame.
+    uint64_t perObjectDrawCount = 0;
+    uint64_t instancedDrawCount = 0;
+    uint64_t perObjectRootBindingCount = 0;
+    uint64_t instancedRootBindingCount = 0;
+};
+
+struct InstancingBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<InstancingBenchmarkResult> results = {};
+};
+
+InstancingBenchmarkReport runInstancingBenchmark(const InstancingBenchmarkDesc& desc);
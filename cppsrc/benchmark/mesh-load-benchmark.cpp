@@ -0,0 +1,108 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "bench-utils.h"
+#include "mesh-load-benchmark.h"
+#include "utils/mesh-file-utils.h"
+
+static bool isSameGeometry(const ObjectGeometry& a, const ObjectGeometry& b) {
+    return a.vertices.size() == b.vertices.size() && a.indices.size() == b.indices.size() &&
+        memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0 &&
+        memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(UINT32)) == 0 &&
+        a.locationInfo.indexCount == b.locationInfo.indexCount;
+}
+
+// Write a copy of the binary file whose submesh draws one index past the index data.
+static bool isBadSubmeshRejected(const std::string& binaryPath) {
+    std::ifstream fin(binaryPath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(MeshFileHeader)) return false;
+    MeshFileHeader header = {};
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (header.submeshCount == 0) return false;
+    UINT64 countOffset = header.submeshTableOffset + offsetof(MeshFileSubmesh, location) + offsetof(Vsubmesh, indexCount);
+    UINT badIndexCount = header.indexCount + 1;
+    memcpy(&bytes[countOffset], &badIndexCount, sizeof(badIndexCount));
+
+    std::string badPath = binaryPath + ".bad";
+    std::ofstream(badPath, std::ios::binary | std::ios::trunc).write(bytes.data(), (std::streamsize)bytes.size());
+    MappedMeshFile file = {};
+    bool isMapped = mapBinaryMeshFile(badPath, &file);
+    unmapBinaryMeshFile(&file);
+    std::filesystem::remove(badPath);
+    return !isMapped;
+}
+
+MeshLoadBenchmarkReport runMeshLoadBenchmark(const std::string& textPath, int repeatCount) {
+    MeshLoadBenchmarkReport report = {};
+    std::string binaryPath = std::filesystem::path(textPath).replace_extension(".rsmesh").string();
+    repeatCount = (std::max)(repeatCount, 1);
+
+    ObjectGeometry textGeo = {};
+    report.textLoadSecs = 1e30;
+    for (int k = 0; k < repeatCount; ++k) {
+        auto start = BenchClock::now();
+        if (!loadTextMeshFile(textPath, &textGeo, &report.errorMessage)) return report;
+        report.textLoadSecs = (std::min)(report.textLoadSecs, secsBetween(start, BenchClock::now()));
+    }
+    report.isLoaded = true;
+
+    ObjectGeometry referenceGeo = {};
+    report.textReferenceLoadSecs = 1e30;
+    for (int k = 0; k < repeatCount; ++k) {
+        auto start = BenchClock::now();
+        loadTextMeshFileReference(textPath, &referenceGeo);
+        report.textReferenceLoadSecs = (std::min)(report.textReferenceLoadSecs, secsBetween(start, BenchClock::now()));
+    }
+    report.isParserEqual = isSameGeometry(textGeo, referenceGeo);
+    report.vertexCount = textGeo.vertices.size();
+    report.indexCount = textGeo.indices.size();
+    if (!writeBinaryMeshFile(binaryPath, &textGeo)) return report;
+
+    ObjectGeometry binaryGeo = {};
+    report.binaryLoadSecs = 1e30;
+    for (int k = 0; k < repeatCount; ++k) {
+        auto start = BenchClock::now();
+        if (!loadBinaryMeshFile(binaryPath, &binaryGeo)) return report;
+        report.binaryLoadSecs = (std::min)(report.binaryLoadSecs, secsBetween(start, BenchClock::now()));
+    }
+    report.isRoundTripEqual = isSameGeometry(textGeo, binaryGeo);
+    report.isBadSubmeshRejected = isBadSubmeshRejected(binaryPath);
+
+    // This is what a zero-copy consumer of the mapped file costs before the upload.
+    report.binaryMapSecs = 1e30;
+    for (int k = 0; k < repeatCount; ++k) {
+        auto start = BenchClock::now();
+        MappedMeshFile file = {};
+        if (!mapBinaryMeshFile(binaryPath, &file)) return report;
+        BYTE sum = 0;
+        for (UINT64 offset = 0; offset < file.view.size; offset += 4096) sum += ((const BYTE*)file.view.data)[offset];
+        volatile BYTE sink = sum;
+        (void)sink;
+        unmapBinaryMeshFile(&file);
+        report.binaryMapSecs = (std::min)(report.binaryMapSecs, secsBetween(start, BenchClock::now()));
+    }
+
+    report.textFileSize = (size_t)std::filesystem::file_size(textPath);
+    report.binaryFileSize = (size_t)std::filesystem::file_size(binaryPath);
+    return report;
+}
+
+bool generateGridTextMeshFile(const std::string& path, uint32_t m, uint32_t n) {
+    ObjectGeometry grid = {};
+    generateGrid(10.0f, 10.0f, m, n, &grid);
+    disturbGridToHill(1.0f, 0.5f, &grid);
+    updateVertexNormals(&grid);
+    return writeTextMeshFile(path, &grid);
+}
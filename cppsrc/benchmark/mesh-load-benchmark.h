@@ -0,0 +1,36 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Compare the load time of a text mesh file (e.g. models/skull.txt) parsed by iostream (the reference)
+// and by the parallel from_chars parser, and that of its binary cache.
+// The binary file is written next to the text file with the extension replaced by .rsmesh.
+struct MeshLoadBenchmarkReport {
+    bool isLoaded = false; // FALSE if the text file can not be loaded.
+    std::string errorMessage = {};
+    bool isParserEqual = false; // TRUE if both text parsers give exactly the same geometry.
+    bool isRoundTripEqual = false; // TRUE if the binary file gives exactly the same geometry.
+    bool isBadSubmeshRejected = false; // TRUE if a copy with a submesh past the index data is not mapped.
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t textFileSize = 0;
+    size_t binaryFileSize = 0;
+    // Best of several repeats.
+    double textReferenceLoadSecs = 0.0;
+    double textLoadSecs = 0.0;
+    double binaryLoadSecs = 0.0; // Map and copy into ObjectGeometry.
+    double binaryMapSecs = 0.0; // Map and touch every page without copy.
+};
+
+MeshLoadBenchmarkReport runMeshLoadBenchmark(const std::string& textPath, int repeatCount);
+
+// Write a text mesh file of a hill grid for the benchmarks, i.e. (2m + 1) * (2n + 1) vertices.
+bool generateGridTextMeshFile(const std::string& path, uint32_t m, uint32_t n);
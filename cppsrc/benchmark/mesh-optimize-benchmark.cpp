@@ -0,0 +1,84 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <array>
+
+#include "bench-utils.h"
+#include "mesh-optimize-benchmark.h"
+#include "utils/mesh-file-utils.h"
+
+// Compare the triangles by the positions of their corners, which are not changed by the optimization.
+// Each triangle is rotated to start from its smallest corner, so that the winding order is checked too.
+static std::vector<std::array<XMFLOAT3, 3>> collectTriangles(const ObjectGeometry& geo) {
+    auto less = [](const XMFLOAT3& a, const XMFLOAT3& b) {
+        return memcmp(&a, &b, sizeof(XMFLOAT3)) < 0;
+    };
+    std::vector<std::array<XMFLOAT3, 3>> tris(geo.indices.size() / 3);
+    for (size_t i = 0; i < tris.size(); ++i) {
+        for (int c = 0; c < 3; ++c) tris[i][c] = geo.vertices[geo.indices[i * 3 + c]].pos;
+        int first = less(tris[i][1], tris[i][0]) ? 1 : 0;
+        if (less(tris[i][2], tris[i][first])) first = 2;
+        std::rotate(tris[i].begin(), tris[i].begin() + first, tris[i].end());
+    }
+    std::sort(tris.begin(), tris.end(), [](const auto& a, const auto& b) {
+        return memcmp(a.data(), b.data(), sizeof(a)) < 0;
+    });
+    return tris;
+}
+
+// Give every corner of every triangle a vertex of its own, which is what an exporter without an index
+// buffer writes. Welding restores the shared vertices.
+static void convertToTriangleSoup(ObjectGeometry* geo) {
+    std::vector<Vertex> vertices(geo->indices.size());
+    for (size_t i = 0; i < geo->indices.size(); ++i) {
+        vertices[i] = geo->vertices[geo->indices[i]];
+        geo->indices[i] = (UINT32)i;
+    }
+    geo->vertices = std::move(vertices);
+}
+
+static MeshOptimizeBenchmarkReport measureMeshOptimize(const std::string& name, ObjectGeometry* geo) {
+    MeshOptimizeBenchmarkReport report = {};
+    report.meshName = name;
+    report.triangleCount = geo->indices.size() / 3;
+
+    auto originalTris = collectTriangles(*geo);
+    auto start = BenchClock::now();
+    optimizeObjectGeometry(geo, true, &report.optimizeReport);
+    report.optimizeSecs = secsBetween(start, BenchClock::now());
+
+    auto optimizedTris = collectTriangles(*geo);
+    report.isTriangleSetKept = originalTris.size() == optimizedTris.size() &&
+        memcmp(originalTris.data(), optimizedTris.data(), originalTris.size() * sizeof(originalTris[0])) == 0;
+    return report;
+}
+
+std::vector<MeshOptimizeBenchmarkReport> runMeshOptimizeBenchmark(const std::string& textPath) {
+    std::vector<MeshOptimizeBenchmarkReport> reports = {};
+
+    ObjectGeometry geo = {};
+    generateGeoSphere(1.0f, 6, &geo);
+    reports.push_back(measureMeshOptimize("geo-sphere (6)", &geo));
+
+    generateGeoSphere(1.0f, 6, &geo);
+    convertToTriangleSoup(&geo);
+    reports.push_back(measureMeshOptimize("geo-sphere soup (6)", &geo));
+    reports.back().hasDuplicateVertices = true;
+
+    generateGrid(10.0f, 10.0f, 256, 256, &geo);
+    reports.push_back(measureMeshOptimize("grid (513x513)", &geo));
+
+    generateCylinder(1.0f, 1.0f, 2.0f, 256, 256, &geo);
+    reports.push_back(measureMeshOptimize("cylinder (256)", &geo));
+
+    if (!textPath.empty() && loadTextMeshFile(textPath, &geo)) {
+        reports.push_back(measureMeshOptimize(textPath, &geo));
+    }
+    return reports;
+}
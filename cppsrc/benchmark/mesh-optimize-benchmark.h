@@ -0,0 +1,26 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "utils/mesh-optimize-utils.h"
+
+// Run optimizeObjectGeometry over some generated meshes (and a text mesh file if given),
+// and verify the results with the software vertex cache simulator.
+struct MeshOptimizeBenchmarkReport {
+    std::string meshName = {};
+    size_t triangleCount = 0;
+    MeshOptimizeReport optimizeReport = {};
+    double optimizeSecs = 0.0;
+    bool isTriangleSetKept = false; // TRUE if the same triangles are drawn after optimized.
+    bool hasDuplicateVertices = false; // TRUE if the mesh is built as a triangle soup, which must be welded.
+};
+
+std::vector<MeshOptimizeBenchmarkReport> runMeshOptimizeBenchmark(const std::string& textPath);
@@ -0,0 +1,162 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <cstring>
+#include <d3d12.h>
+#include <memory>
+#include <unordered_map>
+
+#include "bench-utils.h"
+#include "obj-consts-benchmark.h"
+#include "utils/obj-consts-utils.h"
+
+namespace {
+
+constexpr UINT OBJ_CONST_SEAT_SIZE = 256;
+
+// The legacy render items are iterated through the name table just like pCore->ritems.
+struct LegacyRitem {
+    RenderItem* ritem = nullptr;
+    int numDirtyFrames = NUM_FRAME_RESOURCES;
+};
+
+// Same as dev_updateCoreObjConsts before the dirty seat ranges. Return the seats written.
+uint64_t updateLegacyObjConsts(std::unordered_map<std::string, LegacyRitem>& ritems, BYTE* objConstBuff) {
+    uint64_t seatWriteCount = 0;
+    for (auto& kv : ritems) {
+        auto& item = kv.second;
+        if (item.numDirtyFrames > 0) {
+            for (UINT i = 0; i < item.ritem->objConstBuffSeatCount; ++i) {
+                memcpy(objConstBuff + (item.ritem->objConstBuffStartIdx + i) * OBJ_CONST_SEAT_SIZE,
+                    &item.ritem->constData[i], sizeof(ObjConsts));
+            }
+            seatWriteCount += item.ritem->objConstBuffSeatCount;
+            item.numDirtyFrames--;
+        }
+    }
+    return seatWriteCount;
+}
+
+void randomizeObjConsts(BenchRandom* rng, ObjConsts* consts) {
+    consts->worldTrans._41 = benchRandfloat(-100.0f, 100.0f, rng);
+    consts->worldTrans._42 = benchRandfloat(-100.0f, 100.0f, rng);
+    consts->worldTrans._43 = benchRandfloat(-100.0f, 100.0f, rng);
+    consts->invTrWorldTrans._14 = -consts->worldTrans._41;
+    consts->invTrWorldTrans._24 = -consts->worldTrans._42;
+    consts->invTrWorldTrans._34 = -consts->worldTrans._43;
+}
+
+bool runItemCount(const ObjConstsBenchmarkDesc& desc, uint32_t itemCount, BenchRandom* rng,
+    ObjConstsBenchmarkResult* result, std::string* errorMessage)
+{
+    std::vector<std::unique_ptr<RenderItem>> ritems = {};
+    std::unordered_map<std::string, LegacyRitem> legacyRitems = {};
+    UINT seatCount = 0;
+    for (uint32_t i = 0; i < itemCount; ++i) {
+        auto ritem = std::make_unique<RenderItem>();
+        ritem->objConstBuffStartIdx = seatCount;
+        ritem->objConstBuffSeatCount = (UINT)benchRandint(1, desc.maxSeatCount, rng);
+        ritem->constData.resize(ritem->objConstBuffSeatCount);
+        for (auto& consts : ritem->constData) {
+            randomizeObjConsts(rng, &consts);
+        }
+        seatCount += ritem->objConstBuffSeatCount;
+
+        legacyRitems["ritem" + std::to_string(i)].ritem = ritem.get();
+        ritems.push_back(std::move(ritem));
+    }
+
+    size_t buffSize = (size_t)seatCount * OBJ_CONST_SEAT_SIZE;
+    std::vector<BYTE> legacyBuffs[NUM_FRAME_RESOURCES] = {};
+    std::vector<BYTE> dirtyBuffs[NUM_FRAME_RESOURCES] = {};
+    DirtySeatSet seatSets[NUM_FRAME_RESOURCES] = {};
+    DirtySeatSet* ppSeatSet[NUM_FRAME_RESOURCES] = {};
+    for (int i = 0; i < NUM_FRAME_RESOURCES; ++i) {
+        legacyBuffs[i].assign(buffSize, 0);
+        dirtyBuffs[i].assign(buffSize, 0);
+        seatSets[i].reset(seatCount);
+        ppSeatSet[i] = &seatSets[i];
+    }
+
+    // Same as createFrameResources.
+    ObjConstsShadow shadow = {};
+    initObjConstsShadow(seatCount, OBJ_CONST_SEAT_SIZE, 0, &shadow);
+    for (auto& ritem : ritems) queueRitemObjConsts(ritem.get(), &shadow);
+
+    uint32_t churnCount = (uint32_t)(itemCount * desc.churnRatio);
+    double legacySecs = 0.0, dirtySecs = 0.0;
+    uint64_t legacySeatWrites = 0, dirtySeatWrites = 0, dirtyRangeWrites = 0;
+    for (int frame = 0; frame < desc.frameCount; ++frame) {
+        if (frame > 0) {
+            for (uint32_t i = 0; i < churnCount; ++i) {
+                uint32_t idx = (uint32_t)benchRandint(0, (int)itemCount - 1, rng);
+                auto& ritem = ritems[idx];
+                randomizeObjConsts(rng, &ritem->constData[benchRandint(0, (int)ritem->objConstBuffSeatCount - 1, rng)]);
+
+                legacyRitems["ritem" + std::to_string(idx)].numDirtyFrames = NUM_FRAME_RESOURCES;
+                queueRitemObjConsts(ritem.get(), &shadow);
+            }
+        }
+
+        int resourceIdx = frame % NUM_FRAME_RESOURCES;
+        auto t0 = BenchClock::now();
+        uint64_t legacyWrites = updateLegacyObjConsts(legacyRitems, legacyBuffs[resourceIdx].data());
+        auto t1 = BenchClock::now();
+        flushObjConstsShadow(&shadow, ppSeatSet, nullptr, NUM_FRAME_RESOURCES);
+        auto stats = writeDirtyObjConsts(shadow, &seatSets[resourceIdx], dirtyBuffs[resourceIdx].data());
+        auto t2 = BenchClock::now();
+
+        if (memcmp(legacyBuffs[resourceIdx].data(), dirtyBuffs[resourceIdx].data(), buffSize) != 0) {
+            *errorMessage = "object constants buffers differ at frame " + std::to_string(frame) +
+                " of " + std::to_string(itemCount) + " items";
+            return false;
+        }
+
+        if (frame >= NUM_FRAME_RESOURCES) {
+            legacySecs += secsBetween(t0, t1);
+            dirtySecs += secsBetween(t1, t2);
+            legacySeatWrites += legacyWrites;
+            dirtySeatWrites += stats.seatCount;
+            dirtyRangeWrites += stats.rangeCount;
+        }
+    }
+
+    int countedFrameCount = desc.frameCount - NUM_FRAME_RESOURCES;
+    result->itemCount = itemCount;
+    result->seatCount = seatCount;
+    result->legacySecs = legacySecs / countedFrameCount;
+    result->dirtySecs = dirtySecs / countedFrameCount;
+    result->legacySeatWrites = (double)legacySeatWrites / countedFrameCount;
+    result->dirtySeatWrites = (double)dirtySeatWrites / countedFrameCount;
+    result->dirtyRangeWrites = (double)dirtyRangeWrites / countedFrameCount;
+    return true;
+}
+
+} // namespace
+
+ObjConstsBenchmarkReport runObjConstsBenchmark(const ObjConstsBenchmarkDesc& desc) {
+    ObjConstsBenchmarkReport report = {};
+    if (desc.frameCount <= NUM_FRAME_RESOURCES || desc.maxSeatCount < 1) {
+        report.errorMessage = "frame count must be greater than " + std::to_string(NUM_FRAME_RESOURCES) +
+            " and seat count must be positive";
+        return report;
+    }
+
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+    for (uint32_t itemCount : desc.itemCounts) {
+        ObjConstsBenchmarkResult result = {};
+        if (itemCount == 0 || !runItemCount(desc, itemCount, &rng, &result, &report.errorMessage)) {
+            if (report.errorMessage.empty()) report.errorMessage = "item count must be positive";
+            return report;
+        }
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
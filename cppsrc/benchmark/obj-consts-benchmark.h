@@ -0,0 +1,44 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Change the object constants of a random part of the render items every frame, and update the object
+// constants buffers of NUM_FRAME_RESOURCES frame resources (plain memory here) in turn, once with the
+// legacy full scan of dev_updateCoreObjConsts (per-item dirty frame counts and one memcpy per seat) and
+// once with the dirty seat ranges (see utils/obj-consts-utils.h). The buffers written by both paths are
+// compared every frame, so a missed seat is reported as an error.
+struct ObjConstsBenchmarkDesc {
+    std::vector<uint32_t> itemCounts = { 10000, 100000 };
+    float churnRatio = 0.01f; // Ratio of the render items changed per frame.
+    int maxSeatCount = 2; // Seats of a render item are in [1, maxSeatCount].
+    int frameCount = 200;
+    uint64_t seed = 0;
+};
+
+// The first NUM_FRAME_RESOURCES frames write all seats, so they are not counted.
+struct ObjConstsBenchmarkResult {
+    uint32_t itemCount = 0;
+    uint32_t seatCount = 0;
+    double legacySecs = 0.0; // Per frame.
+    double dirtySecs = 0.0; // Per frame, the flush included.
+    double legacySeatWrites = 0.0; // Per frame.
+    double dirtySeatWrites = 0.0; // Per frame.
+    double dirtyRangeWrites = 0.0; // memcpy calls per frame.
+};
+
+struct ObjConstsBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<ObjConstsBenchmarkResult> results = {};
+};
+
+ObjConstsBenchmarkReport runObjConstsBenchmark(const ObjConstsBenchmarkDesc& desc);
@@ -0,0 +1,247 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+
+#include "bench-utils.h"
+#include "postprocess-graph-benchmark.h"
+#include "utils/postprocess-graph-utils.h"
+
+namespace {
+
+// The kinds of the nodes in devfunc, see the outline overlay there.
+constexpr int BLUR = 0, SOBEL = 1, MULTIPLY = 2, SOBEL_MULTIPLY = 3, COPY = 4;
+
+UINT addResource(const std::string& name, bool isExternal, PostProcessGraphDesc* desc) {
+    desc->resources.push_back({ name, isExternal });
+    return (UINT)desc->resources.size() - 1;
+}
+
+void addNode(const std::string& name, int kind, std::vector<UINT> inputs, UINT output, PostProcessGraphDesc* desc) {
+    PostProcessNodeDesc node = {};
+    node.name = name;
+    node.kind = kind;
+    node.inputs = std::move(inputs);
+    node.output = output;
+    node.isPointwise = kind == MULTIPLY;
+    node.isCopy = kind == COPY;
+    desc->nodes.push_back(node);
+}
+
+// The Sobel edges multiplied onto the frame.
+PostProcessGraphDesc makeOutlineGraph() {
+    PostProcessGraphDesc desc = {};
+    UINT frame = addResource("frame", true, &desc);
+    UINT edges = addResource("edges", false, &desc);
+    UINT outlined = addResource("outlined", false, &desc);
+    addNode("sobel", SOBEL, { frame }, edges, &desc);
+    addNode("multiply", MULTIPLY, { frame, edges }, outlined, &desc);
+    desc.fusionRules = { { SOBEL, MULTIPLY, SOBEL_MULTIPLY } };
+    desc.finalOutput = outlined;
+    return desc;
+}
+
+// The blur and the outline overlay chained by the copies between the postprocessors, like devfunc would
+// if each postprocessor owned its input and output.
+PostProcessGraphDesc makeCopyChainGraph() {
+    PostProcessGraphDesc desc = {};
+    UINT frame = addResource("frame", true, &desc);
+    UINT blurInput = addResource("blur input", false, &desc);
+    UINT blurred = addResource("blurred", false, &desc);
+    UINT sobelInput = addResource("sobel input", false, &desc);
+    UINT edges = addResource("edges", false, &desc);
+    UINT compositorInput = addResource("compositor input", false, &desc);
+    UINT outlined = addResource("outlined", false, &desc);
+    UINT result = addResource("result", false, &desc);
+    addNode("copy to blur", COPY, { frame }, blurInput, &desc);
+    addNode("blur", BLUR, { blurInput }, blurred, &desc);
+    addNode("copy to sobel", COPY, { blurred }, sobelInput, &desc);
+    addNode("sobel", SOBEL, { sobelInput }, edges, &desc);
+    addNode("copy to compositor", COPY, { blurred }, compositorInput, &desc);
+    addNode("multiply", MULTIPLY, { compositorInput, edges }, outlined, &desc);
+    addNode("copy to result", COPY, { outlined }, result, &desc);
+    desc.fusionRules = { { SOBEL, MULTIPLY, SOBEL_MULTIPLY } };
+    desc.finalOutput = result;
+    return desc;
+}
+
+PostProcessGraphDesc makeChainGraph(int nodeCount) {
+    PostProcessGraphDesc desc = {};
+    UINT input = addResource("frame", true, &desc);
+    for (int i = 0; i < nodeCount; ++i) {
+        UINT output = addResource("r" + std::to_string(i), false, &desc);
+        addNode("n" + std::to_string(i), BLUR, { input }, output, &desc);
+        input = output;
+    }
+    desc.finalOutput = input;
+    return desc;
+}
+
+// Each node reads 1 to 3 of the last 8 resources, so the lifetimes are short like the real chains. Some outputs
+// are external (e.g. the history buffers) and the rest are transient, and the nodes are shuffled.
+PostProcessGraphDesc makeRandomGraph(uint32_t nodeCount, BenchRandom* rng) {
+    PostProcessGraphDesc desc = {};
+    addResource("frame", true, &desc);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        UINT resourceCount = (UINT)desc.resources.size();
+        int kind = benchRandint(0, 9, rng) == 0 ? COPY : benchRandint(BLUR, SOBEL_MULTIPLY, rng);
+        int inputCount = kind == COPY ? 1 : benchRandint(1, 3, rng);
+        std::vector<UINT> inputs = {};
+        for (int k = 0; k < inputCount; ++k) {
+            inputs.push_back((UINT)benchRandint((int)(std::max)(resourceCount, 8u) - 8, (int)resourceCount - 1, rng));
+        }
+        UINT output = addResource("r" + std::to_string(i), benchRandint(0, 19, rng) == 0, &desc);
+        addNode("n" + std::to_string(i), kind, inputs, output, &desc);
+    }
+    for (size_t i = desc.nodes.size(); i > 1; --i) {
+        std::swap(desc.nodes[i - 1], desc.nodes[benchRandint(0, (int)i - 1, rng)]);
+    }
+    desc.fusionRules = { { SOBEL, MULTIPLY, SOBEL_MULTIPLY }, { BLUR, MULTIPLY, BLUR }, { SOBEL_MULTIPLY, MULTIPLY, SOBEL_MULTIPLY } };
+    desc.finalOutput = (UINT)desc.resources.size() - 1;
+    return desc;
+}
+
+// Compile and validate the graph, and check the counts of the plan (-1 to skip).
+bool checkGraph(const std::string& graphName, const PostProcessGraphDesc& desc, int passCount, int transientTextureCount,
+    int droppedCopyCount, int fusedNodeCount, PostProcessPlan* plan, std::string* errorMessage)
+{
+    std::string message = {};
+    if (!compilePostProcessGraph(desc, plan, &message) || !validatePostProcessPlan(desc, *plan, &message)) {
+        *errorMessage = graphName + ": " + message;
+        return false;
+    }
+    auto isExpected = [](int expected, size_t value) { return expected < 0 || (size_t)expected == value; };
+    if (!isExpected(passCount, plan->passes.size()) || !isExpected(transientTextureCount, plan->transientTextureCount) ||
+        !isExpected(droppedCopyCount, plan->droppedCopyCount) || !isExpected(fusedNodeCount, plan->fusedNodeCount))
+    {
+        *errorMessage = graphName + ": " + std::to_string(plan->passes.size()) + " passes, " +
+            std::to_string(plan->transientTextureCount) + " textures, " + std::to_string(plan->droppedCopyCount) +
+            " dropped copies, " + std::to_string(plan->fusedNodeCount) + " fused nodes are not expected";
+        return false;
+    }
+    return true;
+}
+
+bool checkFixedGraphs(std::string* errorMessage) {
+    PostProcessPlan plan = {};
+    if (!checkGraph("outline", makeOutlineGraph(), 1, 1, 0, 1, &plan, errorMessage)) return false;
+    if (plan.passes[0].kind != SOBEL_MULTIPLY || plan.passes[0].inputResources.size() != 1) {
+        *errorMessage = "outline: the fused pass must be SOBEL_MULTIPLY reading only the frame";
+        return false;
+    }
+
+    auto copyChain = makeCopyChainGraph();
+    if (!checkGraph("copy chain", copyChain, 2, 2, 4, 1, &plan, errorMessage)) return false;
+    // The validation must catch the output of the fused pass overwriting the blurred frame it reads.
+    plan.passes[1].outputTexture = plan.passes[0].outputTexture;
+    if (validatePostProcessPlan(copyChain, plan)) {
+        *errorMessage = "copy chain: the validation misses a texture overwritten in use";
+        return false;
+    }
+
+    if (!checkGraph("chain", makeChainGraph(16), 16, 2, 0, 0, &plan, errorMessage)) return false;
+
+    PostProcessGraphDesc desc = {};
+    UINT a = addResource("a", false, &desc);
+    UINT b = addResource("b", false, &desc);
+    addNode("n0", BLUR, { a }, b, &desc);
+    addNode("n1", BLUR, { b }, a, &desc);
+    desc.finalOutput = b;
+    if (compilePostProcessGraph(desc, &plan)) {
+        *errorMessage = "cycle: the graph is not rejected";
+        return false;
+    }
+    desc.nodes[1].kind = COPY;
+    desc.nodes[1].isCopy = true;
+    desc.nodes[0] = desc.nodes[1];
+    desc.nodes[0].inputs = { b };
+    desc.nodes[0].output = a;
+    desc.nodes[1].inputs = { a };
+    desc.nodes[1].output = b;
+    if (compilePostProcessGraph(desc, &plan)) {
+        *errorMessage = "copy cycle: the graph is not rejected";
+        return false;
+    }
+
+    desc = makeOutlineGraph();
+    addNode("blur", BLUR, { 0 }, 1, &desc);
+    if (compilePostProcessGraph(desc, &plan)) {
+        *errorMessage = "2 writers: the graph is not rejected";
+        return false;
+    }
+
+    desc = makeOutlineGraph();
+    desc.nodes.erase(desc.nodes.begin());
+    if (compilePostProcessGraph(desc, &plan)) {
+        *errorMessage = "unwritten read: the graph is not rejected";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+PostProcessGraphBenchmarkReport runPostProcessGraphBenchmark(const PostProcessGraphBenchmarkDesc& desc) {
+    PostProcessGraphBenchmarkReport report = {};
+    if (desc.graphCount <= 0 || desc.repeatCount <= 0) {
+        report.errorMessage = "graph count and repeat count must be positive";
+        return report;
+    }
+    if (!checkFixedGraphs(&report.errorMessage)) return report;
+
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+    for (uint32_t nodeCount : desc.nodeCounts) {
+        PostProcessGraphBenchmarkResult result = {};
+        result.nodeCount = nodeCount;
+        result.resourceCount = nodeCount + 1;
+
+        std::vector<PostProcessGraphDesc> graphs = {};
+        for (int i = 0; i < desc.graphCount; ++i) graphs.push_back(makeRandomGraph(nodeCount, &rng));
+
+        std::vector<PostProcessPlan> plans(graphs.size());
+        for (int i = 0; i < desc.repeatCount; ++i) {
+            auto start = BenchClock::now();
+            for (size_t g = 0; g < graphs.size(); ++g) {
+                if (!compilePostProcessGraph(graphs[g], &plans[g], &report.errorMessage)) {
+                    report.errorMessage = "random graph of " + std::to_string(nodeCount) + " nodes: " + report.errorMessage;
+                    return report;
+                }
+            }
+            double secs = secsBetween(start, BenchClock::now()) / graphs.size();
+            result.compileSecs = i == 0 ? secs : (std::min)(result.compileSecs, secs);
+        }
+
+        auto start = BenchClock::now();
+        for (size_t g = 0; g < graphs.size(); ++g) {
+            if (!validatePostProcessPlan(graphs[g], plans[g], &report.errorMessage)) {
+                report.errorMessage = "random graph of " + std::to_string(nodeCount) + " nodes: " + report.errorMessage;
+                return report;
+            }
+        }
+        result.validateSecs = secsBetween(start, BenchClock::now()) / graphs.size();
+
+        for (auto& plan : plans) {
+            result.passCount += plan.passes.size();
+            result.transientResourceCount += plan.transientResourceCount;
+            result.transientTextureCount += plan.transientTextureCount;
+            result.droppedCopyCount += plan.droppedCopyCount;
+            result.droppedNodeCount += plan.droppedNodeCount;
+            result.fusedNodeCount += plan.fusedNodeCount;
+            result.barrierCount += plan.barrierCount;
+        }
+        for (double* count : { &result.passCount, &result.transientResourceCount, &result.transientTextureCount,
+            &result.droppedCopyCount, &result.droppedNodeCount, &result.fusedNodeCount, &result.barrierCount })
+        {
+            *count /= plans.size();
+        }
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
@@ -0,0 +1,49 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compile the post-processing graphs (See utils/postprocess-graph-utils.h) and validate the plans.
+// First the fixed graphs are checked against their expected plans: the outline overlay of devfunc fuses into a
+// single pass, the copies of a blur + outline chain are dropped, a long chain takes 2 textures, and the invalid
+// graphs (a cycle, 2 writers, an unwritten read) are rejected. Then random DAGs of nodeCounts nodes (with copies,
+// dead nodes and pointwise nodes) are compiled and validated, and the compile time is reported.
+struct PostProcessGraphBenchmarkDesc {
+    std::vector<uint32_t> nodeCounts = { 10, 100, 1000 };
+    int graphCount = 100; // Random graphs of each node count to validate.
+    int repeatCount = 10;
+    uint64_t seed = 0;
+};
+
+struct PostProcessGraphBenchmarkResult {
+    uint32_t nodeCount = 0;
+    uint32_t resourceCount = 0;
+
+    // Averaged over the random graphs.
+    double passCount = 0.0;
+    double transientResourceCount = 0.0;
+    double transientTextureCount = 0.0;
+    double droppedCopyCount = 0.0;
+    double droppedNodeCount = 0.0;
+    double fusedNodeCount = 0.0;
+    double barrierCount = 0.0;
+
+    double compileSecs = 0.0; // Per graph, best of the repeats.
+    double validateSecs = 0.0; // Per graph.
+};
+
+struct PostProcessGraphBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    std::vector<PostProcessGraphBenchmarkResult> results = {};
+};
+
+PostProcessGraphBenchmarkReport runPostProcessGraphBenchmark(const PostProcessGraphBenchmarkDesc& desc);
@@ -0,0 +1,243 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "bench-utils.h"
+#include "ray-cast-benchmark.h"
+#include "utils/bvh-utils.h"
+#include "utils/mesh-file-utils.h"
+#include "utils/ray-cast-utils.h"
+#include "utils/thread-utils.h"
+
+namespace {
+
+struct Ray {
+    XMFLOAT3 origin = {}, dir = {};
+};
+
+// Rays 4i ~ 4i + 3 make packet i, and the set is padded with the inactive rays of tMax 0.
+struct RaySet {
+    std::vector<Ray> rays = {};
+    std::vector<float> tMaxes = {};
+    std::vector<RayPacket> packets = {};
+};
+
+void packRaySet(RaySet* set) {
+    while (set->rays.size() % 4 != 0) {
+        set->rays.push_back(set->rays.back());
+        set->tMaxes.push_back(0.0f);
+    }
+    set->packets.resize(set->rays.size() / 4);
+    for (size_t i = 0; i < set->packets.size(); ++i) {
+        const Ray* r = &set->rays[4 * i];
+        const float* tMax = &set->tMaxes[4 * i];
+        auto& packet = set->packets[i];
+        packet.originX = XMVectorSet(r[0].origin.x, r[1].origin.x, r[2].origin.x, r[3].origin.x);
+        packet.originY = XMVectorSet(r[0].origin.y, r[1].origin.y, r[2].origin.y, r[3].origin.y);
+        packet.originZ = XMVectorSet(r[0].origin.z, r[1].origin.z, r[2].origin.z, r[3].origin.z);
+        packet.dirX = XMVectorSet(r[0].dir.x, r[1].dir.x, r[2].dir.x, r[3].dir.x);
+        packet.dirY = XMVectorSet(r[0].dir.y, r[1].dir.y, r[2].dir.y, r[3].dir.y);
+        packet.dirZ = XMVectorSet(r[0].dir.z, r[1].dir.z, r[2].dir.z, r[3].dir.z);
+        packet.tMax = XMVectorSet(tMax[0], tMax[1], tMax[2], tMax[3]);
+    }
+}
+
+// The camera looks at the center along +Z from 2.5 radii away with a 45 degree field of view.
+void generatePrimaryRays(XMFLOAT3 center, float radius, int imageSize, RaySet* set) {
+    XMFLOAT3 eye = { center.x, center.y, center.z - 2.5f * radius };
+    float tanHalfFov = std::tan(0.125f * XM_PI);
+    auto pixelDir = [&](int x, int y) {
+        return XMFLOAT3{ ((x + 0.5f) / imageSize * 2.0f - 1.0f) * tanHalfFov, (1.0f - (y + 0.5f) / imageSize * 2.0f) * tanHalfFov, 1.0f };
+    };
+    // 2 x 2 pixels per packet.
+    for (int y = 0; y < imageSize; y += 2) {
+        for (int x = 0; x < imageSize; x += 2) {
+            for (int k = 0; k < 4; ++k) {
+                int px = (std::min)(x + (k & 1), imageSize - 1), py = (std::min)(y + (k >> 1), imageSize - 1);
+                set->rays.push_back({ eye, pixelDir(px, py) });
+                set->tMaxes.push_back(FLT_MAX);
+            }
+        }
+    }
+    packRaySet(set);
+}
+
+// From a random point on the sphere of 2 radii to a random point in the bounds, and tMax is 1.
+void generateRandomRays(XMFLOAT3 center, float radius, XMFLOAT3 extents, int rayCount, BenchRandom* rng, RaySet* set) {
+    for (int i = 0; i < rayCount; ++i) {
+        XMVECTOR onSphere;
+        do {
+            onSphere = XMVectorSet(benchRandfloat(-1.0f, 1.0f, rng), benchRandfloat(-1.0f, 1.0f, rng), benchRandfloat(-1.0f, 1.0f, rng), 0.0f);
+        } while (XMVectorGetX(XMVector3LengthSq(onSphere)) > 1.0f || XMVectorGetX(XMVector3LengthSq(onSphere)) < 1e-4f);
+        XMFLOAT3 o, target;
+        XMStoreFloat3(&o, XMVectorAdd(XMLoadFloat3(&center), XMVectorScale(XMVector3Normalize(onSphere), 2.0f * radius)));
+        target = { center.x + benchRandfloat(-extents.x, extents.x, rng), center.y + benchRandfloat(-extents.y, extents.y, rng),
+            center.z + benchRandfloat(-extents.z, extents.z, rng) };
+        set->rays.push_back({ o, { target.x - o.x, target.y - o.y, target.z - o.z } });
+        set->tMaxes.push_back(1.0f);
+    }
+    packRaySet(set);
+}
+
+bool castBruteForce(const std::vector<TriangleBvhTri>& tris, const Ray& ray, float tMax, float* pT) {
+    bool isHit = false;
+    float tBest = tMax;
+    for (auto& tri : tris) {
+        float t, u, v;
+        if (intersectRayTriangle(ray.origin, ray.dir, tri, tBest, &t, &u, &v)) {
+            isHit = true;
+            tBest = t;
+        }
+    }
+    *pT = tBest;
+    return isHit;
+}
+
+// Time all queries of the set, and check that they agree with each other and with the brute force.
+bool runRaySet(const RayCastBenchmarkDesc& desc, const TriangleBvh& triBvh, const std::vector<TriangleBvhTri>& bruteTris,
+    const RaySet& set, RayCastSetResult* result, std::string* errorMessage)
+{
+    size_t rayCount = set.rays.size();
+    std::vector<RayHit> closest(rayCount), packetClosest(rayCount);
+    std::vector<char> isClosestHit(rayCount), isAnyHit(rayCount);
+    std::vector<int> packetClosestBits(set.packets.size()), packetAnyBits(set.packets.size());
+
+    auto t0 = BenchClock::now();
+    for (size_t i = 0; i < rayCount; ++i) {
+        isClosestHit[i] = castRayClosest(triBvh, XMLoadFloat3(&set.rays[i].origin), XMLoadFloat3(&set.rays[i].dir), set.tMaxes[i], &closest[i]);
+    }
+    auto t1 = BenchClock::now();
+    for (size_t i = 0; i < set.packets.size(); ++i) {
+        packetClosestBits[i] = castRayPacketClosest(triBvh, set.packets[i], &packetClosest[4 * i]);
+    }
+    auto t2 = BenchClock::now();
+    for (size_t i = 0; i < rayCount; ++i) {
+        isAnyHit[i] = castRayAny(triBvh, XMLoadFloat3(&set.rays[i].origin), XMLoadFloat3(&set.rays[i].dir), set.tMaxes[i]);
+    }
+    auto t3 = BenchClock::now();
+    for (size_t i = 0; i < set.packets.size(); ++i) {
+        packetAnyBits[i] = castRayPacketAny(triBvh, set.packets[i]);
+    }
+    auto t4 = BenchClock::now();
+    std::vector<RayHit> parallelHits(rayCount);
+    parallelFor(0, set.packets.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) castRayPacketClosest(triBvh, set.packets[i], &parallelHits[4 * i]);
+    });
+    auto t5 = BenchClock::now();
+
+    size_t hitCount = 0, activeCount = 0;
+    for (size_t i = 0; i < rayCount; ++i) {
+        bool isActive = set.tMaxes[i] > 0.0f;
+        activeCount += isActive ? 1 : 0;
+        hitCount += isClosestHit[i] ? 1 : 0;
+        bool isPacketHit = (packetClosestBits[i / 4] >> (i % 4)) & 1;
+        bool isPacketAnyHit = (packetAnyBits[i / 4] >> (i % 4)) & 1;
+        if (isPacketHit != (bool)isClosestHit[i] || (isClosestHit[i] && packetClosest[i].t != closest[i].t)) {
+            *errorMessage = "packet closest hit differs at ray " + std::to_string(i);
+            return false;
+        }
+        if ((bool)isAnyHit[i] != (bool)isClosestHit[i] || isPacketAnyHit != (bool)isClosestHit[i]) {
+            *errorMessage = "any hit differs from closest hit at ray " + std::to_string(i);
+            return false;
+        }
+        if (isActive && i < (size_t)desc.verifyCount) {
+            float t;
+            bool isBruteHit = castBruteForce(bruteTris, set.rays[i], set.tMaxes[i], &t);
+            if (isBruteHit != (bool)isClosestHit[i] || (isBruteHit && t != closest[i].t)) {
+                *errorMessage = "closest hit differs from brute force at ray " + std::to_string(i);
+                return false;
+            }
+        }
+    }
+
+    result->rayCount = activeCount;
+    result->hitRatio = activeCount > 0 ? (double)hitCount / activeCount : 0.0;
+    result->closestSecs = secsBetween(t0, t1);
+    result->packetClosestSecs = secsBetween(t1, t2);
+    result->anySecs = secsBetween(t2, t3);
+    result->packetAnySecs = secsBetween(t3, t4);
+    result->parallelPacketSecs = secsBetween(t4, t5);
+    return true;
+}
+
+bool runMesh(const RayCastBenchmarkDesc& desc, const std::string& meshName, const ObjectGeometry& geo, BenchRandom* rng,
+    RayCastBenchmarkResult* result, std::string* errorMessage)
+{
+    result->meshName = meshName;
+    result->triangleCount = geo.indices.size() / 3;
+
+    TriangleBvh triBvh = {};
+    auto t0 = BenchClock::now();
+    buildTriangleBvh(geo, desc.maxLeafSize, &triBvh);
+    result->buildSecs = secsBetween(t0, BenchClock::now());
+    result->nodeCount = triBvh.bvh.nodes.size();
+    result->sahCost = calcBvhSahCost(triBvh.bvh);
+
+    std::vector<TriangleBvhTri> bruteTris(result->triangleCount);
+    XMVECTOR boxMin = XMVectorReplicate(FLT_MAX), boxMax = XMVectorReplicate(-FLT_MAX);
+    for (size_t i = 0; i < bruteTris.size(); ++i) {
+        const XMFLOAT3& p0 = geo.vertices[geo.indices[3 * i]].pos;
+        const XMFLOAT3& p1 = geo.vertices[geo.indices[3 * i + 1]].pos;
+        const XMFLOAT3& p2 = geo.vertices[geo.indices[3 * i + 2]].pos;
+        bruteTris[i] = { p0, { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z }, { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z } };
+        for (auto p : { &p0, &p1, &p2 }) {
+            boxMin = XMVectorMin(boxMin, XMLoadFloat3(p));
+            boxMax = XMVectorMax(boxMax, XMLoadFloat3(p));
+        }
+    }
+    XMFLOAT3 center, extents;
+    XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f));
+    XMStoreFloat3(&extents, XMVectorScale(XMVectorSubtract(boxMax, boxMin), 0.5f));
+    float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&extents)));
+
+    RaySet primary = {}, random = {};
+    generatePrimaryRays(center, radius, desc.imageSize, &primary);
+    generateRandomRays(center, radius, extents, desc.randomRayCount, rng, &random);
+    if (!runRaySet(desc, triBvh, bruteTris, primary, &result->primary, errorMessage)) {
+        *errorMessage = meshName + " primary rays, " + *errorMessage;
+        return false;
+    }
+    if (!runRaySet(desc, triBvh, bruteTris, random, &result->random, errorMessage)) {
+        *errorMessage = meshName + " random rays, " + *errorMessage;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+RayCastBenchmarkReport runRayCastBenchmark(const RayCastBenchmarkDesc& desc) {
+    RayCastBenchmarkReport report = {};
+    report.threadCount = workerThreadCount();
+    if (desc.maxLeafSize == 0 || desc.imageSize <= 0 || desc.randomRayCount <= 0) {
+        report.errorMessage = "leaf size, image size and ray count must be positive";
+        return report;
+    }
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    std::vector<std::pair<std::string, ObjectGeometry>> meshes = {};
+    for (uint32_t level : desc.sphereLevels) {
+        meshes.push_back({ "geo-sphere (" + std::to_string(level) + ")", {} });
+        generateGeoSphere(1.0f, (int)level, &meshes.back().second);
+    }
+    if (!desc.textPath.empty()) {
+        meshes.push_back({ desc.textPath, {} });
+        if (!loadTextMeshFile(desc.textPath, &meshes.back().second, &report.errorMessage)) return report;
+    }
+
+    for (auto& mesh : meshes) {
+        RayCastBenchmarkResult result = {};
+        if (!runMesh(desc, mesh.first, mesh.second, &rng, &result, &report.errorMessage)) return report;
+        report.results.push_back(result);
+    }
+    report.isValid = true;
+    return report;
+}
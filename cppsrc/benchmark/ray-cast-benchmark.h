@@ -0,0 +1,58 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Build the triangle BVH (See utils/ray-cast-utils.h) of some geo-spheres and a text mesh file if given
+// (e.g. models/skull.txt), then cast 2 sets of rays at each mesh: the primary rays of a pinhole camera, which
+// are packed by 2 x 2 pixels, and the random rays between 2 points around the mesh, which are packed in order.
+// Every ray is cast by all of the closest-hit and any-hit queries, which must agree with each other, and the
+// first verifyCount rays of each set are checked against the brute force over all triangles.
+struct RayCastBenchmarkDesc {
+    std::string textPath = {};
+    std::vector<uint32_t> sphereLevels = { 3, 5, 7 };
+    uint32_t maxLeafSize = 4;
+    int imageSize = 512; // The primary rays are imageSize x imageSize.
+    int randomRayCount = 262144;
+    int verifyCount = 1000;
+    uint64_t seed = 0;
+};
+
+// Seconds of the whole set on a single thread, except parallelPacketSecs, which splits the packets across the
+// worker pool (See thread-utils.h).
+struct RayCastSetResult {
+    size_t rayCount = 0;
+    double hitRatio = 0.0;
+    double closestSecs = 0.0;
+    double packetClosestSecs = 0.0;
+    double anySecs = 0.0;
+    double packetAnySecs = 0.0;
+    double parallelPacketSecs = 0.0;
+};
+
+struct RayCastBenchmarkResult {
+    std::string meshName = {};
+    size_t triangleCount = 0;
+    size_t nodeCount = 0;
+    double buildSecs = 0.0;
+    float sahCost = 0.0f;
+    RayCastSetResult primary = {};
+    RayCastSetResult random = {};
+};
+
+struct RayCastBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    unsigned int threadCount = 0;
+    std::vector<RayCastBenchmarkResult> results = {};
+};
+
+RayCastBenchmarkReport runRayCastBenchmark(const RayCastBenchmarkDesc& desc);
@@ -0,0 +1,130 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "bench-utils.h"
+#include "ring-alloc-benchmark.h"
+#include "utils/ring-allocator.h"
+
+namespace {
+
+// The fence value is advanced by submit and the GPU completes the frames in order.
+struct FakeFence {
+    uint64_t nextValue = 1;
+    uint64_t completedValue = 0;
+};
+
+struct LiveRegion {
+    uint64_t end = 0;
+    uint64_t fenceValue = 0;
+};
+
+}
+
+static std::string describeRegion(uint64_t offset, uint64_t size) {
+    return "[" + std::to_string(offset) + ", " + std::to_string(offset + size) + ")";
+}
+
+// Return an empty string if the region does not break any rule, otherwise the error message.
+static std::string checkRegion(const std::map<uint64_t, LiveRegion>& live,
+    uint64_t offset, uint64_t size, uint64_t alignment, uint64_t capacity)
+{
+    if (offset + size > capacity) return "region out of bound " + describeRegion(offset, size);
+    if (offset % alignment != 0) return "region misaligned " + describeRegion(offset, size);
+    auto next = live.lower_bound(offset);
+    if (next != live.end() && next->first < offset + size) {
+        return "region " + describeRegion(offset, size) + " overlaps " + describeRegion(next->first, next->second.end - next->first);
+    }
+    if (next != live.begin()) {
+        auto prev = std::prev(next);
+        if (prev->second.end > offset) {
+            return "region " + describeRegion(offset, size) + " overlaps " + describeRegion(prev->first, prev->second.end - prev->first);
+        }
+    }
+    return "";
+}
+
+RingAllocBenchmarkReport runRingAllocBenchmark(const RingAllocBenchmarkDesc& desc) {
+    RingAllocBenchmarkReport report = {};
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    RingAllocator allocator(desc.capacity);
+    FakeFence fence = {};
+    std::map<uint64_t, LiveRegion> live = {}; // Keyed by the offsets.
+
+    auto completeFrame = [&](uint64_t fenceValue) {
+        fence.completedValue = fenceValue;
+        allocator.retire(fence.completedValue);
+        for (auto itor = live.begin(); itor != live.end();) {
+            if (itor->second.fenceValue <= fence.completedValue) itor = live.erase(itor);
+            else ++itor;
+        }
+    };
+
+    auto start = BenchClock::now();
+    uint64_t lastOffset = 0;
+    for (uint32_t frame = 0; frame < desc.frameCount; ++frame) {
+        uint64_t fenceValue = fence.nextValue;
+        int allocCount = benchRandint(1, (int)desc.maxAllocPerFrame, &rng);
+        for (int k = 0; k < allocCount; ++k) {
+            uint64_t size = (uint64_t)benchRandint(1, (int)desc.maxAllocSize, &rng);
+            uint64_t alignment = 1ull << benchRandint(0, 9, &rng);
+
+            uint64_t offset = allocator.allocate(size, alignment);
+            // Wait the oldest frame in flight until the region fits.
+            while (offset == RingAllocator::INVALID_OFFSET && fence.completedValue + 1 < fenceValue) {
+                ++report.stallCount;
+                completeFrame(fence.completedValue + 1);
+                offset = allocator.allocate(size, alignment);
+            }
+            if (offset == RingAllocator::INVALID_OFFSET) {
+                // An empty ring must hold any region not larger than itself.
+                if (live.empty() && size <= desc.capacity) {
+                    report.errorMessage = "no space for " + std::to_string(size) + " bytes in the empty ring";
+                    return report;
+                }
+                // Otherwise only the regions of the current frame are live, i.e. the frame is too large.
+                ++report.rejectCount;
+                continue;
+            }
+
+            std::string error = checkRegion(live, offset, size, alignment, desc.capacity);
+            if (!error.empty()) {
+                report.errorMessage = "frame " + std::to_string(frame) + ": " + error;
+                return report;
+            }
+            live[offset] = { offset + size, fenceValue };
+            if (offset < lastOffset) ++report.wrapCount;
+            lastOffset = offset;
+
+            ++report.allocCount;
+            report.allocBytes += size;
+            report.maxUsedSize = (std::max)(report.maxUsedSize, allocator.usedSize());
+        }
+        allocator.submit(fenceValue);
+        fence.nextValue++;
+
+        // The fake GPU lags behind by a random count of frames.
+        uint64_t latency = (uint64_t)benchRandint(0, (int)desc.maxLatency, &rng);
+        if (fenceValue > latency && fenceValue - latency > fence.completedValue) completeFrame(fenceValue - latency);
+    }
+    completeFrame(fence.nextValue - 1);
+    report.secs = secsBetween(start, BenchClock::now());
+
+    if (allocator.usedSize() != 0 || allocator.submittedBatchCount() != 0) {
+        report.errorMessage = std::to_string(allocator.usedSize()) + " bytes are not retired after all frames completed";
+        return report;
+    }
+    report.isValid = true;
+    return report;
+}
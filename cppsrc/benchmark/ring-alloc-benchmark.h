@@ -0,0 +1,37 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Stress RingAllocator (see utils/ring-allocator.h) against a fake fence, i.e. a simulated GPU which
+// completes the submitted frames with a random latency. Every allocation is checked against the
+// live regions (bounds, alignment and overlap), so any broken offset math is reported as an error.
+struct RingAllocBenchmarkDesc {
+    uint64_t capacity = 4ull << 20;
+    uint32_t frameCount = 100000;
+    uint32_t maxAllocPerFrame = 32;
+    uint32_t maxAllocSize = 64 * 1024;
+    uint32_t maxLatency = 3; // Max count of the frames in flight.
+    uint64_t seed = 0;
+};
+
+struct RingAllocBenchmarkReport {
+    bool isValid = false;
+    std::string errorMessage = {};
+    uint64_t allocCount = 0;
+    uint64_t allocBytes = 0;
+    uint64_t wrapCount = 0; // Times the regions wrap around the end.
+    uint64_t stallCount = 0; // Times the CPU has to wait the fake fence for free space.
+    uint64_t rejectCount = 0; // Regions which do not fit even if all previous frames are completed.
+    uint64_t maxUsedSize = 0;
+    double secs = 0.0;
+};
+
+RingAllocBenchmarkReport runRingAllocBenchmark(const RingAllocBenchmarkDesc& desc);
@@ -0,0 +1,49 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+
+#include "bench-utils.h"
+#include "subdivision-benchmark.h"
+#include "utils/geometry-utils.h"
+
+static SubdivisionBenchmarkReport measureSubdivision(int level, bool indexed, int repeatCount) {
+    SubdivisionBenchmarkReport report = {};
+    report.level = level;
+    report.indexed = indexed;
+    report.buildSecs = 1e30;
+
+    ObjectGeometry geo = {};
+    for (int k = 0; k < (std::max)(repeatCount, 1); ++k) {
+        // The same icosahedron as generateGeoSphere, which is created with a level 0 call.
+        generateGeoSphere(1.0f, 0, &geo);
+
+        auto start = BenchClock::now();
+        for (int i = 0; i < level; ++i) {
+            if (indexed) subdivideIndexed(&geo);
+            else subdivide(&geo);
+        }
+        report.buildSecs = (std::min)(report.buildSecs, secsBetween(start, BenchClock::now()));
+    }
+
+    report.vertexCount = geo.vertices.size();
+    report.indexCount = geo.indices.size();
+    report.byteSize = (size_t)(geo.vertexDataSize() + geo.indexDataSize());
+    report.checksum = fnv1a64(geo.vertices.data(), (size_t)geo.vertexDataSize());
+    report.checksum = fnv1a64(geo.indices.data(), (size_t)geo.indexDataSize(), report.checksum);
+    return report;
+}
+
+std::vector<SubdivisionBenchmarkReport> runSubdivisionBenchmark(int minLevel, int maxLevel, int repeatCount) {
+    std::vector<SubdivisionBenchmarkReport> reports = {};
+    for (int level = minLevel; level <= maxLevel; ++level) {
+        reports.push_back(measureSubdivision(level, false, repeatCount));
+        reports.push_back(measureSubdivision(level, true, repeatCount));
+    }
+    return reports;
+}
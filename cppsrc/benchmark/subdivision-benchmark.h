@@ -0,0 +1,24 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Compare subdivide and subdivideIndexed by building a geo-sphere of every level.
+struct SubdivisionBenchmarkReport {
+    int level = 0;
+    bool indexed = false;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t byteSize = 0; // Vertex data size + index data size.
+    double buildSecs = 0.0; // Best of several repeats.
+    uint64_t checksum = 0; // FNV-1a of the vertices and indices.
+};
+
+std::vector<SubdivisionBenchmarkReport> runSubdivisionBenchmark(int minLevel, int maxLevel, int repeatCount);
@@ -0,0 +1,53 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "bench-utils.h"
+#include "utils/mesh-file-utils.h"
+#include "vertex-pack-benchmark.h"
+
+static bool isErrorInBound(const PackedVertexError& error, const PackedVertexError& bound) {
+    return error.pos.x <= bound.pos.x && error.pos.y <= bound.pos.y && error.pos.z <= bound.pos.z &&
+        error.normalAngle <= bound.normalAngle && error.uv.x <= bound.uv.x && error.uv.y <= bound.uv.y;
+}
+
+static VertexPackBenchmarkReport measureVertexPack(const std::string& name, const ObjectGeometry* geo) {
+    VertexPackBenchmarkReport report = {};
+    report.meshName = name;
+    report.vertexCount = geo->vertices.size();
+    report.fullBytes = geo->vertices.size() * sizeof(Vertex);
+
+    PackedGeometry packed = {};
+    auto start = BenchClock::now();
+    packObjectGeometry(geo, &packed);
+    report.packSecs = secsBetween(start, BenchClock::now());
+    report.packedBytes = (size_t)packed.vertexDataSize();
+
+    report.error = measurePackedVertexError(geo, &packed);
+    report.bound = calcPackedVertexErrorBound(packed.dequantization);
+    report.isInBound = isErrorInBound(report.error, report.bound);
+    return report;
+}
+
+std::vector<VertexPackBenchmarkReport> runVertexPackBenchmark(const std::string& textPath) {
+    std::vector<VertexPackBenchmarkReport> reports = {};
+
+    ObjectGeometry geo = {};
+    generateGeoSphere(1.0f, 6, &geo);
+    reports.push_back(measureVertexPack("geo-sphere (6)", &geo));
+
+    generateGrid(10.0f, 10.0f, 512, 512, &geo);
+    reports.push_back(measureVertexPack("grid (1025x1025)", &geo));
+
+    generateCylinder(1.0f, 1.0f, 2.0f, 256, 256, &geo);
+    reports.push_back(measureVertexPack("cylinder (256)", &geo));
+
+    if (!textPath.empty() && loadTextMeshFile(textPath, &geo)) {
+        reports.push_back(measureVertexPack(textPath, &geo));
+    }
+    return reports;
+}
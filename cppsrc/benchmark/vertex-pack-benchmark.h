@@ -0,0 +1,28 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "utils/packed-vertex-utils.h"
+
+// Pack some generated meshes (and a text mesh file if given) into PackedVertex, and compare the
+// vertex bytes and the measured errors against the theoretical error bounds.
+struct VertexPackBenchmarkReport {
+    std::string meshName = {};
+    size_t vertexCount = 0;
+    size_t fullBytes = 0; // Vertex
+    size_t packedBytes = 0; // PackedVertex
+    double packSecs = 0.0;
+    PackedVertexError error = {};
+    PackedVertexError bound = {};
+    bool isInBound = false;
+};
+
+std::vector<VertexPackBenchmarkReport> runVertexPackBenchmark(const std::string& textPath);
@@ -0,0 +1,62 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "bench-utils.h"
+#include "modifier/wave-solver.h"
+#include "wave-benchmark.h"
+
+WaveBenchmarkReport runWaveBenchmark(const WaveBenchmarkDesc& desc) {
+    WaveBenchmarkReport report = {};
+
+    WaveGrid grid = {};
+    initWaveGrid(desc.M, desc.N, &grid);
+    if (desc.M < 3 || desc.N < 3) return report;
+
+    auto coef = calcWaveCoefficients(desc.d, desc.c, desc.u);
+
+    BenchRandom rng = {};
+    seedBenchRandom(desc.seed, &rng);
+
+    // The simulated clock advances by exactly one update interval per step, which is the same
+    // as WaveSimulator running with a frame time slightly longer than the update interval.
+    double lastDisturbSecs = -(double)desc.disturbCD;
+
+    auto start = BenchClock::now();
+    for (uint32_t step = 0; step < desc.stepCount; ++step) {
+        double simSecs = (double)step * coef.t;
+
+        // Wait disturb CD.
+        if (simSecs >= lastDisturbSecs + desc.disturbCD) {
+            lastDisturbSecs = simSecs;
+
+            int x = benchRandint(1, desc.M - 2, &rng);
+            int y = benchRandint(1, desc.N - 2, &rng);
+            float h = benchRandfloat(desc.hmin, desc.hmax, &rng);
+            disturbWaveGrid(x, y, h, &grid);
+            ++report.disturbCount;
+        }
+
+        if (desc.useReference) {
+            stepWaveGridReference(coef.a1, coef.a2, coef.a3, desc.d, &grid);
+        }
+        else {
+            stepWaveGrid(coef.a1, coef.a2, coef.a3, desc.d, &grid);
+        }
+    }
+    report.totalSecs = secsBetween(start, BenchClock::now());
+
+    double cellCount = (double)(desc.M - 2) * (desc.N - 2) * desc.stepCount;
+    if (cellCount > 0.0 && report.totalSecs > 0.0) {
+        report.nsPerCell = report.totalSecs * 1e9 / cellCount;
+        report.cellsPerSec = cellCount / report.totalSecs;
+        report.bytesPerSec = report.cellsPerSec * 6 * sizeof(float);
+    }
+
+    report.checksum = fnv1a64(grid.currHeights.data(), grid.currHeights.size() * sizeof(float));
+    return report;
+}
@@ -0,0 +1,39 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+
+// Replay the wave equation of WaveSimulator without D3DCore.
+// The wall clock and rand() are replaced by a fixed simulated clock and a seeded random generator,
+// so two runs with the same description always produce the same height field.
+struct WaveBenchmarkDesc {
+    uint32_t M = 513, N = 513; // Node count of each row and each column.
+    uint32_t stepCount = 100; // Count of update steps to replay.
+    uint64_t seed = 0;
+
+    // The same parameters as WaveSimulator.
+    float d = 0.1f, c = 1.0f, u = 0.2f;
+    float hmin = 0.2f, hmax = 0.6f;
+    float disturbCD = 0.02f; // Simulated seconds between 2 random disturbances.
+
+    bool useReference = false; // TRUE to replay with the scalar reference solver.
+};
+
+struct WaveBenchmarkReport {
+    double totalSecs = 0.0; // Wall time spent in disturb and update steps.
+    double nsPerCell = 0.0; // Per interior node per step.
+    double cellsPerSec = 0.0;
+    // Estimated from the minimum traffic of every interior node per step, i.e. read the current and
+    // previous heights, write the next height and 3 normal components: 6 * sizeof(float) = 24 bytes.
+    double bytesPerSec = 0.0;
+    uint32_t disturbCount = 0;
+    uint64_t checksum = 0; // FNV-1a of the final height field.
+};
+
+WaveBenchmarkReport runWaveBenchmark(const WaveBenchmarkDesc& desc);
@@ -0,0 +1,55 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <vector>
+using namespace DirectX;
+
+// Deep enough for any balanced tree, and the build makes a leaf of the whole range once this depth is reached,
+// so the traversal stacks can be fixed arrays.
+constexpr UINT BVH_MAX_DEPTH = 64;
+
+// childIdx of an empty child, e.g. the second child of the root when all primitives fit in one leaf.
+constexpr UINT BVH_EMPTY_CHILD = 0xffffffff;
+
+// A node holds the bounds of its 2 children, so that it takes exactly one cache line and both children are
+// tested with the node loaded once. The bounds of the root are the union of its children.
+struct alignas(64) BvhNode {
+    XMFLOAT3 childMin[2];
+    XMFLOAT3 childMax[2];
+    // Index into Bvh::nodes of an inner child, or the first index into Bvh::primIdx of a leaf child.
+    UINT childIdx[2];
+    // Primitive count of a leaf child, and 0 for an inner child.
+    UINT childCount[2];
+};
+static_assert(sizeof(BvhNode) == 64, "BvhNode must fit in a cache line");
+
+struct BvhPrimBounds {
+    XMFLOAT3 center;
+    XMFLOAT3 extents;
+};
+
+// Bounding volume hierarchy over the boxes of BoundsSoA (See utils/bvh-utils.h), i.e. the primitives are the
+// world-space bounds of the render items, and the primitive indices are RenderItem::boundsIdx.
+// The nodes are in depth-first order, so a parent is always before its children. The subtrees built in
+// parallel are stored one after another behind the top nodes, which is how the refit runs in parallel too.
+struct Bvh {
+    std::vector<BvhNode> nodes = {}; // nodes[0] is the root. It is empty if there is no bounded primitive.
+    std::vector<UINT> primIdx = {}; // Referenced by the leaves.
+    // Copies of the boxes in the order of primIdx, so the leaves read them contiguously instead of gathering them from BoundsSoA.
+    std::vector<BvhPrimBounds> primBounds = {};
+    std::vector<UINT> unboundedIdx = {}; // Primitives of infinite bounds, which are kept out of the tree.
+
+    UINT topNodeCount = 0;
+    std::vector<UINT> subtreeNodeBegin = {}; // Subtree i is [subtreeNodeBegin[i], subtreeNodeBegin[i + 1] or nodes.size()).
+
+    size_t primCount = 0; // BoundsSoA::count when built.
+    UINT maxLeafSize = 4;
+};
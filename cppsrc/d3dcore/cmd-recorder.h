@@ -0,0 +1,158 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+
+// Commands of a frame, i.e. the subset of ID3D12GraphicsCommandList used by the draw loops (see
+// frame-async-utils.h), the postprocessors and the modifiers. The methods have the same names and
+// parameters as ID3D12GraphicsCommandList, so the frame code records through D3DCore::cmdRecorder
+// without knowing the backend, e.g. D3D12CmdRecorder below or CmdStreamRecorder (see
+// utils/cmd-stream-recorder.h), which records the commands without any device.
+//
+// The commands to reset, close and execute the command list and to upload the resources are
+// still recorded with D3DCore::cmdList directly, since they need a real device anyway.
+class CmdRecorder {
+public:
+    virtual ~CmdRecorder() { }
+
+    // Pipeline States
+    virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+    virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSig) = 0;
+    virtual void SetComputeRootSignature(ID3D12RootSignature* rootSig) = 0;
+    virtual void SetDescriptorHeaps(UINT heapCount, ID3D12DescriptorHeap* const* heaps) = 0;
+
+    // Root Bindings
+    virtual void SetGraphicsRootConstantBufferView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) = 0;
+    virtual void SetGraphicsRootShaderResourceView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) = 0;
+    virtual void SetGraphicsRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) = 0;
+    virtual void SetGraphicsRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) = 0;
+    virtual void SetComputeRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) = 0;
+    virtual void SetComputeRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) = 0;
+    virtual void SetComputeRoot32BitConstants(UINT rootParamIdx, UINT valueCount, const void* data, UINT destOffset) = 0;
+
+    // Input Assembler, Rasterizer and Output Merger
+    virtual void IASetVertexBuffers(UINT startSlot, UINT viewCount, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+    virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+    virtual void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) = 0;
+    virtual void RSSetViewports(UINT viewportCount, const D3D12_VIEWPORT* viewports) = 0;
+    virtual void RSSetScissorRects(UINT rectCount, const D3D12_RECT* rects) = 0;
+    virtual void OMSetRenderTargets(UINT rtvCount, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvHandles,
+        BOOL isSingleHandleToDescRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsvHandle) = 0;
+
+    // Draws and Dispatches
+    virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) = 0;
+    virtual void Dispatch(UINT groupCountX, UINT groupCountY, UINT groupCountZ) = 0;
+
+    // Resources
+    virtual void ResourceBarrier(UINT barrierCount, const D3D12_RESOURCE_BARRIER* barriers) = 0;
+    virtual void CopyResource(ID3D12Resource* dest, ID3D12Resource* src) = 0;
+    virtual void ResolveSubresource(ID3D12Resource* dest, UINT destSubresource,
+        ID3D12Resource* src, UINT srcSubresource, DXGI_FORMAT format) = 0;
+    virtual void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, const FLOAT color[4],
+        UINT rectCount, const D3D12_RECT* rects) = 0;
+    virtual void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT rectCount, const D3D12_RECT* rects) = 0;
+
+    // Queries, e.g. the GPU timestamps of the postprocessors
+    virtual void EndQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT index) = 0;
+    virtual void ResolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT startIndex, UINT queryCount,
+        ID3D12Resource* destBuff, UINT64 alignedDestBuffOffset) = 0;
+};
+
+// Forward every command to the command list, which is the default backend of D3DCore::cmdRecorder.
+class D3D12CmdRecorder final : public CmdRecorder {
+public:
+    explicit D3D12CmdRecorder(ID3D12GraphicsCommandList* cmdList) : _cmdList(cmdList) {}
+
+    void SetPipelineState(ID3D12PipelineState* pso) override { _cmdList->SetPipelineState(pso); }
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSig) override { _cmdList->SetGraphicsRootSignature(rootSig); }
+    void SetComputeRootSignature(ID3D12RootSignature* rootSig) override { _cmdList->SetComputeRootSignature(rootSig); }
+    void SetDescriptorHeaps(UINT heapCount, ID3D12DescriptorHeap* const* heaps) override {
+        _cmdList->SetDescriptorHeaps(heapCount, heaps);
+    }
+
+    void SetGraphicsRootConstantBufferView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) override {
+        _cmdList->SetGraphicsRootConstantBufferView(rootParamIdx, addr);
+    }
+    void SetGraphicsRootShaderResourceView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) override {
+        _cmdList->SetGraphicsRootShaderResourceView(rootParamIdx, addr);
+    }
+    void SetGraphicsRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) override {
+        _cmdList->SetGraphicsRootDescriptorTable(rootParamIdx, handle);
+    }
+    void SetGraphicsRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) override {
+        _cmdList->SetGraphicsRoot32BitConstant(rootParamIdx, data, destOffset);
+    }
+    void SetComputeRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) override {
+        _cmdList->SetComputeRootDescriptorTable(rootParamIdx, handle);
+    }
+    void SetComputeRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) override {
+        _cmdList->SetComputeRoot32BitConstant(rootParamIdx, data, destOffset);
+    }
+    void SetComputeRoot32BitConstants(UINT rootParamIdx, UINT valueCount, const void* data, UINT destOffset) override {
+        _cmdList->SetComputeRoot32BitConstants(rootParamIdx, valueCount, data, destOffset);
+    }
+
+    void IASetVertexBuffers(UINT startSlot, UINT viewCount, const D3D12_VERTEX_BUFFER_VIEW* views) override {
+        _cmdList->IASetVertexBuffers(startSlot, viewCount, views);
+    }
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override { _cmdList->IASetIndexBuffer(view); }
+    void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) override { _cmdList->IASetPrimitiveTopology(topology); }
+    void RSSetViewports(UINT viewportCount, const D3D12_VIEWPORT* viewports) override {
+        _cmdList->RSSetViewports(viewportCount, viewports);
+    }
+    void RSSetScissorRects(UINT rectCount, const D3D12_RECT* rects) override { _cmdList->RSSetScissorRects(rectCount, rects); }
+    void OMSetRenderTargets(UINT rtvCount, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvHandles,
+        BOOL isSingleHandleToDescRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsvHandle) override
+    {
+        _cmdList->OMSetRenderTargets(rtvCount, rtvHandles, isSingleHandleToDescRange, dsvHandle);
+    }
+
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override
+    {
+        _cmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+    }
+    void Dispatch(UINT groupCountX, UINT groupCountY, UINT groupCountZ) override {
+        _cmdList->Dispatch(groupCountX, groupCountY, groupCountZ);
+    }
+
+    void ResourceBarrier(UINT barrierCount, const D3D12_RESOURCE_BARRIER* barriers) override {
+        _cmdList->ResourceBarrier(barrierCount, barriers);
+    }
+    void CopyResource(ID3D12Resource* dest, ID3D12Resource* src) override { _cmdList->CopyResource(dest, src); }
+    void ResolveSubresource(ID3D12Resource* dest, UINT destSubresource,
+        ID3D12Resource* src, UINT srcSubresource, DXGI_FORMAT format) override
+    {
+        _cmdList->ResolveSubresource(dest, destSubresource, src, srcSubresource, format);
+    }
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, const FLOAT color[4],
+        UINT rectCount, const D3D12_RECT* rects) override
+    {
+        _cmdList->ClearRenderTargetView(rtvHandle, color, rectCount, rects);
+    }
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT rectCount, const D3D12_RECT* rects) override
+    {
+        _cmdList->ClearDepthStencilView(dsvHandle, clearFlags, depth, stencil, rectCount, rects);
+    }
+
+    void EndQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT index) override {
+        _cmdList->EndQuery(queryHeap, type, index);
+    }
+    void ResolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT startIndex, UINT queryCount,
+        ID3D12Resource* destBuff, UINT64 alignedDestBuffOffset) override
+    {
+        _cmdList->ResolveQueryData(queryHeap, type, startIndex, queryCount, destBuff, alignedDestBuffOffset);
+    }
+
+private:
+    ID3D12GraphicsCommandList* _cmdList = nullptr;
+};
@@ -0,0 +1,29 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+using namespace DirectX;
+
+// World-space axis-aligned bounding boxes of the render items in SoA form, so that the frustum test
+// loads the same component of 8 boxes at a time. The arrays are padded to a multiple of 8 boxes, and the
+// padding boxes are never reported visible. Box i belongs to the render item of RenderItem::boundsIdx i.
+// See utils/culling-utils.h.
+struct BoundsSoA {
+    size_t count = 0;
+
+    std::vector<float> centerX = {}, centerY = {}, centerZ = {};
+    std::vector<float> extentX = {}, extentY = {}, extentZ = {};
+};
+
+// A point p is inside the frustum if dot(plane.xyz, p) + plane.w >= 0 for all planes.
+// The order is left, right, bottom, top, near and far.
+struct Frustum {
+    XMFLOAT4 planes[6] = {};
+};
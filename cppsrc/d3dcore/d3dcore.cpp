@@ -10,10 +10,14 @@
 
 #include "d3dcore.h"
 #include "toolbox/DDSTextureLoader.h"
+#include "utils/culling-utils.h"
 #include "utils/debugger.h"
 #include "utils/frame-async-utils.h"
+#include "utils/geometry-pool-utils.h"
+#include "utils/obj-consts-utils.h"
 #include "utils/render-item-utils.h"
 #include "utils/timer-utils.h"
+#include "utils/upload-ring-utils.h"
 #include "utils/vmesh-utils.h"
 
 std::pair<int, int> getWndSize(HWND hWnd) {
@@ -23,6 +27,7 @@ std::pair<int, int> getWndSize(HWND hWnd) {
 }
 
 void flushCmdQueue(D3DCore* pCore) {
+    ++pCore->cmdQueueStallCount;
     pCore->currFenceValue++;
     checkHR(pCore->cmdQueue->Signal(pCore->fence.Get(), pCore->currFenceValue));
     if (pCore->fence->GetCompletedValue() < pCore->currFenceValue) {
@@ -62,6 +67,9 @@ void createD3DCore(HWND hWnd, XMFLOAT4 clearColor, D3DCore** ppCore) {
     checkFeatureSupports(pCore);
 
     createCmdObjs(pCore);
+
+    createUploadRing(pCore);
+    createGeometryPool(pCore);
     
     createSwapChain(hWnd, pCore);
 
@@ -81,9 +89,12 @@ void createD3DCore(HWND hWnd, XMFLOAT4 clearColor, D3DCore** ppCore) {
     createBasicMaterials(pCore);
 
     createRenderItemLayers(pCore);
-    createRenderItems(pCore);
 
+    // The meshes and buffers of render items and frame resources are uploaded with one submission.
+    beginUploadBatch(pCore);
+    createRenderItems(pCore);
     createFrameResources(pCore);
+    endUploadBatch(pCore);
 
     createBasicPostprocessor(pCore);
 
@@ -133,6 +144,16 @@ void createCmdObjs(D3DCore* pCore) {
     // Start off in a closed state.  This is because the first time we refer
     // to the command list we will Reset it, and it needs to be closed before calling Reset
     pCore->cmdList->Close();
+
+    pCore->cmdRecorder = std::make_unique<D3D12CmdRecorder>(pCore->cmdList.Get());
+}
+
+void createUploadRing(D3DCore* pCore) {
+    initUploadRing(pCore, UPLOAD_RING_SIZE, &pCore->uploadRing);
+}
+
+void createGeometryPool(D3DCore* pCore) {
+    initGeometryPool(pCore, GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY, sizeof(Vertex), &pCore->geometryPool);
 }
 
 void createSwapChain(HWND hWnd, D3DCore* pCore) {
@@ -209,7 +230,7 @@ void createRootSig(D3DCore* pCore, const std::string& name, D3D12_ROOT_SIGNATURE
 
 void createRootSigs(D3DCore* pCore) {
     // Main default root signature.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[6];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[8];
 
     slotRootParameter[0].InitAsConstantBufferView(0); // Per object constant buffer data
     slotRootParameter[1].InitAsConstantBufferView(1); // Global process constant buffer data
@@ -223,11 +244,14 @@ void createRootSigs(D3DCore* pCore) {
         texTable[i].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, i + 1); // space2, space3
         slotRootParameter[i + 3].InitAsDescriptorTable(1, &texTable[i], D3D12_SHADER_VISIBILITY_ALL);
     }
+    // Instances of the instanced render items (See RenderItem::instances)
+    slotRootParameter[6].InitAsShaderResourceView(1, 1); // Instance structured buffer data
+    slotRootParameter[7].InitAsConstants(1, 2); // Index of the first instance of the draw call
 
     auto samplers = generateStaticSamplers();
 
     // A root signature is an array of root parameters.
-    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(6, slotRootParameter, (UINT)samplers.size(), samplers.data(),
+    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(8, slotRootParameter, (UINT)samplers.size(), samplers.data(),
         D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
     createRootSig(pCore, "main", &rootSigDesc);
 }
@@ -240,6 +264,24 @@ void createShaders(D3DCore* pCore) {
         L"shaders/basic/default.hlsl",
         Shader::VS | Shader::PS,
         entryPoint);
+
+    ShaderFuncEntryPoints packedEntryPoint = {};
+    packedEntryPoint.vs = "VSPacked";
+
+    pCore->shaders["default_packed"] = std::make_unique<Shader>(
+        "default_packed",
+        L"shaders/basic/default.hlsl",
+        Shader::VS | Shader::PS,
+        packedEntryPoint);
+
+    ShaderFuncEntryPoints instancedEntryPoint = {};
+    instancedEntryPoint.vs = "VSInstanced";
+
+    pCore->shaders["default_instanced"] = std::make_unique<Shader>(
+        "default_instanced",
+        L"shaders/basic/default.hlsl",
+        Shader::VS | Shader::PS,
+        instancedEntryPoint);
 }
 
 void createInputLayout(D3DCore* pCore) {
@@ -249,6 +291,11 @@ void createInputLayout(D3DCore* pCore) {
         { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "SIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+
+    pCore->packedInputLayout = {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
 }
 
 void createPSOs(D3DCore* pCore) {
@@ -274,6 +321,25 @@ void createPSOs(D3DCore* pCore) {
     wireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
     checkHR(pCore->device->CreateGraphicsPipelineState(&wireframePsoDesc, IID_PPV_ARGS(&pCore->PSOs["wireframe"])));
 
+    // Solid & Wireframe of packed vertices
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC solidPackedPsoDesc = solidPsoDesc;
+    solidPackedPsoDesc.InputLayout = { pCore->packedInputLayout.data(), (UINT)pCore->packedInputLayout.size() };
+    bindShaderToPSO(&solidPackedPsoDesc, pCore->shaders["default_packed"].get());
+    checkHR(pCore->device->CreateGraphicsPipelineState(&solidPackedPsoDesc, IID_PPV_ARGS(&pCore->PSOs["solid_packed"])));
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC wireframePackedPsoDesc = solidPackedPsoDesc;
+    wireframePackedPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+    checkHR(pCore->device->CreateGraphicsPipelineState(&wireframePackedPsoDesc, IID_PPV_ARGS(&pCore->PSOs["wireframe_packed"])));
+
+    // Solid & Wireframe of instanced render items
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC solidInstancedPsoDesc = solidPsoDesc;
+    bindShaderToPSO(&solidInstancedPsoDesc, pCore->shaders["default_instanced"].get());
+    checkHR(pCore->device->CreateGraphicsPipelineState(&solidInstancedPsoDesc, IID_PPV_ARGS(&pCore->PSOs["solid_instanced"])));
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC wireframeInstancedPsoDesc = solidInstancedPsoDesc;
+    wireframeInstancedPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+    checkHR(pCore->device->CreateGraphicsPipelineState(&wireframeInstancedPsoDesc, IID_PPV_ARGS(&pCore->PSOs["wireframe_instanced"])));
+
     // Alpha Test
     D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestPsoDesc = solidPsoDesc;
     alphaTestPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -289,6 +355,10 @@ void createPSOs(D3DCore* pCore) {
     alphaPsoDesc.BlendState.RenderTarget[0] = alphaRTBD;
     checkHR(pCore->device->CreateGraphicsPipelineState(&alphaPsoDesc, IID_PPV_ARGS(&pCore->PSOs["alpha"])));
 
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaInstancedPsoDesc = alphaPsoDesc;
+    bindShaderToPSO(&alphaInstancedPsoDesc, pCore->shaders["default_instanced"].get());
+    checkHR(pCore->device->CreateGraphicsPipelineState(&alphaInstancedPsoDesc, IID_PPV_ARGS(&pCore->PSOs["alpha_instanced"])));
+
     // Stencil Mark:
     // Keep the render target buffer and depth buffer intact and always mark the stencil buffer (stencil test will always passes).
     // (Note: This setting also takes into account the depth test. When depth test fails the stencil test will not pass.)
@@ -562,6 +632,7 @@ void loadBasicTextures(D3DCore* pCore) {
     checkHR(pCore->cmdList->Close());
     ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
     pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+    ++pCore->cmdSubmissionCount;
     flushCmdQueue(pCore);
 }
 
@@ -658,12 +729,16 @@ void createRenderItemLayers(D3DCore* pCore) {
     std::string ritemLayerNames[] = {
         // General
         "solid", "cartoon", "wireframe", "hill_tessellation", "hill_tessellation_wireframe",
+        // Packed Vertex
+        "solid_packed", "wireframe_packed",
+        // Instanced Render Item
+        "solid_instanced", "wireframe_instanced",
         // Geometry Shader
         "subdivision", "billboard", "billboard_cartoon", "cylinder_generator", "explosion_animation",
         "ver_normal_visible", "tri_normal_visible",
         // Alpha Blend, Stencil
         "alpha_test", "alpha_test_cartoon", "stencil_mark", "stencil_reflect", "planar_shadow",
-        "alpha", "alpha_cartoon"
+        "alpha", "alpha_instanced", "alpha_cartoon"
     };
     for (auto& name : ritemLayerNames) {
         pCore->ritemLayers.push_back({ name, std::vector<RenderItem*>() });
@@ -674,7 +749,7 @@ void createRenderItems(D3DCore* pCore) {
     auto xAxisGeo = std::make_unique<ObjectGeometry>();
     generateCube(XMFLOAT3(100.0f, 0.01f, 0.01f), xAxisGeo.get());
     auto xAxis = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, xAxisGeo.get(), 1, xAxis.get());
+    initRitemWithPooledGeoInfo(pCore, &pCore->geometryPool, xAxisGeo.get(), 1, xAxis.get());
     xAxis->materials[0] = pCore->materials["red"].get();
     moveNamedRitemToAllRitems(pCore, "X", std::move(xAxis));
     bindRitemReferenceWithLayers(pCore, "X", { {"solid",0} });
@@ -682,7 +757,7 @@ void createRenderItems(D3DCore* pCore) {
     auto yAxisGeo = std::make_unique<ObjectGeometry>();
     generateCube(XMFLOAT3(0.01f, 100.0f, 0.01f), yAxisGeo.get());
     auto yAxis = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, yAxisGeo.get(), 1, yAxis.get());
+    initRitemWithPooledGeoInfo(pCore, &pCore->geometryPool, yAxisGeo.get(), 1, yAxis.get());
     yAxis->materials[0] = pCore->materials["green"].get();
     moveNamedRitemToAllRitems(pCore, "Y", std::move(yAxis));
     bindRitemReferenceWithLayers(pCore, "Y", { {"solid",0} });
@@ -690,7 +765,7 @@ void createRenderItems(D3DCore* pCore) {
     auto zAxisGeo = std::make_unique<ObjectGeometry>();
     generateCube(XMFLOAT3(0.01f, 0.01f, 100.0f), zAxisGeo.get());
     auto zAxis = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, zAxisGeo.get(), 1, zAxis.get());
+    initRitemWithPooledGeoInfo(pCore, &pCore->geometryPool, zAxisGeo.get(), 1, zAxis.get());
     zAxis->materials[0] = pCore->materials["blue"].get();
     moveNamedRitemToAllRitems(pCore, "Z", std::move(zAxis));
     bindRitemReferenceWithLayers(pCore, "Z", { {"solid",0} });
@@ -707,6 +782,10 @@ void createFrameResources(D3DCore* pCore) {
             pCore->allRitems.data(), pCore->allRitems.size());
         initFResourceObjConstBuff(pCore, totalObjBuffCount, resource.get());
 
+        UINT totalInstanceCount = calcRitemRangeTotalInstanceCount(
+            pCore->allRitems.data(), pCore->allRitems.size());
+        initFResourceInstStructBuff(pCore, totalInstanceCount, resource.get());
+
         // Due to we use the stencil technique to achieve an effect of plane mirror,
         // another reflected process constant buffer is needed to draw the mirror objects.
         initFResourceProcConstBuff(pCore, 2, resource.get());
@@ -720,17 +799,37 @@ void createFrameResources(D3DCore* pCore) {
             materialDataList.size() * sizeof(MaterialData), resource.get());
 
         // Initialize dynamic meshes.
+        UINT64 dynamicMeshDataSize = 0;
         for (auto& kv : pCore->ritems) {
             auto& name = kv.first;
             auto& ritem = kv.second;
             if (ritem->isDynamic) {
                 // Copy origin mesh in render item into frame resource.
                 resource->dynamicMeshes[name].reset(copyVmesh(pCore, ritem->mesh.get()));
+                // Reserve some bytes for the alignment of each region.
+                dynamicMeshDataSize += ritem->mesh->vertexBuffCPU->GetBufferSize() + 256;
             }
         }
 
+        // The dynamic meshes are uploaded every frame, so the ring must hold all of them at least.
+        initFResourceUploadRing(pCore, (std::max)(dynamicMeshDataSize, FRAME_UPLOAD_RING_MIN_SIZE), resource.get());
+
         pCore->frameResources.push_back(std::move(resource));
     }
+
+    // All seats of the new buffers are dirty, so every render item is queued to fill them.
+    UINT totalObjBuffCount = calcRitemRangeTotalObjConstBuffSeatCount(
+        pCore->allRitems.data(), pCore->allRitems.size());
+    UINT totalInstanceCount = calcRitemRangeTotalInstanceCount(
+        pCore->allRitems.data(), pCore->allRitems.size());
+    initObjConstsShadow(totalObjBuffCount, calcConstBuffSize(sizeof(ObjConsts)), totalInstanceCount, &pCore->objConstsShadow);
+    for (auto& resource : pCore->frameResources) {
+        resource->dirtyObjSeats.reset(totalObjBuffCount);
+        resource->dirtyInstSeats.reset(totalInstanceCount);
+    }
+    // The bounds are filled when the queued render items are flushed, see updateCurrObjConstBuff.
+    resizeBoundsSoA(pCore->allRitems.size(), &pCore->ritemBounds);
+    for (auto ritem : pCore->allRitems) markRitemObjConstsDirty(pCore, ritem);
 }
 
 void createBasicPostprocessor(D3DCore* pCore) {
@@ -817,6 +916,7 @@ void resizeSwapBuffs(int w, int h, XMFLOAT4 clearColor, D3DCore* pCore) {
     checkHR(pCore->cmdList->Close());
     ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
     pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+    ++pCore->cmdSubmissionCount;
 
     flushCmdQueue(pCore);
 }
@@ -824,9 +924,9 @@ void resizeSwapBuffs(int w, int h, XMFLOAT4 clearColor, D3DCore* pCore) {
 void clearBackBuff(D3D12_CPU_DESCRIPTOR_HANDLE msaaRtvDescHandle, XMVECTORF32 color,
     D3D12_CPU_DESCRIPTOR_HANDLE dsvDescHandle, FLOAT depth, UINT8 stencil, D3DCore* pCore)
 {
-    pCore->cmdList->ClearRenderTargetView(
+    pCore->cmdRecorder->ClearRenderTargetView(
         msaaRtvDescHandle, color, 0, nullptr);
-    pCore->cmdList->ClearDepthStencilView(
+    pCore->cmdRecorder->ClearDepthStencilView(
         dsvDescHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, depth, stencil, 0, nullptr);
 }
 
@@ -835,31 +935,31 @@ void copyStatedResource(D3DCore* pCore,
     ID3D12Resource* src, D3D12_RESOURCE_STATES srcState)
 {
     if (srcState != D3D12_RESOURCE_STATE_COPY_SOURCE) {
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 src,
                 srcState,
                 D3D12_RESOURCE_STATE_COPY_SOURCE));
     }
     if (destState != D3D12_RESOURCE_STATE_COPY_DEST) {
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 dest,
                 destState,
                 D3D12_RESOURCE_STATE_COPY_DEST));
     }
 
-    pCore->cmdList->CopyResource(dest, src);
+    pCore->cmdRecorder->CopyResource(dest, src);
 
     if (srcState != D3D12_RESOURCE_STATE_COPY_SOURCE) {
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 src,
                 D3D12_RESOURCE_STATE_COPY_SOURCE,
                 srcState));
     }
     if (destState != D3D12_RESOURCE_STATE_COPY_DEST) {
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 dest,
                 D3D12_RESOURCE_STATE_COPY_DEST,
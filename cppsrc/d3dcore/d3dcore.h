@@ -26,7 +26,13 @@ using namespace DirectX;
 using namespace DirectX::PackedVector;
 using namespace Microsoft::WRL;
 
+#include "bvh.h"
+#include "cmd-recorder.h"
+#include "cull-bounds.h"
+#include "draw-list.h"
 #include "frame-async.h"
+#include "geometry-dedup.h"
+#include "geometry-pool.h"
 #include "graphics/material.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
@@ -72,6 +78,8 @@ struct D3DCore {
     ComPtr<ID3D12CommandQueue> cmdQueue = nullptr;
     ComPtr<ID3D12CommandAllocator> cmdAlloc = nullptr;
     ComPtr<ID3D12GraphicsCommandList> cmdList = nullptr;
+    // The commands of a frame are recorded through cmdRecorder (See cmd-recorder.h), which forwards them to cmdList.
+    std::unique_ptr<CmdRecorder> cmdRecorder = nullptr;
 
     ComPtr<ID3D12DescriptorHeap> rtvHeap = nullptr;
     ComPtr<ID3D12DescriptorHeap> dsvHeap = nullptr;
@@ -82,6 +90,8 @@ struct D3DCore {
     std::unordered_map<std::string, std::unique_ptr<Shader>> shaders = {};
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> defaultInputLayout = {};
+    // Input layout of PackedVertex. See graphics/vmesh.h.
+    std::vector<D3D12_INPUT_ELEMENT_DESC> packedInputLayout = {};
 
     std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> PSOs = {};
 
@@ -92,9 +102,49 @@ struct D3DCore {
 
     ProcConsts processData = {};
 
+    // Object Constants and Instances (See obj-consts-utils.h)
+    ObjConstsShadow objConstsShadow = {};
+    UINT objConstSeatWriteCount = 0; // Seats written in the last update, see updateCurrObjConstBuff.
+    UINT objConstRangeWriteCount = 0; // memcpy calls of the last update, the instances included.
+    UINT instWriteCount = 0; // Instances written in the last update.
+    UINT64 objDataUploadByteSize = 0; // Bytes of the seats and instances written in the last update.
+
+    // Draw calls of the current frame, which is reset at the beginning of dev_drawCoreElems.
+    UINT frameDrawCount = 0;
+
+    // Frustum Culling (See cullRenderItems in frame-async-utils.h)
+    bool isFrustumCullingEnabled = true;
+    BoundsSoA ritemBounds = {}; // Indexed by RenderItem::boundsIdx.
+    std::vector<UINT32> visibleRitemIdxList = {}; // Compact list of the boundsIdx of the visible render items.
+    std::vector<BYTE> ritemCullMask = {}; // 1 for the visible render items, which is read by the draw lists.
+    // Hierarchy over ritemBounds for the picking and the culling of large scenes (See updateRitemBvh in frame-async-utils.h).
+    Bvh ritemBvh = {};
+    bool isRitemBvhDirty = true; // Some bounds moved since the last update.
+    UINT bvhCullingMinRitemCount = 4096; // The flat culling is faster for the smaller scenes.
+    std::string pickedRitemName = ""; // Picked with the left button (See pickRenderItem), shown in the window caption.
+
+    // Upload Batch (See upload-ring-utils.h)
+    UploadRing uploadRing = {};
+    bool isUploadBatchOpen = false;
+    // Upload buffers of the data larger than the ring, which are released when the batch ends.
+    std::vector<ComPtr<ID3D12Resource>> uploadBatchTempBuffs = {};
+
+    // Geometry Pool (See geometry-pool-utils.h) of the static meshes of Vertex.
+    GeometryPool geometryPool = {};
+    // Meshes shared by the render items of identical geometry (See geometry-dedup-utils.h).
+    GeometryDedupTable geometryDedup = {};
+
+    // Command Queue Statistics (e.g. the startup report in dev_initCoreElems)
+    UINT cmdSubmissionCount = 0; // ExecuteCommandLists calls.
+    UINT cmdQueueStallCount = 0; // Times the CPU waits until the GPU is idle, i.e. flushCmdQueue calls.
+
     std::unordered_map<std::string, std::unique_ptr<RenderItem>> ritems = {};// ritems: render items
     std::vector<RenderItem*> allRitems = {};
     std::vector<std::pair<std::string, std::vector<RenderItem*>>> ritemLayers = {};
+    // Compiled draw lists of the layers (See draw-list-utils.h), which are compiled again when
+    // their versions do not match ritemLayersVersion, i.e. after invalidateDrawLists is called.
+    std::unordered_map<std::string, DrawList> drawLists = {};
+    UINT64 ritemLayersVersion = 1;
 
     // Graphics
     std::unordered_map<std::string, std::unique_ptr<Material>> materials = {};
@@ -119,6 +169,8 @@ void createD3DCore(HWND hWnd, XMFLOAT4 clearColor, D3DCore** ppCore);
 void checkFeatureSupports(D3DCore* pCore);
 
 void createCmdObjs(D3DCore* pCore);
+void createUploadRing(D3DCore* pCore);
+void createGeometryPool(D3DCore* pCore);
 void createSwapChain(HWND hWnd, D3DCore* pCore);
 void createRtvDsvHeaps(D3DCore* pCore);
 
@@ -0,0 +1,60 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "graphics/vmesh.h"
+
+// Everything needed to draw one render item of a layer, which is flattened from the render item when the
+// draw list is compiled, so that the draw loop does no hash lookups. See utils/draw-list-utils.h.
+struct DrawPacket {
+    // [63, 48]: ID of the descriptor heap of the maps (0 for none),
+    // [47, 24]: ID of the bound vertex and index buffers,
+    // [23,  0]: order of the render item in the layer, which keeps the sorting stable.
+    UINT64 sortKey = 0;
+
+    // Read when submitted, so the visibility can be changed without compiling again.
+    const bool* isVisible = nullptr;
+    // Only set for the dynamic render items, whose meshes are changed every frame (see dev_updateCoreDynamicMesh),
+    // in which case the buffer views below are not used.
+    Vmesh* const* dynamicMesh = nullptr;
+
+    D3D12_VERTEX_BUFFER_VIEW vertexBuffView = {};
+    D3D12_INDEX_BUFFER_VIEW indexBuffView = {};
+    D3D_PRIMITIVE_TOPOLOGY topologyType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+    // Relative to the object constants buffer of the current frame resource.
+    UINT64 objConstBuffOffset = 0;
+    // Only used by the instanced render items (instanceCount > 0), which bind instBuffStartIdx as the
+    // root constant of the first instance instead of the object constants.
+    UINT instanceCount = 0;
+    UINT instBuffStartIdx = 0;
+
+    // RenderItem::boundsIdx, which indexes into the cull mask when submitted.
+    UINT boundsIdx = 0;
+
+    UINT indexCount = 0;
+    UINT startIndexLocation = 0;
+    INT baseVertexLocation = 0;
+
+    // Descriptor heap for displacement and normal map (if has).
+    ID3D12DescriptorHeap* descHeap = nullptr;
+    int hasDisplacementMap = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE displacementMapHandle = {};
+    int hasNormalMap = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE normalMapHandle = {};
+};
+
+struct DrawList {
+    // Sorted by DrawPacket::sortKey, or in the order of the render items for a blended layer.
+    std::vector<DrawPacket> packets = {};
+    // D3DCore::ritemLayersVersion when compiled, i.e. the list is compiled again if they do not match.
+    UINT64 layersVersion = 0;
+};
@@ -10,6 +10,8 @@
 #include "graphics/material.h"
 #include "graphics/shader.h"
 #include "modifier/modifier.h"
+#include "upload-ring.h"
+#include "utils/dirty-seat-set.h"
 #include "utils/geometry-utils.h"
 
 #ifndef NUM_FRAME_RESOURCES
@@ -28,14 +30,24 @@ struct FrameResource {
     // data itself can be stored at any reasonable position if the CBVs are set properly.
     BYTE* objConstBuffCPU = nullptr;
     ComPtr<ID3D12Resource> objConstBuffGPU = nullptr;
+    // Seats of objConstBuffCPU that are older than the object constants shadow (See ObjConstsShadow).
+    DirtySeatSet dirtyObjSeats = {};
+
+    // Tightly packed InstanceData of the instanced render items (See RenderItem::instances).
+    BYTE* instStructBuffCPU = nullptr;
+    ComPtr<ID3D12Resource> instStructBuffGPU = nullptr;
+    DirtySeatSet dirtyInstSeats = {};
 
     BYTE* procConstBuffCPU = nullptr;
     ComPtr<ID3D12Resource> procConstBuffGPU = nullptr;
 
     ComPtr<ID3DBlob> matStructBuffCPU = nullptr;
-    ComPtr<ID3D12Resource> matStructBuffUploader = nullptr;
     ComPtr<ID3D12Resource> matStructBuffGPU = nullptr;
 
+    // Per-frame uploads (e.g. the dynamic meshes) are sub-allocated from this ring. The regions
+    // are submitted with currFenceValue and retired when the frame resource is reused.
+    UploadRing uploadRing = {};
+
     // Dynamic mesh, i.e. dynamic vertex buffer, should be updated in frame resource.
     // For those meshes that will be updated frequently, we store many copies in
     // frame resources and update them in a circuit array just like the constants buffers.
@@ -45,10 +57,10 @@ struct FrameResource {
 };
 
 struct RenderItem {
-    // We use the dirty flag, i.e. count of dirty frames, to check whether the object data related to
-    // this render item is changed. If changed, we must update the data of every frame as each of them
-    // stores a copy of the object data, which means numDirtyFrames should be set to NUM_FRAME_RESOURCES.
-    int numDirtyFrames = NUM_FRAME_RESOURCES;
+    // Every frame resource stores a copy of the object data, so after constData is changed, the render item
+    // must be queued with markRitemObjConstsDirty (See frame-async-utils.h) to update all of the copies.
+    // This flag is TRUE while the render item is in the queue, which keeps it from being queued twice.
+    bool isObjConstsQueued = false;
 
     // Unique object property data maintained by this render item.
     std::vector<ObjConsts> constData = {};
@@ -63,9 +75,18 @@ struct RenderItem {
     UINT objConstBuffSeatCount = 0;
     // If the render item is dynamic, you should create mesh as usual.
     // The mesh will be copied into the initialized frame resources later.
-    std::unique_ptr<Vmesh> mesh = nullptr;
+    // The render items of identical geometry can share one mesh, see initRitemWithDedupGeoInfo.
+    std::shared_ptr<Vmesh> mesh = nullptr;
     D3D_PRIMITIVE_TOPOLOGY topologyType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
+    // If instances is not empty, the render item is instanced, i.e. the mesh is drawn once for every instance
+    // with one DrawIndexedInstanced, and the instances are read from the instance buffer of the frame resource
+    // starting at instBuffStartIdx instead of the object constants buffer. An instanced render item holds no
+    // seats in the object constants buffer, uses materials[0] for all instances, and must be bound to the
+    // layers of instanced PSOs, e.g. "solid_instanced". The instances are updated just like constData.
+    std::vector<InstanceData> instances = {};
+    UINT instBuffStartIdx = 0;
+
     // We have material now. Cool! Every material is correspond to one object constants buffer seat in constData.
     std::vector<Material*> materials = {};
 
@@ -85,6 +106,14 @@ struct RenderItem {
     // Set this field FALSE to skip drawing this render item in drawing func series.
     bool isVisible = true;
 
+    // Local-space bounds of the mesh, which are calculated from the geometry when the render item is initialized.
+    // The world-space bounds are stored in D3DCore::ritemBounds at boundsIdx, which is the index of the
+    // render item in allRitems, and are culled against the camera frustum. See utils/culling-utils.h.
+    bool hasBounds = false;
+    XMFLOAT3 boundsCenter = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 boundsExtents = { 0.0f, 0.0f, 0.0f };
+    UINT boundsIdx = 0;
+
     // Descriptor heap for displacement and normal map.
     ID3D12DescriptorHeap* displacementAndNormalMapDescHeap = nullptr;
 
@@ -95,4 +124,16 @@ struct RenderItem {
     // Set this field 1 to use normal map instead of origin normal.
     int hasNormalMap = 0;
     D3D12_GPU_DESCRIPTOR_HANDLE normalMapHandle = {};
+};
+
+// CPU copy of the object constants and instances of all render items, which has the same layout as the object
+// constants buffers and the instance buffers of the frame resources. The changed seats are copied into the shadow
+// once, and then copied into every frame resource with one memcpy per range of contiguous seats (See obj-consts-utils.h).
+struct ObjConstsShadow {
+    UINT seatSize = 0;
+    std::vector<BYTE> seats = {};
+    // Laid out as the instance buffers, see RenderItem::instances.
+    std::vector<InstanceData> instances = {};
+    // Render items whose constData is changed since the last flush.
+    std::vector<RenderItem*> dirtyRitems = {};
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "graphics/vmesh.h"
+
+// Meshes shared by the render items of identical geometry, which are looked up by the 64-bit hash of the
+// vertices and indices. The geometry is placed at the origin and the render items are positioned by
+// ObjConsts::worldTrans instead. See initRitemWithDedupGeoInfo in utils/render-item-utils.h.
+struct GeometryDedupTable {
+    struct Entry {
+        // Compared when the hashes match, so a hash collision never shares the mesh of another geometry.
+        std::vector<Vertex> vertices = {};
+        std::vector<UINT32> indices = {};
+        Vsubmesh locationInfo = {};
+
+        std::shared_ptr<Vmesh> mesh = nullptr;
+    };
+    std::unordered_map<UINT64, std::vector<Entry>> buckets = {};
+
+    UINT lookupCount = 0;
+    UINT sharedCount = 0; // Lookups that found a mesh in the table.
+    UINT64 savedByteSize = 0; // Vertex and index bytes not allocated thanks to the shared meshes.
+};
@@ -0,0 +1,40 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+using namespace Microsoft::WRL;
+
+#include "graphics/vmesh.h"
+#include "utils/free-list-allocator.h"
+
+#ifndef GEOMETRY_POOL_VERTEX_CAPACITY
+#define GEOMETRY_POOL_VERTEX_CAPACITY (1ull << 19) // 20 MB of Vertex.
+#endif
+
+#ifndef GEOMETRY_POOL_INDEX_CAPACITY
+#define GEOMETRY_POOL_INDEX_CAPACITY (1ull << 21) // 8 MB of UINT32.
+#endif
+
+// One large vertex buffer and one large index buffer shared by the static meshes of the same vertex
+// format, so that the meshes drawn one after another need no rebinding. The regions are counted in
+// vertices and indices, which are exactly baseVertexLocation and startIndexLocation of the submeshes.
+// See initPooledVmesh in utils/geometry-pool-utils.h.
+struct GeometryPool {
+    UINT vertexStride = sizeof(Vertex);
+
+    ComPtr<ID3D12Resource> vertexBuffGPU = nullptr;
+    ComPtr<ID3D12Resource> indexBuffGPU = nullptr;
+
+    D3D12_VERTEX_BUFFER_VIEW vertexBuffView = {};
+    D3D12_INDEX_BUFFER_VIEW indexBuffView = {};
+
+    FreeListAllocator vertexAllocator = {};
+    FreeListAllocator indexAllocator = {};
+};
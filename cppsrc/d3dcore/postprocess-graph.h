@@ -0,0 +1,92 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <string>
+#include <vector>
+
+// Texture index of a resource which has no texture, e.g. the intermediate of a fused pass.
+constexpr UINT POSTPROCESS_NO_TEXTURE = 0xffffffff;
+
+// A full-frame texture of the graph, in the format of the swap chain buffers. The external ones are owned by
+// the caller (e.g. the resolved back buffer), and they are in D3D12_RESOURCE_STATE_COMMON before and after the
+// graph. The transient ones are owned by the graph, and they share the textures when their lifetimes allow.
+struct PostProcessResourceDesc {
+    std::string name = {};
+    bool isExternal = false;
+};
+
+// A node reads its inputs as SRVs and writes its output as an UAV. Each resource is written by one node at most.
+struct PostProcessNodeDesc {
+    std::string name = {};
+    int kind = 0; // Chosen by the caller, e.g. which shader to dispatch.
+    std::vector<UINT> inputs = {}; // Indices into PostProcessGraphDesc::resources.
+    UINT output = 0;
+
+    // TRUE if each input is only read at the pixel being written, so the node can be fused into the node
+    // producing one of its inputs (See PostProcessFusionRule).
+    bool isPointwise = false;
+
+    // TRUE for a plain copy of the single input, which is dropped unless the output is external.
+    bool isCopy = false;
+};
+
+// A pointwise node of consumerKind reading the output of a node of producerKind (and nothing else reads it)
+// is merged into a single pass of fusedKind. The kind of a fused pass can be the producerKind of another rule.
+struct PostProcessFusionRule {
+    int producerKind = 0;
+    int consumerKind = 0;
+    int fusedKind = 0;
+};
+
+struct PostProcessGraphDesc {
+    std::vector<PostProcessResourceDesc> resources = {};
+    std::vector<PostProcessNodeDesc> nodes = {}; // In any order, the passes are sorted by the dependencies.
+    std::vector<PostProcessFusionRule> fusionRules = {};
+    UINT finalOutput = 0; // The resource read after the graph, e.g. copied to the swap chain buffer.
+};
+
+struct PostProcessBarrier {
+    UINT texture = 0;
+    D3D12_RESOURCE_STATES stateBefore = D3D12_RESOURCE_STATE_COMMON;
+    D3D12_RESOURCE_STATES stateAfter = D3D12_RESOURCE_STATE_COMMON;
+};
+
+// The inputs are in D3D12_RESOURCE_STATE_GENERIC_READ and the output in D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+// during a pass, or D3D12_RESOURCE_STATE_COPY_SOURCE and D3D12_RESOURCE_STATE_COPY_DEST during a copy.
+struct PostProcessPass {
+    int kind = 0; // Kind of the node, or fusedKind of the rule.
+    bool isCopy = false;
+    std::vector<UINT> nodes = {}; // The producer first if fused.
+
+    // The inputs of the producer and then the other inputs of the consumers, without repeats.
+    std::vector<UINT> inputResources = {};
+    std::vector<UINT> inputTextures = {};
+    UINT outputResource = 0;
+    UINT outputTexture = 0;
+
+    std::vector<PostProcessBarrier> barriers = {}; // Recorded before the pass.
+};
+
+// Textures [0, externalTextureCount) are the external resources in the order of PostProcessGraphDesc::resources,
+// and the transient textures follow them.
+struct PostProcessPlan {
+    std::vector<PostProcessPass> passes = {};
+    std::vector<PostProcessBarrier> finalBarriers = {}; // Return all textures to D3D12_RESOURCE_STATE_COMMON.
+
+    std::vector<UINT> resourceTextures = {}; // Texture of each resource, or POSTPROCESS_NO_TEXTURE.
+    UINT externalTextureCount = 0;
+    UINT transientTextureCount = 0;
+
+    UINT transientResourceCount = 0; // Transient resources with a texture, which share transientTextureCount.
+    UINT droppedCopyCount = 0;
+    UINT droppedNodeCount = 0; // Whose output is never read.
+    UINT fusedNodeCount = 0; // Merged into the pass of another node.
+    UINT barrierCount = 0; // Including finalBarriers.
+};
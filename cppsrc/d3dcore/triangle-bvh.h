@@ -0,0 +1,42 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cfloat>
+
+#include "bvh.h"
+
+// A triangle in the form of the Moller-Trumbore test, i.e. p = v0 + u * edge1 + v * edge2.
+struct TriangleBvhTri {
+    XMFLOAT3 v0;
+    XMFLOAT3 edge1; // v1 - v0
+    XMFLOAT3 edge2; // v2 - v0
+};
+
+// BVH over the triangles of a mesh (See utils/ray-cast-utils.h). The primitives of bvh are the triangles,
+// and the primitive index of triangle i is i, i.e. the corners are indices[3 * i] ~ indices[3 * i + 2].
+struct TriangleBvh {
+    Bvh bvh = {};
+    // In the order of Bvh::primIdx, so a leaf reads its triangles contiguously.
+    std::vector<TriangleBvhTri> tris = {};
+};
+
+// The hit point is v0 + u * (v1 - v0) + v * (v2 - v0) of the triangle, and origin + t * dir of the ray.
+struct RayHit {
+    float t = FLT_MAX;
+    float u = 0.0f, v = 0.0f;
+    UINT triIdx = BVH_EMPTY_CHILD;
+};
+
+// 4 rays in SoA form, i.e. lane i of every vector belongs to ray i. The packet queries test 4 rays against
+// a node or a triangle at a time, which pays off when the rays are coherent (e.g. the adjacent pixels).
+struct RayPacket {
+    XMVECTOR originX, originY, originZ;
+    XMVECTOR dirX, dirY, dirZ;
+    XMVECTOR tMax; // The lanes of tMax <= 0 are inactive, e.g. to fill the last packet.
+};
@@ -0,0 +1,31 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+using namespace Microsoft::WRL;
+
+#include "utils/ring-allocator.h"
+
+#ifndef UPLOAD_RING_SIZE
+#define UPLOAD_RING_SIZE (64ull << 20)
+#endif
+
+#ifndef FRAME_UPLOAD_RING_MIN_SIZE
+#define FRAME_UPLOAD_RING_MIN_SIZE (4ull << 20)
+#endif
+
+// One persistently mapped upload heap sub-allocated by a ring allocator, which replaces the
+// committed upload buffer per resource. D3DCore holds one for the loading-time uploads (see
+// beginUploadBatch in upload-ring-utils.h) and every frame resource holds one for the per-frame uploads.
+struct UploadRing {
+    ComPtr<ID3D12Resource> buff = nullptr;
+    BYTE* mappedData = nullptr;
+    RingAllocator allocator = {};
+};
@@ -6,21 +6,31 @@
 ** yiyaowen (c) 2021 All Rights Reserved.
 */
 
+#include <chrono>
 #include <DirectXColors.h>
-#include <fstream>
 
 #include "devfunc.h"
 #include "modifier/wave-simulator.h"
 #include "postprocessing/bilateral-blur.h"
-#include "postprocessing/color-compositor.h"
 #include "postprocessing/gaussian-blur.h"
+#include "postprocessing/postprocess-graph.h"
+#include "postprocessing/sobel-compositor.h"
 #include "postprocessing/sobel-operator.h"
 #include "utils/debugger.h"
 #include "utils/frame-async-utils.h"
+#include "utils/geometry-dedup-utils.h"
+#include "utils/mesh-file-utils.h"
+#include "utils/packed-vertex-utils.h"
 #include "utils/render-item-utils.h"
+#include "utils/upload-ring-utils.h"
 #include "utils/vmesh-utils.h"
 
-static void loadSkullModel(D3DCore* pCore);
+static void loadSkullModel(D3DCore* pCore, SceneBuilder* builder);
+
+// Kinds of the nodes in the outline overlay graph.
+constexpr int OUTLINE_SOBEL = 0, OUTLINE_MULTIPLY = 1, OUTLINE_SOBEL_MULTIPLY = 2;
+
+static PostProcessGraphDesc makeOutlineOverlayGraphDesc();
 
 void dev_initCoreElems(D3DCore* pCore) {
      //Note the origin render item collection has already included a set of axes (X-Y-Z).
@@ -31,42 +41,77 @@ void dev_initCoreElems(D3DCore* pCore) {
     rotateCamera(20.0f * XM_PI / 180.0f, 0.0f, 0.0f, pCore->camera.get());
     pCore->camera->isViewTransDirty = true;
 
+    auto buildStartTime = std::chrono::steady_clock::now();
+    UINT prevSubmissionCount = pCore->cmdSubmissionCount;
+    UINT prevStallCount = pCore->cmdQueueStallCount;
+
+    // All meshes of the scene are queued into the builder and uploaded with the frame resources in one batch.
+    SceneBuilder builder(pCore);
+    beginUploadBatch(pCore);
+
     /* Build scene object start */
 
-    createCubeObject(pCore, "floor", XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(20.0f, 1.0f, 20.0f), "tile", { {"solid", 0}, {"wireframe", 0} });
+    // The floor and the stage share one unit cube mesh, which is sized by the world matrix.
+    createCubeObject(pCore, "floor", XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(20.0f, 1.0f, 20.0f), "tile", { {"solid", 0}, {"wireframe", 0} }, &builder);
     
-    createCubeObject(pCore, "stage", XMFLOAT3(0.0f, 3.0f, 0.0f), XMFLOAT3(2.0f, 2.0f, 2.0f), "brick", { {"solid", 0}, {"wireframe", 0} });
+    createCubeObject(pCore, "stage", XMFLOAT3(0.0f, 3.0f, 0.0f), XMFLOAT3(2.0f, 2.0f, 2.0f), "brick", { {"solid", 0}, {"wireframe", 0} }, &builder);
 
-    loadSkullModel(pCore);
+    loadSkullModel(pCore, &builder);
 
-    int k = 0;
+    // The pillars and the balls share a mesh each, and are drawn with one draw call each.
+    std::vector<XMFLOAT3> pillarPositions = {}, ballPositions = {};
     for (int i = 0; i < 3; i += 2) {
         for (int j = 0; j < 4; ++j) {
-            createCylinderObject(pCore, "pillar" + std::to_string(k),
-                /* pos */ XMFLOAT3(10.0f * (i - 1), 4.0f, (j / 3.0f) * -16.0f + (1.0f - j / 3.0f) * 16.0f),
-                /* topR */ 0.8f, /* bottomR */ 1.2f, /* h */ 6.0f, /* sliceCount */ 30, /* stackCount */ 10,
-                "brick", { {"solid", 0}, {"wireframe", 0} });
-            createSphereObject(pCore, "ball" + std::to_string(k++),
-                /* pos */ XMFLOAT3(10.0f * (i - 1), 8.0f, (j / 3.0f) * -16.0f + (1.0f - j / 3.0f) * 16.0f),
-                /* r */ 1.0f, /* subdivisionCount */ 3, "glass", { {"alpha", 0}, {"wireframe", 0} });
+            pillarPositions.push_back(XMFLOAT3(10.0f * (i - 1), 4.0f, (j / 3.0f) * -16.0f + (1.0f - j / 3.0f) * 16.0f));
+            ballPositions.push_back(XMFLOAT3(10.0f * (i - 1), 8.0f, (j / 3.0f) * -16.0f + (1.0f - j / 3.0f) * 16.0f));
         }
     }
+    createCylinderInstances(pCore, "pillars", pillarPositions,
+        /* topR */ 0.8f, /* bottomR */ 1.2f, /* h */ 6.0f, /* sliceCount */ 30, /* stackCount */ 10,
+        "brick", { {"solid_instanced", 0}, {"wireframe_instanced", 0} }, &builder);
+    createSphereInstances(pCore, "balls", ballPositions,
+        /* r */ 1.0f, /* subdivisionCount */ 3, "glass", { {"alpha_instanced", 0}, {"wireframe_instanced", 0} }, &builder);
 
     //createSphereObject(pCore, "test", XMFLOAT3(-0.7f, 7.0f, -0.4f), 0.1f, 2, "red", { {"solid", 0}, {"wireframe", 0} });
 
     /* Build scene object end */
 
+    size_t sceneBuffCount = builder.queuedBuffCount();
+    UINT64 sceneDataSize = builder.queuedDataSize();
+    builder.commit();
+
     updateRitemRangeObjConstBuffIdx(pCore->allRitems.data(), pCore->allRitems.size());
     updateRitemRangeMaterialDataIdx(pCore->allRitems.data(), pCore->allRitems.size());
+    invalidateDrawLists(pCore);
 
     pCore->frameResources.clear();
     createFrameResources(pCore);
 
+    endUploadBatch(pCore);
+
+    // Startup report. Before the builder, every buffer took a submission and a stall of its own.
+    double buildMsecs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStartTime).count();
+    char buildReport[256];
+    snprintf(buildReport, sizeof(buildReport), "Scene build: %zu buffers (%.2f MB) in %.2f ms, submissions: %u (per-buffer: %zu), stalls: %u (per-buffer: %zu)\n",
+        sceneBuffCount, sceneDataSize / (1024.0 * 1024.0), buildMsecs,
+        pCore->cmdSubmissionCount - prevSubmissionCount, sceneBuffCount,
+        pCore->cmdQueueStallCount - prevStallCount, sceneBuffCount);
+    OutputDebugStringA(buildReport);
+
+    // The meshes shared by the render items of identical geometry, see initRitemWithDedupGeoInfo.
+    auto& dedup = pCore->geometryDedup;
+    snprintf(buildReport, sizeof(buildReport), "Geometry dedup: %u of %u meshes shared, %.2f KB saved\n",
+        dedup.sharedCount, dedup.lookupCount, dedup.savedByteSize / 1024.0);
+    OutputDebugStringA(buildReport);
+    clearGeometryDedupTable(&dedup);
+
     // Initialiez all postprocess effects.
     pCore->postprocessors["gaussian_blur"] = std::make_unique<GaussianBlur>(pCore, 5, 256.0f, 1);
     pCore->postprocessors["bilateral_blur"] = std::make_unique<BilateralBlur>(pCore, 5, 256.0f, 0.1f, 1);
     pCore->postprocessors["sobel_operator"] = std::make_unique<SobelOperator>(pCore);
-    pCore->postprocessors["color_compositor"] = std::make_unique<ColorCompositor>(pCore);
+    auto outlineOverlay = std::make_unique<PostProcessGraph>(pCore, makeOutlineOverlayGraphDesc());
+    outlineOverlay->setKernel(OUTLINE_SOBEL_MULTIPLY, std::make_unique<SobelMultiplyKernel>(pCore));
+    pCore->postprocessors["outline_overlay"] = std::move(outlineOverlay);
 
     // Init all created postprocessors.
     for (auto p = pCore->postprocessors.begin(); p != pCore->postprocessors.end(); ++p)
@@ -74,24 +119,16 @@ void dev_initCoreElems(D3DCore* pCore) {
 }
 
 void dev_updateCoreObjConsts(D3DCore* pCore) {
-    // There is no need to set dirty flag for initialization purpose.
-    XMStoreFloat4x4(&pCore->ritems["floor"]->constData[0].texTrans, XMMatrixScaling(5.0f, 5.0f, 1.0f));
-
-    // Apply updates.
-    auto currObjConstBuff = pCore->currFrameResource->objConstBuffCPU;
-    for (auto& kv : pCore->ritems) {
-        auto& ritem = kv.second;
-        if (ritem->numDirtyFrames > 0) {
-            // Every seat should be updated.
-            for (UINT i = 0; i < ritem->objConstBuffSeatCount; ++i) {
-                memcpy(currObjConstBuff + (ritem->objConstBuffStartIdx + i) * calcConstBuffSize(sizeof(ObjConsts)),
-                    &ritem->constData[i], sizeof(ObjConsts));
-            }
-            // After each update progress, we decrease numDirtyFrames of the render item.
-            // If numDirtyFrames is still greater than 0, then it will be updated in next update progress.
-            ritem->numDirtyFrames--;
-        }
+    // There is no need to mark the render item dirty for initialization purpose,
+    // since all render items are queued when the frame resources are created.
+    // The render items updated by name may have been removed (see removeNamedRitem).
+    auto floorRitem = pCore->ritems.find("floor");
+    if (floorRitem != pCore->ritems.end()) {
+        XMStoreFloat4x4(&floorRitem->second->constData[0].texTrans, XMMatrixScaling(5.0f, 5.0f, 1.0f));
     }
+
+    // Apply updates. Only the seats changed since this frame resource was last updated are written.
+    updateCurrObjConstBuff(pCore);
 }
 
 void dev_updateCoreProcConsts(D3DCore* pCore) {
@@ -141,11 +178,13 @@ void dev_updateCoreDynamicMesh(D3DCore* pCore) {
     for (auto& kv : currDynamicMeshes) {
         auto& name = kv.first;
         auto& mesh = kv.second;
+        auto target = pCore->ritems.find(name);
+        if (target == pCore->ritems.end()) continue;
 
         // Bind current dynamic mesh to render item.
-        pCore->ritems[name]->dynamicMesh = mesh.get();
+        target->second->dynamicMesh = mesh.get();
 
-        auto& modifiers = pCore->ritems[name]->modifiers;
+        auto& modifiers = target->second->modifiers;
         for (auto& mod : modifiers) {
             auto& modifier = mod.second;
             // Change target mesh to current dynamic mesh and update it.
@@ -177,6 +216,9 @@ void dev_updateCoreData(D3DCore* pCore) {
         CloseHandle(hEvent);
     }
 
+    // The GPU has finished the commands of this frame resource, so its upload ring can be reclaimed.
+    pCore->currFrameResource->uploadRing.allocator.retire(pCore->fence->GetCompletedValue());
+
     checkHR(pCore->currFrameResource->cmdAlloc->Reset());
     checkHR(pCore->cmdList->Reset(pCore->currFrameResource->cmdAlloc.Get(), nullptr));
 
@@ -187,39 +229,53 @@ void dev_updateCoreData(D3DCore* pCore) {
 }
 
 void dev_drawCoreElems(D3DCore* pCore) {
-    pCore->cmdList->RSSetViewports(1, &pCore->camera->screenViewport);
-    pCore->cmdList->RSSetScissorRects(1, &pCore->camera->scissorRect);
+    pCore->frameDrawCount = 0;
+
+    // The render items out of the camera frustum are skipped by the layers drawn below.
+    cullRenderItems(pCore);
+
+    pCore->cmdRecorder->RSSetViewports(1, &pCore->camera->screenViewport);
+    pCore->cmdRecorder->RSSetScissorRects(1, &pCore->camera->scissorRect);
 
     ID3D12DescriptorHeap* descHeaps[] = { pCore->srvUavHeap.Get() };
-    pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
-    pCore->cmdList->SetGraphicsRootSignature(pCore->rootSigs["main"].Get());
+    pCore->cmdRecorder->SetGraphicsRootSignature(pCore->rootSigs["main"].Get());
 
     // Global process data
     auto procConstBuffAddr = pCore->currFrameResource->procConstBuffGPU->GetGPUVirtualAddress();
-    pCore->cmdList->SetGraphicsRootConstantBufferView(1, procConstBuffAddr);
+    pCore->cmdRecorder->SetGraphicsRootConstantBufferView(1, procConstBuffAddr);
 
     // Scene material infos
     auto materialStructBuffAddr = pCore->currFrameResource->matStructBuffGPU->GetGPUVirtualAddress();
-    pCore->cmdList->SetGraphicsRootShaderResourceView(2, materialStructBuffAddr);
+    pCore->cmdRecorder->SetGraphicsRootShaderResourceView(2, materialStructBuffAddr);
 
     // Actual diffuse textures
-    pCore->cmdList->SetGraphicsRootDescriptorTable(3, pCore->srvUavHeap->GetGPUDescriptorHandleForHeapStart());
+    pCore->cmdRecorder->SetGraphicsRootDescriptorTable(3, pCore->srvUavHeap->GetGPUDescriptorHandleForHeapStart());
+
+    // Instances of the instanced render items
+    auto instStructBuffAddr = pCore->currFrameResource->instStructBuffGPU->GetGPUVirtualAddress();
+    pCore->cmdRecorder->SetGraphicsRootShaderResourceView(6, instStructBuffAddr);
 
     auto msaaRtvDescHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(pCore->rtvHeap->GetCPUDescriptorHandleForHeapStart());
     msaaRtvDescHandle.Offset(2, pCore->rtvDescSize);
     auto dsvDescHanlde = pCore->dsvHeap->GetCPUDescriptorHandleForHeapStart();
-    pCore->cmdList->OMSetRenderTargets(1, &msaaRtvDescHandle, TRUE, &dsvDescHanlde);
+    pCore->cmdRecorder->OMSetRenderTargets(1, &msaaRtvDescHandle, TRUE, &dsvDescHanlde);
 
     // Firstly draw all objects on MSAA back buffer.
     clearBackBuff(msaaRtvDescHandle, Colors::Black, dsvDescHanlde, 1.0f, 0, pCore);
     // Switch between solid mode and wireframe mode.
     if (GetAsyncKeyState('1') & 0x8000) {
         drawRitemLayerWithName(pCore, "wireframe");
+        drawRitemLayerWithName(pCore, "wireframe_packed");
+        drawRitemLayerWithName(pCore, "wireframe_instanced");
     }
     else {
         drawRitemLayerWithName(pCore, "solid");
+        drawRitemLayerWithName(pCore, "solid_packed");
+        drawRitemLayerWithName(pCore, "solid_instanced");
         drawRitemLayerWithName(pCore, "alpha");
+        drawRitemLayerWithName(pCore, "alpha_instanced");
     }
 
     // Post Processing.
@@ -227,9 +283,13 @@ void dev_drawCoreElems(D3DCore* pCore) {
     processedOutput = pCore->postprocessors["basic"]->process(pCore->msaaBackBuff.Get());
 
     if (GetAsyncKeyState('2') & 0x8000) {
+        ((GaussianBlur*)pCore->postprocessors["gaussian_blur"].get())
+            ->setBlurMode(GetAsyncKeyState(VK_SPACE) ? GaussianBlur::BOX_CASCADE : GaussianBlur::DIRECT);
         processedOutput = pCore->postprocessors["gaussian_blur"]->process(processedOutput);
     }
     if (GetAsyncKeyState('3') & 0x8000) {
+        ((BilateralBlur*)pCore->postprocessors["bilateral_blur"].get())
+            ->setBlurMode(GetAsyncKeyState(VK_SPACE) ? BilateralBlur::GRID : BilateralBlur::DIRECT);
         processedOutput = pCore->postprocessors["bilateral_blur"]->process(processedOutput);
     }
 
@@ -237,10 +297,8 @@ void dev_drawCoreElems(D3DCore* pCore) {
         processedOutput = pCore->postprocessors["sobel_operator"]->process(processedOutput);
     }
     else if (GetAsyncKeyState('5') & 0x8000) {
-        auto sobelOutput = pCore->postprocessors["sobel_operator"]->process(processedOutput);
-        ((ColorCompositor*)pCore->postprocessors["color_compositor"].get())
-            ->bindBackgroundPlate(sobelOutput, ColorCompositor::MULTIPLY, 1.0f);
-        processedOutput = pCore->postprocessors["color_compositor"]->process(processedOutput);
+        // A single fused pass, instead of the Sobel operator and the color compositor with 3 full-frame copies.
+        processedOutput = pCore->postprocessors["outline_overlay"]->process(processedOutput);
     }
 
     // Write final processed output into swap chain back buffer.
@@ -251,6 +309,7 @@ void dev_drawCoreElems(D3DCore* pCore) {
     checkHR(pCore->cmdList->Close());
     ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
     pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+    ++pCore->cmdSubmissionCount;
 
     // Finally preset swap chain buffer.
     checkHR(pCore->swapChain->Present(0, 0));
@@ -259,6 +318,7 @@ void dev_drawCoreElems(D3DCore* pCore) {
     // We use the following frame resource loop array technique to asynchronize CPU and GPU.
     pCore->currFrameResource->currFenceValue = ++pCore->currFenceValue;
     checkHR(pCore->cmdQueue->Signal(pCore->fence.Get(), pCore->currFenceValue));
+    pCore->currFrameResource->uploadRing.allocator.submit(pCore->currFenceValue);
 }
 
 void dev_onKeyDown(WPARAM keyCode, D3DCore* pCore) {
@@ -270,7 +330,13 @@ void dev_onKeyUp(WPARAM keyCode, D3DCore* pCore) {
 }
 
 void dev_onMouseDown(WPARAM btnState, int x, int y, D3DCore* pCore) {
-    // Reserved
+    if (btnState & MK_LBUTTON) {
+        RenderItem* picked = pickRenderItem(pCore, x, y);
+        pCore->pickedRitemName = "";
+        for (auto& kv : pCore->ritems) {
+            if (kv.second.get() == picked) pCore->pickedRitemName = kv.first;
+        }
+    }
 }
 
 void dev_onMouseUp(WPARAM btnState, int x, int y, D3DCore* pCore) {
@@ -319,6 +385,17 @@ void updateRenderWindowCaptionInfo(D3DCore* pCore) {
     std::wstring caption = L"Render Station Ⱦ @ MSPF ÿ֡ʱ䣨룩: " +
         std::to_wstring(MSPF) + L", FPS ֡: " + std::to_wstring(FPS);
 
+    // Draw calls and bytes of the object constants and instances uploaded in the last frame.
+    caption += L", Draw Calls Ƶ: " + std::to_wstring(pCore->frameDrawCount) +
+        L", Object Upload ϴ: " + std::to_wstring(pCore->objDataUploadByteSize) + L" B";
+
+    caption += L", Visible Objects ɼ: " + std::to_wstring(pCore->visibleRitemIdxList.size()) +
+        L"/" + std::to_wstring(pCore->ritemBounds.count);
+
+    if (!pCore->pickedRitemName.empty()) {
+        caption += L", Picked ʰȡ: " + std::wstring(pCore->pickedRitemName.begin(), pCore->pickedRitemName.end());
+    }
+
     //caption += L", Camera Position λã(" +
     //    std::to_wstring(pCore->camera->position.x) + L", " +
     //    std::to_wstring(pCore->camera->position.y) + L", " +
@@ -331,11 +408,19 @@ void updateRenderWindowCaptionInfo(D3DCore* pCore) {
     // Gaussian blur.
     if (GetAsyncKeyState('2') & 0x8000) {
         caption += L", Gaussian Blur ˹ģ˾";
+        if (GetAsyncKeyState(VK_SPACE)) {
+            caption += L"ʽ";
+        }
+        auto gaussianBlur = (GaussianBlur*)pCore->postprocessors["gaussian_blur"].get();
+        caption += L", GPU Time ʱ: " + std::to_wstring(gaussianBlur->gpuMsecs()) + L" ms";
     }
 
     // Bilateral blur.
     if (GetAsyncKeyState('3') & 0x8000) {
         caption += L", Bilateral Blur ˫ģ˾";
+        if (GetAsyncKeyState(VK_SPACE)) {
+            caption += L"˫";
+        }
     }
 
     // Sobel operator.
@@ -360,13 +445,16 @@ void createCubeObject(
     const std::string& name,
     XMFLOAT3 pos, XMFLOAT3 xyz,
     const std::string& materialName,
-    const std::unordered_map<std::string, UINT>& layerInfos)
+    const std::unordered_map<std::string, UINT>& layerInfos,
+    SceneBuilder* builder)
 {
     auto geo = std::make_unique<ObjectGeometry>();
-    generateCube(xyz, geo.get());
-    translateObjectGeometry(pos.x, pos.y, pos.z, geo.get());
+    // The size is applied by the world matrix, so all cubes share one mesh. Note the normals are transformed
+    // with the inverse transpose of the world matrix, which keeps them right for the non-uniform sizes.
+    generateCube({ 1.0f, 1.0f, 1.0f }, geo.get());
     auto obj = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, geo.get(), 1, obj.get());
+    initRitemWithDedupGeoInfo(pCore, &pCore->geometryPool, geo.get(), 1, obj.get(), builder);
+    setRitemWorldTrans(XMMatrixScaling(xyz.x, xyz.y, xyz.z) * XMMatrixTranslation(pos.x, pos.y, pos.z), obj.get());
     obj->materials = { pCore->materials[materialName].get() };
     moveNamedRitemToAllRitems(pCore, name, std::move(obj));
     bindRitemReferenceWithLayers(pCore, name, layerInfos);
@@ -379,14 +467,16 @@ void createCylinderObject(
     float topR, float bottomR, float h,
     UINT sliceCount, UINT stackCount,
     const std::string& materialName,
-    const std::unordered_map<std::string, UINT>& layerInfos)
+    const std::unordered_map<std::string, UINT>& layerInfos,
+    SceneBuilder* builder)
 {
     auto geo = std::make_unique<ObjectGeometry>();
     generateCylinder(topR, bottomR, h, sliceCount, stackCount, geo.get());
-    rotateObjectGeometry(-XM_PIDIV2, 0.0f, 0.0f, geo.get());
-    translateObjectGeometry(pos.x, pos.y, pos.z, geo.get());
+    // The position is applied by the world matrix, so the cylinders of the same shape share one mesh.
+    transformObjectGeometry({ 1.0f, 1.0f, 1.0f }, { -XM_PIDIV2, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, geo.get());
     auto obj = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, geo.get(), 1, obj.get());
+    initRitemWithDedupGeoInfo(pCore, &pCore->geometryPool, geo.get(), 1, obj.get(), builder);
+    setRitemWorldTrans(XMMatrixTranslation(pos.x, pos.y, pos.z), obj.get());
     obj->materials = { pCore->materials[materialName].get() };
     moveNamedRitemToAllRitems(pCore, name, std::move(obj));
     bindRitemReferenceWithLayers(pCore, name, layerInfos);
@@ -398,47 +488,104 @@ void createSphereObject(
     XMFLOAT3 pos, float r,
     UINT subdivisionCount,
     const std::string& materialName,
-    const std::unordered_map<std::string, UINT>& layerInfos)
+    const std::unordered_map<std::string, UINT>& layerInfos,
+    SceneBuilder* builder)
 {
     auto geo = std::make_unique<ObjectGeometry>();
+    // The position is applied by the world matrix, so the spheres of the same shape share one mesh.
     generateGeoSphere(r, subdivisionCount, geo.get());
-    translateObjectGeometry(pos.x, pos.y, pos.z, geo.get());
     auto obj = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, geo.get(), 1, obj.get());
+    initRitemWithDedupGeoInfo(pCore, &pCore->geometryPool, geo.get(), 1, obj.get(), builder);
+    setRitemWorldTrans(XMMatrixTranslation(pos.x, pos.y, pos.z), obj.get());
     obj->materials = { pCore->materials[materialName].get() };
     moveNamedRitemToAllRitems(pCore, name, std::move(obj));
     bindRitemReferenceWithLayers(pCore, name, layerInfos);
 }
 
-void loadSkullModel(D3DCore* pCore) {
-    auto skullGeo = std::make_unique<ObjectGeometry>();
-    std::ifstream fin("models/skull.txt");
-    std::string skull_ignore;
-    UINT skullVerCount, skullTriCount;
-    fin >> skull_ignore >> skullVerCount;
-    fin >> skull_ignore >> skullTriCount;
-    skullGeo->vertices.resize(skullVerCount);
-    skullGeo->indices.resize(skullTriCount * 3);
-    fin >> skull_ignore >> skull_ignore >> skull_ignore >> skull_ignore;
-    for (UINT i = 0; i < skullVerCount; ++i) {
-        Vertex& ver = skullGeo->vertices[i];
-        fin >> ver.pos.x >> ver.pos.y >> ver.pos.z;
-        fin >> ver.normal.x >> ver.normal.y >> ver.normal.z;
+void createCylinderInstances(
+    D3DCore* pCore,
+    const std::string& name,
+    const std::vector<XMFLOAT3>& positions,
+    float topR, float bottomR, float h,
+    UINT sliceCount, UINT stackCount,
+    const std::string& materialName,
+    const std::unordered_map<std::string, UINT>& layerInfos,
+    SceneBuilder* builder)
+{
+    auto geo = std::make_unique<ObjectGeometry>();
+    generateCylinder(topR, bottomR, h, sliceCount, stackCount, geo.get());
+    // The positions are applied by the instances, so the mesh stays at the origin.
+    transformObjectGeometry({ 1.0f, 1.0f, 1.0f }, { -XM_PIDIV2, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, geo.get());
+    auto obj = std::make_unique<RenderItem>();
+    initRitemWithInstancedGeoInfo(pCore, &pCore->geometryPool, geo.get(), (UINT)positions.size(), obj.get(), builder);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        setInstanceWorldTrans(XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z), &obj->instances[i]);
     }
-    fin >> skull_ignore >> skull_ignore >> skull_ignore;
-    for (UINT i = 0; i < skullTriCount; ++i) {
-        fin >> skullGeo->indices[i * 3];
-        fin >> skullGeo->indices[i * 3 + 1];
-        fin >> skullGeo->indices[i * 3 + 2];
+    obj->materials = { pCore->materials[materialName].get() };
+    moveNamedRitemToAllRitems(pCore, name, std::move(obj));
+    bindRitemReferenceWithLayers(pCore, name, layerInfos);
+}
+
+void createSphereInstances(
+    D3DCore* pCore,
+    const std::string& name,
+    const std::vector<XMFLOAT3>& positions,
+    float r, UINT subdivisionCount,
+    const std::string& materialName,
+    const std::unordered_map<std::string, UINT>& layerInfos,
+    SceneBuilder* builder)
+{
+    auto geo = std::make_unique<ObjectGeometry>();
+    generateGeoSphere(r, subdivisionCount, geo.get());
+    auto obj = std::make_unique<RenderItem>();
+    initRitemWithInstancedGeoInfo(pCore, &pCore->geometryPool, geo.get(), (UINT)positions.size(), obj.get(), builder);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        setInstanceWorldTrans(XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z), &obj->instances[i]);
+    }
+    obj->materials = { pCore->materials[materialName].get() };
+    moveNamedRitemToAllRitems(pCore, name, std::move(obj));
+    bindRitemReferenceWithLayers(pCore, name, layerInfos);
+}
+
+void loadSkullModel(D3DCore* pCore, SceneBuilder* builder) {
+    auto skullGeo = std::make_unique<ObjectGeometry>();
+    // The text model is converted to a binary cache at the first run, which is loaded much faster.
+    std::string errorMessage;
+    if (!loadCachedTextMeshFile("models/skull.txt", "models/skull.rsmesh", skullGeo.get(), &errorMessage)) {
+        popupDebugWnd(std::wstring(errorMessage.begin(), errorMessage.end()));
+        exit(1);
     }
-    skullGeo->locationInfo.indexCount = (UINT)skullGeo->indices.size();
-    skullGeo->locationInfo.startIndexLocation = 0;
-    skullGeo->locationInfo.baseVertexLocation = 0;
-    scaleObjectGeometry(0.5f, 0.5f, 0.5f, skullGeo.get());
-    translateObjectGeometry(0.0f, 5.0f, 0.0f, skullGeo.get());
+    transformObjectGeometry({ 0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 5.0f, 0.0f }, skullGeo.get());
+    // The skull is the heaviest mesh in the scene, which is drawn with the packed vertices (16 bytes each).
+    auto skullPackedGeo = std::make_unique<PackedGeometry>();
+    packObjectGeometry(skullGeo.get(), skullPackedGeo.get());
     auto skull = std::make_unique<RenderItem>();
-    initRitemWithGeoInfo(pCore, skullGeo.get(), 1, skull.get());
+    initRitemWithPackedGeoInfo(pCore, skullPackedGeo.get(), 1, skull.get(), builder);
     skull->materials = { pCore->materials["skull"].get() };
     moveNamedRitemToAllRitems(pCore, "skull", std::move(skull));
-    bindRitemReferenceWithLayers(pCore, "skull", { {"solid", 0}, {"wireframe", 0} });
+    bindRitemReferenceWithLayers(pCore, "skull", { {"solid_packed", 0}, {"wireframe_packed", 0} });
+}
+
+PostProcessGraphDesc makeOutlineOverlayGraphDesc() {
+    PostProcessGraphDesc desc = {};
+    desc.resources = { { "frame", true }, { "edges", false }, { "outlined", false } };
+
+    PostProcessNodeDesc sobel = {};
+    sobel.name = "sobel";
+    sobel.kind = OUTLINE_SOBEL;
+    sobel.inputs = { 0 };
+    sobel.output = 1;
+
+    // The frame multiplied by its edges, which is compiled into the pass of the Sobel operator.
+    PostProcessNodeDesc multiply = {};
+    multiply.name = "multiply";
+    multiply.kind = OUTLINE_MULTIPLY;
+    multiply.inputs = { 0, 1 };
+    multiply.output = 2;
+    multiply.isPointwise = true;
+
+    desc.nodes = { sobel, multiply };
+    desc.fusionRules = { { OUTLINE_SOBEL, OUTLINE_MULTIPLY, OUTLINE_SOBEL_MULTIPLY } };
+    desc.finalOutput = 2;
+    return desc;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "d3dcore/d3dcore.h"
+#include "utils/scene-builder.h"
 
 void dev_initCoreElems(D3DCore* pCore);
 
@@ -37,12 +38,14 @@ void dev_onMouseScroll(WPARAM scrollInfo, D3DCore* pCore);
 void updateRenderWindowCaptionInfo(D3DCore* pCore);
 
 // Scene object creation tool funcs
+// If builder is not nullptr, the mesh data is uploaded in SceneBuilder::commit.
 void createCubeObject(
 	D3DCore* pCore,
 	const std::string& name,
 	XMFLOAT3 pos, XMFLOAT3 xyz,
 	const std::string& materialName,
-	const std::unordered_map<std::string, UINT>& layerInfos);
+	const std::unordered_map<std::string, UINT>& layerInfos,
+	SceneBuilder* builder = nullptr);
 
 void createCylinderObject(
 	D3DCore* pCore,
@@ -51,11 +54,34 @@ void createCylinderObject(
 	float topR, float bottomR, float h,
 	UINT sliceCount, UINT stackCount,
 	const std::string& materialName,
-	const std::unordered_map<std::string, UINT>& layerInfos);
+	const std::unordered_map<std::string, UINT>& layerInfos,
+	SceneBuilder* builder = nullptr);
 
 void createSphereObject(
 	D3DCore* pCore,
 	const std::string& name,
 	XMFLOAT3 pos, float r, UINT subdivisionCount,
 	const std::string& materialName,
-	const std::unordered_map<std::string, UINT>& layerInfos);
\ No newline at end of file
+	const std::unordered_map<std::string, UINT>& layerInfos,
+	SceneBuilder* builder = nullptr);
+
+// The objects share one mesh and are drawn with one draw call, i.e. an instanced render item (See
+// RenderItem::instances) with one instance at each position. Note the layers must be instanced, e.g. "solid_instanced".
+void createCylinderInstances(
+	D3DCore* pCore,
+	const std::string& name,
+	const std::vector<XMFLOAT3>& positions,
+	float topR, float bottomR, float h,
+	UINT sliceCount, UINT stackCount,
+	const std::string& materialName,
+	const std::unordered_map<std::string, UINT>& layerInfos,
+	SceneBuilder* builder = nullptr);
+
+void createSphereInstances(
+	D3DCore* pCore,
+	const std::string& name,
+	const std::vector<XMFLOAT3>& positions,
+	float r, UINT subdivisionCount,
+	const std::string& materialName,
+	const std::unordered_map<std::string, UINT>& layerInfos,
+	SceneBuilder* builder = nullptr);
\ No newline at end of file
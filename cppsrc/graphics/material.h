@@ -32,7 +32,8 @@ struct MaterialData {
 struct Material {
     std::string name;
     // We decide the material should be a frame-asynchronized data type.
-    // For more information about numDirtyFrames please turn to frame-async.h.
+    // Every frame resource stores a copy of the material data, so after matData is changed, numDirtyFrames
+    // should be set to NUM_FRAME_RESOURCES. It is decreased by 1 each time a copy is updated.
     int numDirtyFrames = NUM_FRAME_RESOURCES;
     // Specific material properties.
     MaterialData matData;
@@ -89,6 +89,26 @@ struct ObjConsts {
     int hasNormalMap = 0;
 
     UINT materialIndex = 0;
+    UINT _placeholder1 = 0;
+
+    // Only used by the meshes of packed vertices. See VertexDequantization in vmesh.h.
+    XMFLOAT4 posDequantScale = { 1.0f, 1.0f, 1.0f, 0.0f };
+    XMFLOAT4 posDequantBias = { 0.0f, 0.0f, 0.0f, 0.0f };
+    XMFLOAT4 uvDequantScaleBias = { 1.0f, 1.0f, 0.0f, 0.0f }; // xy: scale, zw: bias
+};
+
+// Per-instance data of the instanced render items (See RenderItem::instances). It is read from a tightly packed
+// structured buffer instead of a 256-byte constant buffer seat, so only the fields used by the instances are kept,
+// i.e. no displacement/normal maps and no packed vertices. The matrices are transposed just like ObjConsts.
+struct InstanceData {
+    XMFLOAT4X4 worldTrans = makeIdentityFloat4x4();
+    XMFLOAT4X4 invTrWorldTrans = makeIdentityFloat4x4(); // Tr: Transpose
+    XMFLOAT4X4 texTrans = makeIdentityFloat4x4();
+
+    UINT materialIndex = 0;
+    UINT _placeholder1 = 0;
+    UINT _placeholder2 = 0;
+    UINT _placeholder3 = 0;
 };
 
 struct ProcConsts {
@@ -22,6 +22,25 @@ struct Vertex {
     XMFLOAT2 size = { 0.0f, 0.0f }; // Only used for billboard technique. (generate vertices by geometry shader)
 };
 
+// Compact 16-byte vertex layout, which is used by the meshes with Vmesh::PACKED_VERTEX format.
+// See utils/packed-vertex-utils.h for the encoding and the error bounds. The size attribute is not
+// included here, since there is no billboard pipeline for the packed vertices.
+struct PackedVertex {
+    INT16 pos[4] = {}; // snorm16 relative to the mesh AABB. The 4th component is only a padding.
+    INT16 normal[2] = {}; // snorm16 of the octahedral-encoded normal.
+    UINT16 uv[2] = {}; // unorm16 relative to the mesh UV bounds.
+};
+
+// pos = posBias + posScale * p, uv = uvBias + uvScale * t, where p and t are the normalized values.
+struct VertexDequantization {
+    XMFLOAT3 posScale = { 1.0f, 1.0f, 1.0f };
+    XMFLOAT3 posBias = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT2 uvScale = { 1.0f, 1.0f };
+    XMFLOAT2 uvBias = { 0.0f, 0.0f };
+};
+
+struct GeometryPool;
+
 struct Vsubmesh {
     UINT indexCount = 0;
     UINT startIndexLocation = 0;
@@ -29,17 +48,28 @@ struct Vsubmesh {
 };
 
 struct Vmesh {
+    constexpr static int FULL_VERTEX = 0; // Vertex
+    constexpr static int PACKED_VERTEX = 1; // PackedVertex, which must be drawn with the packed input layout.
+
+    int vertexFormat = FULL_VERTEX;
+    // Only used by PACKED_VERTEX meshes. Note the shaders read it from ObjConsts of the render item.
+    VertexDequantization dequantization = {};
+
     ComPtr<ID3DBlob> vertexBuffCPU = nullptr;
     ComPtr<ID3DBlob> indexBuffCPU = nullptr;
 
     ComPtr<ID3D12Resource> vertexBuffGPU = nullptr;
     ComPtr<ID3D12Resource> indexBuffGPU = nullptr;
 
-    ComPtr<ID3D12Resource> vertexUploadBuff = nullptr;
-    ComPtr<ID3D12Resource> indexUploadBuff = nullptr;
-
     D3D12_VERTEX_BUFFER_VIEW vertexBuffView = {};
     D3D12_INDEX_BUFFER_VIEW indexBuffView = {};
 
+    // Set if the vertices and indices are suballocated from a geometry pool (see d3dcore/geometry-pool.h),
+    // in which case vertexBuffGPU and indexBuffGPU are shared with other meshes, and the submeshes are
+    // offset by poolVertexOffset and poolIndexOffset. The CPU data blocks are still of the mesh only.
+    GeometryPool* pool = nullptr;
+    UINT poolVertexOffset = 0;
+    UINT poolIndexOffset = 0;
+
     std::unordered_map<std::string, Vsubmesh> objects = {};
 };
\ No newline at end of file
@@ -8,6 +8,9 @@
 
 #include "d3dcore/d3dcore.h"
 #include "utils/debugger.h"
+#include "utils/frame-async-utils.h"
+#include "utils/thread-utils.h"
+#include "utils/upload-ring-utils.h"
 #include "utils/vmesh-utils.h"
 #include "wave-simulator.h"
 
@@ -31,7 +34,15 @@ WaveSimulator::WaveSimulator(D3DCore* pCore,
 
 	updateConstraints();
 
-	if (_optimized) initComputeShaderResources();
+	if (_optimized) {
+		initComputeShaderResources();
+	}
+	else {
+		// The wave grid is only read by the CPU solvers.
+		_waveGrid = std::make_unique<WaveGrid>();
+		initWaveGrid(_M, _N, _waveGrid.get());
+		gatherWaveGrid();
+	}
 }
 
 /*                    /|\ y
@@ -54,11 +65,87 @@ void WaveSimulator::update() {
 	if (_optimized) {
 		updateWithComputeShaderOptimized();
 	}
+	else if (_cpuSolverMode == CPU_PARALLEL_SOA) {
+		updateWithCPUParallelSoA();
+	}
 	else {
 		updateWithCPUGeneralCompute();
 	}
 }
 
+void WaveSimulator::setCPUSolverMode(int mode) {
+	if (mode == _cpuSolverMode) return;
+	if (_optimized) {
+		_cpuSolverMode = mode;
+		return;
+	}
+	// Keep the wave state when switching, so that the animation continues seamlessly.
+	if (mode == CPU_PARALLEL_SOA) gatherWaveGrid();
+	else scatterWaveGrid(true);
+	_cpuSolverMode = mode;
+}
+
+void WaveSimulator::updateWithCPUParallelSoA() {
+	// Wait disturb CD.
+	if (pCore->timer->elapsedSecs > lastDisturbTime + _disturbCD) {
+
+		lastDisturbTime = (float)pCore->timer->elapsedSecs;
+
+		UINT x = randint(1, _M - 2);
+		UINT y = randint(1, _N - 2);
+		float h = randfloat(_hmin, _hmax);
+		disturbWaveGrid(x, y, h, _waveGrid.get());
+	}
+
+	// Wait update CD.
+	if (pCore->timer->elapsedSecs > lastUpdateTime + _t) {
+
+		lastUpdateTime = (float)pCore->timer->elapsedSecs;
+
+		stepWaveGrid(_a1, _a2, _a3, _d, _waveGrid.get());
+	}
+
+	// _prevGeo is only needed by CPU general computation, which is synchronized in setCPUSolverMode.
+	scatterWaveGrid(false);
+
+	uploadDynamicVertices();
+}
+
+void WaveSimulator::uploadDynamicVertices() {
+	// The target mesh is the copy in current frame resource, so the data is staged in its upload ring,
+	// which is reclaimed after the GPU finishes the frame. See dev_updateCoreData in devfunc.cpp.
+	if (!uploadStatedBuffWithRing(pCore, &pCore->currFrameResource->uploadRing,
+		_mesh->vertexBuffGPU.Get(), D3D12_RESOURCE_STATE_GENERIC_READ,
+		_geo->vertices.data(), _geo->vertexDataSize()))
+	{
+		popupDebugWnd(L"The upload ring of frame resource is too small for the dynamic mesh");
+		exit(1);
+	}
+}
+
+void WaveSimulator::gatherWaveGrid() {
+	auto& prev = _waveGrid->prevHeights;
+	auto& curr = _waveGrid->currHeights;
+	for (UINT k = 0; k < _M * _N; ++k) {
+		prev[k] = _prevGeo->vertices[k].pos.y;
+		curr[k] = _geo->vertices[k].pos.y;
+		_waveGrid->normalX[k] = _geo->vertices[k].normal.x;
+		_waveGrid->normalY[k] = _geo->vertices[k].normal.y;
+		_waveGrid->normalZ[k] = _geo->vertices[k].normal.z;
+	}
+}
+
+void WaveSimulator::scatterWaveGrid(bool includePrevHeights) {
+	parallelFor(0, _N, 16, [&](size_t begin, size_t end) {
+		for (size_t k = begin * _M; k < end * _M; ++k) {
+			auto& v = _geo->vertices[k];
+			v.pos.y = _waveGrid->currHeights[k];
+			v.normal = { _waveGrid->normalX[k], _waveGrid->normalY[k], _waveGrid->normalZ[k] };
+			if (includePrevHeights) _prevGeo->vertices[k].pos.y = _waveGrid->prevHeights[k];
+		}
+	});
+}
+
 void WaveSimulator::updateWithCPUGeneralCompute() {
 	// Wait disturb CD.
 	if (pCore->timer->elapsedSecs > lastDisturbTime + _disturbCD) {
@@ -120,10 +207,7 @@ void WaveSimulator::updateWithCPUGeneralCompute() {
 		}
 	}
 
-	uploadStatedResource(pCore,
-		_mesh->vertexBuffGPU.Get(), D3D12_RESOURCE_STATE_GENERIC_READ,
-		_mesh->vertexUploadBuff.Get(), D3D12_RESOURCE_STATE_GENERIC_READ,
-		_geo->vertices.data(), _geo->vertexDataSize());
+	uploadDynamicVertices();
 }
 
 void WaveSimulator::initComputeShaderResources() {
@@ -299,14 +383,14 @@ void WaveSimulator::createResourceDescriptors() {
 
 void WaveSimulator::updateWithComputeShaderOptimized() {
 
-	pCore->cmdList->SetComputeRootSignature(pCore->rootSigs["wave_simulator"].Get());
+	pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["wave_simulator"].Get());
 
 	ID3D12DescriptorHeap* descHeaps[] = { descHeap.Get() };
-	pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+	pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
 	// We should bind current crest texture resource here due to both
 	// random-disturb and calc-update will use the crest data in it.
-	pCore->cmdList->SetComputeRootDescriptorTable(2, currUav_GPU);
+	pCore->cmdRecorder->SetComputeRootDescriptorTable(2, currUav_GPU);
 
 	// Wait disturb CD.
 	if (pCore->timer->elapsedSecs > lastDisturbTime + _disturbCD) {
@@ -328,13 +412,13 @@ void WaveSimulator::updateWithComputeShaderOptimized() {
 		// I falied to find any doc, article or blog about this problem until I write these codes.
 
 		// Dispatch CS.
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &h, 4);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &x, 7);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &y, 8);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &h, 4);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &x, 7);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &y, 8);
 
-		pCore->cmdList->SetPipelineState(pCore->PSOs["wave_simulator_disturb_wave"].Get());
+		pCore->cmdRecorder->SetPipelineState(pCore->PSOs["wave_simulator_disturb_wave"].Get());
 
-		pCore->cmdList->Dispatch(1, 1, 1);
+		pCore->cmdRecorder->Dispatch(1, 1, 1);
 	}
 
 	// Wait update CD.
@@ -343,29 +427,29 @@ void WaveSimulator::updateWithComputeShaderOptimized() {
 		lastUpdateTime = (float)pCore->timer->elapsedSecs;
 
 		// Dispatch CS.
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_a1, 0);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_a2, 1);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_a3, 2);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_d, 3);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_M, 5);
-		pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_N, 6);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_a1, 0);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_a2, 1);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_a3, 2);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_d, 3);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_M, 5);
+		pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_N, 6);
 
-		pCore->cmdList->SetComputeRootDescriptorTable(1, prevUav_GPU);
-		pCore->cmdList->SetComputeRootDescriptorTable(3, nextUav_GPU);
+		pCore->cmdRecorder->SetComputeRootDescriptorTable(1, prevUav_GPU);
+		pCore->cmdRecorder->SetComputeRootDescriptorTable(3, nextUav_GPU);
 
-		pCore->cmdList->SetComputeRootDescriptorTable(4, displacementUav_GPU);
-		pCore->cmdList->SetComputeRootDescriptorTable(5, normalUav_GPU);
+		pCore->cmdRecorder->SetComputeRootDescriptorTable(4, displacementUav_GPU);
+		pCore->cmdRecorder->SetComputeRootDescriptorTable(5, normalUav_GPU);
 
 		UINT numGroupX = (UINT)ceilf(_M / 32.0f); // M = 32 in wave-simulation.hlsl
 		UINT numGroupY = (UINT)ceilf(_N / 32.0f); // N = 32 in wave-simulation.hlsl
 
-		pCore->cmdList->SetPipelineState(pCore->PSOs["wave_simulator_calc_displacement"].Get());
+		pCore->cmdRecorder->SetPipelineState(pCore->PSOs["wave_simulator_calc_displacement"].Get());
 
-		pCore->cmdList->Dispatch(numGroupX, numGroupY, 1);
+		pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
 
-		pCore->cmdList->SetPipelineState(pCore->PSOs["wave_simulator_calc_normal"].Get());
+		pCore->cmdRecorder->SetPipelineState(pCore->PSOs["wave_simulator_calc_normal"].Get());
 
-		pCore->cmdList->Dispatch(numGroupX, numGroupY, 1);
+		pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
 
 		// Update crest data.
 		copyStatedResource(pCore,
@@ -376,7 +460,9 @@ void WaveSimulator::updateWithComputeShaderOptimized() {
 			nextResource.Get(), D3D12_RESOURCE_STATE_GENERIC_READ);
 	}
 
-	// Update target render item properties.
+	// Update target render item properties. The draw lists copy the descriptor heap, so they must be
+	// compiled again if it is changed.
+	if (ritem->displacementAndNormalMapDescHeap != descHeap.Get()) invalidateDrawLists(pCore);
 	ritem->displacementAndNormalMapDescHeap = descHeap.Get();
 	ritem->hasDisplacementMap = 1;
 	ritem->displacementMapHandle = displacementSrv_GPU;
@@ -385,26 +471,16 @@ void WaveSimulator::updateWithComputeShaderOptimized() {
 }
 
 void WaveSimulator::updateConstraints() {
-	
-	// Coefficients:
-	//
-	//       4 - 8 c^2 t^2 / d^2              ut - 2              2 c^2 t^2 / d^2
-	// a1 = ---------------------       a2 = --------       a3 = -----------------
-	//             ut + 2                     ut + 2                   ut + 2
-	//
-	// Constraints:
-	// 
-	//              u + sqrt{ u^2 + 32 c^2 / d^2 }   ||    ||           d
-	// 0 < max_t < --------------------------------  || OR ||  0 < c < ---- sqrt{ ut + 2 }
-	//                       8 c^2 / d^2             ||    ||           2t
+	// See wave-solver.cpp for the coefficients and constraints.
+	auto coef = calcWaveCoefficients(_d, _c, _u);
 
-	_maxt = (_u + sqrtf(_u * _u + 32 * _c * _c / (_d * _d))) / (8 * _c * _c / (_d * _d));
+	_maxt = coef.maxt;
 
-	_t = _maxt * 0.5f;
+	_t = coef.t;
 
-	_a1 = (4 - 8 * _c * _c * _t * _t / (_d * _d)) / (_u * _t + 2);
+	_a1 = coef.a1;
 
-	_a2 = (_u * _t - 2) / (_u * _t + 2);
+	_a2 = coef.a2;
 
-	_a3 = (2 * _c * _c * _t * _t / (_d * _d)) / (_u * _t + 2);
-}
+	_a3 = coef.a3;
+}
\ No newline at end of file
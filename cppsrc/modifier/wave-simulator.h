@@ -9,6 +9,7 @@
 
 #include "utils/geometry-utils.h"
 #include "modifier.h"
+#include "wave-solver.h"
 
 class WaveSimulator : public Modifier {
 public:
@@ -28,11 +29,33 @@ public:
 	// Inovke Update() every frame to simulate a wave animation.
 	void update() override;
 
+	// CPU solver modes, which only take effect when the GPU CS optimization is disabled.
+	constexpr static int CPU_GENERAL = 0; // Walk the vertices of the grid geometry directly.
+	constexpr static int CPU_PARALLEL_SOA = 1; // Multithreaded vector kernels. See wave-solver.h.
+
 private:
 	bool _optimized = true;
 
 	void updateWithCPUGeneralCompute();
 
+	// Upload the vertices of _geo to the target mesh with the upload ring of current frame resource.
+	void uploadDynamicVertices();
+
+	// CPU parallel SoA optimization.
+
+	int _cpuSolverMode = CPU_PARALLEL_SOA;
+
+	// Only allocated when the GPU CS optimization is disabled.
+	std::unique_ptr<WaveGrid> _waveGrid = nullptr;
+
+	void updateWithCPUParallelSoA();
+
+	// Copy the crest heights of _geo and _prevGeo into the wave grid.
+	void gatherWaveGrid();
+
+	// Write the crest heights and normals of the wave grid back to _geo and _prevGeo.
+	void scatterWaveGrid(bool includePrevHeights);
+
 	// GPU optimization.
 
 	void initComputeShaderResources();
@@ -106,4 +129,7 @@ public:
 
 	inline float disturbCD() { return _disturbCD; }
 	inline void setDisturbCD(float value) { _disturbCD = value; }
+
+	inline int cpuSolverMode() { return _cpuSolverMode; }
+	void setCPUSolverMode(int mode);
 };
\ No newline at end of file
@@ -0,0 +1,223 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "utils/thread-utils.h"
+#include "wave-solver.h"
+
+WaveCoefficients calcWaveCoefficients(float d, float c, float u) {
+	// Coefficients:
+	//
+	//       4 - 8 c^2 t^2 / d^2              ut - 2              2 c^2 t^2 / d^2
+	// a1 = ---------------------       a2 = --------       a3 = -----------------
+	//             ut + 2                     ut + 2                   ut + 2
+	//
+	// Constraints:
+	// 
+	//              u + sqrt{ u^2 + 32 c^2 / d^2 }   ||    ||           d
+	// 0 < max_t < --------------------------------  || OR ||  0 < c < ---- sqrt{ ut + 2 }
+	//                       8 c^2 / d^2             ||    ||           2t
+
+	WaveCoefficients coef = {};
+
+	coef.maxt = (u + sqrtf(u * u + 32 * c * c / (d * d))) / (8 * c * c / (d * d));
+
+	coef.t = coef.maxt * 0.5f;
+
+	float t = coef.t;
+
+	coef.a1 = (4 - 8 * c * c * t * t / (d * d)) / (u * t + 2);
+
+	coef.a2 = (u * t - 2) / (u * t + 2);
+
+	coef.a3 = (2 * c * c * t * t / (d * d)) / (u * t + 2);
+
+	return coef;
+}
+
+void initWaveGrid(uint32_t M, uint32_t N, WaveGrid* grid) {
+	grid->M = M;
+	grid->N = N;
+	size_t count = (size_t)M * N;
+	grid->prevHeights.assign(count, 0.0f);
+	grid->currHeights.assign(count, 0.0f);
+	grid->normalX.assign(count, 0.0f);
+	grid->normalY.assign(count, 1.0f);
+	grid->normalZ.assign(count, 0.0f);
+}
+
+void disturbWaveGrid(uint32_t x, uint32_t y, float h, WaveGrid* grid) {
+	float halfH = h * 0.5f;
+	auto M = grid->M;
+	auto& curr = grid->currHeights;
+	curr[x + y * M] = h;
+	curr[x - 1 + y * M] = halfH;
+	curr[x + 1 + y * M] = halfH;
+	curr[x + (y - 1) * M] = halfH;
+	curr[x + (y + 1) * M] = halfH;
+}
+
+// Every node in the vector kernels is evaluated with exactly the same expression as the scalar one:
+// next = (a1 * curr + a2 * prev) + a3 * (((left + right) + above) + below)
+// The brackets are written explicitly to keep the evaluation order, which makes the result bit-exact.
+
+static inline float calcNextHeight(float a1, float a2, float a3,
+	const float* curr, const float* prev, const float* above, const float* below, uint32_t i)
+{
+	return (a1 * curr[i] + a2 * prev[i]) + a3 * (((curr[i - 1] + curr[i + 1]) + above[i]) + below[i]);
+}
+
+static inline XMVECTOR XM_CALLCONV calcNextHeight4(FXMVECTOR a1, FXMVECTOR a2, FXMVECTOR a3,
+	const float* curr, const float* prev, const float* above, const float* below, uint32_t i)
+{
+	XMVECTOR c = XMLoadFloat4((const XMFLOAT4*)(curr + i));
+	XMVECTOR p = XMLoadFloat4((const XMFLOAT4*)(prev + i));
+	XMVECTOR l = XMLoadFloat4((const XMFLOAT4*)(curr + i - 1));
+	XMVECTOR r = XMLoadFloat4((const XMFLOAT4*)(curr + i + 1));
+	XMVECTOR u = XMLoadFloat4((const XMFLOAT4*)(above + i));
+	XMVECTOR b = XMLoadFloat4((const XMFLOAT4*)(below + i));
+	XMVECTOR t = XMVectorAdd(XMVectorMultiply(a1, c), XMVectorMultiply(a2, p));
+	XMVECTOR s = XMVectorAdd(XMVectorAdd(XMVectorAdd(l, r), u), b);
+	return XMVectorAdd(t, XMVectorMultiply(a3, s));
+}
+
+// Row j of prevHeights is overwritten by the heights of next time step, since the formula
+// only depends on the previous height of the same node. See updateWithCPUGeneralCompute.
+static void stepWaveGridRow(float a1, float a2, float a3, uint32_t j, WaveGrid* grid) {
+	auto M = grid->M;
+	const float* curr = grid->currHeights.data() + (size_t)j * M;
+	const float* above = curr - M;
+	const float* below = curr + M;
+	float* next = grid->prevHeights.data() + (size_t)j * M;
+
+	XMVECTOR va1 = XMVectorReplicate(a1);
+	XMVECTOR va2 = XMVectorReplicate(a2);
+	XMVECTOR va3 = XMVectorReplicate(a3);
+
+	uint32_t i = 1;
+	// 2 vectors (8 nodes) per iteration to hide the latency of the adds.
+	for (; i + 8 <= M - 1; i += 8) {
+		XMVECTOR n0 = calcNextHeight4(va1, va2, va3, curr, next, above, below, i);
+		XMVECTOR n1 = calcNextHeight4(va1, va2, va3, curr, next, above, below, i + 4);
+		XMStoreFloat4((XMFLOAT4*)(next + i), n0);
+		XMStoreFloat4((XMFLOAT4*)(next + i + 4), n1);
+	}
+	for (; i + 4 <= M - 1; i += 4) {
+		XMStoreFloat4((XMFLOAT4*)(next + i), calcNextHeight4(va1, va2, va3, curr, next, above, below, i));
+	}
+	for (; i < M - 1; ++i) {
+		next[i] = calcNextHeight(a1, a2, a3, curr, next, above, below, i);
+	}
+}
+
+// Note the heights here are those of the next time step, i.e. grid->prevHeights before swapped.
+static void updateWaveGridNormalRow(float d, const float* heights, uint32_t j, WaveGrid* grid) {
+	auto M = grid->M;
+	const float* row = heights + (size_t)j * M;
+	const float* above = row - M;
+	const float* below = row + M;
+	float* nx = grid->normalX.data() + (size_t)j * M;
+	float* ny = grid->normalY.data() + (size_t)j * M;
+	float* nz = grid->normalZ.data() + (size_t)j * M;
+
+	// Swap y-component and z-component due to Y-axis is the upward direction in the scene.
+	XMVECTOR vy = XMVectorReplicate(2 * d);
+	XMVECTOR vyy = XMVectorMultiply(vy, vy);
+
+	uint32_t i = 1;
+	for (; i + 4 <= M - 1; i += 4) {
+		XMVECTOR x = XMVectorSubtract(
+			XMLoadFloat4((const XMFLOAT4*)(row + i - 1)), XMLoadFloat4((const XMFLOAT4*)(row + i + 1)));
+		XMVECTOR z = XMVectorSubtract(
+			XMLoadFloat4((const XMFLOAT4*)(above + i)), XMLoadFloat4((const XMFLOAT4*)(below + i)));
+		XMVECTOR len = XMVectorSqrt(XMVectorAdd(XMVectorAdd(XMVectorMultiply(x, x), vyy), XMVectorMultiply(z, z)));
+		XMStoreFloat4((XMFLOAT4*)(nx + i), XMVectorDivide(x, len));
+		XMStoreFloat4((XMFLOAT4*)(ny + i), XMVectorDivide(vy, len));
+		XMStoreFloat4((XMFLOAT4*)(nz + i), XMVectorDivide(z, len));
+	}
+	float y = 2 * d;
+	for (; i < M - 1; ++i) {
+		float x = row[i - 1] - row[i + 1];
+		float z = above[i] - below[i];
+		float len = sqrtf((x * x + y * y) + z * z);
+		nx[i] = x / len;
+		ny[i] = y / len;
+		nz[i] = z / len;
+	}
+}
+
+void stepWaveGrid(float a1, float a2, float a3, float d, WaveGrid* grid) {
+	auto M = grid->M;
+	auto N = grid->N;
+	if (M < 3 || N < 3) return;
+
+	const float* nextHeights = grid->prevHeights.data();
+
+	// The interior rows are [1, N - 1). Each band takes some rows and the normal of row k can be
+	// calculated in the same band only if rows k - 1 and k + 1 are finished, i.e. they are either in
+	// the band or border rows (which are never changed). The rest rows are handled after all bands.
+	size_t bandCount = std::max<size_t>(1, std::min<size_t>(workerThreadCount() * 4, (N - 2) / 4));
+	size_t bandRowCount = (N - 2 + bandCount - 1) / bandCount;
+
+	parallelFor(1, N - 1, bandRowCount, [&](size_t begin, size_t end) {
+		size_t firstNormalRow = (begin == 1) ? 1 : begin + 1;
+		for (size_t j = begin; j < end; ++j) {
+			stepWaveGridRow(a1, a2, a3, (uint32_t)j, grid);
+			if (j >= firstNormalRow + 1) updateWaveGridNormalRow(d, nextHeights, (uint32_t)(j - 1), grid);
+		}
+		if (end == N - 1 && end - 1 >= firstNormalRow) updateWaveGridNormalRow(d, nextHeights, (uint32_t)(end - 1), grid);
+	});
+
+	std::vector<uint32_t> deferredRows = {};
+	for (size_t begin = 1; begin < N - 1; begin += bandRowCount) {
+		size_t end = std::min<size_t>(begin + bandRowCount, N - 1);
+		size_t firstNormalRow = (begin == 1) ? 1 : begin + 1;
+		auto isDoneInBand = [&](size_t k) { return k >= firstNormalRow && (k < end - 1 || end == N - 1); };
+		if (!isDoneInBand(begin)) deferredRows.push_back((uint32_t)begin);
+		if (end - 1 != begin && !isDoneInBand(end - 1)) deferredRows.push_back((uint32_t)(end - 1));
+	}
+	parallelFor(0, deferredRows.size(), 4, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k) updateWaveGridNormalRow(d, nextHeights, deferredRows[k], grid);
+	});
+
+	std::swap(grid->prevHeights, grid->currHeights);
+}
+
+void stepWaveGridReference(float a1, float a2, float a3, float d, WaveGrid* grid) {
+	auto M = grid->M;
+	auto N = grid->N;
+	auto& prev = grid->prevHeights;
+	auto& curr = grid->currHeights;
+
+	for (uint32_t i = 1; i < M - 1; ++i) {
+		for (uint32_t j = 1; j < N - 1; ++j) {
+			prev[i + j * M] = a1 * curr[i + j * M] + a2 * prev[i + j * M] +
+				a3 * (curr[i - 1 + j * M] + curr[i + 1 + j * M] + curr[i + (j - 1) * M] + curr[i + (j + 1) * M]);
+		}
+	}
+
+	std::swap(grid->prevHeights, grid->currHeights);
+
+	for (uint32_t i = 1; i < M - 1; ++i) {
+		for (uint32_t j = 1; j < N - 1; ++j) {
+			float y_left = curr[i - 1 + j * M];
+			float y_right = curr[i + 1 + j * M];
+			float y_above = curr[i + (j - 1) * M];
+			float y_below = curr[i + (j + 1) * M];
+			XMFLOAT3 nor;
+			XMStoreFloat3(&nor, XMVector3Normalize(XMVectorSet(y_left - y_right, 2 * d, y_above - y_below, 0.0f)));
+			grid->normalX[i + j * M] = nor.x;
+			grid->normalY[i + j * M] = nor.y;
+			grid->normalZ[i + j * M] = nor.z;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Headless CPU kernel of the wave equation used by WaveSimulator.
+// It does not depend on D3DCore or any Windows API, so it can also be driven without a GPU.
+//
+// Unlike the general CPU computation in WaveSimulator, which walks the 40-byte Vertex array
+// column by column, the crest heights here are kept in separate float planes (SoA), laid out
+// row by row with x as the fastest axis. The index of node (x, y) is x + y * M, which is the
+// same as the vertex index in the grid generated by generateGrid(xxx).
+//
+// Precision: the heights are bit-for-bit identical to the scalar computation, since the vector
+// kernels evaluate the same expression in the same order (no fused multiply-add is used).
+// The normals are normalized with a per-lane square root and division, which may differ from
+// XMVector3Normalize by at most 2 ULP per component (i.e. absolute error < 3.0e-7).
+struct WaveGrid {
+	uint32_t M = 0, N = 0; // Node count of each row and each column.
+
+	std::vector<float> prevHeights = {}; // Crest heights of the previous time step.
+	std::vector<float> currHeights = {}; // Crest heights of the current time step.
+
+	// Normal components of the current time step.
+	// Note the normals of the border nodes are never updated by stepWaveGrid.
+	std::vector<float> normalX = {}, normalY = {}, normalZ = {};
+};
+
+// Coefficients and time step of the wave equation. See calcWaveCoefficients for the formulas.
+struct WaveCoefficients {
+	float maxt = 0.0f; // Maximum update interval seconds.
+	float t = 0.0f; // Actual update interval seconds, which is set to maxt / 2.
+	float a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+};
+
+// d is the distance between two adjacent nodes, c is the spread velocity of wave
+// and u is the damping grade with velocity dimension.
+WaveCoefficients calcWaveCoefficients(float d, float c, float u);
+
+void initWaveGrid(uint32_t M, uint32_t N, WaveGrid* grid);
+
+// The disturbance is applied to the node (x, y) and its 4 adjacent nodes (with half height).
+// Thus x must be in [1, M - 2] and y must be in [1, N - 2].
+void disturbWaveGrid(uint32_t x, uint32_t y, float h, WaveGrid* grid);
+
+// Advance the grid by one time step with the wave equation's coefficients a1, a2, a3.
+// The rows are split across the worker pool (see thread-utils.h) and each row is processed with
+// vector kernels. The normal pass is fused into the same row loop, which lags one row behind.
+// d is the distance between two adjacent nodes, which is used to calculate the normals.
+void stepWaveGrid(float a1, float a2, float a3, float d, WaveGrid* grid);
+
+// Single-threaded scalar version of stepWaveGrid, which is kept as the golden reference.
+void stepWaveGridReference(float a1, float a2, float a3, float d, WaveGrid* grid);
@@ -28,26 +28,26 @@ void BasicProcess::onResize(UINT w, UINT h) {
 }
 
 ID3D12Resource* BasicProcess::process(ID3D12Resource* msaaOrigin) {
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             msaaOrigin,
             D3D12_RESOURCE_STATE_RENDER_TARGET,
             D3D12_RESOURCE_STATE_RESOLVE_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["main"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_RESOLVE_DEST));
 
     // We simply resolve and copy the MSAA origin buffer to the flat output buffer without postprocessing.
-    pCore->cmdList->ResolveSubresource(textures["main"].Get(), 0, msaaOrigin, 0, pCore->swapChainBuffFormat);
+    pCore->cmdRecorder->ResolveSubresource(textures["main"].Get(), 0, msaaOrigin, 0, pCore->swapChainBuffFormat);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             msaaOrigin,
             D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
             D3D12_RESOURCE_STATE_RENDER_TARGET));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["main"].Get(),
             D3D12_RESOURCE_STATE_RESOLVE_DEST,
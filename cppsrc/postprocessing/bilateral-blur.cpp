@@ -53,6 +53,38 @@ void BilateralBlur::init() {
     bindShaderToCPSO(&horzPsoDesc, s_bilateralBlur.get());
     horzPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
     checkHR(pCore->device->CreateComputePipelineState(&horzPsoDesc, IID_PPV_ARGS(&pCore->PSOs["bilateral_blur"])));
+
+    // Create bilateral grid root signature, where the grid is bound to t1 and u1.
+    CD3DX12_ROOT_PARAMETER gridRootParameter[5];
+
+    gridRootParameter[0].InitAsConstants(8, 0);
+    gridRootParameter[1].InitAsDescriptorTable(1, &srvTable);
+    gridRootParameter[2].InitAsDescriptorTable(1, &uavTable);
+    CD3DX12_DESCRIPTOR_RANGE gridSrvTable;
+    gridSrvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+    gridRootParameter[3].InitAsDescriptorTable(1, &gridSrvTable);
+    CD3DX12_DESCRIPTOR_RANGE gridUavTable;
+    gridUavTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1);
+    gridRootParameter[4].InitAsDescriptorTable(1, &gridUavTable);
+
+    CD3DX12_ROOT_SIGNATURE_DESC gridRootSigDesc(5, gridRootParameter, 0, nullptr,
+        D3D12_ROOT_SIGNATURE_FLAG_NONE);
+    createRootSig(pCore, "bilateral_grid", &gridRootSigDesc);
+
+    // Compile bilateral grid shaders and create their PSOs.
+    auto createGridPso = [&](const std::string& name, const char* entryPoint, std::unique_ptr<Shader>* shader) {
+        csEntryPoint.cs = entryPoint;
+        *shader = std::make_unique<Shader>(name, L"shaders/postprocessing/bilateral-grid.hlsl", Shader::CS, csEntryPoint);
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC gridPsoDesc = {};
+        gridPsoDesc.pRootSignature = pCore->rootSigs["bilateral_grid"].Get();
+        bindShaderToCPSO(&gridPsoDesc, shader->get());
+        gridPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+        checkHR(pCore->device->CreateComputePipelineState(&gridPsoDesc, IID_PPV_ARGS(&pCore->PSOs[name])));
+    };
+    createGridPso("bilateral_grid_splat", "SplatCS", &s_gridSplat);
+    createGridPso("bilateral_grid_blur", "BlurCS", &s_gridBlur);
+    createGridPso("bilateral_grid_slice", "SliceCS", &s_gridSlice);
 }
 
 void BilateralBlur::onResize(UINT w, UINT h) {
@@ -63,80 +95,256 @@ void BilateralBlur::onResize(UINT w, UINT h) {
 }
 
 ID3D12Resource* BilateralBlur::process(ID3D12Resource* flatOrigin) {
-    auto weights = calcGaussianBlurWeight(_blurRadius, _distanceGrade);
+    if (_blurMode == GRID) {
+        // The swap chain buffers are UNORM, thus the gray is in [0, 1].
+        BilateralGridLayout layout = {};
+        if (!calcBilateralGridLayout(_blurRadius, _distanceGrade, _grayGrade, texWidth, texHeight, 0.0f, 1.0f, &layout)) {
+            popupDebugWnd(L"The blur radius of the bilateral grid must be in [0, " + std::to_wstring(MAX_BLUR_RADIUS) + L"]");
+            exit(1);
+        }
+        prepareGridResources(layout);
+    }
 
     ID3D12DescriptorHeap* descHeaps[] = { texDescHeap.Get() };
-    pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
-
-    pCore->cmdList->SetComputeRootSignature(pCore->rootSigs["bilateral_blur"].Get());
-
-    pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_blurRadius, 0);
-    pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_twoSigma2, 1);
-    pCore->cmdList->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 2);
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_DEST));
 
-    pCore->cmdList->CopyResource(textures["A"].Get(), flatOrigin);
+    pCore->cmdRecorder->CopyResource(textures["A"].Get(), flatOrigin);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COPY_SOURCE,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COPY_DEST,
             D3D12_RESOURCE_STATE_GENERIC_READ));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
+    // Both ping-pong between texture A and B once per blur count.
+    if (_blurMode == GRID) recordGridPasses();
+    else recordDirectPasses();
+
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            textures["A"].Get(),
+            _blurCount % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_COMMON));
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            textures["B"].Get(),
+            _blurCount % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ,
+            D3D12_RESOURCE_STATE_COMMON));
+
+    return _blurCount % 2 == 0 ? textures["A"].Get() : textures["B"].Get();
+}
+
+void BilateralBlur::recordDirectPasses() {
+    auto weights = calcGaussianBlurWeight(_blurRadius, _distanceGrade);
+
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["bilateral_blur"].Get());
+
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_blurRadius, 0);
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_twoSigma2, 1);
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 2);
+
     for (int i = 0; i < _blurCount; ++i) {
         // Blur
-        pCore->cmdList->SetPipelineState(pCore->PSOs["bilateral_blur"].Get());
-        pCore->cmdList->SetComputeRootDescriptorTable(1, i % 2 == 0 ? texA_SrvGPU : texB_SrvGPU);
-        pCore->cmdList->SetComputeRootDescriptorTable(2, i % 2 == 0 ? texB_UavGPU : texA_UavGPU);
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["bilateral_blur"].Get());
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, i % 2 == 0 ? texA_SrvGPU : texB_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(2, i % 2 == 0 ? texB_UavGPU : texA_UavGPU);
 
         UINT numGroupX = (UINT)ceilf(texWidth / 16.0f); // X = 16 in bilateral-blur.hlsl
         UINT numGroupY = (UINT)ceilf(texHeight / 16.0f); // Y = 16 in bilateral-blur.hlsl
-        pCore->cmdList->Dispatch(numGroupX, numGroupY, 1);
+        pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
 
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["A"].Get(),
                 i % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
                 i % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ));
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["B"].Get(),
                 i % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ,
                 i % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
     }
+}
 
-    pCore->cmdList->ResourceBarrier(1,
+void BilateralBlur::recordGridPasses() {
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["bilateral_grid"].Get());
+
+    // Same as cbGridConfigs in bilateral-grid.hlsl.
+    struct GridConfigs {
+        float cellSize, invCellSize;
+        float grayOrigin, invGrayCellSize;
+        int gridWidth, gridHeight, gridDepth;
+        int blurAxis;
+    };
+    GridConfigs configs = {
+        _gridLayout.cellSize, 1.0f / _gridLayout.cellSize,
+        _gridLayout.grayOrigin, 1.0f / _gridLayout.grayCellSize,
+        (int)_gridLayout.width, (int)_gridLayout.height, (int)_gridLayout.depth,
+        0 };
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 8, &configs, 0);
+
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
-            textures["A"].Get(),
-            _blurCount % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            gridA.Get(),
+            D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            gridB.Get(),
+            D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_GENERIC_READ));
+
+    // Swap the states of grid A and B, i.e. the one just written becomes readable and the other writable.
+    auto swapGridStates = [&](bool isAWritten) {
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                gridA.Get(),
+                isAWritten ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ,
+                isAWritten ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                gridB.Get(),
+                isAWritten ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                isAWritten ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ));
+    };
+
+    for (int i = 0; i < _blurCount; ++i) {
+        // Splat into grid A.
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["bilateral_grid_splat"].Get());
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, i % 2 == 0 ? texA_SrvGPU : texB_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(4, gridA_UavGPU);
+
+        UINT numGroupX = (UINT)ceilf(_gridLayout.width / 8.0f); // X = 8 in SplatCS
+        UINT numGroupY = (UINT)ceilf(_gridLayout.height / 8.0f); // Y = 8 in SplatCS
+        pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
+        swapGridStates(true);
+
+        // Blur along x (A to B), y (B to A) and gray (A to B).
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["bilateral_grid_blur"].Get());
+        for (int axis = 0; axis < 3; ++axis) {
+            bool isFromA = axis % 2 == 0;
+            pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &axis, 7);
+            pCore->cmdRecorder->SetComputeRootDescriptorTable(3, isFromA ? gridA_SrvGPU : gridB_SrvGPU);
+            pCore->cmdRecorder->SetComputeRootDescriptorTable(4, isFromA ? gridB_UavGPU : gridA_UavGPU);
+
+            // X = Y = Z = 4 in BlurCS
+            pCore->cmdRecorder->Dispatch((UINT)ceilf(_gridLayout.width / 4.0f),
+                (UINT)ceilf(_gridLayout.height / 4.0f), (UINT)ceilf(_gridLayout.depth / 4.0f));
+            swapGridStates(!isFromA);
+        }
+
+        // Slice grid B.
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["bilateral_grid_slice"].Get());
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, i % 2 == 0 ? texA_SrvGPU : texB_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(2, i % 2 == 0 ? texB_UavGPU : texA_UavGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(3, gridB_SrvGPU);
+
+        numGroupX = (UINT)ceilf(texWidth / 16.0f); // X = 16 in SliceCS
+        numGroupY = (UINT)ceilf(texHeight / 16.0f); // Y = 16 in SliceCS
+        pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
+
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                textures["A"].Get(),
+                i % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                i % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ));
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                textures["B"].Get(),
+                i % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ,
+                i % 2 == 0 ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+    }
+
+    // After the splat and the 3 blurs, grid A is writable and grid B readable again.
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            gridA.Get(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
-            textures["B"].Get(),
-            _blurCount % 2 == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_GENERIC_READ,
+            gridB.Get(),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
             D3D12_RESOURCE_STATE_COMMON));
+}
 
-    return _blurCount % 2 == 0 ? textures["A"].Get() : textures["B"].Get();
+void BilateralBlur::prepareGridResources(const BilateralGridLayout& layout) {
+    if (gridA != nullptr && layout.width == _gridLayout.width &&
+        layout.height == _gridLayout.height && layout.depth == _gridLayout.depth)
+    {
+        _gridLayout = layout;
+        return;
+    }
+    _gridLayout = layout;
+
+    // The old grid might be still in use by the frames in flight.
+    flushCmdQueue(pCore);
+
+    D3D12_RESOURCE_DESC gridDesc;
+    ZeroMemory(&gridDesc, sizeof(D3D12_RESOURCE_DESC));
+    gridDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+    gridDesc.Alignment = 0;
+    gridDesc.Width = layout.width;
+    gridDesc.Height = layout.height;
+    gridDesc.DepthOrArraySize = (UINT16)layout.depth;
+    gridDesc.MipLevels = 1;
+    gridDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    gridDesc.SampleDesc.Count = 1;
+    gridDesc.SampleDesc.Quality = 0;
+    gridDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    gridDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    ComPtr<ID3D12Resource>* grids[] = { &gridA, &gridB };
+    for (auto grid : grids) {
+        checkHR(pCore->device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &gridDesc,
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(&*grid)));
+    }
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+    srvDesc.Texture3D.MostDetailedMip = 0;
+    srvDesc.Texture3D.MipLevels = 1;
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE3D;
+    uavDesc.Texture3D.MipSlice = 0;
+    uavDesc.Texture3D.FirstWSlice = 0;
+    uavDesc.Texture3D.WSize = layout.depth;
+
+    pCore->device->CreateShaderResourceView(gridA.Get(), &srvDesc, gridA_SrvCPU);
+    pCore->device->CreateShaderResourceView(gridB.Get(), &srvDesc, gridB_SrvCPU);
+
+    pCore->device->CreateUnorderedAccessView(gridA.Get(), nullptr, &uavDesc, gridA_UavCPU);
+    pCore->device->CreateUnorderedAccessView(gridB.Get(), nullptr, &uavDesc, gridB_UavCPU);
 }
 
 void BilateralBlur::createOffscreenTextureResources() {
@@ -174,7 +382,7 @@ void BilateralBlur::createOffscreenTextureResources() {
 
 void BilateralBlur::createTextureDescriptorHeap() {
     D3D12_DESCRIPTOR_HEAP_DESC tdhDesc = {}; // tdh: Texture Descriptor Heap
-    tdhDesc.NumDescriptors = 4; // SRV, UAV for texA, texB, 2*2 = 4
+    tdhDesc.NumDescriptors = 8; // SRV, UAV for texA, texB, gridA, gridB, 2*4 = 8
     tdhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     tdhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     checkHR(pCore->device->CreateDescriptorHeap(&tdhDesc, IID_PPV_ARGS(&texDescHeap)));
@@ -188,12 +396,20 @@ void BilateralBlur::createResourceDescriptors() {
     texA_UavCPU = handle.Offset(1, cbvSrvUavDescSize);
     texB_SrvCPU = handle.Offset(1, cbvSrvUavDescSize);
     texB_UavCPU = handle.Offset(1, cbvSrvUavDescSize);
+    gridA_SrvCPU = handle.Offset(1, cbvSrvUavDescSize);
+    gridA_UavCPU = handle.Offset(1, cbvSrvUavDescSize);
+    gridB_SrvCPU = handle.Offset(1, cbvSrvUavDescSize);
+    gridB_UavCPU = handle.Offset(1, cbvSrvUavDescSize);
 
     CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(texDescHeap->GetGPUDescriptorHandleForHeapStart());
     texA_SrvGPU = gpuHandle;
     texA_UavGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
     texB_SrvGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
     texB_UavGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
+    gridA_SrvGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
+    gridA_UavGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
+    gridB_SrvGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
+    gridB_UavGPU = gpuHandle.Offset(1, cbvSrvUavDescSize);
 
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
     srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -11,9 +11,19 @@
 
 #include "basic-process.h"
 #include "graphics/shader.h"
-
+#include "image-filter.h"
+
+// The blur radius must not be greater than 5 (See bilateral-blur.hlsl), and bilateralBlurImage in image-filter.h is
+// the CPU version.
+//
+// In GRID mode, the blur is instead approximated by a bilateral grid (See bilateral-grid.hlsl), whose cost does not
+// depend on the blur radius. The grid of 2 3D textures is created on first use and whenever its layout changes.
+// bilateralGridBlurImage in image-filter.h is the CPU version.
 class BilateralBlur : public BasicProcess {
 public:
+    constexpr static int DIRECT = 0;
+    constexpr static int GRID = 1;
+
     BilateralBlur(D3DCore* pCore, int blurRadius, float distanceGrade, float grayGrade, int blurCount);
 
     void init() override;
@@ -34,6 +44,9 @@ public:
     inline int blurCount() { return _blurCount; }
     inline void setBlurCount(int c) { _blurCount = c; }
 
+    inline int blurMode() { return _blurMode; }
+    inline void setBlurMode(int m) { _blurMode = m; }
+
 protected:
     void createOffscreenTextureResources() override;
 
@@ -47,22 +60,40 @@ private:
 
     void createResourceDescriptors();
 
+    // Recreate the grid textures and their descriptors if the layout has changed.
+    void prepareGridResources(const BilateralGridLayout& layout);
+
+    void recordDirectPasses();
+
+    void recordGridPasses();
+
 private:
     int _blurRadius = 0;
     float _distanceGrade = 0.0f;
     float _grayGrade = 0.0f;
     int _blurCount = 0;
+    int _blurMode = DIRECT;
 
     float _twoSigma2 = 0.0f;
 
     std::unique_ptr<Shader> s_bilateralBlur = nullptr;
+    std::unique_ptr<Shader> s_gridSplat = nullptr;
+    std::unique_ptr<Shader> s_gridBlur = nullptr;
+    std::unique_ptr<Shader> s_gridSlice = nullptr;
+
+    BilateralGridLayout _gridLayout = {};
+    ComPtr<ID3D12Resource> gridA = nullptr, gridB = nullptr;
 
     ComPtr<ID3D12DescriptorHeap> texDescHeap = nullptr;
 
     D3D12_CPU_DESCRIPTOR_HANDLE
         texA_SrvCPU = {}, texA_UavCPU = {},
-        texB_SrvCPU = {}, texB_UavCPU = {};
+        texB_SrvCPU = {}, texB_UavCPU = {},
+        gridA_SrvCPU = {}, gridA_UavCPU = {},
+        gridB_SrvCPU = {}, gridB_UavCPU = {};
     D3D12_GPU_DESCRIPTOR_HANDLE
         texA_SrvGPU = {}, texA_UavGPU = {},
-        texB_SrvGPU = {}, texB_UavGPU = {};
+        texB_SrvGPU = {}, texB_UavGPU = {},
+        gridA_SrvGPU = {}, gridA_UavGPU = {},
+        gridB_SrvGPU = {}, gridB_UavGPU = {};
 };
\ No newline at end of file
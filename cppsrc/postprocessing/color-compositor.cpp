@@ -65,57 +65,57 @@ void ColorCompositor::onResize(UINT w, UINT h) {
 ID3D12Resource* ColorCompositor::process(ID3D12Resource* flatOrigin) {
 
     ID3D12DescriptorHeap* descHeaps[] = { texDescHeap.Get() };
-    pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
-    pCore->cmdList->SetComputeRootSignature(pCore->rootSigs["color_compositor"].Get());
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["color_compositor"].Get());
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_DEST));
 
-    pCore->cmdList->CopyResource(textures["A"].Get(), flatOrigin);
+    pCore->cmdRecorder->CopyResource(textures["A"].Get(), flatOrigin);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COPY_SOURCE,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COPY_DEST,
             D3D12_RESOURCE_STATE_GENERIC_READ));
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["C"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
-    pCore->cmdList->SetPipelineState(pCore->PSOs["color_compositor"].Get());
-    pCore->cmdList->SetComputeRoot32BitConstant(0, _mixType, 0);
-    pCore->cmdList->SetComputeRoot32BitConstant(0, (UINT)_weight, 1);
-    pCore->cmdList->SetComputeRootDescriptorTable(1, texA_SrvGPU);
-    pCore->cmdList->SetComputeRootDescriptorTable(2, texB_SrvGPU);
-    pCore->cmdList->SetComputeRootDescriptorTable(3, texC_UavGPU);
+    pCore->cmdRecorder->SetPipelineState(pCore->PSOs["color_compositor"].Get());
+    pCore->cmdRecorder->SetComputeRoot32BitConstant(0, _mixType, 0);
+    pCore->cmdRecorder->SetComputeRoot32BitConstant(0, (UINT)_weight, 1);
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(1, texA_SrvGPU);
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(2, texB_SrvGPU);
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(3, texC_UavGPU);
 
     UINT numGroupX = (UINT)ceilf(texWidth / 32.0f); // M = 32 in multiplication-compositor.hlsl
     UINT numGroupY = (UINT)ceilf(texHeight / 32.0f); // N = 32 in multiplication-compositor.hlsl
-    pCore->cmdList->Dispatch(numGroupX, numGroupY, 1);
+    pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_GENERIC_READ,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["C"].Get(),
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
@@ -129,25 +129,25 @@ void ColorCompositor::bindBackgroundPlate(ID3D12Resource* bkgn, int mixType, flo
     _mixType = mixType;
     _weight = weight;
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             bkgn,
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_DEST));
 
-    pCore->cmdList->CopyResource(textures["B"].Get(), bkgn);
+    pCore->cmdRecorder->CopyResource(textures["B"].Get(), bkgn);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             bkgn,
             D3D12_RESOURCE_STATE_COPY_SOURCE,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_COPY_DEST,
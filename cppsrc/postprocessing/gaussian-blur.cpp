@@ -6,11 +6,22 @@
 ** yiyaowen (c) 2021 All Rights Reserved.
 */
 
+#include <algorithm>
+
 #include "d3dcore/d3dcore.h"
 #include "gaussian-blur.h"
+#include "image-filter.h"
 #include "utils/debugger.h"
 #include "utils/math-utils.h"
 
+// Each thread of box-blur.hlsl walks a segment of at least this many pixels, and of at least the window of the
+// box, so summing the window of the first pixel never costs more than the walk.
+constexpr int MIN_BOX_SEGMENT_LENGTH = 32;
+
+static int calcBoxSegmentLength(int boxRadius) {
+    return (std::max)(MIN_BOX_SEGMENT_LENGTH, 2 * boxRadius + 1);
+}
+
 GaussianBlur::GaussianBlur(D3DCore* pCore, int blurRadius, float blurGrade, int blurCount)
     : BasicProcess(pCore), _blurRadius(blurRadius), _blurGrade(blurGrade), _blurCount(blurCount)
 {
@@ -61,6 +72,28 @@ void GaussianBlur::init() {
     bindShaderToCPSO(&vertPsoDesc, s_gaussianBlurVert.get());
     vertPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
     checkHR(pCore->device->CreateComputePipelineState(&vertPsoDesc, IID_PPV_ARGS(&pCore->PSOs["gaussian_blur_vert"])));
+
+    // The box filters share the root signature, of which only the first constant (the box radius) is used.
+    csEntryPoint.cs = "HorzBoxBlurCS";
+    s_boxBlurHorz = std::make_unique<Shader>(
+        "box_blur_horz", L"shaders/postprocessing/box-blur.hlsl", Shader::CS, csEntryPoint);
+    csEntryPoint.cs = "VertBoxBlurCS";
+    s_boxBlurVert = std::make_unique<Shader>(
+        "box_blur_vert", L"shaders/postprocessing/box-blur.hlsl", Shader::CS, csEntryPoint);
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC boxHorzPsoDesc = {};
+    boxHorzPsoDesc.pRootSignature = pCore->rootSigs["gaussian_blur"].Get();
+    bindShaderToCPSO(&boxHorzPsoDesc, s_boxBlurHorz.get());
+    boxHorzPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    checkHR(pCore->device->CreateComputePipelineState(&boxHorzPsoDesc, IID_PPV_ARGS(&pCore->PSOs["box_blur_horz"])));
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC boxVertPsoDesc = {};
+    boxVertPsoDesc.pRootSignature = pCore->rootSigs["gaussian_blur"].Get();
+    bindShaderToCPSO(&boxVertPsoDesc, s_boxBlurVert.get());
+    boxVertPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    checkHR(pCore->device->CreateComputePipelineState(&boxVertPsoDesc, IID_PPV_ARGS(&pCore->PSOs["box_blur_vert"])));
+
+    createTimestampResources();
 }
 
 void GaussianBlur::onResize(UINT w, UINT h) {
@@ -71,97 +104,152 @@ void GaussianBlur::onResize(UINT w, UINT h) {
 }
 
 ID3D12Resource* GaussianBlur::process(ID3D12Resource* flatOrigin) {
-    auto weights = calcGaussianBlurWeight(_blurRadius, _blurGrade);
+    // The last process call with the current frame resource has finished on the GPU, since its fence was waited.
+    readTimestamps();
+    UINT firstQuery = 2 * pCore->currFrameResourceIdx;
+    pCore->cmdRecorder->EndQuery(timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery);
 
     ID3D12DescriptorHeap* descHeaps[] = { texDescHeap.Get() };
-    pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
-
-    pCore->cmdList->SetComputeRootSignature(pCore->rootSigs["gaussian_blur"].Get());
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
-    pCore->cmdList->SetComputeRoot32BitConstants(0, 1, &_blurRadius, 0);
-    pCore->cmdList->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 1);
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["gaussian_blur"].Get());
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_DEST));
 
-    pCore->cmdList->CopyResource(textures["A"].Get(), flatOrigin);
+    pCore->cmdRecorder->CopyResource(textures["A"].Get(), flatOrigin);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COPY_SOURCE,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COPY_DEST,
             D3D12_RESOURCE_STATE_GENERIC_READ));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
+    // Both leave the result in texture A, with the same resource states as before.
+    if (_blurMode == BOX_CASCADE) recordBoxCascadePasses();
+    else recordDirectPasses();
+
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            textures["A"].Get(),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            D3D12_RESOURCE_STATE_COMMON));
+    pCore->cmdRecorder->ResourceBarrier(1,
+        &CD3DX12_RESOURCE_BARRIER::Transition(
+            textures["B"].Get(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+            D3D12_RESOURCE_STATE_COMMON));
+
+    pCore->cmdRecorder->EndQuery(timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery + 1);
+    pCore->cmdRecorder->ResolveQueryData(timestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, 2,
+        timestampReadbackBuff.Get(), firstQuery * sizeof(UINT64));
+    resolvedTimestampMask |= 1u << pCore->currFrameResourceIdx;
+
+    return textures["A"].Get();
+}
+
+void GaussianBlur::recordDirectPasses() {
+    auto weights = calcGaussianBlurWeight(_blurRadius, _blurGrade);
+
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 1, &_blurRadius, 0);
+    pCore->cmdRecorder->SetComputeRoot32BitConstants(0, (UINT)weights.size(), weights.data(), 1);
+
     for (int i = 0; i < _blurCount; ++i) {
         // Horizontal Blur
-        pCore->cmdList->SetPipelineState(pCore->PSOs["gaussian_blur_horz"].Get());
-        pCore->cmdList->SetComputeRootDescriptorTable(1, texA_SrvGPU);
-        pCore->cmdList->SetComputeRootDescriptorTable(2, texB_UavGPU);
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["gaussian_blur_horz"].Get());
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, texA_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(2, texB_UavGPU);
 
         UINT numGroupX = (UINT)ceilf(texWidth / 256.0f); // N = 256 in gaussian-blur.hlsl
-        pCore->cmdList->Dispatch(numGroupX, texHeight, 1);
+        pCore->cmdRecorder->Dispatch(numGroupX, texHeight, 1);
 
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["A"].Get(),
                 D3D12_RESOURCE_STATE_GENERIC_READ,
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["B"].Get(),
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
                 D3D12_RESOURCE_STATE_GENERIC_READ));
 
         // Vertical Blur
-        pCore->cmdList->SetPipelineState(pCore->PSOs["gaussian_blur_vert"].Get());
-        pCore->cmdList->SetComputeRootDescriptorTable(1, texB_SrvGPU);
-        pCore->cmdList->SetComputeRootDescriptorTable(2, texA_UavGPU);
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs["gaussian_blur_vert"].Get());
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, texB_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(2, texA_UavGPU);
 
         UINT numGroupY = (UINT)ceilf(texHeight / 256.0f); // N = 256 in gaussian-blur.hlsl
-        pCore->cmdList->Dispatch(texWidth, numGroupY, 1);
+        pCore->cmdRecorder->Dispatch(texWidth, numGroupY, 1);
 
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["A"].Get(),
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
                 D3D12_RESOURCE_STATE_GENERIC_READ));
-        pCore->cmdList->ResourceBarrier(1,
+        pCore->cmdRecorder->ResourceBarrier(1,
             &CD3DX12_RESOURCE_BARRIER::Transition(
                 textures["B"].Get(),
                 D3D12_RESOURCE_STATE_GENERIC_READ,
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
     }
+}
 
-    pCore->cmdList->ResourceBarrier(1,
-        &CD3DX12_RESOURCE_BARRIER::Transition(
-            textures["A"].Get(),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
-        &CD3DX12_RESOURCE_BARRIER::Transition(
-            textures["B"].Get(),
-            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            D3D12_RESOURCE_STATE_COMMON));
-
-    return textures["A"].Get();
+void GaussianBlur::recordBoxCascadePasses() {
+    // The variances add up, so the blurCount passes of the weights are matched by a single cascade.
+    float sigma = calcFilterWeightSigma(calcGaussianBlurWeight(_blurRadius, _blurGrade)) * sqrtf((float)_blurCount);
+    int radii[3] = {};
+    calcBoxCascadeRadii(sigma, radii);
+
+    // 3 horizontal boxes and then 3 vertical boxes, which ping-pong between texture A and B.
+    // As the pass count is even, the last one writes texture A.
+    for (int i = 0; i < 6; ++i) {
+        bool isHorz = i < 3;
+        bool isFromA = i % 2 == 0;
+        auto src = isFromA ? textures["A"].Get() : textures["B"].Get();
+        auto dst = isFromA ? textures["B"].Get() : textures["A"].Get();
+
+        int boxConfigs[2] = { radii[i % 3], calcBoxSegmentLength(radii[i % 3]) };
+        pCore->cmdRecorder->SetPipelineState(pCore->PSOs[isHorz ? "box_blur_horz" : "box_blur_vert"].Get());
+        pCore->cmdRecorder->SetComputeRoot32BitConstants(0, 2, boxConfigs, 0);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(1, isFromA ? texA_SrvGPU : texB_SrvGPU);
+        pCore->cmdRecorder->SetComputeRootDescriptorTable(2, isFromA ? texB_UavGPU : texA_UavGPU);
+
+        // One thread per segment of a row (or column), and N = 64 rows (or columns) per group in box-blur.hlsl
+        UINT segmentCount = ((isHorz ? texWidth : texHeight) + boxConfigs[1] - 1) / boxConfigs[1];
+        UINT numGroup = (UINT)ceilf((isHorz ? texHeight : texWidth) / 64.0f);
+        if (isHorz) pCore->cmdRecorder->Dispatch(segmentCount, numGroup, 1);
+        else pCore->cmdRecorder->Dispatch(numGroup, segmentCount, 1);
+
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                src,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+        pCore->cmdRecorder->ResourceBarrier(1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                dst,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                D3D12_RESOURCE_STATE_GENERIC_READ));
+    }
 }
 
 void GaussianBlur::createOffscreenTextureResources() {
@@ -237,4 +325,38 @@ void GaussianBlur::createResourceDescriptors() {
 
     pCore->device->CreateUnorderedAccessView(textures["A"].Get(), nullptr, &uavDesc, texA_UavCPU);
     pCore->device->CreateUnorderedAccessView(textures["B"].Get(), nullptr, &uavDesc, texB_UavCPU);
+}
+
+void GaussianBlur::createTimestampResources() {
+    D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+    queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    queryHeapDesc.Count = 2 * NUM_FRAME_RESOURCES;
+    queryHeapDesc.NodeMask = 0;
+    checkHR(pCore->device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&timestampQueryHeap)));
+
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(2 * NUM_FRAME_RESOURCES * sizeof(UINT64)),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&timestampReadbackBuff)));
+
+    // Ticks per second of the timestamps on the queue.
+    checkHR(pCore->cmdQueue->GetTimestampFrequency(&timestampFreq));
+    resolvedTimestampMask = 0;
+}
+
+void GaussianBlur::readTimestamps() {
+    if (!(resolvedTimestampMask & (1u << pCore->currFrameResourceIdx))) return;
+
+    UINT firstQuery = 2 * pCore->currFrameResourceIdx;
+    D3D12_RANGE readRange = { firstQuery * sizeof(UINT64), (firstQuery + 2) * sizeof(UINT64) };
+    UINT64* timestamps = nullptr;
+    checkHR(timestampReadbackBuff->Map(0, &readRange, reinterpret_cast<void**>(&timestamps)));
+    UINT64 beginTicks = timestamps[firstQuery], endTicks = timestamps[firstQuery + 1];
+    D3D12_RANGE writtenRange = { 0, 0 };
+    timestampReadbackBuff->Unmap(0, &writtenRange);
+
+    if (timestampFreq > 0 && endTicks >= beginTicks) _gpuMsecs = (endTicks - beginTicks) * 1000.0 / timestampFreq;
 }
\ No newline at end of file
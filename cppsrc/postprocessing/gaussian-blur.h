@@ -12,8 +12,20 @@
 #include "basic-process.h"
 #include "graphics/shader.h"
 
+// The blur radius must not be greater than 5 (See gaussian-blur.hlsl). gaussianBlurImage in image-filter.h is
+// the CPU version without the limit, which is also the golden reference of the shaders.
+//
+// In BOX_CASCADE mode, the blur is instead approximated by 3 box filters in each direction (See box-blur.hlsl),
+// whose variance matches the blurCount passes of the weights, so any blur count costs the same 6 dispatches.
+// The intermediate boxes are written to the off-screen textures, thus rounded like them, whereas
+// boxCascadeBlurImage in image-filter.h keeps the 3 boxes of a direction in float.
+//
+// Both modes are timed on the GPU with a pair of timestamps per frame resource, see gpuMsecs.
 class GaussianBlur : public BasicProcess {
 public:
+    constexpr static int DIRECT = 0;
+    constexpr static int BOX_CASCADE = 1;
+
     GaussianBlur(D3DCore* pCore, int blurRadius, float blurGrade, int blurCount);
 
     void init() override;
@@ -31,6 +43,13 @@ public:
     inline int blurCount() { return _blurCount; }
     inline void setBlurCount(int c) { _blurCount = c; }
 
+    inline int blurMode() { return _blurMode; }
+    inline void setBlurMode(int m) { _blurMode = m; }
+
+    // GPU time of the copy and the passes recorded by process, in milliseconds. The timestamps are read back
+    // when the same frame resource comes around again, i.e. the value lags NUM_FRAME_RESOURCES frames behind.
+    inline double gpuMsecs() { return _gpuMsecs; }
+
 protected:
     void createOffscreenTextureResources() override;
 
@@ -44,16 +63,36 @@ private:
 
     void createResourceDescriptors();
 
+    void createTimestampResources();
+
+    // Read back the timestamps of the last process call with the current frame resource.
+    void readTimestamps();
+
+    void recordDirectPasses();
+
+    void recordBoxCascadePasses();
+
 private:
     int _blurRadius = 0;
     float _blurGrade = 0.0f;
     int _blurCount = 0;
+    int _blurMode = DIRECT;
+    double _gpuMsecs = 0.0;
 
     std::unique_ptr<Shader> s_gaussianBlurHorz = nullptr;
     std::unique_ptr<Shader> s_gaussianBlurVert = nullptr;
+    std::unique_ptr<Shader> s_boxBlurHorz = nullptr;
+    std::unique_ptr<Shader> s_boxBlurVert = nullptr;
 
     ComPtr<ID3D12DescriptorHeap> texDescHeap = nullptr;
 
+    // 2 timestamps (before and after the passes) per frame resource, resolved into the readback buffer.
+    ComPtr<ID3D12QueryHeap> timestampQueryHeap = nullptr;
+    ComPtr<ID3D12Resource> timestampReadbackBuff = nullptr;
+    UINT64 timestampFreq = 0;
+    // Bit i is set once the timestamps of frame resource i are resolved.
+    UINT resolvedTimestampMask = 0;
+
     D3D12_CPU_DESCRIPTOR_HANDLE
         texA_SrvCPU = {}, texA_UavCPU = {},
         texB_SrvCPU = {}, texB_UavCPU = {};
@@ -0,0 +1,649 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "image-filter.h"
+#include "utils/math-utils.h"
+#include "utils/thread-utils.h"
+
+namespace {
+
+// Columns of a strip of the vertical pass. A row of the strip takes 1 KB in float RGBA.
+constexpr UINT STRIP_WIDTH = 64;
+
+// Columns of a strip of the vertical box passes, which keep the whole strip in 2 buffers (1 MB for 4K).
+constexpr UINT BOX_STRIP_WIDTH = 16;
+
+// Pixels of an iteration of the Sobel operator, i.e. 4 XMVECTORs of 4 pixels each.
+constexpr UINT SOBEL_BLOCK_WIDTH = 16;
+
+// Rows of a band of the Sobel operator, whose 2 rows beyond the band are converted again by the adjacent bands.
+constexpr UINT SOBEL_BAND_HEIGHT = 32;
+
+// The UNORM values are read as q / 255 exactly like the texture loads, which is not the same as q * (1 / 255).
+struct UnormTable {
+    float values[256];
+    UnormTable() { for (int q = 0; q < 256; ++q) values[q] = (float)q / 255.0f; }
+};
+const UnormTable g_unormTable;
+
+inline BYTE quantizeUnorm(float value) {
+    return (BYTE)std::nearbyint((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f);
+}
+
+// Convert count pixels from (x, y) into dst.
+void loadPixels(const CpuImage& image, UINT x, UINT y, UINT count, XMVECTOR* dst) {
+    size_t offset = (size_t)x + (size_t)y * image.width;
+    if (image.format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+        auto src = (const XMFLOAT4*)image.data.data() + offset;
+        for (UINT i = 0; i < count; ++i) dst[i] = XMLoadFloat4(&src[i]);
+    }
+    else {
+        const BYTE* src = image.data.data() + offset * 4;
+        const float* unorm = g_unormTable.values;
+        for (UINT i = 0; i < count; ++i, src += 4) dst[i] = XMVectorSet(unorm[src[0]], unorm[src[1]], unorm[src[2]], unorm[src[3]]);
+    }
+}
+
+void storePixels(const XMVECTOR* src, UINT x, UINT y, UINT count, CpuImage* image) {
+    size_t offset = (size_t)x + (size_t)y * image->width;
+    if (image->format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+        auto dst = (XMFLOAT4*)image->data.data() + offset;
+        for (UINT i = 0; i < count; ++i) XMStoreFloat4(&dst[i], src[i]);
+    }
+    else {
+        BYTE* dst = image->data.data() + offset * 4;
+        XMVECTOR scale = XMVectorReplicate(255.0f);
+        for (UINT i = 0; i < count; ++i, dst += 4) {
+            XMFLOAT4 q;
+            XMStoreFloat4(&q, XMVectorRound(XMVectorMultiply(XMVectorClamp(src[i], XMVectorZero(), XMVectorSplatOne()), scale)));
+            dst[0] = (BYTE)q.x; dst[1] = (BYTE)q.y; dst[2] = (BYTE)q.z; dst[3] = (BYTE)q.w;
+        }
+    }
+}
+
+// dst[x] = sum of weights[i] * src[x + i], 2 pixels at a time to keep 2 independent sums in flight.
+void convolvePixels(const XMVECTOR* src, const XMVECTOR* weights, int tapCount, UINT count, XMVECTOR* dst) {
+    UINT x = 0;
+    for (; x + 2 <= count; x += 2) {
+        XMVECTOR sum0 = XMVectorZero(), sum1 = XMVectorZero();
+        for (int i = 0; i < tapCount; ++i) {
+            sum0 = XMVectorAdd(sum0, XMVectorMultiply(weights[i], src[x + i]));
+            sum1 = XMVectorAdd(sum1, XMVectorMultiply(weights[i], src[x + 1 + i]));
+        }
+        dst[x] = sum0;
+        dst[x + 1] = sum1;
+    }
+    for (; x < count; ++x) {
+        XMVECTOR sum = XMVectorZero();
+        for (int i = 0; i < tapCount; ++i) sum = XMVectorAdd(sum, XMVectorMultiply(weights[i], src[x + i]));
+        dst[x] = sum;
+    }
+}
+
+void filterRows(const std::vector<XMVECTOR>& weights, const CpuImage& src, CpuImage* dst) {
+    int radius = (int)weights.size() / 2;
+    UINT w = src.width;
+    parallelFor(0, src.height, 8, [&](size_t begin, size_t end) {
+        // The row with radius clamped pixels on both sides.
+        std::vector<XMVECTOR> padded(w + 2 * radius), filtered(w);
+        for (UINT y = (UINT)begin; y < (UINT)end; ++y) {
+            loadPixels(src, 0, y, w, padded.data() + radius);
+            std::fill(padded.begin(), padded.begin() + radius, padded[radius]);
+            std::fill(padded.begin() + radius + w, padded.end(), padded[radius + w - 1]);
+            convolvePixels(padded.data(), weights.data(), (int)weights.size(), w, filtered.data());
+            storePixels(filtered.data(), 0, y, w, dst);
+        }
+    });
+}
+
+void filterColumns(const std::vector<XMVECTOR>& weights, const CpuImage& src, CpuImage* dst) {
+    int tapCount = (int)weights.size();
+    int radius = tapCount / 2;
+    int h = (int)src.height;
+    UINT stripCount = (src.width + STRIP_WIDTH - 1) / STRIP_WIDTH;
+    parallelFor(0, stripCount, 1, [&](size_t begin, size_t end) {
+        // Padded row k is source row clamp(k - radius), and it is kept in ring slot k % tapCount.
+        std::vector<XMVECTOR> ring((size_t)tapCount * STRIP_WIDTH), filtered(STRIP_WIDTH);
+        std::vector<const XMVECTOR*> taps(tapCount);
+        for (UINT strip = (UINT)begin; strip < (UINT)end; ++strip) {
+            UINT x0 = strip * STRIP_WIDTH;
+            UINT stripWidth = (std::min)(STRIP_WIDTH, src.width - x0);
+            auto loadPaddedRow = [&](int k) {
+                int y = (std::min)((std::max)(k - radius, 0), h - 1);
+                loadPixels(src, x0, (UINT)y, stripWidth, ring.data() + (size_t)(k % tapCount) * STRIP_WIDTH);
+            };
+            for (int k = 0; k < tapCount - 1; ++k) loadPaddedRow(k);
+
+            for (int y = 0; y < h; ++y) {
+                loadPaddedRow(y + tapCount - 1);
+                for (int i = 0; i < tapCount; ++i) taps[i] = ring.data() + (size_t)((y + i) % tapCount) * STRIP_WIDTH;
+                for (UINT x = 0; x < stripWidth; ++x) {
+                    XMVECTOR sum = XMVectorZero();
+                    for (int i = 0; i < tapCount; ++i) sum = XMVectorAdd(sum, XMVectorMultiply(weights[i], taps[i][x]));
+                    filtered[x] = sum;
+                }
+                storePixels(filtered.data(), x0, (UINT)y, stripWidth, dst);
+            }
+        }
+    });
+}
+
+// Box filter of 2 * radius + 1 pixels along the row, with the edge pixels clamped.
+void boxFilterRow(const XMVECTOR* src, int length, int radius, XMVECTOR* dst) {
+    XMVECTOR invWidth = XMVectorReplicate(1.0f / (2 * radius + 1));
+    int last = length - 1;
+    XMVECTOR sum = XMVectorScale(src[0], (float)(radius + 1));
+    for (int k = 1; k <= radius; ++k) sum = XMVectorAdd(sum, src[(std::min)(k, last)]);
+    for (int x = 0; x < length; ++x) {
+        dst[x] = XMVectorMultiply(sum, invWidth);
+        sum = XMVectorAdd(sum, XMVectorSubtract(src[(std::min)(x + radius + 1, last)], src[(std::max)(x - radius, 0)]));
+    }
+}
+
+// Same as boxFilterRow for every column of the strip, whose rows are BOX_STRIP_WIDTH pixels apart. The strip is
+// walked one row at a time for all of its columns, so that the loads are contiguous.
+void boxFilterStrip(const XMVECTOR* src, int height, UINT stripWidth, int radius, XMVECTOR* dst) {
+    XMVECTOR invWidth = XMVectorReplicate(1.0f / (2 * radius + 1));
+    int last = height - 1;
+    XMVECTOR sums[BOX_STRIP_WIDTH];
+    for (UINT x = 0; x < stripWidth; ++x) sums[x] = XMVectorScale(src[x], (float)(radius + 1));
+    for (int k = 1; k <= radius; ++k) {
+        const XMVECTOR* row = src + (size_t)(std::min)(k, last) * BOX_STRIP_WIDTH;
+        for (UINT x = 0; x < stripWidth; ++x) sums[x] = XMVectorAdd(sums[x], row[x]);
+    }
+    for (int y = 0; y < height; ++y) {
+        const XMVECTOR* entering = src + (size_t)(std::min)(y + radius + 1, last) * BOX_STRIP_WIDTH;
+        const XMVECTOR* leaving = src + (size_t)(std::max)(y - radius, 0) * BOX_STRIP_WIDTH;
+        XMVECTOR* out = dst + (size_t)y * BOX_STRIP_WIDTH;
+        for (UINT x = 0; x < stripWidth; ++x) {
+            out[x] = XMVectorMultiply(sums[x], invWidth);
+            sums[x] = XMVectorAdd(sums[x], XMVectorSubtract(entering[x], leaving[x]));
+        }
+    }
+}
+
+inline float calcGray(FXMVECTOR rgba) {
+    XMFLOAT4 c;
+    XMStoreFloat4(&c, rgba);
+    return c.x * 0.299f + c.y * 0.587f + c.z * 0.114f;
+}
+
+// Load the image into pixels and their luminance into grays, and return the range of the luminance.
+void loadGrayPixels(const CpuImage& image, XMVECTOR* pixels, float* grays, float* minGray, float* maxGray) {
+    UINT w = image.width, h = image.height;
+    std::vector<float> rowMins(h), rowMaxs(h);
+    parallelFor(0, h, 8, [&](size_t begin, size_t end) {
+        for (UINT y = (UINT)begin; y < (UINT)end; ++y) {
+            size_t offset = (size_t)y * w;
+            loadPixels(image, 0, y, w, pixels + offset);
+            rowMins[y] = rowMaxs[y] = calcGray(pixels[offset]);
+            for (UINT x = 0; x < w; ++x) {
+                grays[offset + x] = calcGray(pixels[offset + x]);
+                rowMins[y] = (std::min)(rowMins[y], grays[offset + x]);
+                rowMaxs[y] = (std::max)(rowMaxs[y], grays[offset + x]);
+            }
+        }
+    });
+    *minGray = *std::min_element(rowMins.begin(), rowMins.end());
+    *maxGray = *std::max_element(rowMaxs.begin(), rowMaxs.end());
+}
+
+// The cell of grid row gy is at ((gy * layout.width + gx) * layout.depth + gz), so the gray axis is contiguous.
+inline size_t getGridCellIndex(const BilateralGridLayout& layout, UINT gx, UINT gy, UINT gz) {
+    return ((size_t)gy * layout.width + gx) * layout.depth + gz;
+}
+
+// dst = src / 2 + (the 2 neighbors along the axis) / 4, where the cells beyond the grid are 0.
+// The axis is 0 for x, 1 for y and 2 for gray.
+void blurBilateralGrid(const BilateralGridLayout& layout, int axis, const XMVECTOR* src, XMVECTOR* dst) {
+    size_t strides[3] = { layout.depth, (size_t)layout.width * layout.depth, 1 };
+    UINT extents[3] = { layout.width, layout.height, layout.depth };
+    size_t stride = strides[axis];
+    XMVECTOR half = XMVectorReplicate(0.5f), quarter = XMVectorReplicate(0.25f);
+    parallelFor(0, layout.height, 4, [&](size_t begin, size_t end) {
+        for (UINT gy = (UINT)begin; gy < (UINT)end; ++gy) {
+            for (UINT gx = 0; gx < layout.width; ++gx) {
+                for (UINT gz = 0; gz < layout.depth; ++gz) {
+                    UINT coords[3] = { gx, gy, gz };
+                    size_t i = getGridCellIndex(layout, gx, gy, gz);
+                    XMVECTOR sum = XMVectorMultiply(src[i], half);
+                    if (coords[axis] > 0) sum = XMVectorAdd(sum, XMVectorMultiply(src[i - stride], quarter));
+                    if (coords[axis] + 1 < extents[axis]) sum = XMVectorAdd(sum, XMVectorMultiply(src[i + stride], quarter));
+                    dst[i] = sum;
+                }
+            }
+        }
+    });
+}
+
+// Convert row y of the image into planar R, G, B rows, where pixel x is at index x + 1 and the rest are 0.
+// A row out of the image is all 0.
+void loadPlanarRow(const CpuImage& image, int y, float* planes[3]) {
+    size_t rowLength = image.width + 2;
+    for (int c = 0; c < 3; ++c) std::fill(planes[c], planes[c] + rowLength, 0.0f);
+    if (y < 0 || y >= (int)image.height) return;
+    size_t offset = (size_t)y * image.width;
+    if (image.format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+        auto src = (const float*)image.data.data() + offset * 4;
+        for (UINT x = 0; x < image.width; ++x, src += 4) {
+            for (int c = 0; c < 3; ++c) planes[c][x + 1] = src[c];
+        }
+    }
+    else {
+        const BYTE* src = image.data.data() + offset * 4;
+        const float* unorm = g_unormTable.values;
+        for (UINT x = 0; x < image.width; ++x, src += 4) {
+            for (int c = 0; c < 3; ++c) planes[c][x + 1] = unorm[src[c]];
+        }
+    }
+}
+
+// The Sobel gradients of sobel-operator.hlsl, where up, mid and down are the rows y - 1, y and y + 1 offset to x - 1.
+// Keep the same order of the terms as the shader.
+inline void calcSobelGradients(const float* up, const float* mid, const float* down, XMVECTOR* dx, XMVECTOR* dy) {
+    XMVECTOR two = XMVectorReplicate(2.0f);
+    XMVECTOR up0 = XMLoadFloat4((const XMFLOAT4*)up), up2 = XMLoadFloat4((const XMFLOAT4*)(up + 2));
+    XMVECTOR down0 = XMLoadFloat4((const XMFLOAT4*)down), down2 = XMLoadFloat4((const XMFLOAT4*)(down + 2));
+    XMVECTOR mid0 = XMLoadFloat4((const XMFLOAT4*)mid), mid2 = XMLoadFloat4((const XMFLOAT4*)(mid + 2));
+
+    XMVECTOR x = XMVectorNegate(up0);
+    x = XMVectorSubtract(x, XMVectorMultiply(two, XMLoadFloat4((const XMFLOAT4*)(up + 1))));
+    x = XMVectorSubtract(x, up2);
+    x = XMVectorAdd(x, down0);
+    x = XMVectorAdd(x, XMVectorMultiply(two, XMLoadFloat4((const XMFLOAT4*)(down + 1))));
+    *dx = XMVectorAdd(x, down2);
+
+    XMVECTOR y = XMVectorNegate(up2);
+    y = XMVectorSubtract(y, XMVectorMultiply(two, mid2));
+    y = XMVectorSubtract(y, down2);
+    y = XMVectorAdd(y, up0);
+    y = XMVectorAdd(y, XMVectorMultiply(two, mid0));
+    *dy = XMVectorAdd(y, down0);
+}
+
+void storeSobelLuminance(FXMVECTOR luminance, UINT x, UINT y, UINT count, CpuImage* image) {
+    XMFLOAT4 values;
+    size_t offset = (size_t)x + (size_t)y * image->width;
+    if (image->format == DXGI_FORMAT_R32G32B32A32_FLOAT) {
+        XMStoreFloat4(&values, luminance);
+        auto dst = (float*)image->data.data() + offset * 4;
+        for (UINT i = 0; i < count; ++i) std::fill(dst + i * 4, dst + i * 4 + 4, (&values.x)[i]);
+    }
+    else {
+        // The luminance is already in [0, 1].
+        XMStoreFloat4(&values, XMVectorRound(XMVectorScale(luminance, 255.0f)));
+        BYTE* dst = image->data.data() + offset * 4;
+        for (UINT i = 0; i < count; ++i) std::fill(dst + i * 4, dst + i * 4 + 4, (BYTE)(&values.x)[i]);
+    }
+}
+
+void loadPixelReference(const CpuImage& image, int x, int y, float* rgba) {
+    x = (std::min)((std::max)(x, 0), (int)image.width - 1);
+    y = (std::min)((std::max)(y, 0), (int)image.height - 1);
+    size_t offset = (size_t)x + (size_t)y * image.width;
+    for (int c = 0; c < 4; ++c) {
+        if (image.format == DXGI_FORMAT_R32G32B32A32_FLOAT) rgba[c] = ((const float*)image.data.data())[offset * 4 + c];
+        else rgba[c] = (float)image.data[offset * 4 + c] / 255.0f;
+    }
+}
+
+void storePixelReference(const float* rgba, int x, int y, CpuImage* image) {
+    size_t offset = (size_t)x + (size_t)y * image->width;
+    for (int c = 0; c < 4; ++c) {
+        if (image->format == DXGI_FORMAT_R32G32B32A32_FLOAT) ((float*)image->data.data())[offset * 4 + c] = rgba[c];
+        else image->data[offset * 4 + c] = quantizeUnorm(rgba[c]);
+    }
+}
+
+} // namespace
+
+UINT getImagePixelSize(DXGI_FORMAT format) {
+    return format == DXGI_FORMAT_R32G32B32A32_FLOAT ? 16 : 4;
+}
+
+void initCpuImage(DXGI_FORMAT format, UINT width, UINT height, CpuImage* image) {
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    image->data.assign((size_t)width * height * getImagePixelSize(format), 0);
+}
+
+bool gaussianBlurImage(int blurRadius, float blurGrade, int blurCount, CpuImage* image) {
+    if (!isValidBlurRadius(blurRadius)) return false;
+    separableFilterImage(calcGaussianBlurWeight((uint8_t)blurRadius, blurGrade), blurCount, image);
+    return true;
+}
+
+void separableFilterImage(const std::vector<float>& weights, int passCount, CpuImage* image) {
+    if (image->width == 0 || image->height == 0 || weights.size() % 2 == 0) return;
+    std::vector<XMVECTOR> splatWeights(weights.size());
+    for (size_t i = 0; i < weights.size(); ++i) splatWeights[i] = XMVectorReplicate(weights[i]);
+
+    CpuImage temp = {};
+    initCpuImage(image->format, image->width, image->height, &temp);
+    for (int pass = 0; pass < passCount; ++pass) {
+        filterRows(splatWeights, *image, &temp);
+        filterColumns(splatWeights, temp, image);
+    }
+}
+
+void separableFilterImageReference(const std::vector<float>& weights, int passCount, CpuImage* image) {
+    if (image->width == 0 || image->height == 0 || weights.size() % 2 == 0) return;
+    int radius = (int)weights.size() / 2;
+    CpuImage temp = {};
+    initCpuImage(image->format, image->width, image->height, &temp);
+    for (int pass = 0; pass < passCount; ++pass) {
+        for (int axis = 0; axis < 2; ++axis) {
+            const CpuImage& src = axis == 0 ? *image : temp;
+            CpuImage* dst = axis == 0 ? &temp : image;
+            for (int y = 0; y < (int)src.height; ++y) {
+                for (int x = 0; x < (int)src.width; ++x) {
+                    float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                    for (int i = -radius; i <= radius; ++i) {
+                        float rgba[4];
+                        loadPixelReference(src, axis == 0 ? x + i : x, axis == 0 ? y : y + i, rgba);
+                        for (int c = 0; c < 4; ++c) sum[c] += weights[i + radius] * rgba[c];
+                    }
+                    storePixelReference(sum, x, y, dst);
+                }
+            }
+        }
+    }
+}
+
+float calcFilterWeightSigma(const std::vector<float>& weights) {
+    int radius = (int)weights.size() / 2;
+    double variance = 0.0;
+    for (int i = -radius; i <= radius; ++i) variance += (double)weights[i + radius] * i * i;
+    return (float)std::sqrt(variance);
+}
+
+void calcBoxCascadeRadii(float sigma, int radii[3]) {
+    // A box of w pixels has the variance (w^2 - 1) / 12. The cascade takes m boxes of width wl and 3 - m of wl + 2,
+    // where wl is the greatest odd width not wider than the ideal one, and m makes the total variance closest.
+    float variance = sigma * sigma;
+    int wl = (int)std::floor(std::sqrt(4.0f * variance + 1.0f));
+    if (wl % 2 == 0) --wl;
+    wl = (std::max)(wl, 1);
+    float m = (12.0f * variance - 3.0f * wl * wl - 12.0f * wl - 9.0f) / (-4.0f * wl - 4.0f);
+    int smallCount = (std::min)((std::max)((int)std::lround(m), 0), 3);
+    for (int i = 0; i < 3; ++i) radii[i] = (i < smallCount ? wl - 1 : wl + 1) / 2;
+}
+
+void boxCascadeBlurImage(float sigma, CpuImage* image) {
+    if (image->width == 0 || image->height == 0) return;
+    int radii[3];
+    calcBoxCascadeRadii(sigma, radii);
+    UINT w = image->width, h = image->height;
+
+    parallelFor(0, h, 8, [&](size_t begin, size_t end) {
+        std::vector<XMVECTOR> rowA(w), rowB(w);
+        for (UINT y = (UINT)begin; y < (UINT)end; ++y) {
+            loadPixels(*image, 0, y, w, rowA.data());
+            boxFilterRow(rowA.data(), (int)w, radii[0], rowB.data());
+            boxFilterRow(rowB.data(), (int)w, radii[1], rowA.data());
+            boxFilterRow(rowA.data(), (int)w, radii[2], rowB.data());
+            storePixels(rowB.data(), 0, y, w, image);
+        }
+    });
+
+    UINT stripCount = (w + BOX_STRIP_WIDTH - 1) / BOX_STRIP_WIDTH;
+    parallelFor(0, stripCount, 1, [&](size_t begin, size_t end) {
+        std::vector<XMVECTOR> stripA((size_t)h * BOX_STRIP_WIDTH), stripB((size_t)h * BOX_STRIP_WIDTH);
+        for (UINT strip = (UINT)begin; strip < (UINT)end; ++strip) {
+            UINT x0 = strip * BOX_STRIP_WIDTH;
+            UINT stripWidth = (std::min)(BOX_STRIP_WIDTH, w - x0);
+            for (UINT y = 0; y < h; ++y) loadPixels(*image, x0, y, stripWidth, stripA.data() + (size_t)y * BOX_STRIP_WIDTH);
+            boxFilterStrip(stripA.data(), (int)h, stripWidth, radii[0], stripB.data());
+            boxFilterStrip(stripB.data(), (int)h, stripWidth, radii[1], stripA.data());
+            boxFilterStrip(stripA.data(), (int)h, stripWidth, radii[2], stripB.data());
+            for (UINT y = 0; y < h; ++y) storePixels(stripB.data() + (size_t)y * BOX_STRIP_WIDTH, x0, y, stripWidth, image);
+        }
+    });
+}
+
+double calcImagePsnr(const CpuImage& a, const CpuImage& b, float peak) {
+    size_t valueCount = (size_t)a.width * a.height * 4;
+    double squaredErrorSum = 0.0;
+    for (size_t i = 0; i < valueCount; ++i) {
+        double diff;
+        if (a.format == DXGI_FORMAT_R32G32B32A32_FLOAT) diff = (double)((const float*)a.data.data())[i] - ((const float*)b.data.data())[i];
+        else diff = ((double)a.data[i] - b.data[i]) / 255.0;
+        squaredErrorSum += diff * diff;
+    }
+    if (squaredErrorSum == 0.0) return INFINITY;
+    return 10.0 * std::log10((double)peak * peak * valueCount / squaredErrorSum);
+}
+
+bool bilateralBlurImage(int blurRadius, float distanceGrade, float grayGrade, int blurCount, CpuImage* image) {
+    if (!isValidBlurRadius(blurRadius)) return false;
+    if (image->width == 0 || image->height == 0) return true;
+    auto weights = calcGaussianBlurWeight((uint8_t)blurRadius, distanceGrade);
+    float twoSigma2 = 2.0f * grayGrade * grayGrade;
+    int w = (int)image->width, h = (int)image->height;
+    std::vector<XMVECTOR> pixels((size_t)w * h);
+    std::vector<float> grays((size_t)w * h);
+
+    for (int pass = 0; pass < blurCount; ++pass) {
+        float minGray, maxGray;
+        loadGrayPixels(*image, pixels.data(), grays.data(), &minGray, &maxGray);
+        parallelFor(0, h, 4, [&](size_t begin, size_t end) {
+            std::vector<XMVECTOR> row(w);
+            for (int y = (int)begin; y < (int)end; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    float sourceGray = grays[(size_t)x + (size_t)y * w];
+                    XMVECTOR blurColor = XMVectorZero();
+                    float weightSum = 0.0f;
+                    // Same order as the shader, whose outer loop is along x.
+                    for (int i = -blurRadius; i <= blurRadius; ++i) {
+                        int tx = (std::min)((std::max)(x + i, 0), w - 1);
+                        for (int j = -blurRadius; j <= blurRadius; ++j) {
+                            int ty = (std::min)((std::max)(y + j, 0), h - 1);
+                            size_t offset = (size_t)tx + (size_t)ty * w;
+                            float diff = sourceGray - grays[offset];
+                            float mixedWeight = weights[i + blurRadius] * weights[j + blurRadius] *
+                                std::exp(-diff * diff / twoSigma2);
+                            blurColor = XMVectorAdd(blurColor, XMVectorScale(pixels[offset], mixedWeight));
+                            weightSum += mixedWeight;
+                        }
+                    }
+                    row[x] = XMVectorScale(blurColor, 1.0f / weightSum);
+                }
+                storePixels(row.data(), 0, (UINT)y, (UINT)w, image);
+            }
+        });
+    }
+    return true;
+}
+
+bool calcBilateralGridLayout(int blurRadius, float distanceGrade, float grayGrade, UINT imageWidth, UINT imageHeight,
+    float minGray, float maxGray, BilateralGridLayout* layout)
+{
+    if (!isValidBlurRadius(blurRadius)) return false;
+    // The nearest cell splat, the [1 2 1] / 4 blur and the trilinear slice have the variances 1 / 12, 1 / 2 and 1 / 6
+    // (in cells^2) respectively, so a cell of sigma / sqrt(3 / 4) gives the variance sigma^2 in total.
+    const float cellsPerSigma = std::sqrt(0.75f);
+    float distanceSigma = calcFilterWeightSigma(calcGaussianBlurWeight((uint8_t)blurRadius, distanceGrade));
+    layout->cellSize = (std::max)(distanceSigma / cellsPerSigma, 1.0f);
+    layout->grayOrigin = minGray;
+    float grayExtent = maxGray - minGray;
+    layout->grayCellSize = (std::max)(grayGrade / cellsPerSigma, grayExtent / (MAX_BILATERAL_GRID_DEPTH - 3));
+
+    // The nearest cells are in [1, round(max / cellSize) + 1], and the slices read up to floor(max / cellSize) + 2.
+    auto calcExtent = [](float maxCoord, float cellSize) { return (UINT)std::lround(maxCoord / cellSize) + 3; };
+    layout->width = calcExtent((float)(imageWidth - 1), layout->cellSize);
+    layout->height = calcExtent((float)(imageHeight - 1), layout->cellSize);
+    layout->depth = (std::min)(calcExtent(grayExtent, layout->grayCellSize), MAX_BILATERAL_GRID_DEPTH);
+    return true;
+}
+
+bool bilateralGridBlurImage(int blurRadius, float distanceGrade, float grayGrade, int blurCount, CpuImage* image) {
+    if (!isValidBlurRadius(blurRadius)) return false;
+    if (image->width == 0 || image->height == 0) return true;
+    UINT w = image->width, h = image->height;
+    std::vector<XMVECTOR> pixels((size_t)w * h);
+    std::vector<float> grays((size_t)w * h);
+    std::vector<XMVECTOR> gridA, gridB;
+
+    for (int pass = 0; pass < blurCount; ++pass) {
+        float minGray, maxGray;
+        loadGrayPixels(*image, pixels.data(), grays.data(), &minGray, &maxGray);
+        BilateralGridLayout layout = {};
+        calcBilateralGridLayout(blurRadius, distanceGrade, grayGrade, w, h,
+            (std::min)(minGray, 0.0f), (std::max)(maxGray, 1.0f), &layout);
+        float invCellSize = 1.0f / layout.cellSize, invGrayCellSize = 1.0f / layout.grayCellSize;
+        size_t cellCount = (size_t)layout.width * layout.height * layout.depth;
+        gridA.assign(cellCount, XMVectorZero());
+        gridB.resize(cellCount);
+
+        // Splat (r, g, b, 1) of each pixel to its nearest cell. A grid row only takes the pixels of the image rows
+        // nearest to it, so the grid rows can be splatted in parallel without any race.
+        parallelFor(0, layout.height, 1, [&](size_t begin, size_t end) {
+            for (UINT gy = (UINT)begin; gy < (UINT)end; ++gy) {
+                int y = (std::max)((int)std::floor(((float)gy - 1.5f) * layout.cellSize) - 1, 0);
+                for (; y < (int)h; ++y) {
+                    UINT cy = (UINT)(y * invCellSize + 1.5f);
+                    if (cy < gy) continue;
+                    if (cy > gy) break;
+                    size_t offset = (size_t)y * w;
+                    for (UINT x = 0; x < w; ++x) {
+                        UINT cx = (UINT)(x * invCellSize + 1.5f);
+                        UINT cz = (UINT)((grays[offset + x] - layout.grayOrigin) * invGrayCellSize + 1.5f);
+                        XMVECTOR& cell = gridA[getGridCellIndex(layout, cx, gy, cz)];
+                        cell = XMVectorAdd(cell, XMVectorSetW(pixels[offset + x], 1.0f));
+                    }
+                }
+            }
+        });
+
+        blurBilateralGrid(layout, 2, gridA.data(), gridB.data());
+        blurBilateralGrid(layout, 0, gridB.data(), gridA.data());
+        blurBilateralGrid(layout, 1, gridA.data(), gridB.data());
+
+        // Slice the grid at (x, y, gray) of each pixel, and divide the colors by the weight in w.
+        const XMVECTOR* grid = gridB.data();
+        size_t strideX = layout.depth, strideY = (size_t)layout.width * layout.depth;
+        parallelFor(0, h, 8, [&](size_t begin, size_t end) {
+            std::vector<XMVECTOR> row(w);
+            for (UINT y = (UINT)begin; y < (UINT)end; ++y) {
+                float fy = y * invCellSize + 1.0f;
+                UINT gy = (UINT)fy;
+                XMVECTOR ty = XMVectorReplicate(fy - gy);
+                size_t offset = (size_t)y * w;
+                for (UINT x = 0; x < w; ++x) {
+                    float fx = x * invCellSize + 1.0f;
+                    float fz = (grays[offset + x] - layout.grayOrigin) * invGrayCellSize + 1.0f;
+                    UINT gx = (UINT)fx, gz = (UINT)fz;
+                    XMVECTOR tx = XMVectorReplicate(fx - gx), tz = XMVectorReplicate(fz - gz);
+                    const XMVECTOR* c = grid + getGridCellIndex(layout, gx, gy, gz);
+                    auto lerpZ = [&](const XMVECTOR* cell) { return XMVectorLerpV(cell[0], cell[1], tz); };
+                    XMVECTOR c0 = XMVectorLerpV(lerpZ(c), lerpZ(c + strideX), tx);
+                    XMVECTOR c1 = XMVectorLerpV(lerpZ(c + strideY), lerpZ(c + strideY + strideX), tx);
+                    XMVECTOR sum = XMVectorLerpV(c0, c1, ty);
+                    XMVECTOR color = XMVectorDivide(sum, XMVectorSplatW(sum));
+                    row[x] = XMVectorSelect(pixels[offset + x], color, g_XMSelect1110);
+                }
+                storePixels(row.data(), 0, y, w, image);
+            }
+        });
+    }
+    return true;
+}
+
+void sobelOperatorImage(const CpuImage& src, int colorMode, CpuImage* dst) {
+    initCpuImage(src.format, src.width, src.height, dst);
+    if (src.width == 0 || src.height == 0) return;
+    int h = (int)src.height;
+    UINT w = src.width;
+    // The rows are padded to whole blocks, and the block of the last pixels reads up to the padding.
+    size_t rowLength = (w + SOBEL_BLOCK_WIDTH - 1) / SOBEL_BLOCK_WIDTH * SOBEL_BLOCK_WIDTH + 2;
+    UINT bandCount = (src.height + SOBEL_BAND_HEIGHT - 1) / SOBEL_BAND_HEIGHT;
+
+    parallelFor(0, bandCount, 1, [&](size_t begin, size_t end) {
+        // Row k is kept in ring slot (k + 1) % 3, as 3 planes each.
+        std::vector<float> ring(rowLength * 9, 0.0f);
+        auto getPlane = [&](int k, int c) { return ring.data() + (size_t)(((k + 1) % 3) * 3 + c) * rowLength; };
+        auto loadRow = [&](int k) {
+            float* planes[3] = { getPlane(k, 0), getPlane(k, 1), getPlane(k, 2) };
+            loadPlanarRow(src, k, planes);
+        };
+        XMVECTOR lumaWeights[3] = {
+            XMVectorReplicate(0.299f), XMVectorReplicate(0.587f), XMVectorReplicate(0.114f) };
+
+        for (UINT band = (UINT)begin; band < (UINT)end; ++band) {
+            int y0 = (int)(band * SOBEL_BAND_HEIGHT);
+            int y1 = (std::min)(y0 + (int)SOBEL_BAND_HEIGHT, h);
+            loadRow(y0 - 1);
+            loadRow(y0);
+            for (int y = y0; y < y1; ++y) {
+                loadRow(y + 1);
+                for (UINT x = 0; x < w; x += SOBEL_BLOCK_WIDTH) {
+                    XMVECTOR luminances[4];
+                    for (int k = 0; k < 4; ++k) luminances[k] = XMVectorZero();
+                    for (int c = 0; c < 3; ++c) {
+                        const float* up = getPlane(y - 1, c) + x;
+                        const float* mid = getPlane(y, c) + x;
+                        const float* down = getPlane(y + 1, c) + x;
+                        for (int k = 0; k < 4; ++k) {
+                            XMVECTOR dx, dy;
+                            calcSobelGradients(up + k * 4, mid + k * 4, down + k * 4, &dx, &dy);
+                            XMVECTOR m = XMVectorSqrt(XMVectorAdd(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)));
+                            luminances[k] = XMVectorAdd(luminances[k], XMVectorMultiply(m, lumaWeights[c]));
+                        }
+                    }
+                    for (int k = 0; k < 4; ++k) {
+                        UINT x4 = x + k * 4;
+                        if (x4 >= w) break;
+                        XMVECTOR luminance = XMVectorSaturate(luminances[k]);
+                        if (colorMode == SOBEL_BLACK_ON_WHITE) luminance = XMVectorSubtract(XMVectorSplatOne(), luminance);
+                        storeSobelLuminance(luminance, x4, (UINT)y, (std::min)(4u, w - x4), dst);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void sobelOperatorImageReference(const CpuImage& src, int colorMode, CpuImage* dst) {
+    initCpuImage(src.format, src.width, src.height, dst);
+    int w = (int)src.width, h = (int)src.height;
+    auto loadChannel = [&](int x, int y, int c) {
+        if (x < 0 || x >= w || y < 0 || y >= h) return 0.0f;
+        float rgba[4];
+        loadPixelReference(src, x, y, rgba);
+        return rgba[c];
+    };
+    const float lumaWeights[3] = { 0.299f, 0.587f, 0.114f };
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            float luminance = 0.0f;
+            for (int c = 0; c < 3; ++c) {
+                // a[i][j] is pixel (x + i - 1, y + j - 1) as in the shader.
+                float a[3][3];
+                for (int i = 0; i < 3; ++i) {
+                    for (int j = 0; j < 3; ++j) a[i][j] = loadChannel(x + i - 1, y + j - 1, c);
+                }
+                float dx = -1.0f * a[0][0] - 2.0f * a[1][0] - 1.0f * a[2][0] +
+                    1.0f * a[0][2] + 2.0f * a[1][2] + 1.0f * a[2][2];
+                float dy = -1.0f * a[2][0] - 2.0f * a[2][1] - 1.0f * a[2][2] +
+                    1.0f * a[0][0] + 2.0f * a[0][1] + 1.0f * a[0][2];
+                luminance += std::sqrt(dx * dx + dy * dy) * lumaWeights[c];
+            }
+            luminance = (std::min)((std::max)(luminance, 0.0f), 1.0f);
+            if (colorMode == SOBEL_BLACK_ON_WHITE) luminance = 1.0f - luminance;
+            float rgba[4] = { luminance, luminance, luminance, luminance };
+            storePixelReference(rgba, x, y, dst);
+        }
+    }
+}
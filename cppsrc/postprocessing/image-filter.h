@@ -0,0 +1,121 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+// Headless CPU kernels of the post processors, which work on the images in memory instead of the off-screen
+// textures. They do not depend on D3DCore or any Windows API, so they can be used as the golden references of
+// the shaders, and as the offline path when there is no GPU.
+//
+// The pixels are processed in float RGBA, one XMVECTOR each. Like the UNORM textures written by the shaders,
+// the RGBA8 images are clamped to [0, 1] and rounded to the nearest 1/255 after every pass.
+//
+// Precision: the kernels with a scalar reference are bit-for-bit identical to it, since both evaluate the same
+// expression in the same order (no fused multiply-add is used).
+
+// Only DXGI_FORMAT_R8G8B8A8_UNORM (the format of the swap chain buffers) and DXGI_FORMAT_R32G32B32A32_FLOAT
+// are supported. The rows are tightly packed, i.e. pixel (x, y) is at (x + y * width) * getImagePixelSize(format).
+struct CpuImage {
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    UINT width = 0, height = 0;
+    std::vector<BYTE> data = {};
+};
+
+UINT getImagePixelSize(DXGI_FORMAT format);
+
+// The pixels are cleared to 0.
+void initCpuImage(DXGI_FORMAT format, UINT width, UINT height, CpuImage* image);
+
+// calcGaussianBlurWeight takes the radius as a uint8_t, thus the blur radius of the filters below is in [0, 255].
+constexpr int MAX_BLUR_RADIUS = 255;
+
+inline bool isValidBlurRadius(int blurRadius) { return blurRadius >= 0 && blurRadius <= MAX_BLUR_RADIUS; }
+
+// Same as GaussianBlur (See gaussian-blur.h): the weights of calcGaussianBlurWeight, the horizontal pass and then
+// the vertical pass with the edge pixels clamped, repeated blurCount times. Unlike the shader, whose weights are
+// hard-coded as 11 constants, the radius is only limited by MAX_BLUR_RADIUS.
+// Return false and leave the image untouched if the radius is out of range.
+bool gaussianBlurImage(int blurRadius, float blurGrade, int blurCount, CpuImage* image);
+
+// The separable filter behind gaussianBlurImage, and weights.size() must be odd, i.e. 2 * radius + 1.
+// The rows of the horizontal passes are split across the worker pool (see thread-utils.h). The vertical passes walk
+// the columns in strips, each of which keeps the 2 * radius + 1 rows in use converted in a ring, so a source row is
+// converted only once and the ring stays in the cache however tall the image is. The strips are split across the
+// worker pool too.
+void separableFilterImage(const std::vector<float>& weights, int passCount, CpuImage* image);
+
+// Single-threaded scalar version of separableFilterImage, which is kept as the golden reference.
+void separableFilterImageReference(const std::vector<float>& weights, int passCount, CpuImage* image);
+
+// Standard deviation of the separable weights, whose center is weights[weights.size() / 2]. As the variances add up,
+// a filter of sigma s run n times is about the same as a Gaussian of sigma s * sqrt(n).
+float calcFilterWeightSigma(const std::vector<float>& weights);
+
+// Radii of the 3 box filters (2 * r + 1 pixels each) whose cascade has the variance closest to sigma^2, i.e. about
+// the Gaussian of sigma by the central limit theorem. The smaller boxes come first.
+void calcBoxCascadeRadii(float sigma, int radii[3]);
+
+// Approximate the Gaussian blur of sigma with the 3 box filters of calcBoxCascadeRadii in each direction (edge pixels
+// clamped). Each box is a running sum, which adds the pixel entering the window and subtracts the one leaving it,
+// so the cost per pixel does not depend on sigma. The 3 boxes of a direction run in float before the image is
+// written (and rounded for RGBA8). The rows are split across the worker pool, and so are the column strips.
+void boxCascadeBlurImage(float sigma, CpuImage* image);
+
+// Peak signal-to-noise ratio in dB over all channels, where peak is the maximum value (1 for RGBA8).
+// Return +inf if the images are the same.
+double calcImagePsnr(const CpuImage& a, const CpuImage& b, float peak);
+
+// Same as BilateralBlur (See bilateral-blur.h): each pixel is the average of its (2 * blurRadius + 1)^2 neighbors
+// (edge pixels clamped) weighted by the product of the distance weights of calcGaussianBlurWeight(blurRadius,
+// distanceGrade) and the gray weight exp(-d^2 / (2 * grayGrade^2)), where d is the difference of the luminance.
+// The cost per pixel is O(blurRadius^2), and it is the golden reference of bilateral-blur.hlsl.
+// The rows are split across the worker pool. Return false and leave the image untouched if the radius is out of range.
+bool bilateralBlurImage(int blurRadius, float distanceGrade, float grayGrade, int blurCount, CpuImage* image);
+
+// Max cells of the gray axis of a bilateral grid, including the padding (See bilateral-grid.hlsl).
+constexpr UINT MAX_BILATERAL_GRID_DEPTH = 24;
+
+// A bilateral grid is a 3D grid over (x, y, gray), with one empty cell of padding on each side. Cell (gx, gy, gz)
+// is centered at pixel ((gx - 1) * cellSize, (gy - 1) * cellSize) and gray grayOrigin + (gz - 1) * grayCellSize.
+struct BilateralGridLayout {
+    float cellSize = 1.0f;
+    float grayOrigin = 0.0f, grayCellSize = 1.0f;
+    UINT width = 0, height = 0, depth = 0;
+};
+
+// The cells of the grid, so that splatting to the nearest cell, the [1 2 1] / 4 blur of the grid along each axis
+// and the trilinear slicing add up to the variances of the bilateral weights, i.e. the sigma of the distance weights
+// (See calcFilterWeightSigma) and grayGrade. The gray of the pixels is in [minGray, maxGray]. The cells are no smaller
+// than a pixel, and the gray axis has no more than MAX_BILATERAL_GRID_DEPTH cells.
+// Return false and leave the layout untouched if the radius is out of range (See isValidBlurRadius).
+bool calcBilateralGridLayout(int blurRadius, float distanceGrade, float grayGrade, UINT imageWidth, UINT imageHeight,
+    float minGray, float maxGray, BilateralGridLayout* layout);
+
+// Approximate bilateralBlurImage with a bilateral grid: each pixel is added to its nearest cell (splat), the grid is
+// blurred along the 3 axes, and each pixel reads the grid at its own (x, y, gray) with trilinear interpolation
+// (slice). The cost is linear in the pixels and does not depend on blurRadius, since the grid gets coarser as the
+// weights get wider. The alpha is kept, and the gray range is [0, 1] widened to the gray of the pixels.
+// The grid rows are split across the worker pool, and the result does not depend on the thread count.
+// Return false and leave the image untouched if the radius is out of range.
+bool bilateralGridBlurImage(int blurRadius, float distanceGrade, float grayGrade, int blurCount, CpuImage* image);
+
+// Same as BLACK_ON_WHITE and WHITE_ON_BLACK in sobel-operator.hlsl.
+constexpr int SOBEL_BLACK_ON_WHITE = 0;
+constexpr int SOBEL_WHITE_ON_BLACK = 1;
+
+// Same as SobelOperator (See sobel-operator.h): the 3x3 Sobel gradients of R, G and B with the pixels beyond the edges
+// read as 0 (like the out-of-range texture loads), the luminance of their magnitudes, clamped to [0, 1] and inverted
+// in SOBEL_BLACK_ON_WHITE mode, written to all 4 channels of dst. dst is initialized to the format and size of src.
+// The channels are converted to planar float rows once, in a ring of 3 rows, and 16 pixels are processed at a time
+// in 4 XMVECTORs. The image is split across the worker pool in bands of rows.
+void sobelOperatorImage(const CpuImage& src, int colorMode, CpuImage* dst);
+
+// Single-threaded scalar version of sobelOperatorImage, which is kept as the golden reference.
+void sobelOperatorImageReference(const CpuImage& src, int colorMode, CpuImage* dst);
@@ -0,0 +1,123 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+
+#include "d3dcore/d3dcore.h"
+#include "postprocess-graph.h"
+#include "utils/debugger.h"
+#include "utils/postprocess-graph-utils.h"
+
+PostProcessGraph::PostProcessGraph(D3DCore* pCore, const PostProcessGraphDesc& desc)
+    : BasicProcess(pCore), _desc(desc)
+{
+    // Reserved
+}
+
+void PostProcessGraph::setKernel(int kind, std::unique_ptr<PostProcessKernel> kernel) {
+    kernels[kind] = std::move(kernel);
+}
+
+void PostProcessGraph::init() {
+    _isPrepared = true;
+
+    std::string errorMessage;
+    if (!compilePostProcessGraph(_desc, &_plan, &errorMessage)) {
+        errorMessage = "Invalid post-processing graph: " + errorMessage;
+        popupDebugWnd(std::wstring(errorMessage.begin(), errorMessage.end()));
+        exit(1);
+    }
+    if (_plan.externalTextureCount == 0) {
+        popupDebugWnd(L"The post-processing graph has no external resource for the input");
+        exit(1);
+    }
+    externalTextures.assign(_plan.externalTextureCount, nullptr);
+
+    // The kernels write the descriptors into the slots of the frame resource, so each kind runs once per frame.
+    std::vector<int> passKinds = {};
+    for (auto& pass : _plan.passes) {
+        if (pass.isCopy) continue;
+        if (kernels.find(pass.kind) == kernels.end()) {
+            popupDebugWnd(L"No post-processing kernel of kind " + std::to_wstring(pass.kind));
+            exit(1);
+        }
+        if (std::find(passKinds.begin(), passKinds.end(), pass.kind) != passKinds.end()) {
+            popupDebugWnd(L"More than 1 post-processing pass of kind " + std::to_wstring(pass.kind));
+            exit(1);
+        }
+        passKinds.push_back(pass.kind);
+    }
+    for (auto& kernel : kernels) kernel.second->init();
+
+    createOffscreenTextureResources();
+}
+
+void PostProcessGraph::bindExternalTexture(UINT resource, ID3D12Resource* texture) {
+    externalTextures[_plan.resourceTextures[resource]] = texture;
+}
+
+ID3D12Resource* PostProcessGraph::process(ID3D12Resource* flatOrigin) {
+    externalTextures[0] = flatOrigin;
+
+    std::vector<ID3D12Resource*> inputs = {};
+    for (auto& pass : _plan.passes) {
+        recordBarriers(pass.barriers);
+
+        inputs.clear();
+        for (UINT texture : pass.inputTextures) inputs.push_back(getTexture(texture));
+        ID3D12Resource* output = getTexture(pass.outputTexture);
+        if (pass.isCopy) pCore->cmdRecorder->CopyResource(output, inputs[0]);
+        else kernels[pass.kind]->record(inputs, output, texWidth, texHeight);
+    }
+    recordBarriers(_plan.finalBarriers);
+
+    return getTexture(_plan.resourceTextures[_desc.finalOutput]);
+}
+
+void PostProcessGraph::createOffscreenTextureResources() {
+    D3D12_RESOURCE_DESC texDesc;
+    ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+    texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    texDesc.Alignment = 0;
+    texDesc.Width = texWidth;
+    texDesc.Height = texHeight;
+    texDesc.DepthOrArraySize = 1;
+    texDesc.MipLevels = 1;
+    texDesc.Format = pCore->swapChainBuffFormat;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.SampleDesc.Quality = 0;
+    texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    // Enable changing to UAV state.
+    texDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    for (UINT i = 0; i < _plan.transientTextureCount; ++i) {
+        checkHR(pCore->device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &texDesc,
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(&textures["T" + std::to_string(i)])));
+    }
+}
+
+ID3D12Resource* PostProcessGraph::getTexture(UINT texture) {
+    if (texture < _plan.externalTextureCount) return externalTextures[texture];
+    return textures["T" + std::to_string(texture - _plan.externalTextureCount)].Get();
+}
+
+void PostProcessGraph::recordBarriers(const std::vector<PostProcessBarrier>& barriers) {
+    if (barriers.empty()) return;
+    // Submit the barriers of a pass in a single call.
+    std::vector<D3D12_RESOURCE_BARRIER> transitions = {};
+    for (auto& barrier : barriers) {
+        transitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+            getTexture(barrier.texture), barrier.stateBefore, barrier.stateAfter));
+    }
+    pCore->cmdRecorder->ResourceBarrier((UINT)transitions.size(), transitions.data());
+}
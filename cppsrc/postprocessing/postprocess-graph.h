@@ -0,0 +1,71 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "basic-process.h"
+#include "d3dcore/postprocess-graph.h"
+
+// Records a pass of one kind in PostProcessGraph.
+class PostProcessKernel {
+public:
+    PostProcessKernel(D3DCore* pCore) : pCore(pCore) { }
+
+    virtual ~PostProcessKernel() { }
+
+    // Called by PostProcessGraph::init to create the root signatures, PSOs and descriptor heaps.
+    virtual void init() = 0;
+
+    // The inputs are in D3D12_RESOURCE_STATE_GENERIC_READ and the output in D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+    // which are all full-frame textures in the format of the swap chain buffers. It is called once per frame at most,
+    // so the descriptors can be written into the slots of pCore->currFrameResourceIdx.
+    virtual void record(const std::vector<ID3D12Resource*>& inputs, ID3D12Resource* output, UINT w, UINT h) = 0;
+
+protected:
+    D3DCore* pCore = nullptr;
+};
+
+// Run the passes compiled from the graph (See utils/postprocess-graph-utils.h), where the transient resources
+// share the textures of the graph and the copies between the postprocessors are gone. Unlike the other
+// postprocessors, the input is not copied into an own texture, but read in place.
+class PostProcessGraph : public BasicProcess {
+public:
+    PostProcessGraph(D3DCore* pCore, const PostProcessGraphDesc& desc);
+
+    // Set the kernels before init, each kind of the passes needs one (the fused kinds included).
+    void setKernel(int kind, std::unique_ptr<PostProcessKernel> kernel);
+
+    void init() override;
+
+    // Bind an external resource other than the first one, which must be in D3D12_RESOURCE_STATE_COMMON.
+    void bindExternalTexture(UINT resource, ID3D12Resource* texture);
+
+    // flatOrigin is bound to the first external resource of the graph.
+    // Return: the final output of the graph in D3D12_RESOURCE_STATE_COMMON.
+    ID3D12Resource* process(ID3D12Resource* flatOrigin) override;
+
+    inline const PostProcessPlan& plan() { return _plan; }
+
+protected:
+    void createOffscreenTextureResources() override;
+
+private:
+    ID3D12Resource* getTexture(UINT texture);
+
+    void recordBarriers(const std::vector<PostProcessBarrier>& barriers);
+
+private:
+    PostProcessGraphDesc _desc = {};
+    PostProcessPlan _plan = {};
+
+    std::unordered_map<int, std::unique_ptr<PostProcessKernel>> kernels = {};
+
+    std::vector<ID3D12Resource*> externalTextures = {}; // Indexed by the texture of the plan.
+};
@@ -0,0 +1,91 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "d3dcore/d3dcore.h"
+#include "sobel-compositor.h"
+#include "utils/debugger.h"
+
+SobelMultiplyKernel::SobelMultiplyKernel(D3DCore* pCore)
+    : PostProcessKernel(pCore)
+{
+    // Reserved
+}
+
+void SobelMultiplyKernel::init() {
+    D3D12_DESCRIPTOR_HEAP_DESC tdhDesc = {}; // tdh: Texture Descriptor Heap
+    tdhDesc.NumDescriptors = 2 * NUM_FRAME_RESOURCES; // Input SRV, output UAV.
+    tdhDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    tdhDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    checkHR(pCore->device->CreateDescriptorHeap(&tdhDesc, IID_PPV_ARGS(&texDescHeap)));
+
+    // Create sobel compositor root signature, which is the same as sobel operator.
+    CD3DX12_ROOT_PARAMETER slotRootParameter[3];
+
+    CD3DX12_DESCRIPTOR_RANGE srvTable;
+    srvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+    slotRootParameter[0].InitAsDescriptorTable(1, &srvTable);
+    CD3DX12_DESCRIPTOR_RANGE uavTable;
+    uavTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+    slotRootParameter[1].InitAsDescriptorTable(1, &uavTable);
+    slotRootParameter[2].InitAsConstants(1, 0);
+
+    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(3, slotRootParameter, 0, nullptr,
+        D3D12_ROOT_SIGNATURE_FLAG_NONE);
+    createRootSig(pCore, "sobel_compositor", &rootSigDesc);
+
+    // Compile sobel compositor shaders.
+    ShaderFuncEntryPoints csEntryPoint = {};
+    csEntryPoint.cs = "SobelMultiplyCS";
+    s_sobelMultiply = std::make_unique<Shader>(
+        "sobel_compositor", L"shaders/postprocessing/sobel-compositor.hlsl", Shader::CS, csEntryPoint);
+
+    // Create sobel compositor compute shader PSOs.
+    D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+    psoDesc.pRootSignature = pCore->rootSigs["sobel_compositor"].Get();
+    bindShaderToCPSO(&psoDesc, s_sobelMultiply.get());
+    psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+    checkHR(pCore->device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pCore->PSOs["sobel_compositor"])));
+}
+
+void SobelMultiplyKernel::record(const std::vector<ID3D12Resource*>& inputs, ID3D12Resource* output, UINT w, UINT h) {
+    auto cbvSrvUavDescSize = pCore->cbvSrvUavDescSize;
+    int firstSlot = 2 * pCore->currFrameResourceIdx;
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(texDescHeap->GetCPUDescriptorHandleForHeapStart(), firstSlot, cbvSrvUavDescSize);
+    CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(texDescHeap->GetGPUDescriptorHandleForHeapStart(), firstSlot, cbvSrvUavDescSize);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = pCore->swapChainBuffFormat;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MostDetailedMip = 0;
+    srvDesc.Texture2D.MipLevels = 1;
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format = pCore->swapChainBuffFormat;
+    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+    uavDesc.Texture2D.MipSlice = 0;
+
+    pCore->device->CreateShaderResourceView(inputs[0], &srvDesc, handle);
+    pCore->device->CreateUnorderedAccessView(output, nullptr, &uavDesc, handle.Offset(1, cbvSrvUavDescSize));
+
+    ID3D12DescriptorHeap* descHeaps[] = { texDescHeap.Get() };
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["sobel_compositor"].Get());
+    pCore->cmdRecorder->SetPipelineState(pCore->PSOs["sobel_compositor"].Get());
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(0, gpuHandle);
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(1, gpuHandle.Offset(1, cbvSrvUavDescSize));
+    int colorMode = BLACK_ON_WHITE;
+    if (GetAsyncKeyState(VK_SPACE)) colorMode = WHITE_ON_BLACK;
+    pCore->cmdRecorder->SetComputeRoot32BitConstant(2, colorMode, 0);
+
+    UINT numGroupX = (UINT)ceilf(w / 32.0f); // M = 32 in sobel-compositor.hlsl
+    UINT numGroupY = (UINT)ceilf(h / 32.0f); // N = 32 in sobel-compositor.hlsl
+    pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
+}
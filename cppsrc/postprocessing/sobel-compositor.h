@@ -0,0 +1,33 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <memory>
+
+#include "graphics/shader.h"
+#include "postprocess-graph.h"
+
+// The SobelOperator followed by the ColorCompositor of MULTIPLY with the edges as the background plate, as the
+// fused pass of PostProcessGraph. The input is the frame and the output is the frame multiplied by its edges.
+class SobelMultiplyKernel : public PostProcessKernel {
+public:
+    SobelMultiplyKernel(D3DCore* pCore);
+
+    void init() override;
+
+    void record(const std::vector<ID3D12Resource*>& inputs, ID3D12Resource* output, UINT w, UINT h) override;
+
+private:
+    std::unique_ptr<Shader> s_sobelMultiply = nullptr;
+
+    // A SRV and an UAV for each frame resource, since the textures change with the aliasing and the inputs.
+    ComPtr<ID3D12DescriptorHeap> texDescHeap = nullptr;
+
+    constexpr static int BLACK_ON_WHITE = 0;
+    constexpr static int WHITE_ON_BLACK = 1;
+};
@@ -63,56 +63,56 @@ void SobelOperator::onResize(UINT w, UINT h) {
 ID3D12Resource* SobelOperator::process(ID3D12Resource* flatOrigin) {
 
     ID3D12DescriptorHeap* descHeaps[] = { texDescHeap.Get() };
-    pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+    pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
 
-    pCore->cmdList->SetComputeRootSignature(pCore->rootSigs["sobel_operator"].Get());
+    pCore->cmdRecorder->SetComputeRootSignature(pCore->rootSigs["sobel_operator"].Get());
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_SOURCE));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_COPY_DEST));
 
-    pCore->cmdList->CopyResource(textures["A"].Get(), flatOrigin);
+    pCore->cmdRecorder->CopyResource(textures["A"].Get(), flatOrigin);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             flatOrigin,
             D3D12_RESOURCE_STATE_COPY_SOURCE,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_COPY_DEST,
             D3D12_RESOURCE_STATE_GENERIC_READ));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_COMMON,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
-    pCore->cmdList->SetPipelineState(pCore->PSOs["sobel_operator"].Get());
-    pCore->cmdList->SetComputeRootDescriptorTable(0, texA_SrvGPU);
-    pCore->cmdList->SetComputeRootDescriptorTable(1, texB_UavGPU);
+    pCore->cmdRecorder->SetPipelineState(pCore->PSOs["sobel_operator"].Get());
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(0, texA_SrvGPU);
+    pCore->cmdRecorder->SetComputeRootDescriptorTable(1, texB_UavGPU);
     int colorMode = BLACK_ON_WHITE;
     if (GetAsyncKeyState(VK_SPACE)) colorMode = WHITE_ON_BLACK;
-    pCore->cmdList->SetComputeRoot32BitConstant(2, colorMode, 0);
+    pCore->cmdRecorder->SetComputeRoot32BitConstant(2, colorMode, 0);
 
     UINT numGroupX = (UINT)ceilf(texWidth / 32.0f); // M = 32 in sobel-operator.hlsl
     UINT numGroupY = (UINT)ceilf(texHeight / 32.0f); // N = 32 in sobel-operator.hlsl
-    pCore->cmdList->Dispatch(numGroupX, numGroupY, 1);
+    pCore->cmdRecorder->Dispatch(numGroupX, numGroupY, 1);
 
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["A"].Get(),
             D3D12_RESOURCE_STATE_GENERIC_READ,
             D3D12_RESOURCE_STATE_COMMON));
-    pCore->cmdList->ResourceBarrier(1,
+    pCore->cmdRecorder->ResourceBarrier(1,
         &CD3DX12_RESOURCE_BARRIER::Transition(
             textures["B"].Get(),
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
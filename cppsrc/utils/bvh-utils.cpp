@@ -0,0 +1,660 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#include "bvh-utils.h"
+#include "culling-utils.h"
+#include "thread-utils.h"
+
+namespace {
+
+constexpr int BVH_BIN_COUNT = 16;
+// The ranges of at least this count are binned with parallelFor.
+constexpr UINT PARALLEL_BIN_MIN_COUNT = 65536;
+constexpr size_t PARALLEL_GRAIN_SIZE = 16384;
+// The subtrees of at most this count are built in parallel (or larger ones, so there are enough tasks per worker).
+constexpr UINT SUBTREE_MIN_COUNT = 4096;
+constexpr UINT SUBTREE_TASKS_PER_WORKER = 4;
+// Largest leaf made when the SAH cost says a split does not pay off.
+constexpr UINT SAH_MAX_LEAF_SIZE = 16;
+// The frustum tests of the nodes are loosened by this distance, so the rounding of the node bounds never
+// culls a box which passes its own test.
+constexpr float NODE_TEST_EPSILON = 1e-3f;
+
+struct Box {
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    void grow(const float* pMin, const float* pMax) {
+        for (int a = 0; a < 3; ++a) {
+            min[a] = (std::min)(min[a], pMin[a]);
+            max[a] = (std::max)(max[a], pMax[a]);
+        }
+    }
+    void grow(const Box& box) { grow(box.min, box.max); }
+
+    float halfArea() const {
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return dx < 0.0f ? 0.0f : dx * dy + dy * dz + dz * dx;
+    }
+};
+
+// Box of the build, which is grown with XMVECTOR. w is not used.
+struct BuildBox {
+    XMVECTOR min = XMVectorReplicate(FLT_MAX);
+    XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+
+    void XM_CALLCONV grow(FXMVECTOR pMin, FXMVECTOR pMax) {
+        min = XMVectorMin(min, pMin);
+        max = XMVectorMax(max, pMax);
+    }
+    void grow(const BuildBox& box) { grow(box.min, box.max); }
+
+    float halfArea() const {
+        XMFLOAT3 d;
+        XMStoreFloat3(&d, XMVectorSubtract(max, min));
+        return d.x < 0.0f ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+// The build partitions the boxes themselves instead of their indices, so the binning reads them in order.
+struct Prim {
+    XMVECTOR min, max;
+    UINT idx;
+};
+
+inline XMVECTOR calcCentroid(const Prim& prim) {
+    return XMVectorScale(XMVectorAdd(prim.min, prim.max), 0.5f);
+}
+
+struct BuildRange {
+    UINT first = 0, count = 0;
+    BuildBox box = {}, centroidBox = {};
+};
+
+struct Bin {
+    BuildBox box = {};
+    UINT count = 0;
+};
+
+struct BinSet {
+    Bin bins[3][BVH_BIN_COUNT] = {};
+};
+
+struct SubtreeTask {
+    UINT nodeIdx = 0;
+    int slot = 0;
+    UINT depth = 0;
+    BuildRange range = {};
+};
+
+inline bool isUnbounded(const BoundsSoA& bounds, size_t i) {
+    // NaN is treated as unbounded too.
+    return !(bounds.extentX[i] < FLT_MAX && bounds.extentY[i] < FLT_MAX && bounds.extentZ[i] < FLT_MAX);
+}
+
+inline void getPrimBounds(const BoundsSoA& bounds, size_t i, BvhPrimBounds* primBounds) {
+    primBounds->center = { bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+    primBounds->extents = { bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+}
+
+inline Box getPrimBox(const BvhPrimBounds& primBounds) {
+    Box box;
+    box.min[0] = primBounds.center.x - primBounds.extents.x;
+    box.min[1] = primBounds.center.y - primBounds.extents.y;
+    box.min[2] = primBounds.center.z - primBounds.extents.z;
+    box.max[0] = primBounds.center.x + primBounds.extents.x;
+    box.max[1] = primBounds.center.y + primBounds.extents.y;
+    box.max[2] = primBounds.center.z + primBounds.extents.z;
+    return box;
+}
+
+inline Box getChildBox(const BvhNode& node, int slot) {
+    Box box;
+    box.min[0] = node.childMin[slot].x; box.min[1] = node.childMin[slot].y; box.min[2] = node.childMin[slot].z;
+    box.max[0] = node.childMax[slot].x; box.max[1] = node.childMax[slot].y; box.max[2] = node.childMax[slot].z;
+    return box;
+}
+
+inline void setChildBox(const Box& box, int slot, BvhNode* node) {
+    node->childMin[slot] = { box.min[0], box.min[1], box.min[2] };
+    node->childMax[slot] = { box.max[0], box.max[1], box.max[2] };
+}
+
+inline void setChildBox(const BuildBox& box, int slot, BvhNode* node) {
+    XMStoreFloat3(&node->childMin[slot], box.min);
+    XMStoreFloat3(&node->childMax[slot], box.max);
+}
+
+void initEmptyNode(BvhNode* node) {
+    for (int slot = 0; slot < 2; ++slot) {
+        setChildBox(Box{}, slot, node);
+        node->childIdx[slot] = BVH_EMPTY_CHILD;
+        node->childCount[slot] = 0;
+    }
+}
+
+inline bool isEmptyChild(const BvhNode& node, int slot) { return node.childIdx[slot] == BVH_EMPTY_CHILD; }
+inline bool isLeafChild(const BvhNode& node, int slot) { return node.childCount[slot] > 0; }
+
+inline int calcBinIdx(float binCoord) {
+    return std::clamp((int)binCoord, 0, BVH_BIN_COUNT - 1);
+}
+
+// The bin coordinates of the centroid on all axes, the same arithmetic for the binning and the partition.
+inline XMVECTOR XM_CALLCONV calcBinCoord(const Prim& prim, FXMVECTOR centroidMin, FXMVECTOR scale) {
+    return XMVectorMultiply(XMVectorSubtract(calcCentroid(prim), centroidMin), scale);
+}
+
+class BvhBuilder {
+public:
+    BvhBuilder(UINT maxLeafSize, std::vector<Prim>* prims) : _maxLeafSize(maxLeafSize), _prims(*prims) { }
+
+    // Partition the range into 2 by the binned SAH, and return FALSE if the range should be a leaf.
+    bool split(const BuildRange& range, UINT depth, BuildRange* left, BuildRange* right) {
+        if (range.count <= _maxLeafSize || depth >= BVH_MAX_DEPTH - 1) return false;
+
+        XMFLOAT3 extent;
+        XMStoreFloat3(&extent, XMVectorSubtract(range.centroidBox.max, range.centroidBox.min));
+        float scale[3] = {
+            extent.x > 0.0f ? BVH_BIN_COUNT / extent.x : 0.0f,
+            extent.y > 0.0f ? BVH_BIN_COUNT / extent.y : 0.0f,
+            extent.z > 0.0f ? BVH_BIN_COUNT / extent.z : 0.0f
+        };
+        XMVECTOR scaleV = XMVectorSet(scale[0], scale[1], scale[2], 0.0f);
+
+        BinSet binSet;
+        if (range.count >= PARALLEL_BIN_MIN_COUNT) {
+            std::vector<BinSet> chunkBinSets((range.count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE);
+            parallelFor(range.first, range.first + range.count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+                binPrims(range.centroidBox.min, scaleV, begin, end, &chunkBinSets[(begin - range.first) / PARALLEL_GRAIN_SIZE]);
+            });
+            for (auto& chunk : chunkBinSets) {
+                for (int a = 0; a < 3; ++a) {
+                    for (int b = 0; b < BVH_BIN_COUNT; ++b) {
+                        binSet.bins[a][b].count += chunk.bins[a][b].count;
+                        binSet.bins[a][b].box.grow(chunk.bins[a][b].box);
+                    }
+                }
+            }
+        }
+        else binPrims(range.centroidBox.min, scaleV, range.first, range.first + range.count, &binSet);
+
+        // Sweep the bins from both sides, the split s puts the bins [0, s) to the left.
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = FLT_MAX;
+        for (int a = 0; a < 3; ++a) {
+            if (scale[a] == 0.0f) continue;
+            auto& bins = binSet.bins[a];
+            float rightArea[BVH_BIN_COUNT];
+            UINT rightCount[BVH_BIN_COUNT];
+            BuildBox box;
+            UINT count = 0;
+            for (int b = BVH_BIN_COUNT - 1; b > 0; --b) {
+                box.grow(bins[b].box);
+                count += bins[b].count;
+                rightArea[b] = box.halfArea();
+                rightCount[b] = count;
+            }
+            box = BuildBox{};
+            count = 0;
+            for (int s = 1; s < BVH_BIN_COUNT; ++s) {
+                box.grow(bins[s - 1].box);
+                count += bins[s - 1].count;
+                if (count == 0 || rightCount[s] == 0) continue;
+                float cost = box.halfArea() * count + rightArea[s] * rightCount[s];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = a;
+                    bestSplit = s;
+                }
+            }
+        }
+
+        *left = *right = {};
+        if (bestAxis >= 0) {
+            // A traversal step costs as much as a primitive test.
+            float parentArea = range.box.halfArea();
+            if (range.count <= SAH_MAX_LEAF_SIZE && parentArea > 0.0f && 1.0f + bestCost / parentArea >= range.count) return false;
+
+            for (int b = 0; b < BVH_BIN_COUNT; ++b) {
+                BuildRange* child = b < bestSplit ? left : right;
+                child->count += binSet.bins[bestAxis][b].count;
+            }
+            XMVECTOR centroidMin = range.centroidBox.min;
+            auto first = _prims.begin() + range.first;
+            std::partition(first, first + range.count, [&](const Prim& prim) {
+                return calcBinIdx(XMVectorGetByIndex(calcBinCoord(prim, centroidMin, scaleV), bestAxis)) < bestSplit;
+            });
+        }
+        else {
+            // All centroids are at the same point, so the range is halved by count.
+            left->count = range.count / 2;
+            right->count = range.count - left->count;
+        }
+        left->first = range.first;
+        right->first = range.first + left->count;
+
+        // The bounds of the children are gathered again, which is cheaper than keeping the centroid bounds in every bin.
+        for (UINT i = 0; i < range.count; ++i) {
+            BuildRange* child = i < left->count ? left : right;
+            const Prim& prim = _prims[range.first + i];
+            XMVECTOR centroid = calcCentroid(prim);
+            child->box.grow(prim.min, prim.max);
+            child->centroidBox.grow(centroid, centroid);
+        }
+        return true;
+    }
+
+    // Fill the child of the node with the range. The ranges small enough are pushed into tasks instead if it is not nullptr.
+    void buildChild(std::vector<BvhNode>& nodes, UINT nodeIdx, int slot,
+        const BuildRange& range, UINT depth, UINT subtreeCount, std::vector<SubtreeTask>* tasks)
+    {
+        setChildBox(range.box, slot, &nodes[nodeIdx]);
+        if (tasks != nullptr && range.count <= subtreeCount) {
+            tasks->push_back({ nodeIdx, slot, depth, range });
+            return;
+        }
+
+        BuildRange left, right;
+        if (!split(range, depth, &left, &right)) {
+            nodes[nodeIdx].childIdx[slot] = range.first;
+            nodes[nodeIdx].childCount[slot] = range.count;
+            return;
+        }
+        // Note nodes can be reallocated, so it is indexed again every time.
+        UINT childIdx = (UINT)nodes.size();
+        nodes.emplace_back();
+        initEmptyNode(&nodes[childIdx]);
+        nodes[nodeIdx].childIdx[slot] = childIdx;
+        nodes[nodeIdx].childCount[slot] = 0;
+        buildChild(nodes, childIdx, 0, left, depth + 1, subtreeCount, tasks);
+        buildChild(nodes, childIdx, 1, right, depth + 1, subtreeCount, tasks);
+    }
+
+private:
+    void XM_CALLCONV binPrims(FXMVECTOR centroidMin, FXMVECTOR scale, size_t begin, size_t end, BinSet* binSet) const {
+        for (size_t i = begin; i < end; ++i) {
+            const Prim& prim = _prims[i];
+            XMFLOAT4A binCoord;
+            XMStoreFloat4A(&binCoord, calcBinCoord(prim, centroidMin, scale));
+            float coords[3] = { binCoord.x, binCoord.y, binCoord.z };
+            for (int a = 0; a < 3; ++a) {
+                Bin& bin = binSet->bins[a][calcBinIdx(coords[a])];
+                ++bin.count;
+                bin.box.grow(prim.min, prim.max);
+            }
+        }
+    }
+
+    UINT _maxLeafSize = 4;
+    std::vector<Prim>& _prims;
+};
+
+// Bounds of a node which are moved by the refit, i.e. its leaves are read from the boxes again,
+// and its inner children from the child nodes which must be refit already.
+void refitNode(const BoundsSoA& bounds, Bvh* bvh, size_t nodeIdx, bool* pIsValid) {
+    BvhNode& node = bvh->nodes[nodeIdx];
+    for (int slot = 0; slot < 2; ++slot) {
+        if (isEmptyChild(node, slot)) continue;
+        Box box;
+        if (isLeafChild(node, slot)) {
+            for (UINT k = node.childIdx[slot]; k < node.childIdx[slot] + node.childCount[slot]; ++k) {
+                UINT idx = bvh->primIdx[k];
+                if (isUnbounded(bounds, idx)) *pIsValid = false;
+                getPrimBounds(bounds, idx, &bvh->primBounds[k]);
+                box.grow(getPrimBox(bvh->primBounds[k]));
+            }
+        }
+        else {
+            const BvhNode& child = bvh->nodes[node.childIdx[slot]];
+            for (int childSlot = 0; childSlot < 2; ++childSlot) {
+                if (!isEmptyChild(child, childSlot)) box.grow(getChildBox(child, childSlot));
+            }
+        }
+        setChildBox(box, slot, &node);
+    }
+}
+
+enum class FrustumTest { Outside, Intersecting, Inside };
+
+inline FrustumTest testNodeFrustum(const Frustum& frustum, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) {
+    FrustumTest result = FrustumTest::Inside;
+    for (auto& plane : frustum.planes) {
+        // The corners farthest along and against the plane normal.
+        float px = plane.x >= 0.0f ? boxMax.x : boxMin.x, nx = plane.x >= 0.0f ? boxMin.x : boxMax.x;
+        float py = plane.y >= 0.0f ? boxMax.y : boxMin.y, ny = plane.y >= 0.0f ? boxMin.y : boxMax.y;
+        float pz = plane.z >= 0.0f ? boxMax.z : boxMin.z, nz = plane.z >= 0.0f ? boxMin.z : boxMax.z;
+        if (px * plane.x + py * plane.y + pz * plane.z + plane.w < -NODE_TEST_EPSILON) return FrustumTest::Outside;
+        if (nx * plane.x + ny * plane.y + nz * plane.z + plane.w < 0.0f) result = FrustumTest::Intersecting;
+    }
+    return result;
+}
+
+size_t appendSubtreePrims(const Bvh& bvh, UINT nodeIdx, UINT* visibleIdx, size_t visibleCount) {
+    UINT stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = nodeIdx;
+    while (stackSize > 0) {
+        const BvhNode& node = bvh.nodes[stack[--stackSize]];
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            if (isLeafChild(node, slot)) {
+                for (UINT k = 0; k < node.childCount[slot]; ++k) visibleIdx[visibleCount++] = bvh.primIdx[node.childIdx[slot] + k];
+            }
+            else stack[stackSize++] = node.childIdx[slot];
+        }
+    }
+    return visibleCount;
+}
+
+// Slab test of the ray segment [0, tMax]. NaN of 0 * inf (the origin on a slab of an axis-parallel ray) is ignored.
+inline bool intersectRayBox(const float* origin, const float* invDir, const float* boxMin, const float* boxMax, float tMax, float* tEnter) {
+    float t0 = 0.0f, t1 = tMax;
+    for (int a = 0; a < 3; ++a) {
+        float tNear = (boxMin[a] - origin[a]) * invDir[a];
+        float tFar = (boxMax[a] - origin[a]) * invDir[a];
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = (std::max)(t0, tNear);
+        t1 = (std::min)(t1, tFar);
+    }
+    *tEnter = t0;
+    return t0 <= t1;
+}
+
+// Shared traversal of the overlap queries. test(boxMin, boxMax) tells whether a box overlaps.
+template <typename Test>
+void queryBvhOverlap(const Bvh& bvh, Test test, std::vector<UINT>* result) {
+    result->assign(bvh.unboundedIdx.begin(), bvh.unboundedIdx.end());
+    if (bvh.nodes.empty()) return;
+
+    UINT stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = bvh.nodes[stack[--stackSize]];
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            Box box = getChildBox(node, slot);
+            if (!test(box.min, box.max)) continue;
+            if (isLeafChild(node, slot)) {
+                for (UINT k = node.childIdx[slot]; k < node.childIdx[slot] + node.childCount[slot]; ++k) {
+                    Box primBox = getPrimBox(bvh.primBounds[k]);
+                    if (test(primBox.min, primBox.max)) result->push_back(bvh.primIdx[k]);
+                }
+            }
+            else stack[stackSize++] = node.childIdx[slot];
+        }
+    }
+}
+
+}
+
+void buildBvh(const BoundsSoA& bounds, UINT maxLeafSize, Bvh* bvh) {
+    bvh->nodes.clear();
+    bvh->primIdx.clear();
+    bvh->primBounds.clear();
+    bvh->unboundedIdx.clear();
+    bvh->topNodeCount = 0;
+    bvh->subtreeNodeBegin.clear();
+    bvh->primCount = bounds.count;
+    bvh->maxLeafSize = (std::max)(maxLeafSize, 1u);
+
+    std::vector<UINT> boundedIdx = {};
+    boundedIdx.reserve(bounds.count);
+    for (size_t i = 0; i < bounds.count; ++i) {
+        if (isUnbounded(bounds, i)) bvh->unboundedIdx.push_back((UINT)i);
+        else boundedIdx.push_back((UINT)i);
+    }
+    BuildRange root = {};
+    root.count = (UINT)boundedIdx.size();
+    if (root.count == 0) return;
+
+    std::vector<Prim> prims(root.count);
+    size_t chunkCount = (root.count + PARALLEL_GRAIN_SIZE - 1) / PARALLEL_GRAIN_SIZE;
+    std::vector<BuildBox> chunkBoxes(chunkCount), chunkCentroidBoxes(chunkCount);
+    parallelFor(0, root.count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        size_t chunk = begin / PARALLEL_GRAIN_SIZE;
+        for (size_t i = begin; i < end; ++i) {
+            Prim& prim = prims[i];
+            BvhPrimBounds primBounds;
+            prim.idx = boundedIdx[i];
+            getPrimBounds(bounds, prim.idx, &primBounds);
+            XMVECTOR center = XMLoadFloat3(&primBounds.center), extents = XMLoadFloat3(&primBounds.extents);
+            prim.min = XMVectorSubtract(center, extents);
+            prim.max = XMVectorAdd(center, extents);
+            XMVECTOR centroid = calcCentroid(prim);
+            chunkBoxes[chunk].grow(prim.min, prim.max);
+            chunkCentroidBoxes[chunk].grow(centroid, centroid);
+        }
+    });
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        root.box.grow(chunkBoxes[chunk]);
+        root.centroidBox.grow(chunkCentroidBoxes[chunk]);
+    }
+
+    auto& nodes = bvh->nodes;
+    nodes.reserve(2 * root.count / bvh->maxLeafSize + 1);
+    nodes.emplace_back();
+    initEmptyNode(&nodes[0]);
+
+    BvhBuilder builder(bvh->maxLeafSize, &prims);
+    std::vector<SubtreeTask> tasks = {};
+    unsigned int threadCount = workerThreadCount();
+    std::vector<SubtreeTask>* pTasks = threadCount > 1 ? &tasks : nullptr;
+    UINT subtreeCount = (std::max)(SUBTREE_MIN_COUNT, root.count / (SUBTREE_TASKS_PER_WORKER * threadCount));
+
+    BuildRange left, right;
+    if (builder.split(root, 0, &left, &right)) {
+        builder.buildChild(nodes, 0, 0, left, 1, subtreeCount, pTasks);
+        builder.buildChild(nodes, 0, 1, right, 1, subtreeCount, pTasks);
+    }
+    else {
+        setChildBox(root.box, 0, &nodes[0]);
+        nodes[0].childIdx[0] = root.first;
+        nodes[0].childCount[0] = root.count;
+    }
+    bvh->topNodeCount = (UINT)nodes.size();
+
+    // Every subtree is built into the nodes of its own, with a dummy parent at 0 standing for the top node.
+    std::vector<std::vector<BvhNode>> subtreeNodes(tasks.size());
+    parallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            auto& localNodes = subtreeNodes[t];
+            localNodes.reserve(2 * tasks[t].range.count / bvh->maxLeafSize + 1);
+            localNodes.emplace_back();
+            initEmptyNode(&localNodes[0]);
+            builder.buildChild(localNodes, 0, 0, tasks[t].range, tasks[t].depth, 0, nullptr);
+        }
+    });
+
+    // Append the subtrees behind the top nodes, i.e. the local node i (i > 0) goes to offset + i.
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        auto& localNodes = subtreeNodes[t];
+        UINT offset = (UINT)nodes.size() - 1;
+        auto relocate = [offset](int slot, BvhNode* node) {
+            if (!isEmptyChild(*node, slot) && !isLeafChild(*node, slot)) node->childIdx[slot] += offset;
+        };
+        bvh->subtreeNodeBegin.push_back((UINT)nodes.size());
+        for (size_t i = 1; i < localNodes.size(); ++i) {
+            BvhNode node = localNodes[i];
+            relocate(0, &node);
+            relocate(1, &node);
+            nodes.push_back(node);
+        }
+        BvhNode& parent = nodes[tasks[t].nodeIdx];
+        int slot = tasks[t].slot;
+        parent.childIdx[slot] = localNodes[0].childIdx[0];
+        parent.childCount[slot] = localNodes[0].childCount[0];
+        relocate(slot, &parent);
+    }
+
+    bvh->primIdx.resize(root.count);
+    bvh->primBounds.resize(root.count);
+    parallelFor(0, root.count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            bvh->primIdx[i] = prims[i].idx;
+            getPrimBounds(bounds, prims[i].idx, &bvh->primBounds[i]);
+        }
+    });
+}
+
+bool refitBvh(const BoundsSoA& bounds, Bvh* bvh) {
+    if (bounds.count != bvh->primCount) return false;
+    for (UINT idx : bvh->unboundedIdx) {
+        if (!isUnbounded(bounds, idx)) return false;
+    }
+
+    // The children are always behind their parents, so the nodes are refit in reverse order.
+    std::atomic<bool> isValid = true;
+    size_t subtreeCount = bvh->subtreeNodeBegin.size();
+    parallelFor(0, subtreeCount, 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            size_t first = bvh->subtreeNodeBegin[t];
+            size_t last = t + 1 < subtreeCount ? bvh->subtreeNodeBegin[t + 1] : bvh->nodes.size();
+            bool isSubtreeValid = true;
+            for (size_t n = last; n-- > first;) refitNode(bounds, bvh, n, &isSubtreeValid);
+            if (!isSubtreeValid) isValid = false;
+        }
+    });
+    bool isTopValid = true;
+    for (size_t n = bvh->topNodeCount; n-- > 0;) refitNode(bounds, bvh, n, &isTopValid);
+    return isValid && isTopValid;
+}
+
+float calcBvhSahCost(const Bvh& bvh) {
+    if (bvh.nodes.empty()) return 0.0f;
+    Box rootBox = getChildBox(bvh.nodes[0], 0);
+    if (!isEmptyChild(bvh.nodes[0], 1)) rootBox.grow(getChildBox(bvh.nodes[0], 1));
+    float rootArea = rootBox.halfArea();
+    if (rootArea <= 0.0f) return 0.0f;
+
+    double cost = rootArea;
+    for (auto& node : bvh.nodes) {
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            float area = getChildBox(node, slot).halfArea();
+            cost += isLeafChild(node, slot) ? (double)area * node.childCount[slot] : area;
+        }
+    }
+    return (float)(cost / rootArea);
+}
+
+size_t cullBvh(const Bvh& bvh, const Frustum& frustum, UINT* visibleIdx) {
+    size_t visibleCount = 0;
+    for (UINT idx : bvh.unboundedIdx) visibleIdx[visibleCount++] = idx;
+    if (bvh.nodes.empty()) return visibleCount;
+
+    UINT stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = bvh.nodes[stack[--stackSize]];
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            FrustumTest test = testNodeFrustum(frustum, node.childMin[slot], node.childMax[slot]);
+            if (test == FrustumTest::Outside) continue;
+
+            UINT childIdx = node.childIdx[slot];
+            if (isLeafChild(node, slot)) {
+                for (UINT k = childIdx; k < childIdx + node.childCount[slot]; ++k) {
+                    auto& primBounds = bvh.primBounds[k];
+                    if (test == FrustumTest::Inside || isBoundsInFrustum(frustum, primBounds.center, primBounds.extents)) {
+                        visibleIdx[visibleCount++] = bvh.primIdx[k];
+                    }
+                }
+            }
+            else if (test == FrustumTest::Inside) visibleCount = appendSubtreePrims(bvh, childIdx, visibleIdx, visibleCount);
+            else stack[stackSize++] = childIdx;
+        }
+    }
+    return visibleCount;
+}
+
+bool XM_CALLCONV pickBvh(const Bvh& bvh, FXMVECTOR origin, FXMVECTOR dir, UINT* pIdx, float* pDist) {
+    if (bvh.nodes.empty()) return false;
+    XMFLOAT3 o, d;
+    XMStoreFloat3(&o, origin);
+    XMStoreFloat3(&d, dir);
+    float originArr[3] = { o.x, o.y, o.z };
+    float invDir[3] = { 1.0f / d.x, 1.0f / d.y, 1.0f / d.z };
+
+    struct StackEntry {
+        UINT nodeIdx;
+        float tEnter;
+    };
+    StackEntry stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = { 0, 0.0f };
+
+    bool isHit = false;
+    float nearestDist = FLT_MAX;
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (isHit && entry.tEnter >= nearestDist) continue;
+        const BvhNode& node = bvh.nodes[entry.nodeIdx];
+
+        float tEnter[2];
+        bool isInnerHit[2] = { false, false };
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            Box box = getChildBox(node, slot);
+            if (!intersectRayBox(originArr, invDir, box.min, box.max, nearestDist, &tEnter[slot])) continue;
+            // Only a strictly nearer box replaces the hit, so the children entered at nearestDist are skipped too.
+            if (isHit && tEnter[slot] >= nearestDist) continue;
+            if (!isLeafChild(node, slot)) {
+                isInnerHit[slot] = true;
+                continue;
+            }
+            for (UINT k = node.childIdx[slot]; k < node.childIdx[slot] + node.childCount[slot]; ++k) {
+                Box primBox = getPrimBox(bvh.primBounds[k]);
+                float t;
+                if (intersectRayBox(originArr, invDir, primBox.min, primBox.max, nearestDist, &t) && (!isHit || t < nearestDist)) {
+                    isHit = true;
+                    nearestDist = t;
+                    *pIdx = bvh.primIdx[k];
+                }
+            }
+        }
+        // Push the farther child first, so the nearer one is visited first and shrinks nearestDist earlier.
+        int nearSlot = isInnerHit[0] && isInnerHit[1] && tEnter[1] < tEnter[0] ? 1 : 0;
+        int farSlot = 1 - nearSlot;
+        if (isInnerHit[farSlot]) stack[stackSize++] = { node.childIdx[farSlot], tEnter[farSlot] };
+        if (isInnerHit[nearSlot]) stack[stackSize++] = { node.childIdx[nearSlot], tEnter[nearSlot] };
+    }
+    if (isHit) *pDist = nearestDist;
+    return isHit;
+}
+
+void queryBvhSphere(const Bvh& bvh, XMFLOAT3 center, float radius, std::vector<UINT>* result) {
+    float c[3] = { center.x, center.y, center.z };
+    float radiusSq = radius * radius;
+    queryBvhOverlap(bvh, [&](const float* boxMin, const float* boxMax) {
+        float distSq = 0.0f;
+        for (int a = 0; a < 3; ++a) {
+            float gap = (std::max)((std::max)(boxMin[a] - c[a], c[a] - boxMax[a]), 0.0f);
+            distSq += gap * gap;
+        }
+        return distSq <= radiusSq;
+    }, result);
+}
+
+void queryBvhBox(const Bvh& bvh, XMFLOAT3 boxMin, XMFLOAT3 boxMax, std::vector<UINT>* result) {
+    float qMin[3] = { boxMin.x, boxMin.y, boxMin.z };
+    float qMax[3] = { boxMax.x, boxMax.y, boxMax.z };
+    queryBvhOverlap(bvh, [&](const float* nodeMin, const float* nodeMax) {
+        for (int a = 0; a < 3; ++a) {
+            if (nodeMin[a] > qMax[a] || nodeMax[a] < qMin[a]) return false;
+        }
+        return true;
+    }, result);
+}
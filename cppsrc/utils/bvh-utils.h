@@ -0,0 +1,49 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "d3dcore/bvh.h"
+#include "d3dcore/cull-bounds.h"
+
+// These funcs do not depend on D3DCore, see updateRitemBvh in frame-async-utils.h for the usage.
+// The leaves test the boxes of their primitives one by one (copied into Bvh::primBounds by the build and the refit),
+// so the queries return exactly the primitives whose own boxes pass, e.g. cullBvh reports the same boxes as
+// cullBoundsSoA (in a different order).
+
+// Binned SAH build over the boxes of bounds. The top levels are split with parallel binning, and the subtrees
+// below are built in parallel with parallelFor (See thread-utils.h). The boxes with infinite extents are put
+// into unboundedIdx instead.
+void buildBvh(const BoundsSoA& bounds, UINT maxLeafSize, Bvh* bvh);
+
+// Update the node bounds after the boxes move, and keep the topology. The subtrees are refit in parallel.
+// Return FALSE if the box count changes or any box changes between bounded and unbounded, and then the tree
+// must be built again. Note the quality of the tree decreases as the boxes move further from where they were
+// at the build.
+bool refitBvh(const BoundsSoA& bounds, Bvh* bvh);
+
+// SAH cost of the tree relative to the root area (a traversal step costs 1, so does a primitive test).
+float calcBvhSahCost(const Bvh& bvh);
+
+// Write the indices of the boxes intersecting the frustum into visibleIdx, which must hold primCount
+// indices, and return the count. The unbounded boxes are always visible. The nodes entirely inside the
+// frustum are reported without further tests.
+size_t cullBvh(const Bvh& bvh, const Frustum& frustum, UINT* visibleIdx);
+
+// Find the nearest box hit by the ray, and return FALSE if there is none. The distance is in the units of dir,
+// and it is 0 if the origin is inside the box. The unbounded boxes are never hit.
+bool XM_CALLCONV pickBvh(const Bvh& bvh, FXMVECTOR origin, FXMVECTOR dir, UINT* pIdx, float* pDist);
+
+// The indices of the boxes overlapping the sphere are written into result, which is cleared first.
+// The unbounded boxes are always included.
+void queryBvhSphere(const Bvh& bvh, XMFLOAT3 center, float radius, std::vector<UINT>* result);
+
+// Same as queryBvhSphere for a box given by its min and max corners.
+void queryBvhBox(const Bvh& bvh, XMFLOAT3 boxMin, XMFLOAT3 boxMax, std::vector<UINT>* result);
@@ -0,0 +1,433 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <cstring>
+
+#include "cmd-stream-recorder.h"
+
+namespace {
+
+struct CmdHeader {
+    uint32_t type = 0;
+    uint32_t byteSize = 0; // Header, arguments and arrays (aligned to 8 bytes) included.
+};
+
+constexpr size_t CMD_ALIGNMENT = 8;
+
+constexpr size_t alignCmdSize(size_t size) { return (size + CMD_ALIGNMENT - 1) & ~(CMD_ALIGNMENT - 1); }
+
+// The array of a command starts right after its arguments.
+template <typename T, typename Args>
+T* cmdArray(Args* args) { return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(args) + alignCmdSize(sizeof(Args))); }
+template <typename T, typename Args>
+const T* cmdArray(const Args* args) { return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(args) + alignCmdSize(sizeof(Args))); }
+
+// The arguments are stored field by field into the zeroed stream (see appendCmd), so the paddings are
+// always zero and the same commands always give the same bytes.
+struct PointerArgs { void* ptr; };
+struct CountArgs { UINT count; };
+struct RootAddressArgs { UINT rootParamIdx; D3D12_GPU_VIRTUAL_ADDRESS addr; };
+struct RootTableArgs { UINT rootParamIdx; D3D12_GPU_DESCRIPTOR_HANDLE handle; };
+struct RootConstantsArgs { UINT rootParamIdx; UINT valueCount; UINT destOffset; };
+// The views can be nullptr to unbind the slots (or the index buffer), which is recorded as hasViews (hasView) of FALSE.
+struct VertexBuffersArgs { UINT startSlot; UINT viewCount; BOOL hasViews; };
+struct IndexBufferArgs { BOOL hasView; D3D12_INDEX_BUFFER_VIEW view; };
+struct TopologyArgs { D3D_PRIMITIVE_TOPOLOGY topology; };
+struct RenderTargetsArgs { UINT rtvCount; UINT recordedRtvCount; BOOL isSingleHandleToDescRange; BOOL hasDsv; D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle; };
+struct DrawIndexedArgs { UINT indexCount; UINT instanceCount; UINT startIndexLocation; INT baseVertexLocation; UINT startInstanceLocation; };
+struct DispatchArgs { UINT groupCountX; UINT groupCountY; UINT groupCountZ; };
+struct CopyArgs { ID3D12Resource* dest; ID3D12Resource* src; };
+struct ResolveArgs { ID3D12Resource* dest; UINT destSubresource; ID3D12Resource* src; UINT srcSubresource; DXGI_FORMAT format; };
+struct ClearRtvArgs { D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle; FLOAT color[4]; UINT rectCount; };
+struct ClearDsvArgs { D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle; D3D12_CLEAR_FLAGS clearFlags; FLOAT depth; UINT8 stencil; UINT rectCount; };
+struct EndQueryArgs { ID3D12QueryHeap* queryHeap; D3D12_QUERY_TYPE type; UINT index; };
+struct ResolveQueryArgs { ID3D12QueryHeap* queryHeap; D3D12_QUERY_TYPE type; UINT startIndex; UINT queryCount; ID3D12Resource* destBuff; UINT64 alignedDestBuffOffset; };
+
+}
+
+template <typename Args>
+Args* CmdStreamRecorder::appendCmd(CmdType type, size_t arraySize) {
+    size_t byteSize = alignCmdSize(sizeof(CmdHeader)) + alignCmdSize(sizeof(Args)) + alignCmdSize(arraySize);
+    size_t offset = _stream.size();
+    _stream.resize(offset + byteSize);
+
+    uint8_t* cmd = _stream.data() + offset;
+    auto header = reinterpret_cast<CmdHeader*>(cmd);
+    header->type = type;
+    header->byteSize = (uint32_t)byteSize;
+    ++_stats.cmdCount;
+    return reinterpret_cast<Args*>(cmd + alignCmdSize(sizeof(CmdHeader)));
+}
+
+void CmdStreamRecorder::reset() {
+    _stream.clear();
+    _stats = {};
+}
+
+void CmdStreamRecorder::replay(CmdRecorder* target) const {
+    size_t offset = 0;
+    while (offset < _stream.size()) {
+        auto header = reinterpret_cast<const CmdHeader*>(_stream.data() + offset);
+        const void* args = _stream.data() + offset + alignCmdSize(sizeof(CmdHeader));
+        offset += header->byteSize;
+
+        switch (header->type) {
+        case SET_PIPELINE_STATE:
+            target->SetPipelineState((ID3D12PipelineState*)((const PointerArgs*)args)->ptr);
+            break;
+        case SET_GRAPHICS_ROOT_SIGNATURE:
+            target->SetGraphicsRootSignature((ID3D12RootSignature*)((const PointerArgs*)args)->ptr);
+            break;
+        case SET_COMPUTE_ROOT_SIGNATURE:
+            target->SetComputeRootSignature((ID3D12RootSignature*)((const PointerArgs*)args)->ptr);
+            break;
+        case SET_DESCRIPTOR_HEAPS: {
+            auto cmd = (const CountArgs*)args;
+            target->SetDescriptorHeaps(cmd->count, cmdArray<ID3D12DescriptorHeap* const>(cmd));
+            break;
+        }
+        case SET_GRAPHICS_ROOT_CBV: {
+            auto cmd = (const RootAddressArgs*)args;
+            target->SetGraphicsRootConstantBufferView(cmd->rootParamIdx, cmd->addr);
+            break;
+        }
+        case SET_GRAPHICS_ROOT_SRV: {
+            auto cmd = (const RootAddressArgs*)args;
+            target->SetGraphicsRootShaderResourceView(cmd->rootParamIdx, cmd->addr);
+            break;
+        }
+        case SET_GRAPHICS_ROOT_DESCRIPTOR_TABLE: {
+            auto cmd = (const RootTableArgs*)args;
+            target->SetGraphicsRootDescriptorTable(cmd->rootParamIdx, cmd->handle);
+            break;
+        }
+        case SET_GRAPHICS_ROOT_32BIT_CONSTANTS: {
+            auto cmd = (const RootConstantsArgs*)args;
+            for (UINT i = 0; i < cmd->valueCount; ++i) {
+                target->SetGraphicsRoot32BitConstant(cmd->rootParamIdx, cmdArray<UINT>(cmd)[i], cmd->destOffset + i);
+            }
+            break;
+        }
+        case SET_COMPUTE_ROOT_DESCRIPTOR_TABLE: {
+            auto cmd = (const RootTableArgs*)args;
+            target->SetComputeRootDescriptorTable(cmd->rootParamIdx, cmd->handle);
+            break;
+        }
+        case SET_COMPUTE_ROOT_32BIT_CONSTANTS: {
+            auto cmd = (const RootConstantsArgs*)args;
+            target->SetComputeRoot32BitConstants(cmd->rootParamIdx, cmd->valueCount, cmdArray<UINT>(cmd), cmd->destOffset);
+            break;
+        }
+        case IA_SET_VERTEX_BUFFERS: {
+            auto cmd = (const VertexBuffersArgs*)args;
+            target->IASetVertexBuffers(cmd->startSlot, cmd->viewCount,
+                cmd->hasViews ? cmdArray<D3D12_VERTEX_BUFFER_VIEW>(cmd) : nullptr);
+            break;
+        }
+        case IA_SET_INDEX_BUFFER: {
+            auto cmd = (const IndexBufferArgs*)args;
+            target->IASetIndexBuffer(cmd->hasView ? &cmd->view : nullptr);
+            break;
+        }
+        case IA_SET_PRIMITIVE_TOPOLOGY:
+            target->IASetPrimitiveTopology(((const TopologyArgs*)args)->topology);
+            break;
+        case RS_SET_VIEWPORTS: {
+            auto cmd = (const CountArgs*)args;
+            target->RSSetViewports(cmd->count, cmdArray<D3D12_VIEWPORT>(cmd));
+            break;
+        }
+        case RS_SET_SCISSOR_RECTS: {
+            auto cmd = (const CountArgs*)args;
+            target->RSSetScissorRects(cmd->count, cmdArray<D3D12_RECT>(cmd));
+            break;
+        }
+        case OM_SET_RENDER_TARGETS: {
+            auto cmd = (const RenderTargetsArgs*)args;
+            target->OMSetRenderTargets(cmd->rtvCount,
+                cmd->recordedRtvCount > 0 ? cmdArray<D3D12_CPU_DESCRIPTOR_HANDLE>(cmd) : nullptr,
+                cmd->isSingleHandleToDescRange, cmd->hasDsv ? &cmd->dsvHandle : nullptr);
+            break;
+        }
+        case DRAW_INDEXED_INSTANCED: {
+            auto cmd = (const DrawIndexedArgs*)args;
+            target->DrawIndexedInstanced(cmd->indexCount, cmd->instanceCount,
+                cmd->startIndexLocation, cmd->baseVertexLocation, cmd->startInstanceLocation);
+            break;
+        }
+        case DISPATCH: {
+            auto cmd = (const DispatchArgs*)args;
+            target->Dispatch(cmd->groupCountX, cmd->groupCountY, cmd->groupCountZ);
+            break;
+        }
+        case RESOURCE_BARRIER: {
+            auto cmd = (const CountArgs*)args;
+            target->ResourceBarrier(cmd->count, cmdArray<D3D12_RESOURCE_BARRIER>(cmd));
+            break;
+        }
+        case COPY_RESOURCE: {
+            auto cmd = (const CopyArgs*)args;
+            target->CopyResource(cmd->dest, cmd->src);
+            break;
+        }
+        case RESOLVE_SUBRESOURCE: {
+            auto cmd = (const ResolveArgs*)args;
+            target->ResolveSubresource(cmd->dest, cmd->destSubresource, cmd->src, cmd->srcSubresource, cmd->format);
+            break;
+        }
+        case CLEAR_RENDER_TARGET_VIEW: {
+            auto cmd = (const ClearRtvArgs*)args;
+            target->ClearRenderTargetView(cmd->rtvHandle, cmd->color,
+                cmd->rectCount, cmd->rectCount > 0 ? cmdArray<D3D12_RECT>(cmd) : nullptr);
+            break;
+        }
+        case CLEAR_DEPTH_STENCIL_VIEW: {
+            auto cmd = (const ClearDsvArgs*)args;
+            target->ClearDepthStencilView(cmd->dsvHandle, cmd->clearFlags, cmd->depth, cmd->stencil,
+                cmd->rectCount, cmd->rectCount > 0 ? cmdArray<D3D12_RECT>(cmd) : nullptr);
+            break;
+        }
+        case END_QUERY: {
+            auto cmd = (const EndQueryArgs*)args;
+            target->EndQuery(cmd->queryHeap, cmd->type, cmd->index);
+            break;
+        }
+        case RESOLVE_QUERY_DATA: {
+            auto cmd = (const ResolveQueryArgs*)args;
+            target->ResolveQueryData(cmd->queryHeap, cmd->type, cmd->startIndex, cmd->queryCount,
+                cmd->destBuff, cmd->alignedDestBuffOffset);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+uint64_t CmdStreamRecorder::hash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : _stream) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void CmdStreamRecorder::SetPipelineState(ID3D12PipelineState* pso) {
+    appendCmd<PointerArgs>(SET_PIPELINE_STATE)->ptr = pso;
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::SetGraphicsRootSignature(ID3D12RootSignature* rootSig) {
+    appendCmd<PointerArgs>(SET_GRAPHICS_ROOT_SIGNATURE)->ptr = rootSig;
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::SetComputeRootSignature(ID3D12RootSignature* rootSig) {
+    appendCmd<PointerArgs>(SET_COMPUTE_ROOT_SIGNATURE)->ptr = rootSig;
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::SetDescriptorHeaps(UINT heapCount, ID3D12DescriptorHeap* const* heaps) {
+    auto cmd = appendCmd<CountArgs>(SET_DESCRIPTOR_HEAPS, heapCount * sizeof(ID3D12DescriptorHeap*));
+    cmd->count = heapCount;
+    memcpy(cmdArray<ID3D12DescriptorHeap*>(cmd), heaps, heapCount * sizeof(ID3D12DescriptorHeap*));
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::SetGraphicsRootConstantBufferView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) {
+    auto cmd = appendCmd<RootAddressArgs>(SET_GRAPHICS_ROOT_CBV);
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->addr = addr;
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::SetGraphicsRootShaderResourceView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) {
+    auto cmd = appendCmd<RootAddressArgs>(SET_GRAPHICS_ROOT_SRV);
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->addr = addr;
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::SetGraphicsRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) {
+    auto cmd = appendCmd<RootTableArgs>(SET_GRAPHICS_ROOT_DESCRIPTOR_TABLE);
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->handle = handle;
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::SetGraphicsRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) {
+    auto cmd = appendCmd<RootConstantsArgs>(SET_GRAPHICS_ROOT_32BIT_CONSTANTS, sizeof(UINT));
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->valueCount = 1;
+    cmd->destOffset = destOffset;
+    *cmdArray<UINT>(cmd) = data;
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::SetComputeRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) {
+    auto cmd = appendCmd<RootTableArgs>(SET_COMPUTE_ROOT_DESCRIPTOR_TABLE);
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->handle = handle;
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::SetComputeRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) {
+    SetComputeRoot32BitConstants(rootParamIdx, 1, &data, destOffset);
+}
+
+void CmdStreamRecorder::SetComputeRoot32BitConstants(UINT rootParamIdx, UINT valueCount, const void* data, UINT destOffset) {
+    auto cmd = appendCmd<RootConstantsArgs>(SET_COMPUTE_ROOT_32BIT_CONSTANTS, valueCount * sizeof(UINT));
+    cmd->rootParamIdx = rootParamIdx;
+    cmd->valueCount = valueCount;
+    cmd->destOffset = destOffset;
+    memcpy(cmdArray<UINT>(cmd), data, valueCount * sizeof(UINT));
+    ++_stats.rootBindingCount;
+}
+
+void CmdStreamRecorder::IASetVertexBuffers(UINT startSlot, UINT viewCount, const D3D12_VERTEX_BUFFER_VIEW* views) {
+    size_t arraySize = views != nullptr ? viewCount * sizeof(D3D12_VERTEX_BUFFER_VIEW) : 0;
+    auto cmd = appendCmd<VertexBuffersArgs>(IA_SET_VERTEX_BUFFERS, arraySize);
+    cmd->startSlot = startSlot;
+    cmd->viewCount = viewCount;
+    cmd->hasViews = views != nullptr;
+    if (views != nullptr) memcpy(cmdArray<D3D12_VERTEX_BUFFER_VIEW>(cmd), views, arraySize);
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) {
+    auto cmd = appendCmd<IndexBufferArgs>(IA_SET_INDEX_BUFFER);
+    cmd->hasView = view != nullptr;
+    if (view != nullptr) cmd->view = *view;
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) {
+    appendCmd<TopologyArgs>(IA_SET_PRIMITIVE_TOPOLOGY)->topology = topology;
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::RSSetViewports(UINT viewportCount, const D3D12_VIEWPORT* viewports) {
+    auto cmd = appendCmd<CountArgs>(RS_SET_VIEWPORTS, viewportCount * sizeof(D3D12_VIEWPORT));
+    cmd->count = viewportCount;
+    memcpy(cmdArray<D3D12_VIEWPORT>(cmd), viewports, viewportCount * sizeof(D3D12_VIEWPORT));
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::RSSetScissorRects(UINT rectCount, const D3D12_RECT* rects) {
+    auto cmd = appendCmd<CountArgs>(RS_SET_SCISSOR_RECTS, rectCount * sizeof(D3D12_RECT));
+    cmd->count = rectCount;
+    memcpy(cmdArray<D3D12_RECT>(cmd), rects, rectCount * sizeof(D3D12_RECT));
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::OMSetRenderTargets(UINT rtvCount, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvHandles,
+    BOOL isSingleHandleToDescRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsvHandle)
+{
+    // Only the first handle is read if the handles are a range of contiguous descriptors.
+    UINT recordedRtvCount = rtvHandles == nullptr ? 0 : (isSingleHandleToDescRange && rtvCount > 0 ? 1 : rtvCount);
+    auto cmd = appendCmd<RenderTargetsArgs>(OM_SET_RENDER_TARGETS, recordedRtvCount * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+    cmd->rtvCount = rtvCount;
+    cmd->recordedRtvCount = recordedRtvCount;
+    cmd->isSingleHandleToDescRange = isSingleHandleToDescRange;
+    cmd->hasDsv = dsvHandle != nullptr;
+    if (dsvHandle != nullptr) cmd->dsvHandle = *dsvHandle;
+    memcpy(cmdArray<D3D12_CPU_DESCRIPTOR_HANDLE>(cmd), rtvHandles, recordedRtvCount * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+    ++_stats.stateChangeCount;
+}
+
+void CmdStreamRecorder::DrawIndexedInstanced(UINT indexCount, UINT instanceCount,
+    UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+    auto cmd = appendCmd<DrawIndexedArgs>(DRAW_INDEXED_INSTANCED);
+    cmd->indexCount = indexCount;
+    cmd->instanceCount = instanceCount;
+    cmd->startIndexLocation = startIndexLocation;
+    cmd->baseVertexLocation = baseVertexLocation;
+    cmd->startInstanceLocation = startInstanceLocation;
+    ++_stats.drawCount;
+}
+
+void CmdStreamRecorder::Dispatch(UINT groupCountX, UINT groupCountY, UINT groupCountZ) {
+    auto cmd = appendCmd<DispatchArgs>(DISPATCH);
+    cmd->groupCountX = groupCountX;
+    cmd->groupCountY = groupCountY;
+    cmd->groupCountZ = groupCountZ;
+    ++_stats.dispatchCount;
+}
+
+void CmdStreamRecorder::ResourceBarrier(UINT barrierCount, const D3D12_RESOURCE_BARRIER* barriers) {
+    auto cmd = appendCmd<CountArgs>(RESOURCE_BARRIER, barrierCount * sizeof(D3D12_RESOURCE_BARRIER));
+    cmd->count = barrierCount;
+    memcpy(cmdArray<D3D12_RESOURCE_BARRIER>(cmd), barriers, barrierCount * sizeof(D3D12_RESOURCE_BARRIER));
+    _stats.barrierCount += barrierCount;
+}
+
+void CmdStreamRecorder::CopyResource(ID3D12Resource* dest, ID3D12Resource* src) {
+    auto cmd = appendCmd<CopyArgs>(COPY_RESOURCE);
+    cmd->dest = dest;
+    cmd->src = src;
+    ++_stats.resourceCmdCount;
+}
+
+void CmdStreamRecorder::ResolveSubresource(ID3D12Resource* dest, UINT destSubresource,
+    ID3D12Resource* src, UINT srcSubresource, DXGI_FORMAT format)
+{
+    auto cmd = appendCmd<ResolveArgs>(RESOLVE_SUBRESOURCE);
+    cmd->dest = dest;
+    cmd->destSubresource = destSubresource;
+    cmd->src = src;
+    cmd->srcSubresource = srcSubresource;
+    cmd->format = format;
+    ++_stats.resourceCmdCount;
+}
+
+void CmdStreamRecorder::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, const FLOAT color[4],
+    UINT rectCount, const D3D12_RECT* rects)
+{
+    auto cmd = appendCmd<ClearRtvArgs>(CLEAR_RENDER_TARGET_VIEW, rectCount * sizeof(D3D12_RECT));
+    cmd->rtvHandle = rtvHandle;
+    memcpy(cmd->color, color, sizeof(cmd->color));
+    cmd->rectCount = rectCount;
+    if (rectCount > 0) memcpy(cmdArray<D3D12_RECT>(cmd), rects, rectCount * sizeof(D3D12_RECT));
+    ++_stats.resourceCmdCount;
+}
+
+void CmdStreamRecorder::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, D3D12_CLEAR_FLAGS clearFlags,
+    FLOAT depth, UINT8 stencil, UINT rectCount, const D3D12_RECT* rects)
+{
+    auto cmd = appendCmd<ClearDsvArgs>(CLEAR_DEPTH_STENCIL_VIEW, rectCount * sizeof(D3D12_RECT));
+    cmd->dsvHandle = dsvHandle;
+    cmd->clearFlags = clearFlags;
+    cmd->depth = depth;
+    cmd->stencil = stencil;
+    cmd->rectCount = rectCount;
+    if (rectCount > 0) memcpy(cmdArray<D3D12_RECT>(cmd), rects, rectCount * sizeof(D3D12_RECT));
+    ++_stats.resourceCmdCount;
+}
+
+void CmdStreamRecorder::EndQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT index) {
+    auto cmd = appendCmd<EndQueryArgs>(END_QUERY);
+    cmd->queryHeap = queryHeap;
+    cmd->type = type;
+    cmd->index = index;
+    ++_stats.queryCmdCount;
+}
+
+void CmdStreamRecorder::ResolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT startIndex, UINT queryCount,
+    ID3D12Resource* destBuff, UINT64 alignedDestBuffOffset)
+{
+    auto cmd = appendCmd<ResolveQueryArgs>(RESOLVE_QUERY_DATA);
+    cmd->queryHeap = queryHeap;
+    cmd->type = type;
+    cmd->startIndex = startIndex;
+    cmd->queryCount = queryCount;
+    cmd->destBuff = destBuff;
+    cmd->alignedDestBuffOffset = alignedDestBuffOffset;
+    ++_stats.queryCmdCount;
+}
@@ -0,0 +1,135 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "d3dcore/cmd-recorder.h"
+
+// Backend of CmdRecorder which records the commands into one linear buffer instead of a command list,
+// so the frame code can run without any device, e.g. to measure the CPU cost of a frame on a GPU-less
+// box (see benchmark/frame-cpu-benchmark.h). Like RingAllocator, it does not call any Windows API.
+//
+// Every command is a header (type and size) followed by its arguments and arrays, e.g. the barriers,
+// which are all copied, so the stream can be replayed into any other backend after the sources are gone.
+// The pointers (resources, heaps, PSOs etc.) are recorded as they are, i.e. they must be still alive
+// when replayed into D3D12CmdRecorder.
+class CmdStreamRecorder final : public CmdRecorder {
+public:
+    enum CmdType : uint32_t {
+        SET_PIPELINE_STATE,
+        SET_GRAPHICS_ROOT_SIGNATURE,
+        SET_COMPUTE_ROOT_SIGNATURE,
+        SET_DESCRIPTOR_HEAPS,
+        SET_GRAPHICS_ROOT_CBV,
+        SET_GRAPHICS_ROOT_SRV,
+        SET_GRAPHICS_ROOT_DESCRIPTOR_TABLE,
+        SET_GRAPHICS_ROOT_32BIT_CONSTANTS,
+        SET_COMPUTE_ROOT_DESCRIPTOR_TABLE,
+        SET_COMPUTE_ROOT_32BIT_CONSTANTS, // Both SetComputeRoot32BitConstant and SetComputeRoot32BitConstants.
+        IA_SET_VERTEX_BUFFERS,
+        IA_SET_INDEX_BUFFER,
+        IA_SET_PRIMITIVE_TOPOLOGY,
+        RS_SET_VIEWPORTS,
+        RS_SET_SCISSOR_RECTS,
+        OM_SET_RENDER_TARGETS,
+        DRAW_INDEXED_INSTANCED,
+        DISPATCH,
+        RESOURCE_BARRIER,
+        COPY_RESOURCE,
+        RESOLVE_SUBRESOURCE,
+        CLEAR_RENDER_TARGET_VIEW,
+        CLEAR_DEPTH_STENCIL_VIEW,
+        END_QUERY,
+        RESOLVE_QUERY_DATA,
+        CMD_TYPE_COUNT
+    };
+
+    struct Stats {
+        uint64_t cmdCount = 0;
+        // PSOs, root signatures, descriptor heaps, IA, RS and OM states.
+        uint64_t stateChangeCount = 0;
+        // Root CBVs, SRVs, descriptor tables and constants.
+        uint64_t rootBindingCount = 0;
+        uint64_t drawCount = 0;
+        uint64_t dispatchCount = 0;
+        // Count of the barriers instead of the ResourceBarrier calls.
+        uint64_t barrierCount = 0;
+        // Copies, resolves and clears.
+        uint64_t resourceCmdCount = 0;
+        // EndQuery and ResolveQueryData calls.
+        uint64_t queryCmdCount = 0;
+    };
+
+    CmdStreamRecorder() = default;
+    // Reserve the stream of byteSize bytes, e.g. the size of the last frame.
+    explicit CmdStreamRecorder(size_t byteSize) { _stream.reserve(byteSize); }
+
+    // Clear the commands and statistics, but keep the memory of the stream.
+    void reset();
+
+    // Call the methods of target in the recorded order with the recorded arguments, so replaying into
+    // another CmdStreamRecorder gives the same stream.
+    void replay(CmdRecorder* target) const;
+
+    inline const uint8_t* data() const { return _stream.data(); }
+    inline size_t byteSize() const { return _stream.size(); }
+    inline const Stats& stats() const { return _stats; }
+
+    // 64-bit FNV-1a hash of the stream, e.g. to check two recordings of a frame are the same.
+    uint64_t hash() const;
+
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSig) override;
+    void SetComputeRootSignature(ID3D12RootSignature* rootSig) override;
+    void SetDescriptorHeaps(UINT heapCount, ID3D12DescriptorHeap* const* heaps) override;
+
+    void SetGraphicsRootConstantBufferView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) override;
+    void SetGraphicsRootShaderResourceView(UINT rootParamIdx, D3D12_GPU_VIRTUAL_ADDRESS addr) override;
+    void SetGraphicsRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) override;
+    void SetGraphicsRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) override;
+    void SetComputeRootDescriptorTable(UINT rootParamIdx, D3D12_GPU_DESCRIPTOR_HANDLE handle) override;
+    void SetComputeRoot32BitConstant(UINT rootParamIdx, UINT data, UINT destOffset) override;
+    void SetComputeRoot32BitConstants(UINT rootParamIdx, UINT valueCount, const void* data, UINT destOffset) override;
+
+    void IASetVertexBuffers(UINT startSlot, UINT viewCount, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+    void IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY topology) override;
+    void RSSetViewports(UINT viewportCount, const D3D12_VIEWPORT* viewports) override;
+    void RSSetScissorRects(UINT rectCount, const D3D12_RECT* rects) override;
+    void OMSetRenderTargets(UINT rtvCount, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvHandles,
+        BOOL isSingleHandleToDescRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsvHandle) override;
+
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override;
+    void Dispatch(UINT groupCountX, UINT groupCountY, UINT groupCountZ) override;
+
+    void ResourceBarrier(UINT barrierCount, const D3D12_RESOURCE_BARRIER* barriers) override;
+    void CopyResource(ID3D12Resource* dest, ID3D12Resource* src) override;
+    void ResolveSubresource(ID3D12Resource* dest, UINT destSubresource,
+        ID3D12Resource* src, UINT srcSubresource, DXGI_FORMAT format) override;
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, const FLOAT color[4],
+        UINT rectCount, const D3D12_RECT* rects) override;
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT rectCount, const D3D12_RECT* rects) override;
+
+    void EndQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT index) override;
+    void ResolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, UINT startIndex, UINT queryCount,
+        ID3D12Resource* destBuff, UINT64 alignedDestBuffOffset) override;
+
+private:
+    // Append a command of the fixed arguments Args followed by arraySize bytes, and return the arguments,
+    // which are valid until the next command is appended.
+    template <typename Args>
+    Args* appendCmd(CmdType type, size_t arraySize = 0);
+
+    std::vector<uint8_t> _stream = {};
+    Stats _stats = {};
+};
@@ -0,0 +1,188 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "culling-utils.h"
+
+void calcVertexBounds(const Vertex* vertices, size_t vertexCount, XMFLOAT3* pCenter, XMFLOAT3* pExtents) {
+    if (vertexCount == 0) {
+        *pCenter = *pExtents = { 0.0f, 0.0f, 0.0f };
+        return;
+    }
+    XMVECTOR minPos = XMLoadFloat3(&vertices[0].pos);
+    XMVECTOR maxPos = minPos;
+    for (size_t i = 1; i < vertexCount; ++i) {
+        XMVECTOR pos = XMLoadFloat3(&vertices[i].pos);
+        minPos = XMVectorMin(minPos, pos);
+        maxPos = XMVectorMax(maxPos, pos);
+    }
+    XMStoreFloat3(pCenter, XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f));
+    XMStoreFloat3(pExtents, XMVectorScale(XMVectorSubtract(maxPos, minPos), 0.5f));
+}
+
+void XM_CALLCONV transformBounds(FXMMATRIX trans, XMFLOAT3 center, XMFLOAT3 extents, XMFLOAT3* pCenter, XMFLOAT3* pExtents) {
+    // The extents of the transformed box are the extents projected onto every axis by the absolute matrix.
+    XMVECTOR e = XMLoadFloat3(&extents);
+    XMVECTOR newExtents = XMVectorMultiply(XMVectorSplatX(e), XMVectorAbs(trans.r[0]));
+    newExtents = XMVectorMultiplyAdd(XMVectorSplatY(e), XMVectorAbs(trans.r[1]), newExtents);
+    newExtents = XMVectorMultiplyAdd(XMVectorSplatZ(e), XMVectorAbs(trans.r[2]), newExtents);
+    XMStoreFloat3(pCenter, XMVector3Transform(XMLoadFloat3(&center), trans));
+    XMStoreFloat3(pExtents, newExtents);
+}
+
+void calcRitemWorldBounds(const RenderItem* ritem, XMFLOAT3* pCenter, XMFLOAT3* pExtents) {
+    if (!ritem->hasBounds || ritem->isDynamic || (ritem->constData.empty() && ritem->instances.empty())) {
+        *pCenter = { 0.0f, 0.0f, 0.0f };
+        *pExtents = { FLT_MAX, FLT_MAX, FLT_MAX };
+        return;
+    }
+    // The world matrices are stored transposed for the shaders.
+    if (ritem->instances.empty()) {
+        XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&ritem->constData[0].worldTrans));
+        transformBounds(world, ritem->boundsCenter, ritem->boundsExtents, pCenter, pExtents);
+        return;
+    }
+    XMVECTOR minPos = XMVectorReplicate(FLT_MAX), maxPos = XMVectorReplicate(-FLT_MAX);
+    for (auto& instance : ritem->instances) {
+        XMFLOAT3 center, extents;
+        XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&instance.worldTrans));
+        transformBounds(world, ritem->boundsCenter, ritem->boundsExtents, &center, &extents);
+        XMVECTOR c = XMLoadFloat3(&center), e = XMLoadFloat3(&extents);
+        minPos = XMVectorMin(minPos, XMVectorSubtract(c, e));
+        maxPos = XMVectorMax(maxPos, XMVectorAdd(c, e));
+    }
+    XMStoreFloat3(pCenter, XMVectorScale(XMVectorAdd(minPos, maxPos), 0.5f));
+    XMStoreFloat3(pExtents, XMVectorScale(XMVectorSubtract(maxPos, minPos), 0.5f));
+}
+
+void resizeBoundsSoA(size_t count, BoundsSoA* bounds) {
+    size_t paddedCount = (count + 7) & ~(size_t)7;
+    bounds->count = count;
+    bounds->centerX.resize(paddedCount, 0.0f);
+    bounds->centerY.resize(paddedCount, 0.0f);
+    bounds->centerZ.resize(paddedCount, 0.0f);
+    bounds->extentX.resize(paddedCount, FLT_MAX);
+    bounds->extentY.resize(paddedCount, FLT_MAX);
+    bounds->extentZ.resize(paddedCount, FLT_MAX);
+}
+
+void setBoundsSoAEntry(size_t idx, XMFLOAT3 center, XMFLOAT3 extents, BoundsSoA* bounds) {
+    bounds->centerX[idx] = center.x;
+    bounds->centerY[idx] = center.y;
+    bounds->centerZ[idx] = center.z;
+    bounds->extentX[idx] = extents.x;
+    bounds->extentY[idx] = extents.y;
+    bounds->extentZ[idx] = extents.z;
+}
+
+void XM_CALLCONV extractFrustumPlanes(FXMMATRIX viewProj, Frustum* frustum) {
+    // clip = v * viewProj, so the rows of the transposed matrix give the clip coordinates,
+    // and a point is inside if -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    XMMATRIX cols = XMMatrixTranspose(viewProj);
+    XMVECTOR planes[6] = {
+        XMVectorAdd(cols.r[3], cols.r[0]),
+        XMVectorSubtract(cols.r[3], cols.r[0]),
+        XMVectorAdd(cols.r[3], cols.r[1]),
+        XMVectorSubtract(cols.r[3], cols.r[1]),
+        cols.r[2],
+        XMVectorSubtract(cols.r[3], cols.r[2])
+    };
+    for (int i = 0; i < 6; ++i) {
+        XMStoreFloat4(&frustum->planes[i], XMPlaneNormalize(planes[i]));
+    }
+}
+
+namespace {
+
+// Every component of the planes splatted into a whole vector.
+struct SplattedPlanes {
+    XMVECTOR x[6], y[6], z[6], w[6];
+    XMVECTOR absX[6], absY[6], absZ[6];
+};
+
+void splatPlanes(const Frustum& frustum, SplattedPlanes* sp) {
+    for (int p = 0; p < 6; ++p) {
+        const XMFLOAT4& plane = frustum.planes[p];
+        sp->x[p] = XMVectorReplicate(plane.x);
+        sp->y[p] = XMVectorReplicate(plane.y);
+        sp->z[p] = XMVectorReplicate(plane.z);
+        sp->w[p] = XMVectorReplicate(plane.w);
+        sp->absX[p] = XMVectorReplicate(fabsf(plane.x));
+        sp->absY[p] = XMVectorReplicate(fabsf(plane.y));
+        sp->absZ[p] = XMVectorReplicate(fabsf(plane.z));
+    }
+}
+
+// All bits set for the boxes of the 4 lanes not entirely outside of any plane, i.e. the signed distance of the
+// center plus the projected radius of the extents is not negative for all planes.
+XMVECTOR XM_CALLCONV testBoundsX4(const SplattedPlanes& sp, const BoundsSoA& bounds, size_t i) {
+    XMVECTOR cx = XMLoadFloat4((const XMFLOAT4*)&bounds.centerX[i]);
+    XMVECTOR cy = XMLoadFloat4((const XMFLOAT4*)&bounds.centerY[i]);
+    XMVECTOR cz = XMLoadFloat4((const XMFLOAT4*)&bounds.centerZ[i]);
+    XMVECTOR ex = XMLoadFloat4((const XMFLOAT4*)&bounds.extentX[i]);
+    XMVECTOR ey = XMLoadFloat4((const XMFLOAT4*)&bounds.extentY[i]);
+    XMVECTOR ez = XMLoadFloat4((const XMFLOAT4*)&bounds.extentZ[i]);
+
+    XMVECTOR zero = XMVectorZero();
+    XMVECTOR inside = XMVectorTrueInt();
+    for (int p = 0; p < 6; ++p) {
+        XMVECTOR d = XMVectorMultiplyAdd(cx, sp.x[p], XMVectorMultiplyAdd(cy, sp.y[p], XMVectorMultiplyAdd(cz, sp.z[p], sp.w[p])));
+        XMVECTOR r = XMVectorMultiplyAdd(ex, sp.absX[p], XMVectorMultiplyAdd(ey, sp.absY[p], XMVectorMultiply(ez, sp.absZ[p])));
+        inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorAdd(d, r), zero));
+    }
+    return inside;
+}
+
+// Append the indices of the lanes with the mask set. The index is always written and the count is
+// advanced by the mask bit, so there are no branches to mispredict.
+inline size_t appendVisibleX4(XMVECTOR inside, UINT32 firstIdx, UINT32* visibleIdx, size_t visibleCount) {
+    UINT32 mask[4];
+    XMStoreInt4(mask, inside);
+    for (UINT32 k = 0; k < 4; ++k) {
+        visibleIdx[visibleCount] = firstIdx + k;
+        visibleCount += mask[k] & 1;
+    }
+    return visibleCount;
+}
+
+// The padding boxes are infinite, and they are always at the end.
+inline size_t trimPaddingIdx(const BoundsSoA& bounds, const UINT32* visibleIdx, size_t visibleCount) {
+    while (visibleCount > 0 && visibleIdx[visibleCount - 1] >= bounds.count) --visibleCount;
+    return visibleCount;
+}
+
+}
+
+size_t cullBoundsSoA(const Frustum& frustum, const BoundsSoA& bounds, UINT32* visibleIdx) {
+    SplattedPlanes sp;
+    splatPlanes(frustum, &sp);
+
+    size_t visibleCount = 0;
+    size_t paddedCount = bounds.centerX.size();
+    for (size_t i = 0; i < paddedCount; i += 8) {
+        // The 2 groups are independent, which hides the latency of the multiply-adds.
+        XMVECTOR inside0 = testBoundsX4(sp, bounds, i);
+        XMVECTOR inside1 = testBoundsX4(sp, bounds, i + 4);
+        visibleCount = appendVisibleX4(inside0, (UINT32)i, visibleIdx, visibleCount);
+        visibleCount = appendVisibleX4(inside1, (UINT32)i + 4, visibleIdx, visibleCount);
+    }
+    return trimPaddingIdx(bounds, visibleIdx, visibleCount);
+}
+
+size_t cullBoundsSoAScalar(const Frustum& frustum, const BoundsSoA& bounds, UINT32* visibleIdx) {
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < bounds.centerX.size(); ++i) {
+        XMFLOAT3 center = { bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+        XMFLOAT3 extents = { bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+        if (isBoundsInFrustum(frustum, center, extents)) visibleIdx[visibleCount++] = (UINT32)i;
+    }
+    return trimPaddingIdx(bounds, visibleIdx, visibleCount);
+}
@@ -0,0 +1,54 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cmath>
+#include <d3d12.h>
+
+#include "d3dcore/cull-bounds.h"
+#include "d3dcore/frame-async.h"
+
+// These funcs do not depend on D3DCore, see cullRenderItems in frame-async-utils.h for the usage.
+
+// Local-space bounds of the vertices. The extents are half of the box sizes.
+void calcVertexBounds(const Vertex* vertices, size_t vertexCount, XMFLOAT3* pCenter, XMFLOAT3* pExtents);
+
+// Bounds of the transformed box, which cover all 8 transformed corners.
+void XM_CALLCONV transformBounds(FXMMATRIX trans, XMFLOAT3 center, XMFLOAT3 extents, XMFLOAT3* pCenter, XMFLOAT3* pExtents);
+
+// World-space bounds of the render item, i.e. the local bounds moved by the world matrix of the first seat,
+// or the union of all instances of an instanced render item. The render items without bounds (or dynamic
+// ones, whose meshes change every frame) get infinite bounds, which are never culled.
+void calcRitemWorldBounds(const RenderItem* ritem, XMFLOAT3* pCenter, XMFLOAT3* pExtents);
+
+// The old boxes are kept, and the new ones are infinite.
+void resizeBoundsSoA(size_t count, BoundsSoA* bounds);
+
+void setBoundsSoAEntry(size_t idx, XMFLOAT3 center, XMFLOAT3 extents, BoundsSoA* bounds);
+
+// The planes are extracted from the columns of viewProj (row vectors, D3D depth in [0, 1]) and normalized.
+void XM_CALLCONV extractFrustumPlanes(FXMMATRIX viewProj, Frustum* frustum);
+
+// Write the indices of the boxes intersecting the frustum in ascending order into visibleIdx, which must hold
+// bounds.centerX.size() (the padded count) indices. Return the count. 8 boxes are tested per iteration as 2
+// groups of XMVECTOR, and a box is culled only if it is entirely outside of any plane, i.e. it is conservative.
+size_t cullBoundsSoA(const Frustum& frustum, const BoundsSoA& bounds, UINT32* visibleIdx);
+
+// Reference of cullBoundsSoA with the same arithmetic, one box at a time.
+size_t cullBoundsSoAScalar(const Frustum& frustum, const BoundsSoA& bounds, UINT32* visibleIdx);
+
+// The test of a single box in cullBoundsSoAScalar, which is also used by the leaves of the BVH (See bvh-utils.h).
+inline bool isBoundsInFrustum(const Frustum& frustum, const XMFLOAT3& center, const XMFLOAT3& extents) {
+    bool inside = true;
+    for (auto& plane : frustum.planes) {
+        float d = center.x * plane.x + (center.y * plane.y + (center.z * plane.z + plane.w));
+        float r = extents.x * fabsf(plane.x) + (extents.y * fabsf(plane.y) + extents.z * fabsf(plane.z));
+        inside = inside && d + r >= 0.0f;
+    }
+    return inside;
+}
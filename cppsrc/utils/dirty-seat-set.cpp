@@ -0,0 +1,75 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <bit>
+
+#include "dirty-seat-set.h"
+
+void DirtySeatSet::reset(uint32_t seatCount) {
+    _seatCount = seatCount;
+    _words.assign((seatCount + 63) / 64, 0);
+    _markedBegin = _markedEnd = 0;
+}
+
+void DirtySeatSet::mark(uint32_t first, uint32_t count) {
+    if (first >= _seatCount || count == 0) return;
+    uint32_t last = (std::min)(first + (count - 1), _seatCount - 1);
+
+    size_t firstWord = first / 64;
+    size_t lastWord = last / 64;
+    uint64_t firstMask = ~0ull << (first % 64);
+    uint64_t lastMask = ~0ull >> (63 - last % 64);
+    if (firstWord == lastWord) {
+        _words[firstWord] |= firstMask & lastMask;
+    }
+    else {
+        _words[firstWord] |= firstMask;
+        std::fill(_words.begin() + firstWord + 1, _words.begin() + lastWord, ~0ull);
+        _words[lastWord] |= lastMask;
+    }
+
+    if (empty()) {
+        _markedBegin = firstWord;
+        _markedEnd = lastWord + 1;
+    }
+    else {
+        _markedBegin = (std::min)(_markedBegin, firstWord);
+        _markedEnd = (std::max)(_markedEnd, lastWord + 1);
+    }
+}
+
+void DirtySeatSet::clear() {
+    if (empty()) return;
+    std::fill(_words.begin() + _markedBegin, _words.begin() + _markedEnd, 0);
+    _markedBegin = _markedEnd = 0;
+}
+
+bool DirtySeatSet::findRange(uint32_t seat, uint32_t* pFirst, uint32_t* pCount) const {
+    size_t w = (std::max)((size_t)(seat / 64), _markedBegin);
+    if (w >= _markedEnd) return false;
+
+    // Find the first dirty seat.
+    uint64_t bits = _words[w];
+    if (w == seat / 64) bits &= ~0ull << (seat % 64);
+    while (bits == 0) {
+        if (++w >= _markedEnd) return false;
+        bits = _words[w];
+    }
+    uint32_t first = (uint32_t)(w * 64 + std::countr_zero(bits));
+
+    // Find the first clean seat after it, which can be in the following words.
+    // The bits out of [0, seatCount) are never set, so the range always ends in the set.
+    bits = ~_words[w] & (~0ull << (first % 64));
+    while (bits == 0 && ++w < _markedEnd) bits = ~_words[w];
+    uint32_t end = w < _markedEnd ? (uint32_t)(w * 64 + std::countr_zero(bits)) : (uint32_t)(_markedEnd * 64);
+
+    *pFirst = first;
+    *pCount = (std::min)(end, _seatCount) - first;
+    return true;
+}
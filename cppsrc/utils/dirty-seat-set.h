@@ -0,0 +1,51 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bitset of the dirty seats in a constant buffer, e.g. the object constants buffer of a frame resource.
+// The dirty seats are walked as ranges of contiguous seats, so the writes can be coalesced into large copies.
+// It only does the bookkeeping and does not depend on D3DCore or any Windows API.
+//
+// Usage:
+//     uint32_t first = 0, count = 0;
+//     for (uint32_t seat = 0; set.findRange(seat, &first, &count); seat = first + count) { /* write */ }
+//     set.clear();
+class DirtySeatSet {
+public:
+    DirtySeatSet() = default;
+    explicit DirtySeatSet(uint32_t seatCount) { reset(seatCount); }
+
+    // Change the seat count, and all seats become clean.
+    void reset(uint32_t seatCount);
+
+    // Seats out of [0, seatCount) are ignored.
+    void mark(uint32_t first, uint32_t count);
+    inline void markAll() { mark(0, _seatCount); }
+
+    // Only the words that have been marked since the last clear are touched.
+    void clear();
+
+    // Find the first range of dirty seats at or after seat. The range is as long as possible,
+    // i.e. the seats just before and after it are clean. Return false if there is no dirty seat.
+    bool findRange(uint32_t seat, uint32_t* pFirst, uint32_t* pCount) const;
+
+    inline uint32_t seatCount() const { return _seatCount; }
+    inline bool empty() const { return _markedBegin >= _markedEnd; }
+
+private:
+    uint32_t _seatCount = 0;
+    std::vector<uint64_t> _words = {};
+
+    // Only the words in [_markedBegin, _markedEnd) can have dirty bits.
+    size_t _markedBegin = 0;
+    size_t _markedEnd = 0;
+};
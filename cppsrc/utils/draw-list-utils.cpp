@@ -0,0 +1,84 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "draw-list-utils.h"
+
+bool isBlendedRitemLayer(const std::string& layerName) {
+    // See createPSOs in d3dcore.cpp, planar_shadow is derived from alpha.
+    return layerName == "alpha" || layerName == "alpha_instanced" || layerName == "alpha_cartoon" ||
+        layerName == "planar_shadow";
+}
+
+void compileDrawList(const std::string& layerName, RenderItem* const* ppRitem, size_t ritemCount,
+    UINT objConstSeatSize, DrawList* drawList)
+{
+    drawList->packets.clear();
+    drawList->packets.reserve(ritemCount);
+
+    // The IDs are given in the order of the first appearance.
+    std::unordered_map<ID3D12DescriptorHeap*, UINT64> descHeapIds = { { nullptr, 0 } };
+    std::unordered_map<D3D12_GPU_VIRTUAL_ADDRESS, UINT64> buffBindingIds = {};
+    UINT64 nextBuffBindingId = 0;
+
+    for (size_t i = 0; i < ritemCount; ++i) {
+        RenderItem* ritem = ppRitem[i];
+        DrawPacket packet = {};
+
+        packet.isVisible = &ritem->isVisible;
+        Vmesh* mesh = ritem->mesh.get();
+        if (ritem->isDynamic) {
+            packet.dynamicMesh = &ritem->dynamicMesh;
+        }
+        else {
+            packet.vertexBuffView = mesh->vertexBuffView;
+            packet.indexBuffView = mesh->indexBuffView;
+        }
+        packet.topologyType = ritem->topologyType;
+
+        auto seatOffset = ritem->boundLayerSeatOffsetTable.find(layerName);
+        UINT seatIdx = ritem->objConstBuffStartIdx + (seatOffset != ritem->boundLayerSeatOffsetTable.end() ? seatOffset->second : 0);
+        packet.objConstBuffOffset = (UINT64)seatIdx * objConstSeatSize;
+        packet.instanceCount = (UINT)ritem->instances.size();
+        packet.instBuffStartIdx = ritem->instBuffStartIdx;
+        packet.boundsIdx = ritem->boundsIdx;
+
+        // Note the submeshes of the dynamic meshes are also stored in the origin mesh.
+        Vsubmesh ritemMain = mesh->objects["main"];
+        packet.indexCount = ritemMain.indexCount;
+        packet.startIndexLocation = ritemMain.startIndexLocation;
+        packet.baseVertexLocation = ritemMain.baseVertexLocation;
+
+        packet.descHeap = ritem->displacementAndNormalMapDescHeap;
+        packet.hasDisplacementMap = ritem->hasDisplacementMap;
+        packet.displacementMapHandle = ritem->displacementMapHandle;
+        packet.hasNormalMap = ritem->hasNormalMap;
+        packet.normalMapHandle = ritem->normalMapHandle;
+
+        UINT64 descHeapId = descHeapIds.emplace(packet.descHeap, descHeapIds.size()).first->second;
+        // The meshes with the same vertex buffer (e.g. in the same geometry pool) are put together.
+        // Every dynamic mesh is given an ID of its own, since its buffers are not known until submitted.
+        UINT64 buffBindingId = nextBuffBindingId;
+        if (packet.dynamicMesh == nullptr) {
+            auto result = buffBindingIds.emplace(packet.vertexBuffView.BufferLocation, nextBuffBindingId);
+            buffBindingId = result.first->second;
+            if (result.second) ++nextBuffBindingId;
+        }
+        else ++nextBuffBindingId;
+
+        packet.sortKey = ((descHeapId & 0xffff) << 48) | ((buffBindingId & 0xffffff) << 24) | (i & 0xffffff);
+        drawList->packets.push_back(packet);
+    }
+
+    // Sorting by the state would change the blending result, and the packets are already in the order of the items.
+    if (isBlendedRitemLayer(layerName)) return;
+    std::sort(drawList->packets.begin(), drawList->packets.end(),
+        [](const DrawPacket& a, const DrawPacket& b) { return a.sortKey < b.sortKey; });
+}
@@ -0,0 +1,97 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+#include "d3dcore/draw-list.h"
+#include "d3dcore/frame-async.h"
+
+// Whether the PSO of the layer blends with the render target, i.e. the draw order changes the result.
+bool isBlendedRitemLayer(const std::string& layerName);
+
+// Flatten the render items of the layer into draw packets sorted by the state, i.e. the descriptor heap
+// and then the vertex and index buffers. objConstSeatSize is the size of each object constants seat.
+// The packets of a blended layer (see isBlendedRitemLayer) are kept in the order of the render items instead,
+// so the items put into the layer later are still blended over the former ones.
+// Note the meshes, object constants indices and heaps are copied, so the list must be compiled again
+// when any of them is changed, see invalidateDrawLists in frame-async-utils.h.
+void compileDrawList(const std::string& layerName, RenderItem* const* ppRitem, size_t ritemCount,
+    UINT objConstSeatSize, DrawList* drawList);
+
+// Record the draw calls of the packets with cmdList (CmdRecorder or any class with the same methods,
+// e.g. the stub of the draw-list benchmark). The buffers and topologies are only set when changed.
+// The descriptor heaps are handled the same as drawRenderItems, i.e. the tables of the maps are set with the
+// heap of the packet, and mainDescHeap is bound again before drawing. Return the count of the draw calls.
+// If cullMask is not nullptr, the packets with cullMask[boundsIdx] of 0 are skipped (see cullRenderItems).
+template <typename CmdList>
+UINT submitDrawList(CmdList* cmdList, const DrawList& drawList,
+    D3D12_GPU_VIRTUAL_ADDRESS objConstBuffAddr, ID3D12DescriptorHeap* mainDescHeap, const BYTE* cullMask = nullptr)
+{
+    UINT drawCount = 0;
+    const D3D12_VERTEX_BUFFER_VIEW* boundVertexBuffView = nullptr;
+    const D3D12_INDEX_BUFFER_VIEW* boundIndexBuffView = nullptr;
+    D3D_PRIMITIVE_TOPOLOGY boundTopologyType = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+    for (const DrawPacket& packet : drawList.packets) {
+        // Skip drawing invisible render items.
+        if (!*packet.isVisible) continue;
+        // Skip drawing the render items out of the camera frustum.
+        if (cullMask != nullptr && !cullMask[packet.boundsIdx]) continue;
+
+        const D3D12_VERTEX_BUFFER_VIEW* vertexBuffView = &packet.vertexBuffView;
+        const D3D12_INDEX_BUFFER_VIEW* indexBuffView = &packet.indexBuffView;
+        if (packet.dynamicMesh != nullptr) {
+            const Vmesh* mesh = *packet.dynamicMesh;
+            vertexBuffView = &mesh->vertexBuffView;
+            indexBuffView = &mesh->indexBuffView;
+            // The mesh is changed every frame, so always bind it.
+            boundVertexBuffView = nullptr;
+        }
+
+        if (boundVertexBuffView == nullptr ||
+            boundVertexBuffView->BufferLocation != vertexBuffView->BufferLocation ||
+            boundVertexBuffView->SizeInBytes != vertexBuffView->SizeInBytes ||
+            boundVertexBuffView->StrideInBytes != vertexBuffView->StrideInBytes)
+        {
+            cmdList->IASetVertexBuffers(0, 1, vertexBuffView);
+            boundVertexBuffView = packet.dynamicMesh != nullptr ? nullptr : vertexBuffView;
+        }
+        if (boundIndexBuffView == nullptr ||
+            boundIndexBuffView->BufferLocation != indexBuffView->BufferLocation ||
+            boundIndexBuffView->SizeInBytes != indexBuffView->SizeInBytes)
+        {
+            cmdList->IASetIndexBuffer(indexBuffView);
+            boundIndexBuffView = indexBuffView;
+        }
+        if (boundTopologyType != packet.topologyType) {
+            cmdList->IASetPrimitiveTopology(packet.topologyType);
+            boundTopologyType = packet.topologyType;
+        }
+
+        // Bind Object Constants Buffer, or the first instance of the instanced render item.
+        if (packet.instanceCount == 0) cmdList->SetGraphicsRootConstantBufferView(0, objConstBuffAddr + packet.objConstBuffOffset);
+        else cmdList->SetGraphicsRoot32BitConstant(7, packet.instBuffStartIdx, 0);
+
+        // Bind displacement and normal map (If has).
+        if (packet.descHeap != nullptr) {
+            cmdList->SetDescriptorHeaps(1, &packet.descHeap);
+
+            if (packet.hasDisplacementMap) cmdList->SetGraphicsRootDescriptorTable(4, packet.displacementMapHandle);
+            if (packet.hasNormalMap) cmdList->SetGraphicsRootDescriptorTable(5, packet.normalMapHandle);
+
+            cmdList->SetDescriptorHeaps(1, &mainDescHeap);
+        }
+
+        cmdList->DrawIndexedInstanced(packet.indexCount, (std::max)(packet.instanceCount, 1u),
+            packet.startIndexLocation, packet.baseVertexLocation, 0);
+        ++drawCount;
+    }
+    return drawCount;
+}
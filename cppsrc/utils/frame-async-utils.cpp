@@ -6,9 +6,17 @@
 ** yiyaowen (c) 2021 All Rights Reserved.
 */
 
+#include <algorithm>
+#include <numeric>
+
+#include "bvh-utils.h"
+#include "culling-utils.h"
 #include "debugger.h"
+#include "draw-list-utils.h"
 #include "frame-async-utils.h"
+#include "obj-consts-utils.h"
 #include "render-item-utils.h"
+#include "upload-ring-utils.h"
 #include "vmesh-utils.h"
 
 void initEmptyFrameResource(D3DCore* pCore, FrameResource* pResource) {
@@ -29,14 +37,80 @@ void initFResourceProcConstBuff(D3DCore* pCore, UINT procBuffCount, FrameResourc
 
 void initFResourceMatStructBuff(D3DCore* pCore, void* data, UINT64 byteSize, FrameResource* pResource) {
     createDefaultBuffs(pCore, data, byteSize,
-        &pResource->matStructBuffCPU, &pResource->matStructBuffGPU, &pResource->matStructBuffUploader);
+        &pResource->matStructBuffCPU, &pResource->matStructBuffGPU);
+}
+
+void initFResourceUploadRing(D3DCore* pCore, UINT64 capacity, FrameResource* pResource) {
+    initUploadRing(pCore, capacity, &pResource->uploadRing);
+}
+
+void initFResourceInstStructBuff(D3DCore* pCore, UINT instanceCount, FrameResource* pResource) {
+    // Unlike the constant buffers, the elements of a structured buffer are not aligned to 256 bytes.
+    // The buffer is never empty, so that there is always a valid address to bind.
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer((UINT64)(std::max)(instanceCount, 1u) * sizeof(InstanceData)),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&pResource->instStructBuffGPU)));
+    checkHR(pResource->instStructBuffGPU->Map(0, nullptr, reinterpret_cast<void**>(&pResource->instStructBuffCPU)));
+}
+
+// Bind the vertex and index buffers of the mesh unless they are the same as the bound mesh, e.g. both
+// meshes are suballocated from the same geometry pool. The bound mesh is updated to targetMesh.
+static void bindVmeshBuffs(D3DCore* pCore, const Vmesh* targetMesh, const Vmesh** ppBoundMesh) {
+    auto boundMesh = *ppBoundMesh;
+    if (boundMesh != nullptr &&
+        boundMesh->vertexBuffView.BufferLocation == targetMesh->vertexBuffView.BufferLocation &&
+        boundMesh->vertexBuffView.SizeInBytes == targetMesh->vertexBuffView.SizeInBytes &&
+        boundMesh->vertexBuffView.StrideInBytes == targetMesh->vertexBuffView.StrideInBytes &&
+        boundMesh->indexBuffView.BufferLocation == targetMesh->indexBuffView.BufferLocation &&
+        boundMesh->indexBuffView.SizeInBytes == targetMesh->indexBuffView.SizeInBytes) return;
+
+    pCore->cmdRecorder->IASetVertexBuffers(0, 1, &targetMesh->vertexBuffView);
+    pCore->cmdRecorder->IASetIndexBuffer(&targetMesh->indexBuffView);
+    *ppBoundMesh = targetMesh;
 }
 
 void initEmptyRenderItem(RenderItem* pRitem) {
     // TODO: This func is Reserved for more complicated render item implementation.
 }
 
+void markRitemObjConstsDirty(D3DCore* pCore, RenderItem* pRitem) {
+    queueRitemObjConsts(pRitem, &pCore->objConstsShadow);
+}
+
+void updateCurrObjConstBuff(D3DCore* pCore) {
+    // The world-space bounds move with the world matrices, so only the queued render items are updated.
+    for (auto ritem : pCore->objConstsShadow.dirtyRitems) {
+        if (ritem->boundsIdx >= pCore->ritemBounds.count) continue;
+        XMFLOAT3 center, extents;
+        calcRitemWorldBounds(ritem, &center, &extents);
+        setBoundsSoAEntry(ritem->boundsIdx, center, extents, &pCore->ritemBounds);
+        pCore->isRitemBvhDirty = true;
+    }
+
+    if (!pCore->objConstsShadow.dirtyRitems.empty()) {
+        std::vector<DirtySeatSet*> seatSets = {}, instSets = {};
+        for (auto& resource : pCore->frameResources) {
+            seatSets.push_back(&resource->dirtyObjSeats);
+            instSets.push_back(&resource->dirtyInstSeats);
+        }
+        flushObjConstsShadow(&pCore->objConstsShadow, seatSets.data(), instSets.data(), seatSets.size());
+    }
+
+    auto resource = pCore->currFrameResource;
+    auto stats = writeDirtyObjConsts(pCore->objConstsShadow, &resource->dirtyObjSeats, resource->objConstBuffCPU);
+    auto instStats = writeDirtyInstances(pCore->objConstsShadow, &resource->dirtyInstSeats, resource->instStructBuffCPU);
+    pCore->objConstSeatWriteCount = stats.seatCount;
+    pCore->objConstRangeWriteCount = stats.rangeCount + instStats.rangeCount;
+    pCore->instWriteCount = instStats.seatCount;
+    pCore->objDataUploadByteSize = stats.byteSize + instStats.byteSize;
+}
+
 void drawRenderItems(D3DCore* pCore, RenderItem** ppRitem, UINT ritemCount, std::vector<UINT> seatIdxOffsetList) {
+    const Vmesh* boundMesh = nullptr;
     for (UINT i = 0; i < ritemCount; ++i) {
         // Skip drawing invisible render items.
         if (!ppRitem[i]->isVisible) continue;
@@ -44,30 +118,34 @@ void drawRenderItems(D3DCore* pCore, RenderItem** ppRitem, UINT ritemCount, std:
         UINT seatIdxOffset = seatIdxOffsetList[i];
 
         Vmesh* targetMesh = ppRitem[i]->isDynamic ? ppRitem[i]->dynamicMesh : ppRitem[i]->mesh.get();
-        pCore->cmdList->IASetVertexBuffers(0, 1, &targetMesh->vertexBuffView);
-        pCore->cmdList->IASetIndexBuffer(&targetMesh->indexBuffView);
-        pCore->cmdList->IASetPrimitiveTopology(ppRitem[i]->topologyType);
+        bindVmeshBuffs(pCore, targetMesh, &boundMesh);
+        pCore->cmdRecorder->IASetPrimitiveTopology(ppRitem[i]->topologyType);
 
-        // Bind Object Constants Buffer.
-        auto objectConstBuffAddr = pCore->currFrameResource->objConstBuffGPU->GetGPUVirtualAddress();
-        UINT currSeatIdx = ppRitem[i]->objConstBuffStartIdx + seatIdxOffset;
-        auto currSeatAddr = objectConstBuffAddr + currSeatIdx * calcConstBuffSize(sizeof(ObjConsts));
-        pCore->cmdList->SetGraphicsRootConstantBufferView(0, currSeatAddr);
+        // Bind Object Constants Buffer, or the first instance of the instanced render item.
+        UINT instanceCount = (std::max)((UINT)ppRitem[i]->instances.size(), 1u);
+        if (ppRitem[i]->instances.empty()) {
+            auto objectConstBuffAddr = pCore->currFrameResource->objConstBuffGPU->GetGPUVirtualAddress();
+            UINT currSeatIdx = ppRitem[i]->objConstBuffStartIdx + seatIdxOffset;
+            auto currSeatAddr = objectConstBuffAddr + currSeatIdx * calcConstBuffSize(sizeof(ObjConsts));
+            pCore->cmdRecorder->SetGraphicsRootConstantBufferView(0, currSeatAddr);
+        }
+        else pCore->cmdRecorder->SetGraphicsRoot32BitConstant(7, ppRitem[i]->instBuffStartIdx, 0);
 
         // Bind displacement and normal map (If has).
         if (ppRitem[i]->displacementAndNormalMapDescHeap != nullptr) {
             ID3D12DescriptorHeap* tmpDescHeaps[] = { ppRitem[i]->displacementAndNormalMapDescHeap };
-            pCore->cmdList->SetDescriptorHeaps(_countof(tmpDescHeaps), tmpDescHeaps);
+            pCore->cmdRecorder->SetDescriptorHeaps(_countof(tmpDescHeaps), tmpDescHeaps);
 
-            if (ppRitem[i]->hasDisplacementMap) pCore->cmdList->SetGraphicsRootDescriptorTable(4, ppRitem[i]->displacementMapHandle);
-            if (ppRitem[i]->hasNormalMap) pCore->cmdList->SetGraphicsRootDescriptorTable(5, ppRitem[i]->normalMapHandle);
+            if (ppRitem[i]->hasDisplacementMap) pCore->cmdRecorder->SetGraphicsRootDescriptorTable(4, ppRitem[i]->displacementMapHandle);
+            if (ppRitem[i]->hasNormalMap) pCore->cmdRecorder->SetGraphicsRootDescriptorTable(5, ppRitem[i]->normalMapHandle);
 
             ID3D12DescriptorHeap* descHeaps[] = { pCore->srvUavHeap.Get() };
-            pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+            pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
         }
 
         Vsubmesh ritemMain = ppRitem[i]->mesh->objects["main"];
-        pCore->cmdList->DrawIndexedInstanced(ritemMain.indexCount, 1, ritemMain.startIndexLocation, ritemMain.baseVertexLocation, 0);
+        pCore->cmdRecorder->DrawIndexedInstanced(ritemMain.indexCount, instanceCount, ritemMain.startIndexLocation, ritemMain.baseVertexLocation, 0);
+        ++pCore->frameDrawCount;
     }
 }
 
@@ -80,9 +158,79 @@ void drawRenderItemsInLayer(D3DCore* pCore, std::string layerName, RenderItem**
 }
 
 void drawRitemLayerWithName(D3DCore* pCore, std::string name) {
-    pCore->cmdList->SetPipelineState(pCore->PSOs[name].Get());
-    auto ritemLayer = findRitemLayerWithName(name, pCore->ritemLayers);
-    drawRenderItemsInLayer(pCore, name, ritemLayer.data(), (UINT)ritemLayer.size());
+    pCore->cmdRecorder->SetPipelineState(pCore->PSOs[name].Get());
+
+    auto& drawList = pCore->drawLists[name];
+    if (drawList.layersVersion != pCore->ritemLayersVersion) {
+        auto& ritemLayer = findRitemLayerWithName(name, pCore->ritemLayers);
+        compileDrawList(name, ritemLayer.data(), ritemLayer.size(), calcConstBuffSize(sizeof(ObjConsts)), &drawList);
+        drawList.layersVersion = pCore->ritemLayersVersion;
+    }
+
+    auto objectConstBuffAddr = pCore->currFrameResource->objConstBuffGPU->GetGPUVirtualAddress();
+    bool isCulled = pCore->isFrustumCullingEnabled && pCore->ritemCullMask.size() == pCore->ritemBounds.count;
+    pCore->frameDrawCount += submitDrawList(pCore->cmdRecorder.get(), drawList, objectConstBuffAddr, pCore->srvUavHeap.Get(),
+        isCulled ? pCore->ritemCullMask.data() : nullptr);
+}
+
+void cullRenderItems(D3DCore* pCore) {
+    auto& bounds = pCore->ritemBounds;
+    auto& visibleList = pCore->visibleRitemIdxList;
+    visibleList.resize(bounds.centerX.size());
+
+    size_t visibleCount = bounds.count;
+    if (pCore->isFrustumCullingEnabled) {
+        XMMATRIX viewProj = XMLoadFloat4x4(&pCore->camera->viewTrans) * XMLoadFloat4x4(&pCore->camera->projTrans);
+        Frustum frustum;
+        extractFrustumPlanes(viewProj, &frustum);
+        if (bounds.count >= pCore->bvhCullingMinRitemCount) {
+            updateRitemBvh(pCore);
+            visibleCount = cullBvh(pCore->ritemBvh, frustum, visibleList.data());
+        }
+        else visibleCount = cullBoundsSoA(frustum, bounds, visibleList.data());
+    }
+    else std::iota(visibleList.begin(), visibleList.begin() + visibleCount, 0);
+    visibleList.resize(visibleCount);
+
+    pCore->ritemCullMask.assign(bounds.count, 0);
+    for (UINT32 idx : visibleList) pCore->ritemCullMask[idx] = 1;
+}
+
+void updateRitemBvh(D3DCore* pCore) {
+    auto& bvh = pCore->ritemBvh;
+    if (bvh.primCount != pCore->ritemBounds.count) {
+        buildBvh(pCore->ritemBounds, bvh.maxLeafSize, &bvh);
+    }
+    else if (pCore->isRitemBvhDirty && !refitBvh(pCore->ritemBounds, &bvh)) {
+        buildBvh(pCore->ritemBounds, bvh.maxLeafSize, &bvh);
+    }
+    pCore->isRitemBvhDirty = false;
+}
+
+RenderItem* pickRenderItem(D3DCore* pCore, int x, int y, float* pDist) {
+    updateRitemBvh(pCore);
+
+    // From the viewport to the view space, where the ray starts at the eye and passes the point on z = 1.
+    Camera* camera = pCore->camera.get();
+    auto& viewport = camera->screenViewport;
+    float ndcX = 2.0f * (x - viewport.TopLeftX) / viewport.Width - 1.0f;
+    float ndcY = 1.0f - 2.0f * (y - viewport.TopLeftY) / viewport.Height;
+    XMVECTOR dirV = XMVectorSet(ndcX / camera->projTrans._11, ndcY / camera->projTrans._22, 1.0f, 0.0f);
+
+    XMMATRIX view = XMLoadFloat4x4(&camera->viewTrans);
+    XMMATRIX invView = XMMatrixInverse(nullptr, view);
+    XMVECTOR origin = XMVector3Transform(XMVectorZero(), invView);
+    XMVECTOR dir = XMVector3Normalize(XMVector3TransformNormal(dirV, invView));
+
+    UINT idx = 0;
+    float dist = 0.0f;
+    if (!pickBvh(pCore->ritemBvh, origin, dir, &idx, &dist) || idx >= pCore->allRitems.size()) return nullptr;
+    if (pDist != nullptr) *pDist = dist;
+    return pCore->allRitems[idx];
+}
+
+void invalidateDrawLists(D3DCore* pCore) {
+    ++pCore->ritemLayersVersion;
 }
 
 UINT calcConstBuffSize(UINT byteSize)
@@ -116,7 +264,15 @@ void createConstBuffPair(D3DCore* pCore, size_t elemSize, UINT elemCount,
 }
 
 void drawAllRitemsFormatted(D3DCore* pCore, const std::string& psoName, D3D_PRIMITIVE_TOPOLOGY primTopology, Material* mat) {
-    pCore->cmdList->SetPipelineState(pCore->PSOs[psoName].Get());
+    // The meshes of packed vertices are drawn with the packed variant of the PSO, e.g. "wireframe_packed",
+    // and the instanced render items are drawn with the instanced variant, e.g. "wireframe_instanced".
+    ID3D12PipelineState* pso = pCore->PSOs[psoName].Get();
+    auto packedPsoItor = pCore->PSOs.find(psoName + "_packed");
+    ID3D12PipelineState* packedPso = packedPsoItor != pCore->PSOs.end() ? packedPsoItor->second.Get() : nullptr;
+    auto instancedPsoItor = pCore->PSOs.find(psoName + "_instanced");
+    ID3D12PipelineState* instancedPso = instancedPsoItor != pCore->PSOs.end() ? instancedPsoItor->second.Get() : nullptr;
+    ID3D12PipelineState* currPso = nullptr;
+    const Vmesh* boundMesh = nullptr;
     for (auto ritem : pCore->allRitems) {
         // Skip drawing invisible render items.
         if (!ritem->isVisible) continue;
@@ -124,29 +280,46 @@ void drawAllRitemsFormatted(D3DCore* pCore, const std::string& psoName, D3D_PRIM
         UINT seatIdxOffset = 0;
 
         Vmesh* targetMesh = ritem->isDynamic ? ritem->dynamicMesh : ritem->mesh.get();
-        pCore->cmdList->IASetVertexBuffers(0, 1, &targetMesh->vertexBuffView);
-        pCore->cmdList->IASetIndexBuffer(&targetMesh->indexBuffView);
-        pCore->cmdList->IASetPrimitiveTopology(primTopology);
+        ID3D12PipelineState* targetPso = targetMesh->vertexFormat == Vmesh::PACKED_VERTEX ? packedPso : pso;
+        if (!ritem->instances.empty()) targetPso = instancedPso;
+        else if (targetPso == nullptr) {
+            std::wstring wPsoName(psoName.begin(), psoName.end());
+            popupDebugWnd(L"The packed meshes can not be drawn without the PSO " + wPsoName + L"_packed");
+            exit(1);
+        }
+        // Skip the instanced render items which can not be drawn with this PSO.
+        if (targetPso == nullptr) continue;
+        if (targetPso != currPso) {
+            pCore->cmdRecorder->SetPipelineState(targetPso);
+            currPso = targetPso;
+        }
+        bindVmeshBuffs(pCore, targetMesh, &boundMesh);
+        pCore->cmdRecorder->IASetPrimitiveTopology(primTopology);
 
-        // Bind Object Constants Buffer.
-        auto objectConstBuffAddr = pCore->currFrameResource->objConstBuffGPU->GetGPUVirtualAddress();
-        UINT currSeatIdx = ritem->objConstBuffStartIdx + seatIdxOffset;
-        auto currSeatAddr = objectConstBuffAddr + currSeatIdx * calcConstBuffSize(sizeof(ObjConsts));
-        pCore->cmdList->SetGraphicsRootConstantBufferView(0, currSeatAddr);
+        // Bind Object Constants Buffer, or the first instance of the instanced render item.
+        UINT instanceCount = (std::max)((UINT)ritem->instances.size(), 1u);
+        if (ritem->instances.empty()) {
+            auto objectConstBuffAddr = pCore->currFrameResource->objConstBuffGPU->GetGPUVirtualAddress();
+            UINT currSeatIdx = ritem->objConstBuffStartIdx + seatIdxOffset;
+            auto currSeatAddr = objectConstBuffAddr + currSeatIdx * calcConstBuffSize(sizeof(ObjConsts));
+            pCore->cmdRecorder->SetGraphicsRootConstantBufferView(0, currSeatAddr);
+        }
+        else pCore->cmdRecorder->SetGraphicsRoot32BitConstant(7, ritem->instBuffStartIdx, 0);
 
         // Bind displacement and normal map (If has).
         if (ritem->displacementAndNormalMapDescHeap != nullptr) {
             ID3D12DescriptorHeap* tmpDescHeaps[] = { ritem->displacementAndNormalMapDescHeap };
-            pCore->cmdList->SetDescriptorHeaps(_countof(tmpDescHeaps), tmpDescHeaps);
+            pCore->cmdRecorder->SetDescriptorHeaps(_countof(tmpDescHeaps), tmpDescHeaps);
 
-            if (ritem->hasDisplacementMap) pCore->cmdList->SetGraphicsRootDescriptorTable(4, ritem->displacementMapHandle);
-            if (ritem->hasNormalMap) pCore->cmdList->SetGraphicsRootDescriptorTable(5, ritem->normalMapHandle);
+            if (ritem->hasDisplacementMap) pCore->cmdRecorder->SetGraphicsRootDescriptorTable(4, ritem->displacementMapHandle);
+            if (ritem->hasNormalMap) pCore->cmdRecorder->SetGraphicsRootDescriptorTable(5, ritem->normalMapHandle);
 
             ID3D12DescriptorHeap* descHeaps[] = { pCore->srvUavHeap.Get() };
-            pCore->cmdList->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
+            pCore->cmdRecorder->SetDescriptorHeaps(_countof(descHeaps), descHeaps);
         }
       
         Vsubmesh ritemMain = ritem->mesh->objects["main"];
-        pCore->cmdList->DrawIndexedInstanced(ritemMain.indexCount, 1, ritemMain.startIndexLocation, ritemMain.baseVertexLocation, 0);
+        pCore->cmdRecorder->DrawIndexedInstanced(ritemMain.indexCount, instanceCount, ritemMain.startIndexLocation, ritemMain.baseVertexLocation, 0);
+        ++pCore->frameDrawCount;
     }
 }
\ No newline at end of file
@@ -14,18 +14,49 @@ void initEmptyFrameResource(D3DCore* pCore, FrameResource* pResource);
 void initFResourceObjConstBuff(D3DCore* pCore, UINT objBuffCount, FrameResource* pResource);
 void initFResourceProcConstBuff(D3DCore* pCore, UINT procBuffCount, FrameResource* pResource);
 void initFResourceMatStructBuff(D3DCore* pCore, void* data, UINT64 byteSize, FrameResource* pResource);
+void initFResourceUploadRing(D3DCore* pCore, UINT64 capacity, FrameResource* pResource);
+// The instance buffer is tightly packed, see RenderItem::instances.
+void initFResourceInstStructBuff(D3DCore* pCore, UINT instanceCount, FrameResource* pResource);
 
 void initEmptyRenderItem(RenderItem* pRitem);
 
+// Must be called after constData of the render item is changed, otherwise the change is not uploaded.
+void markRitemObjConstsDirty(D3DCore* pCore, RenderItem* pRitem);
+
+// Write the object constants and instances changed since the current frame resource was last updated into
+// its buffers. Only the dirty seats are written, see obj-consts-utils.h.
+void updateCurrObjConstBuff(D3DCore* pCore);
+
 void drawRenderItems(D3DCore* pCore, RenderItem** ppRitem, UINT ritemCount, std::vector<UINT> seatIdxOffsetList);
 
 void drawRenderItemsInLayer(D3DCore* pCore, std::string name, RenderItem** ppRitem, UINT ritemCount);
 
+// The layer is drawn with its compiled draw list, see draw-list-utils.h.
 void drawRitemLayerWithName(D3DCore* pCore, std::string name);
 
+// Test the world-space bounds of all render items (see culling-utils.h) against the camera frustum, and write
+// visibleRitemIdxList and ritemCullMask of pCore, which are read by drawRitemLayerWithName. It must be called
+// after updateCurrObjConstBuff and the camera update. Nothing is culled if isFrustumCullingEnabled is FALSE.
+// The scenes of at least bvhCullingMinRitemCount render items are culled with ritemBvh.
+void cullRenderItems(D3DCore* pCore);
+
+// Build ritemBvh when the render item count changes, and refit it when the bounds moved (See bvh-utils.h).
+void updateRitemBvh(D3DCore* pCore);
+
+// Return the render item whose world-space bounds are hit first by the ray from the eye through the pixel (x, y)
+// of the viewport, or nullptr if there is none. The distance from the eye is written into pDist if not nullptr.
+// Note the bounds are tested instead of the triangles, and an instanced render item is picked as a whole.
+RenderItem* pickRenderItem(D3DCore* pCore, int x, int y, float* pDist = nullptr);
+
+// Must be called after the render items of any layer are changed, i.e. the layer bindings, the meshes,
+// the object constants indices or the descriptor heaps. Note the visibility is not included.
+void invalidateDrawLists(D3DCore* pCore);
+
 UINT calcConstBuffSize(UINT byteSize);
 
 void createConstBuffPair(D3DCore* pCore, size_t elemSize, UINT elemCount,
     BYTE** ppBuffCPU, ID3D12Resource** ppBuffGPU);
 
+// The packed meshes are drawn with the PSO <psoName>_packed, which must exist if there are any,
+// and the instanced render items with <psoName>_instanced (skipped if it does not exist).
 void drawAllRitemsFormatted(D3DCore* pCore, const std::string& psoName, D3D_PRIMITIVE_TOPOLOGY primTopology, Material* mat);
\ No newline at end of file
@@ -0,0 +1,83 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <iterator>
+
+#include "free-list-allocator.h"
+
+void FreeListAllocator::reset(uint64_t capacity) {
+    _capacity = capacity;
+    _freeSize = 0;
+    _freeBlocksByOffset.clear();
+    _freeBlocksBySize.clear();
+    if (capacity > 0) insertFreeBlock(0, capacity);
+}
+
+uint64_t FreeListAllocator::allocate(uint64_t size) {
+    if (size == 0) return INVALID_OFFSET;
+
+    auto bestFit = _freeBlocksBySize.lower_bound(size);
+    if (bestFit == _freeBlocksBySize.end()) return INVALID_OFFSET;
+
+    uint64_t blockSize = bestFit->first;
+    uint64_t offset = bestFit->second;
+    eraseFreeBlock(_freeBlocksByOffset.find(offset));
+    // The rest of the block is still free.
+    if (blockSize > size) insertFreeBlock(offset + size, blockSize - size);
+    return offset;
+}
+
+void FreeListAllocator::free(uint64_t offset, uint64_t size) {
+    if (size == 0) return;
+
+    uint64_t mergedOffset = offset;
+    uint64_t mergedSize = size;
+
+    // Merge the next block if it starts right at the end of the region.
+    auto next = _freeBlocksByOffset.lower_bound(offset);
+    if (next != _freeBlocksByOffset.end() && next->first == offset + size) {
+        mergedSize += next->second;
+        auto toErase = next++;
+        eraseFreeBlock(toErase);
+    }
+    // Merge the previous block if it ends right at the start of the region.
+    if (next != _freeBlocksByOffset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            mergedOffset = prev->first;
+            mergedSize += prev->second;
+            eraseFreeBlock(prev);
+        }
+    }
+    insertFreeBlock(mergedOffset, mergedSize);
+}
+
+uint64_t FreeListAllocator::largestFreeBlockSize() const {
+    return _freeBlocksBySize.empty() ? 0 : _freeBlocksBySize.rbegin()->first;
+}
+
+void FreeListAllocator::insertFreeBlock(uint64_t offset, uint64_t size) {
+    _freeBlocksByOffset.emplace(offset, size);
+    _freeBlocksBySize.emplace(size, offset);
+    _freeSize += size;
+}
+
+void FreeListAllocator::eraseFreeBlock(std::map<uint64_t, uint64_t>::iterator blockItor) {
+    uint64_t offset = blockItor->first;
+    uint64_t size = blockItor->second;
+    // Several blocks can be of the same size, so find the one with the same offset.
+    auto range = _freeBlocksBySize.equal_range(size);
+    for (auto itor = range.first; itor != range.second; ++itor) {
+        if (itor->second == offset) {
+            _freeBlocksBySize.erase(itor);
+            break;
+        }
+    }
+    _freeBlocksByOffset.erase(blockItor);
+    _freeSize -= size;
+}
@@ -0,0 +1,51 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// General allocator of offsets in [0, capacity) with a free list of blocks, e.g. the vertices and
+// indices of the geometry pool (see d3dcore/geometry-pool.h). Unlike RingAllocator, the regions
+// can be freed in any order. Like RingAllocator, it only does the offset math without any Windows API.
+//
+// The best fit (the smallest free block not less than the size) is chosen, and the adjacent free
+// blocks are merged when a region is freed, so freeing all regions always gives one whole block.
+class FreeListAllocator {
+public:
+    constexpr static uint64_t INVALID_OFFSET = UINT64_MAX;
+
+    FreeListAllocator() = default;
+    explicit FreeListAllocator(uint64_t capacity) { reset(capacity); }
+
+    // Free all regions and change the capacity.
+    void reset(uint64_t capacity);
+
+    // Return the offset of a region of size units, or INVALID_OFFSET if there is no large enough free block.
+    uint64_t allocate(uint64_t size);
+
+    // The region must be returned by allocate with the same size and not freed yet.
+    void free(uint64_t offset, uint64_t size);
+
+    inline uint64_t capacity() const { return _capacity; }
+    inline uint64_t freeSize() const { return _freeSize; }
+    inline size_t freeBlockCount() const { return _freeBlocksByOffset.size(); }
+    uint64_t largestFreeBlockSize() const;
+
+private:
+    void insertFreeBlock(uint64_t offset, uint64_t size);
+    void eraseFreeBlock(std::map<uint64_t, uint64_t>::iterator blockItor);
+
+    uint64_t _capacity = 0;
+    uint64_t _freeSize = 0;
+
+    // Free blocks indexed by offset (offset -> size) for merging, and by size (size -> offset) for the best fit.
+    std::map<uint64_t, uint64_t> _freeBlocksByOffset = {};
+    std::multimap<uint64_t, uint64_t> _freeBlocksBySize = {};
+};
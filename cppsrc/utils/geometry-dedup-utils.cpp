@@ -0,0 +1,129 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <cstring>
+
+#include "geometry-dedup-utils.h"
+
+namespace {
+
+constexpr UINT64 XXH_PRIME64_1 = 0x9e3779b185ebca87ull;
+constexpr UINT64 XXH_PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+constexpr UINT64 XXH_PRIME64_3 = 0x165667b19e3779f9ull;
+constexpr UINT64 XXH_PRIME64_4 = 0x85ebca77c2b2ae63ull;
+constexpr UINT64 XXH_PRIME64_5 = 0x27d4eb2f165667c5ull;
+
+inline UINT64 rotl64(UINT64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Unaligned little-endian reads, which compile to plain loads.
+inline UINT64 read64(const BYTE* p) { UINT64 v; memcpy(&v, p, sizeof(v)); return v; }
+inline UINT32 read32(const BYTE* p) { UINT32 v; memcpy(&v, p, sizeof(v)); return v; }
+
+inline UINT64 xxhRound(UINT64 acc, UINT64 input) {
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+inline UINT64 xxhMergeRound(UINT64 acc, UINT64 val) {
+    acc ^= xxhRound(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+}
+
+UINT64 calcXXHash64(const void* data, size_t byteSize, UINT64 seed) {
+    const BYTE* p = (const BYTE*)data;
+    const BYTE* end = p + byteSize;
+    UINT64 hash = 0;
+
+    if (byteSize >= 32) {
+        // 4 independent lanes, which keep the multipliers busy.
+        UINT64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        UINT64 v2 = seed + XXH_PRIME64_2;
+        UINT64 v3 = seed;
+        UINT64 v4 = seed - XXH_PRIME64_1;
+        for (const BYTE* limit = end - 32; p <= limit; p += 32) {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+        }
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxhMergeRound(hash, v1);
+        hash = xxhMergeRound(hash, v2);
+        hash = xxhMergeRound(hash, v3);
+        hash = xxhMergeRound(hash, v4);
+    }
+    else {
+        hash = seed + XXH_PRIME64_5;
+    }
+    hash += (UINT64)byteSize;
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= xxhRound(0, read64(p));
+        hash = rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        hash ^= (UINT64)read32(p) * XXH_PRIME64_1;
+        hash = rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= (*p) * XXH_PRIME64_5;
+        hash = rotl64(hash, 11) * XXH_PRIME64_1;
+    }
+
+    // Avalanche.
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+UINT64 calcObjectGeometryHash(const ObjectGeometry* geo) {
+    // Each hash seeds the next one, so the same bytes split differently give different keys.
+    UINT64 hash = calcXXHash64(geo->vertices.data(), geo->vertices.size() * sizeof(Vertex));
+    hash = calcXXHash64(geo->indices.data(), geo->indices.size() * sizeof(UINT32), hash);
+    return calcXXHash64(&geo->locationInfo, sizeof(Vsubmesh), hash);
+}
+
+std::shared_ptr<Vmesh> findDedupMesh(const ObjectGeometry* geo, UINT64 hash, GeometryDedupTable* table) {
+    ++table->lookupCount;
+    auto bucket = table->buckets.find(hash);
+    if (bucket == table->buckets.end()) return nullptr;
+
+    for (auto& entry : bucket->second) {
+        if (entry.vertices.size() != geo->vertices.size() || entry.indices.size() != geo->indices.size() ||
+            memcmp(&entry.locationInfo, &geo->locationInfo, sizeof(Vsubmesh)) != 0 ||
+            memcmp(entry.vertices.data(), geo->vertices.data(), geo->vertices.size() * sizeof(Vertex)) != 0 ||
+            memcmp(entry.indices.data(), geo->indices.data(), geo->indices.size() * sizeof(UINT32)) != 0)
+        {
+            continue;
+        }
+        ++table->sharedCount;
+        table->savedByteSize += geo->vertices.size() * sizeof(Vertex) + geo->indices.size() * sizeof(UINT32);
+        return entry.mesh;
+    }
+    return nullptr;
+}
+
+void addDedupMesh(const ObjectGeometry* geo, UINT64 hash, std::shared_ptr<Vmesh> mesh, GeometryDedupTable* table) {
+    GeometryDedupTable::Entry entry = {};
+    entry.vertices = geo->vertices;
+    entry.indices = geo->indices;
+    entry.locationInfo = geo->locationInfo;
+    entry.mesh = std::move(mesh);
+    table->buckets[hash].push_back(std::move(entry));
+}
+
+void clearGeometryDedupTable(GeometryDedupTable* table) {
+    table->buckets.clear();
+}
@@ -0,0 +1,29 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "d3dcore/geometry-dedup.h"
+#include "geometry-utils.h"
+
+// These funcs do not depend on D3DCore, see initRitemWithDedupGeoInfo in render-item-utils.h for the usage.
+
+// 64-bit xxHash (XXH64) of the data, which reads 32 bytes per round.
+UINT64 calcXXHash64(const void* data, size_t byteSize, UINT64 seed = 0);
+
+// Key of GeometryDedupTable, i.e. the hash of the vertices, the indices and the location info.
+UINT64 calcObjectGeometryHash(const ObjectGeometry* geo);
+
+// Return the mesh of the same geometry, or nullptr if there is none. The statistics of the table are updated.
+std::shared_ptr<Vmesh> findDedupMesh(const ObjectGeometry* geo, UINT64 hash, GeometryDedupTable* table);
+
+// The geometry is copied into the table to be compared with the later lookups.
+void addDedupMesh(const ObjectGeometry* geo, UINT64 hash, std::shared_ptr<Vmesh> mesh, GeometryDedupTable* table);
+
+// Drop the copies of the geometry, e.g. after the scene is built. The statistics are kept, and the
+// meshes stay alive as long as any render item holds them.
+void clearGeometryDedupTable(GeometryDedupTable* table);
@@ -0,0 +1,121 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <d3dcompiler.h>
+
+#include "debugger.h"
+#include "geometry-pool-utils.h"
+#include "scene-builder.h"
+#include "upload-ring-utils.h"
+
+void initGeometryPool(D3DCore* pCore, UINT64 vertexCapacity, UINT64 indexCapacity, UINT vertexStride, GeometryPool* pool) {
+    pool->vertexStride = vertexStride;
+
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(vertexCapacity * vertexStride),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&pool->vertexBuffGPU)));
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(indexCapacity * sizeof(UINT32)),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&pool->indexBuffGPU)));
+
+    // The views cover the whole pool, and the meshes are addressed by the draw arguments.
+    pool->vertexBuffView.BufferLocation = pool->vertexBuffGPU->GetGPUVirtualAddress();
+    pool->vertexBuffView.StrideInBytes = vertexStride;
+    pool->vertexBuffView.SizeInBytes = (UINT)(vertexCapacity * vertexStride);
+
+    pool->indexBuffView.BufferLocation = pool->indexBuffGPU->GetGPUVirtualAddress();
+    pool->indexBuffView.Format = DXGI_FORMAT_R32_UINT;
+    pool->indexBuffView.SizeInBytes = (UINT)(indexCapacity * sizeof(UINT32));
+
+    pool->vertexAllocator.reset(vertexCapacity);
+    pool->indexAllocator.reset(indexCapacity);
+}
+
+bool initPooledVmesh(D3DCore* pCore, GeometryPool* pool, const void* vertexData, UINT64 vertexCount,
+    const UINT32* indexData, UINT64 indexCount, Vmesh* pMesh, SceneBuilder* builder)
+{
+    UINT64 vertexOffset = pool->vertexAllocator.allocate(vertexCount);
+    if (vertexOffset == FreeListAllocator::INVALID_OFFSET) return false;
+    UINT64 indexOffset = pool->indexAllocator.allocate(indexCount);
+    if (indexOffset == FreeListAllocator::INVALID_OFFSET) {
+        pool->vertexAllocator.free(vertexOffset, vertexCount);
+        return false;
+    }
+
+    UINT64 vertexDataSize = vertexCount * pool->vertexStride;
+    UINT64 indexDataSize = indexCount * sizeof(UINT32);
+
+    // Create CPU data blocks, which are of the mesh only.
+    checkHR(D3DCreateBlob(vertexDataSize, &pMesh->vertexBuffCPU));
+    memcpy(pMesh->vertexBuffCPU->GetBufferPointer(), vertexData, vertexDataSize);
+    checkHR(D3DCreateBlob(indexDataSize, &pMesh->indexBuffCPU));
+    memcpy(pMesh->indexBuffCPU->GetBufferPointer(), indexData, indexDataSize);
+
+    pMesh->vertexBuffGPU = pool->vertexBuffGPU;
+    pMesh->indexBuffGPU = pool->indexBuffGPU;
+    pMesh->vertexBuffView = pool->vertexBuffView;
+    pMesh->indexBuffView = pool->indexBuffView;
+
+    pMesh->pool = pool;
+    pMesh->poolVertexOffset = (UINT)vertexOffset;
+    pMesh->poolIndexOffset = (UINT)indexOffset;
+
+    if (builder != nullptr) {
+        builder->queueBuffCopy(pMesh->vertexBuffCPU.Get(), pool->vertexBuffGPU.Get(),
+            vertexOffset * pool->vertexStride, D3D12_RESOURCE_STATE_GENERIC_READ);
+        builder->queueBuffCopy(pMesh->indexBuffCPU.Get(), pool->indexBuffGPU.Get(),
+            indexOffset * sizeof(UINT32), D3D12_RESOURCE_STATE_GENERIC_READ);
+        return true;
+    }
+
+    bool isOwnBatch = !pCore->isUploadBatchOpen;
+    if (isOwnBatch) beginUploadBatch(pCore);
+
+    D3D12_RESOURCE_BARRIER barriers[] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(pool->vertexBuffGPU.Get(),
+            D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST),
+        CD3DX12_RESOURCE_BARRIER::Transition(pool->indexBuffGPU.Get(),
+            D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST)
+    };
+    pCore->cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+    uploadBuffInBatch(pCore, pool->vertexBuffGPU.Get(), vertexOffset * pool->vertexStride, vertexData, vertexDataSize);
+    uploadBuffInBatch(pCore, pool->indexBuffGPU.Get(), indexOffset * sizeof(UINT32), indexData, indexDataSize);
+
+    for (auto& barrier : barriers) std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+    pCore->cmdList->ResourceBarrier(_countof(barriers), barriers);
+
+    if (isOwnBatch) endUploadBatch(pCore);
+    return true;
+}
+
+void releasePooledVmesh(Vmesh* pMesh) {
+    if (pMesh->pool == nullptr) return;
+
+    pMesh->pool->vertexAllocator.free(pMesh->poolVertexOffset, pMesh->vertexBuffCPU->GetBufferSize() / pMesh->pool->vertexStride);
+    pMesh->pool->indexAllocator.free(pMesh->poolIndexOffset, pMesh->indexBuffCPU->GetBufferSize() / sizeof(UINT32));
+
+    pMesh->vertexBuffGPU = nullptr;
+    pMesh->indexBuffGPU = nullptr;
+    pMesh->pool = nullptr;
+    pMesh->poolVertexOffset = pMesh->poolIndexOffset = 0;
+}
+
+Vsubmesh rebasePooledSubmesh(const Vmesh* pMesh, Vsubmesh submesh) {
+    submesh.startIndexLocation += pMesh->poolIndexOffset;
+    submesh.baseVertexLocation += (INT)pMesh->poolVertexOffset;
+    return submesh;
+}
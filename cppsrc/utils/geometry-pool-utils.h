@@ -0,0 +1,32 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "d3dcore/d3dcore.h"
+
+class SceneBuilder;
+
+// The pool buffers stay in D3D12_RESOURCE_STATE_GENERIC_READ except while being copied into.
+void initGeometryPool(D3DCore* pCore, UINT64 vertexCapacity, UINT64 indexCapacity, UINT vertexStride, GeometryPool* pool);
+
+// Suballocate the vertices and indices of the mesh from the pool, and upload them within the current
+// upload batch (see upload-ring-utils.h), or queue them into builder if it is not nullptr.
+// Return FALSE if there is no enough space in the pool, in which case nothing is changed.
+// Note the indices are still relative to the first vertex of the mesh, since the submeshes of the
+// mesh are offset by pMesh->poolVertexOffset (see rebasePooledSubmesh).
+bool initPooledVmesh(D3DCore* pCore, GeometryPool* pool, const void* vertexData, UINT64 vertexCount,
+    const UINT32* indexData, UINT64 indexCount, Vmesh* pMesh, SceneBuilder* builder = nullptr);
+
+// Give the regions of the mesh back to the pool for other meshes to stream in. It must be called only
+// after the GPU has finished all frames drawing the mesh (e.g. after flushCmdQueue). The meshes of
+// initRitemWithPooledGeoInfo call it when the last render item sharing them is destroyed.
+void releasePooledVmesh(Vmesh* pMesh);
+
+// Offset the submesh (relative to the mesh itself) to address into the pool buffers.
+// Nothing is changed if the mesh is not pooled.
+Vsubmesh rebasePooledSubmesh(const Vmesh* pMesh, Vsubmesh submesh);
@@ -6,10 +6,12 @@
 ** yiyaowen (c) 2021 All Rights Reserved.
 */
 
+#include <algorithm>
 #include <memory>
 
 #include "geometry-utils.h"
 #include "math-utils.h"
+#include "thread-utils.h"
 
 ObjectGeometry* copyObjectGeometry(ObjectGeometry* source) {
     std::unique_ptr<ObjectGeometry> geo = std::make_unique<ObjectGeometry>();
@@ -32,51 +34,168 @@ void scaleObjectGeometry(float sx, float sy, float sz, ObjectGeometry* geo) {
     applyObjectGeometryTransform(scalingMat, geo);
 }
 
-void XM_CALLCONV applyObjectGeometryTransform(FXMMATRIX trans, ObjectGeometry* geo) {
-    XMMATRIX invTrTrans = XMMatrixTranspose(XMMatrixInverse(&XMMatrixDeterminant(trans), trans));
-    for (auto& ver : geo->vertices) {
-        XMVECTOR pos = XMLoadFloat3(&ver.pos);
-        pos = XMVector3Transform(pos, trans);
-        XMStoreFloat3(&ver.pos, pos);
-        XMVECTOR nor = XMLoadFloat3(&ver.normal);
-        nor = XMVector3Transform(nor, invTrTrans);
-        XMStoreFloat3(&ver.normal, nor);
+void transformObjectGeometry(XMFLOAT3 scaling, XMFLOAT3 rotation, XMFLOAT3 translation, ObjectGeometry* geo) {
+    XMMATRIX trans = XMMatrixScaling(scaling.x, scaling.y, scaling.z) *
+        XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) *
+        XMMatrixTranslation(translation.x, translation.y, translation.z);
+    applyObjectGeometryTransform(trans, geo);
+}
+
+// Every element of the matrix is splatted into a whole vector, so that 4 points in SoA form
+// can be transformed at a time. The operation order is the same as XMVector3Transform.
+struct SplattedMatrix {
+    XMVECTOR e[4][3];
+};
+
+static void XM_CALLCONV splatMatrix(FXMMATRIX m, SplattedMatrix* sm) {
+    for (int r = 0; r < 4; ++r) {
+        sm->e[r][0] = XMVectorSplatX(m.r[r]);
+        sm->e[r][1] = XMVectorSplatY(m.r[r]);
+        sm->e[r][2] = XMVectorSplatZ(m.r[r]);
     }
 }
 
+static XMVECTOR XM_CALLCONV transformSoaComponent(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, const SplattedMatrix& sm, int c) {
+    XMVECTOR result = XMVectorMultiplyAdd(z, sm.e[2][c], sm.e[3][c]);
+    result = XMVectorMultiplyAdd(y, sm.e[1][c], result);
+    return XMVectorMultiplyAdd(x, sm.e[0][c], result);
+}
+
+// p0 ~ p3 point to the same attribute of 4 vertices, which are transposed to SoA form and back.
+static void transformFloat3x4(const SplattedMatrix& sm, XMFLOAT3* p0, XMFLOAT3* p1, XMFLOAT3* p2, XMFLOAT3* p3) {
+    XMMATRIX soa = XMMatrixTranspose(XMMATRIX(XMLoadFloat3(p0), XMLoadFloat3(p1), XMLoadFloat3(p2), XMLoadFloat3(p3)));
+    XMVECTOR x = transformSoaComponent(soa.r[0], soa.r[1], soa.r[2], sm, 0);
+    XMVECTOR y = transformSoaComponent(soa.r[0], soa.r[1], soa.r[2], sm, 1);
+    XMVECTOR z = transformSoaComponent(soa.r[0], soa.r[1], soa.r[2], sm, 2);
+    XMMATRIX aos = XMMatrixTranspose(XMMATRIX(x, y, z, XMVectorZero()));
+    XMStoreFloat3(p0, aos.r[0]);
+    XMStoreFloat3(p1, aos.r[1]);
+    XMStoreFloat3(p2, aos.r[2]);
+    XMStoreFloat3(p3, aos.r[3]);
+}
+
+static void transformVertexBlock(
+    FXMMATRIX trans, CXMMATRIX invTrTrans,
+    const SplattedMatrix& posTrans, const SplattedMatrix& norTrans,
+    Vertex* pVer, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Vertex* v = pVer + i;
+        transformFloat3x4(posTrans, &v[0].pos, &v[1].pos, &v[2].pos, &v[3].pos);
+        transformFloat3x4(norTrans, &v[0].normal, &v[1].normal, &v[2].normal, &v[3].normal);
+    }
+    for (; i < count; ++i) {
+        XMStoreFloat3(&pVer[i].pos, XMVector3Transform(XMLoadFloat3(&pVer[i].pos), trans));
+        XMStoreFloat3(&pVer[i].normal, XMVector3Transform(XMLoadFloat3(&pVer[i].normal), invTrTrans));
+    }
+}
+
+void XM_CALLCONV applyObjectGeometryTransform(FXMMATRIX trans, ObjectGeometry* geo) {
+    XMVECTOR det = XMMatrixDeterminant(trans);
+    XMMATRIX invTrTrans = XMMatrixTranspose(XMMatrixInverse(&det, trans));
+
+    SplattedMatrix posTrans, norTrans;
+    splatMatrix(trans, &posTrans);
+    splatMatrix(invTrTrans, &norTrans);
+
+    // 2048 vertices (80 KB) per block, which fits in the L2 cache of a single core.
+    Vertex* pVer = geo->vertices.data();
+    parallelFor(0, geo->vertices.size(), 2048, [&](size_t begin, size_t end) {
+        transformVertexBlock(trans, invTrTrans, posTrans, norTrans, pVer + begin, end - begin);
+    });
+}
+
 XMVECTOR XM_CALLCONV calcTriangleClockwiseNormal(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2) {
     XMVECTOR x = v1 - v0;
     XMVECTOR y = v2 - v0;
     return XMVector3Normalize(XMVector3Cross(x, y));
 }
 
-void updateVertexNormals(ObjectGeometry* geo) {
-    auto pVer = geo->vertices.data();
+void buildVertexTriangleAdjacency(const ObjectGeometry* geo, VertexTriangleAdjacency* adj) {
     size_t verCount = geo->vertices.size();
+    size_t cornerCount = geo->indices.size() / 3 * 3;
     auto pIdx = geo->indices.data();
-    size_t idxCount = geo->indices.size();
-    for (size_t i = 0; i * 3 + 2 < idxCount; ++i) {
-        UINT32 i0 = pIdx[i * 3];
-        UINT32 i1 = pIdx[i * 3 + 1];
-        UINT32 i2 = pIdx[i * 3 + 2];
-
-        Vertex v0 = pVer[i0];
-        Vertex v1 = pVer[i1];
-        Vertex v2 = pVer[i2];
-
-        XMVECTOR normal = calcTriangleClockwiseNormal(
-            XMLoadFloat3(&v0.pos),
-            XMLoadFloat3(&v1.pos),
-            XMLoadFloat3(&v2.pos));
-
-        XMStoreFloat3(&pVer[i0].normal, XMLoadFloat3(&v0.normal) += normal);
-        XMStoreFloat3(&pVer[i1].normal, XMLoadFloat3(&v1.normal) += normal);
-        XMStoreFloat3(&pVer[i2].normal, XMLoadFloat3(&v2.normal) += normal);
-    }
-    for (size_t i = 0; i < verCount; ++i) {
-        XMFLOAT3 nor = pVer[i].normal;
-        XMStoreFloat3(&pVer[i].normal, XMVector3Normalize(XMLoadFloat3(&pVer[i].normal)));
-    }
+
+    // Count the corners of every vertex first, and then the prefix sums are the row offsets.
+    adj->offsets.assign(verCount + 1, 0);
+    for (size_t c = 0; c < cornerCount; ++c) ++adj->offsets[pIdx[c] + 1];
+    for (size_t i = 0; i < verCount; ++i) adj->offsets[i + 1] += adj->offsets[i];
+
+    // The corners of each vertex are filled in ascending order, which makes the results deterministic.
+    std::vector<UINT32> cursors(adj->offsets.begin(), adj->offsets.end() - 1);
+    adj->corners.resize(cornerCount);
+    for (size_t c = 0; c < cornerCount; ++c) adj->corners[cursors[pIdx[c]]++] = (UINT32)c;
+}
+
+// The weight of each corner is stored together with the triangle normal so that the gather pass
+// only needs a single multiply-add per corner. Uniform and area weighting share the same corner weight
+// of every triangle, while angle weighting gives each corner its own interior angle.
+static void calcTriangleNormalsAndWeights(const ObjectGeometry* geo, int weighting,
+    std::vector<XMFLOAT4>* triNormals, std::vector<float>* cornerWeights)
+{
+    auto pVer = geo->vertices.data();
+    auto pIdx = geo->indices.data();
+    size_t triCount = geo->indices.size() / 3;
+    triNormals->resize(triCount);
+    cornerWeights->resize(triCount * 3);
+
+    parallelFor(0, triCount, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            XMVECTOR p0 = XMLoadFloat3(&pVer[pIdx[i * 3]].pos);
+            XMVECTOR p1 = XMLoadFloat3(&pVer[pIdx[i * 3 + 1]].pos);
+            XMVECTOR p2 = XMLoadFloat3(&pVer[pIdx[i * 3 + 2]].pos);
+
+            // The length of the cross product is twice the area of the triangle,
+            // so it is left unnormalized for area weighting.
+            XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+            XMVECTOR normal = weighting == VertexTriangleAdjacency::AREA_WEIGHT ? cross : XMVector3Normalize(cross);
+            XMStoreFloat4(&(*triNormals)[i], normal);
+
+            float* w = cornerWeights->data() + i * 3;
+            if (weighting == VertexTriangleAdjacency::ANGLE_WEIGHT) {
+                XMVECTOR e01 = XMVector3Normalize(p1 - p0);
+                XMVECTOR e12 = XMVector3Normalize(p2 - p1);
+                XMVECTOR e20 = XMVector3Normalize(p0 - p2);
+                w[0] = XMVectorGetX(XMVector3AngleBetweenNormals(e01, -e20));
+                w[1] = XMVectorGetX(XMVector3AngleBetweenNormals(e12, -e01));
+                w[2] = XMVectorGetX(XMVector3AngleBetweenNormals(e20, -e12));
+            }
+            else {
+                w[0] = w[1] = w[2] = 1.0f;
+            }
+        }
+    });
+}
+
+void updateVertexNormals(const VertexTriangleAdjacency& adj, int weighting, ObjectGeometry* geo) {
+    std::vector<XMFLOAT4> triNormals = {};
+    std::vector<float> cornerWeights = {};
+    calcTriangleNormalsAndWeights(geo, weighting, &triNormals, &cornerWeights);
+
+    // Every vertex only gathers the triangles connected with it and writes its own normal,
+    // so the vertices can be split across threads without any atomic operation.
+    auto pVer = geo->vertices.data();
+    size_t verCount = (std::min)(geo->vertices.size(), adj.offsets.size() - 1);
+    parallelFor(0, verCount, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            UINT32 first = adj.offsets[i], last = adj.offsets[i + 1];
+            // Keep the original normal of the vertex that is not used by any triangle.
+            if (first == last) continue;
+            XMVECTOR normal = XMVectorZero();
+            for (UINT32 k = first; k < last; ++k) {
+                UINT32 c = adj.corners[k];
+                normal = XMVectorMultiplyAdd(XMVectorReplicate(cornerWeights[c]), XMLoadFloat4(&triNormals[c / 3]), normal);
+            }
+            XMStoreFloat3(&pVer[i].normal, XMVector3Normalize(normal));
+        }
+    });
+}
+
+void updateVertexNormals(ObjectGeometry* geo) {
+    VertexTriangleAdjacency adj = {};
+    buildVertexTriangleAdjacency(geo, &adj);
+    updateVertexNormals(adj, VertexTriangleAdjacency::UNIFORM_WEIGHT, geo);
 }
 
 /*               v0 (0)
@@ -129,6 +248,81 @@ void subdivide(ObjectGeometry* geo) {
     }
 }
 
+// Open addressing hash map from an undirected edge (v0, v1) to the index of its midpoint vertex.
+// The capacity is decided in advance, since the edge count of a triangle list is at most 3 times
+// the triangle count, and the table is kept at most half full to make the probe sequences short.
+struct EdgeMidpointMap {
+    constexpr static UINT64 EMPTY_KEY = ~0ull;
+
+    std::vector<UINT64> keys = {};
+    std::vector<UINT32> values = {};
+    size_t mask = 0;
+};
+
+static void initEdgeMidpointMap(size_t maxEdgeCount, EdgeMidpointMap* map) {
+    size_t capacity = 16;
+    while (capacity < maxEdgeCount * 2) capacity <<= 1;
+    map->keys.assign(capacity, EdgeMidpointMap::EMPTY_KEY);
+    map->values.resize(capacity);
+    map->mask = capacity - 1;
+}
+
+// Return the slot of the edge, which holds either the edge or EMPTY_KEY if not found.
+static size_t findEdgeMidpointSlot(UINT64 key, const EdgeMidpointMap& map) {
+    // Fibonacci hashing, which spreads the consecutive vertex indices well.
+    size_t slot = (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & map.mask;
+    while (map.keys[slot] != key && map.keys[slot] != EdgeMidpointMap::EMPTY_KEY) {
+        slot = (slot + 1) & map.mask;
+    }
+    return slot;
+}
+
+static UINT32 getEdgeMidpoint(UINT32 i0, UINT32 i1, EdgeMidpointMap* map, ObjectGeometry* geo) {
+    UINT64 key = i0 < i1 ? ((UINT64)i0 << 32 | i1) : ((UINT64)i1 << 32 | i0);
+    size_t slot = findEdgeMidpointSlot(key, *map);
+    if (map->keys[slot] == key) return map->values[slot];
+
+    // Note the vertices can NOT be referenced before push_back, which may reallocate the array.
+    Vertex v0 = geo->vertices[i0];
+    Vertex v1 = geo->vertices[i1];
+    UINT32 idx = (UINT32)geo->vertices.size();
+    geo->vertices.push_back({ midpoint(v0.pos, v1.pos), midpoint(v0.normal, v1.normal), midpoint(v0.uv, v1.uv) });
+
+    map->keys[slot] = key;
+    map->values[slot] = idx;
+    return idx;
+}
+
+void subdivideIndexed(ObjectGeometry* geo) {
+    std::vector<UINT32> oldIndices = std::move(geo->indices);
+    size_t triCount = oldIndices.size() / 3;
+
+    EdgeMidpointMap map = {};
+    initEdgeMidpointMap(triCount * 3, &map);
+
+    // A closed mesh has (triCount * 3 / 2) edges, which is also the count of new vertices.
+    geo->vertices.reserve(geo->vertices.size() + triCount * 3 / 2);
+    geo->indices.clear();
+    geo->indices.reserve(triCount * 12);
+
+    for (size_t i = 0; i < triCount; ++i) {
+        UINT32 i0 = oldIndices[i * 3];
+        UINT32 i1 = oldIndices[i * 3 + 1];
+        UINT32 i2 = oldIndices[i * 3 + 2];
+
+        UINT32 i01 = getEdgeMidpoint(i0, i1, &map, geo);
+        UINT32 i12 = getEdgeMidpoint(i1, i2, &map, geo);
+        UINT32 i20 = getEdgeMidpoint(i2, i0, &map, geo);
+
+        // The same twist order as subdivide.
+        geo->indices.insert(geo->indices.end(), {
+            i0, i01, i20,
+            i01, i12, i20,
+            i01, i1, i12,
+            i12, i2, i20 });
+    }
+}
+
 void appendVerticesToObjectGeometry(const std::vector<Vertex>& ver, const std::vector<UINT32>& idx, ObjectGeometry* objGeo) {
     UINT count = (UINT)max(ver.size(), idx.size());
     for (UINT i = 0; i < count; ++i) {
@@ -391,7 +585,7 @@ void generateGeoSphere(float r, int subdivisionLevel, ObjectGeometry* gs) {
         3, 10, 7,   10, 6, 7,   6, 11, 7,   6, 0, 11,   6, 1, 0,
         10, 1, 6,   11, 0, 9,   2, 11, 9,   5, 2, 9,    11, 2, 7 };
 
-    for (int i = 0; i < subdivisionLevel; ++i) subdivide(gs);
+    for (int i = 0; i < subdivisionLevel; ++i) subdivideIndexed(gs);
 
     for (size_t i = 0; i < gs->vertices.size(); ++i) {
         XMVECTOR ver_nor = XMVector3Normalize(XMLoadFloat3(&gs->vertices[i].pos));
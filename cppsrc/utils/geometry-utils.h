@@ -27,21 +27,55 @@ void rotateObjectGeometry(float rx, float ry, float rz, ObjectGeometry* geo);
 
 void scaleObjectGeometry(float sx, float sy, float sz, ObjectGeometry* geo);
 
+// Scale, rotate (roll-pitch-yaw) and then translate the geometry. This is the same as calling
+// scaleObjectGeometry, rotateObjectGeometry and translateObjectGeometry in order, but the vertices
+// are walked only once with the composed matrix.
+void transformObjectGeometry(XMFLOAT3 scaling, XMFLOAT3 rotation, XMFLOAT3 translation, ObjectGeometry* geo);
+
+// The positions are transformed by trans and the normals by its inverse-transpose (without normalized).
+// The vertices are processed 4 at a time in SoA form and the blocks are split across the worker pool
+// (see thread-utils.h). The results are the same as applying XMVector3Transform to every vertex.
 void XM_CALLCONV applyObjectGeometryTransform(FXMMATRIX trans, ObjectGeometry* geo);
 
 XMVECTOR XM_CALLCONV calcTriangleClockwiseNormal(FXMVECTOR v0, FXMVECTOR v1, FXMVECTOR v2);
 
+// Vertex -> triangle adjacency in compressed sparse row (CSR) form. The triangle corners of vertex i
+// are corners[offsets[i]] ~ corners[offsets[i + 1] - 1], where corner c is the (c % 3)th corner of
+// the (c / 3)th triangle. It only depends on the indices, so it can be built once and reused as long
+// as the topology of the geometry is not changed.
+struct VertexTriangleAdjacency {
+    // How the normals of the triangles connected with a vertex are weighted.
+    constexpr static int UNIFORM_WEIGHT = 0; // The mean of the unit triangle normals.
+    constexpr static int AREA_WEIGHT = 1; // Weighted by the area of each triangle.
+    constexpr static int ANGLE_WEIGHT = 2; // Weighted by the interior angle at the vertex.
+
+    std::vector<UINT32> offsets = {};
+    std::vector<UINT32> corners = {};
+};
+
+void buildVertexTriangleAdjacency(const ObjectGeometry* geo, VertexTriangleAdjacency* adj);
+
 // After the vertex positions and indices are decided, the vertex normals can be updated through this func.
-// Note this func simply takes every triangle connected with the target vertex into account and calculates
-// the mean normal vector of those triangles, which may lead to some unexpected results (incorrect normals).
-// To avoid this behaviour, it is recommended to calculate the normals manually by mathematical means.
-// In particular, after applied this func to the geometry without coincident vertices, it will present
-// a kind of appearance of so-called "shader smooth" in many 3D modeling or rendering applications.
+// The normals are recalculated from the triangles connected with every vertex, which overwrites the
+// original ones, except for the vertices not used by any triangle. The vertices are split across the
+// worker pool (see thread-utils.h) and each of them gathers its own triangles, so no atomic is needed.
+// Note the coincident vertices are NOT merged, so a geometry with split vertices (e.g. a cube) keeps
+// its hard edges, while a geometry without coincident vertices presents a kind of appearance of
+// so-called "shader smooth" in many 3D modeling or rendering applications.
+void updateVertexNormals(const VertexTriangleAdjacency& adj, int weighting, ObjectGeometry* geo);
+
+// Build the adjacency and update the normals with uniform weighting.
 void updateVertexNormals(ObjectGeometry* geo);
 
 // Note this func only changes the vertices and indices data and other data may be dirty.
 void subdivide(ObjectGeometry* geo);
 
+// Similar to subdivide, but the midpoint of every edge is shared by the triangles on both sides,
+// and the original vertices are kept in place. Thus the vertex count of a closed mesh grows about
+// 4 times per level (V + E) instead of 6 times (6 * F) and the result is still indexed.
+// Note this func only changes the vertices and indices data and other data may be dirty.
+void subdivideIndexed(ObjectGeometry* geo);
+
 void appendVerticesToObjectGeometry(const std::vector<Vertex>& ver, const std::vector<UINT32>& idx, ObjectGeometry* objGeo);
 
 void generateCube(XMFLOAT3 xyz, ObjectGeometry* cube);
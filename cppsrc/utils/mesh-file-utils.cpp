@@ -0,0 +1,437 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mesh-file-utils.h"
+#include "mesh-optimize-utils.h"
+#include "thread-utils.h"
+
+// Return the line number (starting from 1) of the given position.
+static size_t calcLineNumber(const char* fileBegin, const char* pos) {
+    return (size_t)std::count(fileBegin, pos, '\n') + 1;
+}
+
+static const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    return p;
+}
+
+static const char* findLineEnd(const char* p, const char* end) {
+    auto lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+    return lineEnd != nullptr ? lineEnd : end;
+}
+
+// Return the position after the first occurrence of ch, or nullptr if not found.
+static const char* findAfter(const char* p, const char* end, char ch) {
+    auto found = (const char*)memchr(p, ch, (size_t)(end - p));
+    return found != nullptr ? found + 1 : nullptr;
+}
+
+template<typename T>
+static const char* parseTextMeshNumbers(const char* p, const char* end, T* values, int count) {
+    for (int i = 0; i < count; ++i) {
+        p = skipSpaces(p, end);
+        auto result = std::from_chars(p, end, values[i]);
+        if (result.ec != std::errc()) return nullptr;
+        p = result.ptr;
+    }
+    // Nothing but spaces is allowed after the numbers.
+    p = skipSpaces(p, end);
+    return p == end ? p : nullptr;
+}
+
+// The shortest lines of the lists: 6 single-digit numbers and 5 separators for a vertex,
+// and 3 single-digit numbers and 2 separators for a triangle.
+constexpr size_t MIN_TEXT_VERTEX_LENGTH = 11;
+constexpr size_t MIN_TEXT_TRIANGLE_LENGTH = 5;
+
+// The error of a chunk, which is located by its position in the file.
+struct TextMeshError {
+    const char* pos = nullptr;
+    const char* message = nullptr;
+};
+
+// Every non-blank line in [begin, end) is an element. The section is split into chunks on line boundaries,
+// the lines of each chunk are counted first to decide where the chunk starts in the element array, and
+// then all the chunks are parsed in parallel with parseLine(lineBegin, lineEnd, elementIdx), which returns
+// nullptr on success or an error message otherwise.
+template<typename ParseLineFunc>
+static bool parseTextMeshSection(const char* fileBegin, const char* begin, const char* end,
+    size_t expectedCount, const char* sectionName, ParseLineFunc parseLine, std::string* error)
+{
+    // At least 64 KB per chunk, which is large enough to hide the cost of dispatching.
+    size_t chunkCount = std::clamp<size_t>((size_t)(end - begin) / 65536, 1, workerThreadCount() * 8);
+    std::vector<const char*> bounds(chunkCount + 1, end);
+    bounds[0] = begin;
+    for (size_t k = 1; k < chunkCount; ++k) {
+        const char* nominal = begin + (size_t)(end - begin) * k / chunkCount;
+        bounds[k] = (std::max)(bounds[k - 1], (std::min)(findLineEnd(nominal, end) + 1, end));
+    }
+
+    std::vector<size_t> chunkStarts(chunkCount + 1, 0);
+    parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+            size_t lineCount = 0;
+            for (const char* p = bounds[k]; p < bounds[k + 1];) {
+                const char* lineEnd = findLineEnd(p, bounds[k + 1]);
+                if (skipSpaces(p, lineEnd) != lineEnd) ++lineCount;
+                p = lineEnd + 1;
+            }
+            chunkStarts[k + 1] = lineCount;
+        }
+    });
+    for (size_t k = 0; k < chunkCount; ++k) chunkStarts[k + 1] += chunkStarts[k];
+
+    if (chunkStarts[chunkCount] != expectedCount) {
+        *error = "line " + std::to_string(calcLineNumber(fileBegin, begin)) + ": " + sectionName + " has " +
+            std::to_string(chunkStarts[chunkCount]) + " lines, but " + std::to_string(expectedCount) + " are expected";
+        return false;
+    }
+
+    std::vector<TextMeshError> chunkErrors(chunkCount);
+    parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+            size_t idx = chunkStarts[k];
+            for (const char* p = bounds[k]; p < bounds[k + 1];) {
+                const char* lineEnd = findLineEnd(p, bounds[k + 1]);
+                if (skipSpaces(p, lineEnd) != lineEnd) {
+                    if (auto message = parseLine(p, lineEnd, idx++)) {
+                        chunkErrors[k] = { p, message };
+                        break;
+                    }
+                }
+                p = lineEnd + 1;
+            }
+        }
+    });
+
+    // Report the first error in the file.
+    for (auto& chunkError : chunkErrors) {
+        if (chunkError.pos != nullptr) {
+            *error = "line " + std::to_string(calcLineNumber(fileBegin, chunkError.pos)) + ": " + chunkError.message;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool parseTextMeshFile(const std::string& path,
+    const char* fileBegin, const char* fileEnd, ObjectGeometry* geo, std::string* errorMessage)
+{
+    std::string& error = *errorMessage;
+    auto fail = [&](const char* pos, const std::string& message) {
+        error = path + ": line " + std::to_string(calcLineNumber(fileBegin, pos)) + ": " + message;
+        return false;
+    };
+
+    // Header: "VertexCount: xxx" and "TriangleCount: xxx".
+    UINT counts[2] = {};
+    const char* p = fileBegin;
+    const char* countNames[2] = { "VertexCount:", "TriangleCount:" };
+    for (int i = 0; i < 2; ++i) {
+        while (p < fileEnd && isspace((unsigned char)*p)) ++p;
+        const char* lineEnd = findLineEnd(p, fileEnd);
+        size_t nameLength = strlen(countNames[i]);
+        if ((size_t)(lineEnd - p) < nameLength || memcmp(p, countNames[i], nameLength) != 0 ||
+            parseTextMeshNumbers(p + nameLength, lineEnd, &counts[i], 1) == nullptr) {
+            return fail(p, std::string("expected \"") + countNames[i] + " <count>\"");
+        }
+        p = lineEnd;
+    }
+    UINT verCount = counts[0], triCount = counts[1];
+
+    // The vertex list and the triangle list are both enclosed in braces, and the numbers never contain them.
+    const char* verBegin = findAfter(p, fileEnd, '{');
+    if (verBegin == nullptr) return fail(fileEnd, "vertex list is not found");
+    const char* verEnd = findAfter(verBegin, fileEnd, '}');
+    if (verEnd == nullptr) return fail(fileEnd, "vertex list is not closed");
+    const char* triBegin = findAfter(verEnd, fileEnd, '{');
+    if (triBegin == nullptr) return fail(fileEnd, "triangle list is not found");
+    const char* triEnd = findAfter(triBegin, fileEnd, '}');
+    if (triEnd == nullptr) return fail(fileEnd, "triangle list is not closed");
+
+    // Reject the counts that the lists can not hold before allocating, so a corrupt header is reported instead of
+    // exhausting the memory. See MIN_TEXT_VERTEX_LENGTH and MIN_TEXT_TRIANGLE_LENGTH.
+    if ((size_t)verCount * MIN_TEXT_VERTEX_LENGTH > (size_t)(verEnd - verBegin)) {
+        return fail(verBegin, "vertex list is too short for " + std::to_string(verCount) + " vertices");
+    }
+    if ((size_t)triCount * MIN_TEXT_TRIANGLE_LENGTH > (size_t)(triEnd - triBegin)) {
+        return fail(triBegin, "triangle list is too short for " + std::to_string(triCount) + " triangles");
+    }
+
+    geo->vertices.assign(verCount, Vertex{});
+    geo->indices.resize((size_t)triCount * 3);
+    std::string sectionError;
+
+    bool isVertexListValid = parseTextMeshSection(fileBegin, verBegin, verEnd - 1, verCount, "vertex list",
+        [&](const char* lineBegin, const char* lineEnd, size_t idx) -> const char* {
+            float v[6];
+            if (parseTextMeshNumbers(lineBegin, lineEnd, v, 6) == nullptr) return "expected 6 floats (pos, normal)";
+            geo->vertices[idx].pos = { v[0], v[1], v[2] };
+            geo->vertices[idx].normal = { v[3], v[4], v[5] };
+            return nullptr;
+        }, &sectionError);
+    if (!isVertexListValid) {
+        error = path + ": " + sectionError;
+        return false;
+    }
+
+    bool isTriangleListValid = parseTextMeshSection(fileBegin, triBegin, triEnd - 1, triCount, "triangle list",
+        [&](const char* lineBegin, const char* lineEnd, size_t idx) -> const char* {
+            UINT32* tri = geo->indices.data() + idx * 3;
+            if (parseTextMeshNumbers(lineBegin, lineEnd, tri, 3) == nullptr) return "expected 3 vertex indices";
+            if (tri[0] >= verCount || tri[1] >= verCount || tri[2] >= verCount) return "vertex index out of range";
+            return nullptr;
+        }, &sectionError);
+    if (!isTriangleListValid) {
+        error = path + ": " + sectionError;
+        return false;
+    }
+
+    geo->locationInfo.indexCount = (UINT)geo->indices.size();
+    geo->locationInfo.startIndexLocation = 0;
+    geo->locationInfo.baseVertexLocation = 0;
+    return true;
+}
+
+bool loadTextMeshFile(const std::string& path, ObjectGeometry* geo, std::string* errorMessage) {
+    std::string localError;
+    std::string& error = errorMessage != nullptr ? *errorMessage : localError;
+
+    MappedFileView view = {};
+    if (!mapFileView(path, &view)) {
+        error = path + ": can not be read";
+        return false;
+    }
+    bool isLoaded = parseTextMeshFile(path, (const char*)view.data, (const char*)view.data + view.size, geo, &error);
+    unmapFileView(&view);
+    return isLoaded;
+}
+
+bool loadTextMeshFileReference(const std::string& path, ObjectGeometry* geo) {
+    std::ifstream fin(path);
+    if (!fin.is_open()) return false;
+    fin.seekg(0, std::ios::end);
+    size_t fileSize = (size_t)fin.tellg();
+    fin.seekg(0, std::ios::beg);
+    std::string ignore;
+    UINT verCount = 0, triCount = 0;
+    fin >> ignore >> verCount;
+    fin >> ignore >> triCount;
+    // Same bound as loadTextMeshFile, but over the whole file since the lists are not located.
+    if (!fin || (size_t)verCount * MIN_TEXT_VERTEX_LENGTH + (size_t)triCount * MIN_TEXT_TRIANGLE_LENGTH > fileSize) {
+        return false;
+    }
+    geo->vertices.assign(verCount, Vertex{});
+    geo->indices.resize((size_t)triCount * 3);
+    fin >> ignore >> ignore >> ignore >> ignore;
+    for (UINT i = 0; i < verCount; ++i) {
+        Vertex& ver = geo->vertices[i];
+        fin >> ver.pos.x >> ver.pos.y >> ver.pos.z;
+        fin >> ver.normal.x >> ver.normal.y >> ver.normal.z;
+    }
+    fin >> ignore >> ignore >> ignore;
+    for (size_t i = 0; i < triCount; ++i) {
+        fin >> geo->indices[i * 3];
+        fin >> geo->indices[i * 3 + 1];
+        fin >> geo->indices[i * 3 + 2];
+    }
+    geo->locationInfo.indexCount = (UINT)geo->indices.size();
+    geo->locationInfo.startIndexLocation = 0;
+    geo->locationInfo.baseVertexLocation = 0;
+    return true;
+}
+
+bool writeTextMeshFile(const std::string& path, const ObjectGeometry* geo) {
+    std::ofstream fout(path, std::ios::trunc);
+    if (!fout.is_open()) return false;
+    size_t triCount = geo->indices.size() / 3;
+    char line[256];
+    auto writeLine = [&](int length) { fout.write(line, (std::streamsize)length); };
+    writeLine(snprintf(line, sizeof(line), "VertexCount: %zu\nTriangleCount: %zu\nVertexList (pos, normal)\n{\n", geo->vertices.size(), triCount));
+    // 9 significant digits are enough to restore every float exactly.
+    for (auto& ver : geo->vertices) {
+        writeLine(snprintf(line, sizeof(line), "\t%.9g %.9g %.9g %.9g %.9g %.9g\n",
+            ver.pos.x, ver.pos.y, ver.pos.z, ver.normal.x, ver.normal.y, ver.normal.z));
+    }
+    fout << "}\nTriangleList\n{\n";
+    for (size_t i = 0; i < triCount; ++i) {
+        writeLine(snprintf(line, sizeof(line), "\t%u %u %u\n", geo->indices[i * 3], geo->indices[i * 3 + 1], geo->indices[i * 3 + 2]));
+    }
+    fout << "}\n";
+    return fout.good();
+}
+
+static UINT64 alignMeshFileOffset(UINT64 offset) {
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+}
+
+bool writeBinaryMeshFile(const std::string& path, const ObjectGeometry* geo, const std::string& name) {
+    MeshFileHeader header = {};
+    header.submeshCount = 1;
+    header.submeshTableOffset = alignMeshFileOffset(sizeof(MeshFileHeader));
+    header.vertexCount = geo->vertices.size();
+    header.vertexDataOffset = alignMeshFileOffset(header.submeshTableOffset + sizeof(MeshFileSubmesh));
+    header.indexCount = geo->indices.size();
+    header.indexDataOffset = alignMeshFileOffset(header.vertexDataOffset + header.vertexCount * sizeof(Vertex));
+
+    MeshFileSubmesh submesh = {};
+    name.copy(submesh.name, sizeof(submesh.name) - 1);
+    submesh.location = geo->locationInfo;
+
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    if (!fout.is_open()) return false;
+
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    auto writeAt = [&](UINT64 offset, const void* data, UINT64 byteSize) {
+        fout.write(padding, (std::streamsize)(offset - (UINT64)fout.tellp()));
+        fout.write((const char*)data, (std::streamsize)byteSize);
+    };
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.submeshTableOffset, &submesh, sizeof(submesh));
+    writeAt(header.vertexDataOffset, geo->vertices.data(), header.vertexCount * sizeof(Vertex));
+    writeAt(header.indexDataOffset, geo->indices.data(), header.indexCount * sizeof(UINT32));
+    return fout.good();
+}
+
+bool mapFileView(const std::string& path, MappedFileView* view) {
+    *view = {};
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    view->fileHandle = hFile;
+    LARGE_INTEGER fileSize = {};
+    if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0) {
+        view->size = (UINT64)fileSize.QuadPart;
+        view->mappingHandle = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (view->mappingHandle != nullptr) {
+            view->data = MapViewOfFile(view->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st = {};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        view->size = (UINT64)st.st_size;
+        void* data = mmap(nullptr, (size_t)view->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) view->data = data;
+    }
+    // The mapping is still valid after the descriptor is closed.
+    close(fd);
+#endif
+    if (view->data == nullptr) {
+        unmapFileView(view);
+        return false;
+    }
+    return true;
+}
+
+void unmapFileView(MappedFileView* view) {
+#ifdef _WIN32
+    if (view->data != nullptr) UnmapViewOfFile(view->data);
+    if (view->mappingHandle != nullptr) CloseHandle(view->mappingHandle);
+    if (view->fileHandle != nullptr) CloseHandle(view->fileHandle);
+#else
+    if (view->data != nullptr) munmap((void*)view->data, (size_t)view->size);
+#endif
+    *view = {};
+}
+
+static bool validateMappedMeshFile(MappedMeshFile* file) {
+    UINT64 viewSize = file->view.size;
+    if (viewSize < sizeof(MeshFileHeader)) return false;
+    auto base = (const BYTE*)file->view.data;
+    auto header = (const MeshFileHeader*)base;
+    if (memcmp(header->magic, MeshFileHeader{}.magic, sizeof(header->magic)) != 0 ||
+        header->version != MESH_FILE_VERSION || header->vertexStride != sizeof(Vertex)) return false;
+
+    auto isInView = [&](UINT64 offset, UINT64 count, UINT64 stride) {
+        return offset % MESH_FILE_ALIGNMENT == 0 && offset <= viewSize && count <= (viewSize - offset) / stride;
+    };
+    if (!isInView(header->submeshTableOffset, header->submeshCount, sizeof(MeshFileSubmesh)) ||
+        !isInView(header->vertexDataOffset, header->vertexCount, sizeof(Vertex)) ||
+        !isInView(header->indexDataOffset, header->indexCount, sizeof(UINT32))) return false;
+
+    // A submesh must not draw past the index data, and its name must be terminated.
+    auto submeshes = (const MeshFileSubmesh*)(base + header->submeshTableOffset);
+    for (UINT32 i = 0; i < header->submeshCount; ++i) {
+        auto& location = submeshes[i].location;
+        if ((UINT64)location.startIndexLocation + location.indexCount > header->indexCount ||
+            location.baseVertexLocation < 0 || (UINT64)location.baseVertexLocation > header->vertexCount ||
+            memchr(submeshes[i].name, '\0', sizeof(submeshes[i].name)) == nullptr) return false;
+    }
+
+    file->header = header;
+    file->submeshes = submeshes;
+    file->vertices = (const Vertex*)(base + header->vertexDataOffset);
+    file->indices = (const UINT32*)(base + header->indexDataOffset);
+    return true;
+}
+
+bool mapBinaryMeshFile(const std::string& path, MappedMeshFile* file) {
+    *file = {};
+    if (!mapFileView(path, &file->view)) return false;
+    if (!validateMappedMeshFile(file)) {
+        unmapBinaryMeshFile(file);
+        return false;
+    }
+    return true;
+}
+
+void unmapBinaryMeshFile(MappedMeshFile* file) {
+    unmapFileView(&file->view);
+    *file = {};
+}
+
+bool loadBinaryMeshFile(const std::string& path, ObjectGeometry* geo) {
+    MappedMeshFile file = {};
+    if (!mapBinaryMeshFile(path, &file)) return false;
+    geo->vertices.assign(file.vertices, file.vertices + file.header->vertexCount);
+    geo->indices.assign(file.indices, file.indices + file.header->indexCount);
+    if (file.header->submeshCount > 0) {
+        geo->locationInfo = file.submeshes[0].location;
+    }
+    else {
+        geo->locationInfo = { (UINT)geo->indices.size(), 0, 0 };
+    }
+    unmapBinaryMeshFile(&file);
+    return true;
+}
+
+bool loadCachedTextMeshFile(const std::string& textPath, const std::string& cachePath,
+    ObjectGeometry* geo, std::string* errorMessage)
+{
+    std::error_code ec;
+    auto textTime = std::filesystem::last_write_time(textPath, ec);
+    bool hasText = !ec;
+    auto cacheTime = std::filesystem::last_write_time(cachePath, ec);
+    bool isCacheValid = !ec && (!hasText || cacheTime >= textTime);
+
+    if (isCacheValid && loadBinaryMeshFile(cachePath, geo)) return true;
+    if (!loadTextMeshFile(textPath, geo, errorMessage)) return false;
+    // The geometry is optimized only once when it is converted, since the cache keeps the result.
+    optimizeObjectGeometry(geo, true);
+    // It does not matter if the cache fails to be written, e.g. in a read-only directory.
+    writeBinaryMeshFile(cachePath, geo);
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <string>
+
+#include "geometry-utils.h"
+
+// Text mesh file, e.g. models/skull.txt. Only positions and normals are stored.
+//
+// VertexCount: 31076
+// TriangleCount: 60339
+// VertexList (pos, normal)
+// {
+//     0.592978 1.92413 -2.62486 0.572276 0.611288 -0.546668
+//     ...
+// }
+// TriangleList
+// {
+//     0 1 2
+//     ...
+// }
+
+// The whole file is mapped into memory in one go, and then the vertex list and the triangle list are split into chunks
+// on line boundaries, which are parsed with std::from_chars across the worker pool (see thread-utils.h).
+// Return FALSE if the file can not be read or is malformed, and the reason (with the line number)
+// is written into errorMessage if it is not nullptr. Blank lines are allowed in the lists.
+bool loadTextMeshFile(const std::string& path, ObjectGeometry* geo, std::string* errorMessage = nullptr);
+
+// The original single-threaded iostream parser, which is kept as the reference of loadTextMeshFile.
+// Note it does not check the file format, except that the counts in the header must fit in the file.
+bool loadTextMeshFileReference(const std::string& path, ObjectGeometry* geo);
+
+bool writeTextMeshFile(const std::string& path, const ObjectGeometry* geo);
+
+// Binary mesh file (*.rsmesh), which is a raw dump of the geometry in little endian:
+//
+// | MeshFileHeader | MeshFileSubmesh x submeshCount | Vertex x vertexCount | UINT32 x indexCount |
+//
+// Every section starts at a 64-byte aligned offset, so the vertex and index data can be used
+// in place after the file is mapped into memory, without any per-element parsing.
+
+// Version 2 caches the geometry optimized by optimizeObjectGeometry, so the caches of version 1 are rebuilt.
+constexpr UINT32 MESH_FILE_VERSION = 2;
+constexpr UINT64 MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileHeader {
+    char magic[8] = { 'R', 'S', 'M', 'E', 'S', 'H', '\0', '\0' };
+    UINT32 version = MESH_FILE_VERSION;
+    UINT32 vertexStride = sizeof(Vertex); // Checked when loaded, since the layout of Vertex may change.
+    UINT32 submeshCount = 0;
+    UINT32 reserved = 0;
+    UINT64 submeshTableOffset = 0;
+    UINT64 vertexDataOffset = 0, vertexCount = 0;
+    UINT64 indexDataOffset = 0, indexCount = 0;
+};
+static_assert(sizeof(MeshFileHeader) == 64, "Unexpected mesh file header size.");
+
+struct MeshFileSubmesh {
+    char name[52] = {}; // Null-terminated.
+    Vsubmesh location = {};
+};
+static_assert(sizeof(MeshFileSubmesh) == 64, "Unexpected mesh file submesh size.");
+
+// The whole geometry is written as a single submesh with the given name and geo->locationInfo.
+bool writeBinaryMeshFile(const std::string& path, const ObjectGeometry* geo, const std::string& name = "main");
+
+// A read-only view of a whole file mapped into memory.
+struct MappedFileView {
+    const void* data = nullptr;
+    UINT64 size = 0;
+    void* fileHandle = nullptr; // Only used on Windows.
+    void* mappingHandle = nullptr; // Only used on Windows.
+};
+
+// Return FALSE if the file can not be opened or is empty.
+bool mapFileView(const std::string& path, MappedFileView* view);
+
+void unmapFileView(MappedFileView* view);
+
+// A read-only view of a binary mesh file mapped into memory.
+// The pointers are valid until the file is unmapped.
+struct MappedMeshFile {
+    const MeshFileHeader* header = nullptr;
+    const MeshFileSubmesh* submeshes = nullptr;
+    const Vertex* vertices = nullptr;
+    const UINT32* indices = nullptr;
+
+    MappedFileView view = {};
+};
+
+// Return FALSE if the file can not be mapped or is not a valid binary mesh file.
+bool mapBinaryMeshFile(const std::string& path, MappedMeshFile* file);
+
+void unmapBinaryMeshFile(MappedMeshFile* file);
+
+// Copy the data of a mapped binary mesh file into geo. The first submesh is used as geo->locationInfo.
+bool loadBinaryMeshFile(const std::string& path, ObjectGeometry* geo);
+
+// Load the binary cache if it is newer than the text file, otherwise parse the text file, optimize it
+// with optimizeObjectGeometry (see mesh-optimize-utils.h) and (re)write the cache. Return FALSE only if neither of them can be loaded, see loadTextMeshFile for errorMessage.
+bool loadCachedTextMeshFile(const std::string& textPath, const std::string& cachePath,
+    ObjectGeometry* geo, std::string* errorMessage = nullptr);
@@ -0,0 +1,186 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <cstdint>
+#include <cstring>
+
+#include "mesh-optimize-utils.h"
+
+VertexCacheStats simulateVertexCache(const ObjectGeometry* geo, UINT cacheSize) {
+    VertexCacheStats stats = {};
+    size_t verCount = geo->vertices.size();
+    size_t idxCount = geo->indices.size() / 3 * 3;
+    if (idxCount == 0 || cacheSize == 0) return stats;
+
+    // A vertex inserted as the Nth miss is evicted by the (N + cacheSize)th miss.
+    constexpr INT64 NEVER_CACHED = INT64_MIN / 2;
+    std::vector<INT64> missStamps(verCount, NEVER_CACHED);
+    std::vector<bool> isUsed(verCount, false);
+    INT64 missCount = 0;
+    size_t usedCount = 0;
+    for (size_t i = 0; i < idxCount; ++i) {
+        UINT32 v = geo->indices[i];
+        if (missCount - missStamps[v] > (INT64)cacheSize) missStamps[v] = missCount++;
+        if (!isUsed[v]) {
+            isUsed[v] = true;
+            ++usedCount;
+        }
+    }
+    stats.acmr = (double)missCount / (double)(idxCount / 3);
+    stats.atvr = (double)missCount / (double)usedCount;
+    return stats;
+}
+
+/*
+ * Tipsify: start from a vertex (the fanning vertex) and emit all of its live triangles, then choose the
+ * next fanning vertex among the vertices just emitted, preferring the one that is still in the cache and
+ * whose remaining triangles will not push it out. If none of them has live triangles, fall back to the
+ * most recently emitted vertex with live triangles (dead-end stack), and then to the next one in input order.
+*/
+
+void optimizeVertexCache(ObjectGeometry* geo, UINT cacheSize) {
+    size_t verCount = geo->vertices.size();
+    size_t triCount = geo->indices.size() / 3;
+    if (triCount == 0) return;
+
+    VertexTriangleAdjacency adj = {};
+    buildVertexTriangleAdjacency(geo, &adj);
+
+    std::vector<UINT32> liveTriCounts(verCount);
+    for (size_t v = 0; v < verCount; ++v) liveTriCounts[v] = adj.offsets[v + 1] - adj.offsets[v];
+
+    std::vector<INT64> cacheStamps(verCount, 0);
+    std::vector<bool> isEmitted(triCount, false);
+    std::vector<UINT32> deadEnds = {};
+    std::vector<UINT32> candidates = {};
+    std::vector<UINT32> newIndices = {};
+    newIndices.reserve(triCount * 3);
+
+    INT64 stamp = cacheSize + 1;
+    size_t cursor = 0; // Next vertex in input order to check for dead-end fallback.
+
+    auto skipDeadEnd = [&]() -> INT64 {
+        while (!deadEnds.empty()) {
+            UINT32 d = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriCounts[d] > 0) return d;
+        }
+        for (; cursor < verCount; ++cursor) {
+            if (liveTriCounts[cursor] > 0) return (INT64)cursor;
+        }
+        return -1;
+    };
+
+    INT64 fanning = skipDeadEnd();
+    while (fanning >= 0) {
+        candidates.clear();
+        for (UINT32 k = adj.offsets[fanning]; k < adj.offsets[fanning + 1]; ++k) {
+            UINT32 t = adj.corners[k] / 3;
+            if (isEmitted[t]) continue;
+            isEmitted[t] = true;
+            for (int c = 0; c < 3; ++c) {
+                UINT32 v = geo->indices[t * 3 + c];
+                newIndices.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriCounts[v];
+                if (stamp - cacheStamps[v] > (INT64)cacheSize) cacheStamps[v] = stamp++;
+            }
+        }
+
+        // Choose the next fanning vertex among the candidates.
+        INT64 best = -1, bestPriority = -1;
+        for (UINT32 v : candidates) {
+            if (liveTriCounts[v] == 0) continue;
+            // The vertex is still in the cache after its live triangles are emitted, prefer the oldest one.
+            INT64 priority = 0;
+            INT64 age = stamp - cacheStamps[v];
+            if (age + 2 * (INT64)liveTriCounts[v] <= (INT64)cacheSize) priority = age;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        fanning = best >= 0 ? best : skipDeadEnd();
+    }
+
+    geo->indices = std::move(newIndices);
+}
+
+void optimizeVertexFetch(ObjectGeometry* geo) {
+    constexpr UINT32 UNMAPPED = ~0u;
+    std::vector<UINT32> remap(geo->vertices.size(), UNMAPPED);
+    std::vector<Vertex> newVertices = {};
+    newVertices.reserve(geo->vertices.size());
+    for (auto& idx : geo->indices) {
+        if (remap[idx] == UNMAPPED) {
+            remap[idx] = (UINT32)newVertices.size();
+            newVertices.push_back(geo->vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    geo->vertices = std::move(newVertices);
+}
+
+// 64-bit FNV-1a over the raw bytes of a vertex.
+static UINT64 hashVertex(const Vertex& v) {
+    auto bytes = (const BYTE*)&v;
+    UINT64 hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < sizeof(Vertex); ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+size_t weldVertices(ObjectGeometry* geo) {
+    size_t verCount = geo->vertices.size();
+    if (verCount == 0) return 0;
+
+    // Open addressing table of vertex indices, which is kept at most half full.
+    constexpr UINT32 EMPTY_SLOT = ~0u;
+    size_t capacity = 16;
+    while (capacity < verCount * 2) capacity <<= 1;
+    std::vector<UINT32> slots(capacity, EMPTY_SLOT);
+
+    std::vector<UINT32> remap(verCount);
+    std::vector<Vertex> newVertices = {};
+    newVertices.reserve(verCount);
+    for (size_t i = 0; i < verCount; ++i) {
+        const Vertex& v = geo->vertices[i];
+        size_t slot = (size_t)hashVertex(v) & (capacity - 1);
+        while (slots[slot] != EMPTY_SLOT && memcmp(&newVertices[slots[slot]], &v, sizeof(Vertex)) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (slots[slot] == EMPTY_SLOT) {
+            slots[slot] = (UINT32)newVertices.size();
+            newVertices.push_back(v);
+        }
+        remap[i] = slots[slot];
+    }
+    for (auto& idx : geo->indices) idx = remap[idx];
+
+    size_t removedCount = verCount - newVertices.size();
+    geo->vertices = std::move(newVertices);
+    return removedCount;
+}
+
+void optimizeObjectGeometry(ObjectGeometry* geo, bool weld, MeshOptimizeReport* report) {
+    if (report != nullptr) {
+        report->vertexCountBefore = geo->vertices.size();
+        report->before = simulateVertexCache(geo);
+    }
+    size_t weldedVertexCount = weld ? weldVertices(geo) : 0;
+    optimizeVertexCache(geo);
+    optimizeVertexFetch(geo);
+    if (report != nullptr) {
+        report->vertexCountAfter = geo->vertices.size();
+        report->weldedVertexCount = weldedVertexCount;
+        report->after = simulateVertexCache(geo);
+    }
+}
@@ -0,0 +1,42 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "geometry-utils.h"
+
+// The post-transform vertex cache is simulated as a FIFO of cacheSize entries, which is a common
+// approximation of the hardware. See "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// (Sander et al., 2007) for details.
+constexpr UINT DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    double acmr = 0.0; // Average cache miss ratio, i.e. transformed vertices per triangle (0.5 ~ 3.0).
+    double atvr = 0.0; // Average transformed vertex ratio, i.e. transformed vertices per vertex (>= 1.0).
+};
+
+VertexCacheStats simulateVertexCache(const ObjectGeometry* geo, UINT cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorder the triangles with the Tipsify algorithm, which runs in linear time.
+void optimizeVertexCache(ObjectGeometry* geo, UINT cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorder the vertices to the order of their first uses in the indices, so the vertex fetches are
+// as sequential as possible. The vertices not used by any triangle are removed.
+void optimizeVertexFetch(ObjectGeometry* geo);
+
+// Merge the vertices with bit-identical attributes, and return the count of removed vertices.
+size_t weldVertices(ObjectGeometry* geo);
+
+struct MeshOptimizeReport {
+    size_t vertexCountBefore = 0, vertexCountAfter = 0;
+    size_t weldedVertexCount = 0; // Removed by weldVertices, which is not counted if weld is FALSE.
+    VertexCacheStats before = {}, after = {};
+};
+
+// Run weldVertices (optional), optimizeVertexCache and optimizeVertexFetch in order.
+// Note the whole index buffer is treated as a single triangle list and geo->locationInfo is kept.
+void optimizeObjectGeometry(ObjectGeometry* geo, bool weld, MeshOptimizeReport* report = nullptr);
@@ -0,0 +1,79 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "obj-consts-utils.h"
+
+void initObjConstsShadow(UINT seatCount, UINT seatSize, UINT instanceCount, ObjConstsShadow* pShadow) {
+    pShadow->seatSize = seatSize;
+    pShadow->seats.assign((size_t)seatCount * seatSize, 0);
+    pShadow->instances.assign(instanceCount, InstanceData{});
+    for (auto ritem : pShadow->dirtyRitems) ritem->isObjConstsQueued = false;
+    pShadow->dirtyRitems.clear();
+}
+
+void queueRitemObjConsts(RenderItem* pRitem, ObjConstsShadow* pShadow) {
+    if (pRitem->isObjConstsQueued) return;
+    pRitem->isObjConstsQueued = true;
+    pShadow->dirtyRitems.push_back(pRitem);
+}
+
+void flushObjConstsShadow(ObjConstsShadow* pShadow,
+    DirtySeatSet* const* ppSeatSet, DirtySeatSet* const* ppInstSet, size_t seatSetCount)
+{
+    size_t seatCount = pShadow->seatSize > 0 ? pShadow->seats.size() / pShadow->seatSize : 0;
+    for (auto ritem : pShadow->dirtyRitems) {
+        ritem->isObjConstsQueued = false;
+
+        if (!ritem->instances.empty()) {
+            if (ppInstSet == nullptr || ritem->instBuffStartIdx + ritem->instances.size() > pShadow->instances.size()) continue;
+
+            std::copy(ritem->instances.begin(), ritem->instances.end(), pShadow->instances.begin() + ritem->instBuffStartIdx);
+            for (size_t i = 0; i < seatSetCount; ++i) {
+                ppInstSet[i]->mark(ritem->instBuffStartIdx, (uint32_t)ritem->instances.size());
+            }
+            continue;
+        }
+        if (ritem->objConstBuffStartIdx + ritem->objConstBuffSeatCount > seatCount) continue;
+
+        // Note the padding bytes of each seat are not touched, which are always 0.
+        for (UINT i = 0; i < ritem->objConstBuffSeatCount; ++i) {
+            memcpy(pShadow->seats.data() + (size_t)(ritem->objConstBuffStartIdx + i) * pShadow->seatSize,
+                &ritem->constData[i], sizeof(ObjConsts));
+        }
+        for (size_t i = 0; i < seatSetCount; ++i) {
+            ppSeatSet[i]->mark(ritem->objConstBuffStartIdx, ritem->objConstBuffSeatCount);
+        }
+    }
+    pShadow->dirtyRitems.clear();
+}
+
+// Copy the dirty ranges of seatSize bytes each from src to dest, then clear the seat set.
+static ObjConstsWriteStats writeDirtySeats(const BYTE* src, size_t seatSize, DirtySeatSet* pSeatSet, BYTE* dest) {
+    ObjConstsWriteStats stats = {};
+    uint32_t first = 0, count = 0;
+    for (uint32_t seat = 0; pSeatSet->findRange(seat, &first, &count); seat = first + count) {
+        size_t offset = first * seatSize;
+        memcpy(dest + offset, src + offset, count * seatSize);
+        stats.seatCount += count;
+        ++stats.rangeCount;
+    }
+    stats.byteSize = (UINT64)stats.seatCount * seatSize;
+    pSeatSet->clear();
+    return stats;
+}
+
+ObjConstsWriteStats writeDirtyObjConsts(const ObjConstsShadow& shadow, DirtySeatSet* pSeatSet, BYTE* objConstBuff) {
+    return writeDirtySeats(shadow.seats.data(), shadow.seatSize, pSeatSet, objConstBuff);
+}
+
+ObjConstsWriteStats writeDirtyInstances(const ObjConstsShadow& shadow, DirtySeatSet* pInstSet, BYTE* instBuff) {
+    return writeDirtySeats((const BYTE*)shadow.instances.data(), sizeof(InstanceData), pInstSet, instBuff);
+}
@@ -0,0 +1,42 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <d3d12.h>
+
+#include "d3dcore/frame-async.h"
+#include "dirty-seat-set.h"
+
+// The object constants are updated in 2 steps, so a frame only pays for the seats that are changed:
+// 1. flushObjConstsShadow copies constData (or instances) of the queued render items into the shadow, and marks
+//    their seats dirty in the seat sets of all frame resources.
+// 2. writeDirtyObjConsts and writeDirtyInstances copy the dirty ranges of the current frame resource from the shadow.
+// These funcs do not depend on D3DCore, see updateCurrObjConstBuff in frame-async-utils.h for the usage.
+
+struct ObjConstsWriteStats {
+    UINT seatCount = 0; // Seats (or instances) written.
+    UINT rangeCount = 0; // memcpy calls.
+    UINT64 byteSize = 0; // Bytes written.
+};
+
+// The shadow is zeroed and the queue is cleared. seatSize is the stride of the seats, e.g. 256 bytes.
+void initObjConstsShadow(UINT seatCount, UINT seatSize, UINT instanceCount, ObjConstsShadow* pShadow);
+
+// The render item is queued only once until the next flush.
+void queueRitemObjConsts(RenderItem* pRitem, ObjConstsShadow* pShadow);
+
+// ppSeatSet[i] and ppInstSet[i] are the seat sets of the object constants and the instances of a frame resource.
+// ppInstSet can be nullptr if there is no instanced render item.
+void flushObjConstsShadow(ObjConstsShadow* pShadow,
+    DirtySeatSet* const* ppSeatSet, DirtySeatSet* const* ppInstSet, size_t seatSetCount);
+
+// The seat set is cleared after the dirty seats are written into objConstBuff.
+ObjConstsWriteStats writeDirtyObjConsts(const ObjConstsShadow& shadow, DirtySeatSet* pSeatSet, BYTE* objConstBuff);
+
+// The seat set is cleared after the dirty instances are written into instBuff.
+ObjConstsWriteStats writeDirtyInstances(const ObjConstsShadow& shadow, DirtySeatSet* pInstSet, BYTE* instBuff);
@@ -0,0 +1,181 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "packed-vertex-utils.h"
+#include "thread-utils.h"
+
+// Same as the conversions of DXGI_FORMAT_R16_SNORM and DXGI_FORMAT_R16_UNORM.
+
+static inline INT16 encodeSnorm16(float x) {
+    x = (std::min)((std::max)(x, -1.0f), 1.0f);
+    return (INT16)lroundf(x * 32767.0f);
+}
+
+static inline float decodeSnorm16(INT16 x) {
+    return (std::max)(x / 32767.0f, -1.0f);
+}
+
+static inline UINT16 encodeUnorm16(float x) {
+    x = (std::min)((std::max)(x, 0.0f), 1.0f);
+    return (UINT16)lroundf(x * 65535.0f);
+}
+
+static inline float decodeUnorm16(UINT16 x) {
+    return x / 65535.0f;
+}
+
+static inline float signNotZero(float x) {
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+XMFLOAT2 encodeOctahedralNormal(XMFLOAT3 normal) {
+    float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (l1 == 0.0f) return { 0.0f, 0.0f };
+    float x = normal.x / l1;
+    float y = normal.y / l1;
+    // Fold the lower hemisphere onto the corners of the square.
+    if (normal.z < 0.0f) {
+        float foldedX = (1.0f - fabsf(y)) * signNotZero(x);
+        float foldedY = (1.0f - fabsf(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    return { x, y };
+}
+
+XMFLOAT3 decodeOctahedralNormal(XMFLOAT2 code) {
+    XMFLOAT3 n = { code.x, code.y, 1.0f - fabsf(code.x) - fabsf(code.y) };
+    if (n.z < 0.0f) {
+        n.x = (1.0f - fabsf(code.y)) * signNotZero(code.x);
+        n.y = (1.0f - fabsf(code.x)) * signNotZero(code.y);
+    }
+    float len = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+    return { n.x / len, n.y / len, n.z / len };
+}
+
+VertexDequantization calcVertexDequantization(const ObjectGeometry* geo) {
+    VertexDequantization dequant = {};
+    if (geo->vertices.empty()) return dequant;
+
+    XMFLOAT3 posMin = geo->vertices[0].pos, posMax = posMin;
+    XMFLOAT2 uvMin = geo->vertices[0].uv, uvMax = uvMin;
+    for (auto& v : geo->vertices) {
+        posMin = { (std::min)(posMin.x, v.pos.x), (std::min)(posMin.y, v.pos.y), (std::min)(posMin.z, v.pos.z) };
+        posMax = { (std::max)(posMax.x, v.pos.x), (std::max)(posMax.y, v.pos.y), (std::max)(posMax.z, v.pos.z) };
+        uvMin = { (std::min)(uvMin.x, v.uv.x), (std::min)(uvMin.y, v.uv.y) };
+        uvMax = { (std::max)(uvMax.x, v.uv.x), (std::max)(uvMax.y, v.uv.y) };
+    }
+
+    auto scaleOf = [](float range) { return range > 0.0f ? range : 1.0f; };
+    // The positions are mapped to [-1, 1] and the UVs are mapped to [0, 1].
+    dequant.posScale = {
+        scaleOf((posMax.x - posMin.x) * 0.5f), scaleOf((posMax.y - posMin.y) * 0.5f), scaleOf((posMax.z - posMin.z) * 0.5f) };
+    dequant.posBias = {
+        (posMin.x + posMax.x) * 0.5f, (posMin.y + posMax.y) * 0.5f, (posMin.z + posMax.z) * 0.5f };
+    dequant.uvScale = { scaleOf(uvMax.x - uvMin.x), scaleOf(uvMax.y - uvMin.y) };
+    dequant.uvBias = uvMin;
+    return dequant;
+}
+
+PackedVertex packVertex(const Vertex& v, const VertexDequantization& dequant) {
+    PackedVertex pv = {};
+    pv.pos[0] = encodeSnorm16((v.pos.x - dequant.posBias.x) / dequant.posScale.x);
+    pv.pos[1] = encodeSnorm16((v.pos.y - dequant.posBias.y) / dequant.posScale.y);
+    pv.pos[2] = encodeSnorm16((v.pos.z - dequant.posBias.z) / dequant.posScale.z);
+    XMFLOAT2 code = encodeOctahedralNormal(v.normal);
+    pv.normal[0] = encodeSnorm16(code.x);
+    pv.normal[1] = encodeSnorm16(code.y);
+    pv.uv[0] = encodeUnorm16((v.uv.x - dequant.uvBias.x) / dequant.uvScale.x);
+    pv.uv[1] = encodeUnorm16((v.uv.y - dequant.uvBias.y) / dequant.uvScale.y);
+    return pv;
+}
+
+Vertex unpackVertex(const PackedVertex& v, const VertexDequantization& dequant) {
+    Vertex unpacked = {};
+    unpacked.pos.x = dequant.posBias.x + dequant.posScale.x * decodeSnorm16(v.pos[0]);
+    unpacked.pos.y = dequant.posBias.y + dequant.posScale.y * decodeSnorm16(v.pos[1]);
+    unpacked.pos.z = dequant.posBias.z + dequant.posScale.z * decodeSnorm16(v.pos[2]);
+    unpacked.normal = decodeOctahedralNormal({ decodeSnorm16(v.normal[0]), decodeSnorm16(v.normal[1]) });
+    unpacked.uv.x = dequant.uvBias.x + dequant.uvScale.x * decodeUnorm16(v.uv[0]);
+    unpacked.uv.y = dequant.uvBias.y + dequant.uvScale.y * decodeUnorm16(v.uv[1]);
+    return unpacked;
+}
+
+void packObjectGeometry(const ObjectGeometry* geo, PackedGeometry* packed) {
+    size_t count = geo->vertices.size();
+    packed->dequantization = calcVertexDequantization(geo);
+    packed->vertices.resize(count);
+    packed->indices = geo->indices;
+    packed->locationInfo = geo->locationInfo;
+
+    const VertexDequantization& dequant = packed->dequantization;
+    parallelFor(0, count, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            packed->vertices[i] = packVertex(geo->vertices[i], dequant);
+        }
+    });
+}
+
+void unpackObjectGeometry(const PackedGeometry* packed, ObjectGeometry* geo) {
+    size_t count = packed->vertices.size();
+    geo->vertices.resize(count);
+    geo->indices = packed->indices;
+    geo->locationInfo = packed->locationInfo;
+
+    parallelFor(0, count, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            geo->vertices[i] = unpackVertex(packed->vertices[i], packed->dequantization);
+        }
+    });
+}
+
+// Half quantization step plus 4 ULPs of the largest magnitude in the float arithmetics.
+static inline float calcQuantizationErrorBound(float scale, float bias, float maxCode) {
+    return scale / maxCode * 0.5f + 4.0f * FLT_EPSILON * (fabsf(bias) + scale);
+}
+
+PackedVertexError calcPackedVertexErrorBound(const VertexDequantization& dequant) {
+    PackedVertexError bound = {};
+    bound.pos = {
+        calcQuantizationErrorBound(dequant.posScale.x, dequant.posBias.x, 32767.0f),
+        calcQuantizationErrorBound(dequant.posScale.y, dequant.posBias.y, 32767.0f),
+        calcQuantizationErrorBound(dequant.posScale.z, dequant.posBias.z, 32767.0f) };
+    bound.normalAngle = OCTAHEDRAL_SNORM16_MAX_ANGLE_ERROR;
+    bound.uv = {
+        calcQuantizationErrorBound(dequant.uvScale.x, dequant.uvBias.x, 65535.0f),
+        calcQuantizationErrorBound(dequant.uvScale.y, dequant.uvBias.y, 65535.0f) };
+    return bound;
+}
+
+PackedVertexError measurePackedVertexError(const ObjectGeometry* geo, const PackedGeometry* packed) {
+    PackedVertexError error = {};
+    for (size_t i = 0; i < geo->vertices.size(); ++i) {
+        const Vertex& v = geo->vertices[i];
+        Vertex unpacked = unpackVertex(packed->vertices[i], packed->dequantization);
+
+        error.pos.x = (std::max)(error.pos.x, fabsf(unpacked.pos.x - v.pos.x));
+        error.pos.y = (std::max)(error.pos.y, fabsf(unpacked.pos.y - v.pos.y));
+        error.pos.z = (std::max)(error.pos.z, fabsf(unpacked.pos.z - v.pos.z));
+        error.uv.x = (std::max)(error.uv.x, fabsf(unpacked.uv.x - v.uv.x));
+        error.uv.y = (std::max)(error.uv.y, fabsf(unpacked.uv.y - v.uv.y));
+
+        XMVECTOR n0 = XMLoadFloat3(&v.normal);
+        if (XMVectorGetX(XMVector3LengthSq(n0)) == 0.0f) continue;
+        // The angle is calculated from the cross product, which is more precise than acos for small angles.
+        XMVECTOR n1 = XMLoadFloat3(&unpacked.normal);
+        n0 = XMVector3Normalize(n0);
+        float sinAngle = XMVectorGetX(XMVector3Length(XMVector3Cross(n0, n1)));
+        float cosAngle = XMVectorGetX(XMVector3Dot(n0, n1));
+        error.normalAngle = (std::max)(error.normalAngle, atan2f(sinAngle, cosAngle));
+    }
+    return error;
+}
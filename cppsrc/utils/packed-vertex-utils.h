@@ -0,0 +1,64 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "geometry-utils.h"
+
+// PackedVertex takes 16 bytes, i.e. 40% of Vertex (40 bytes). The billboard size is not packed.
+//
+// Encoding:
+// pos    -> snorm16 x 3, relative to the center and half extent of the mesh AABB.
+// normal -> snorm16 x 2, octahedral mapping of the unit normal onto [-1, 1]^2.
+// uv     -> unorm16 x 2, relative to the min corner and range of the mesh UV bounds.
+//
+// Error bounds (each value is rounded to the nearest quantization step):
+// pos    -> |error| <= posScale / 32767 / 2 per axis.
+// normal -> angle error <= OCTAHEDRAL_SNORM16_MAX_ANGLE_ERROR (radians), which is measured over
+//           4M random directions (6.4e-5 at most, i.e. about 0.004 degrees) and rounded up.
+// uv     -> |error| <= uvScale / 65535 / 2 per axis.
+// Plus the rounding error of the float arithmetics, i.e. some ULPs of |bias| + scale, which is
+// also included in calcPackedVertexErrorBound.
+constexpr float OCTAHEDRAL_SNORM16_MAX_ANGLE_ERROR = 8.0e-5f;
+
+struct PackedGeometry {
+    std::vector<PackedVertex> vertices;
+    std::vector<UINT32> indices;
+    Vsubmesh locationInfo;
+    VertexDequantization dequantization;
+    UINT64 vertexDataSize() { return vertices.size() * sizeof(PackedVertex); }
+    UINT64 indexDataSize() { return indices.size() * sizeof(UINT32); }
+};
+
+// Encode a normal (not necessarily normalized) to [-1, 1]^2, and decode it back to a unit vector.
+XMFLOAT2 encodeOctahedralNormal(XMFLOAT3 normal);
+XMFLOAT3 decodeOctahedralNormal(XMFLOAT2 code);
+
+// The AABB of the positions and the bounds of the UVs are used. Degenerated axes are given a scale of 1.
+VertexDequantization calcVertexDequantization(const ObjectGeometry* geo);
+
+PackedVertex packVertex(const Vertex& v, const VertexDequantization& dequant);
+
+// The size of the unpacked vertex is set to 0.
+Vertex unpackVertex(const PackedVertex& v, const VertexDequantization& dequant);
+
+// The vertices are packed in parallel (see thread-utils.h). The billboard sizes are dropped.
+void packObjectGeometry(const ObjectGeometry* geo, PackedGeometry* packed);
+
+void unpackObjectGeometry(const PackedGeometry* packed, ObjectGeometry* geo);
+
+struct PackedVertexError {
+    XMFLOAT3 pos = { 0.0f, 0.0f, 0.0f };
+    float normalAngle = 0.0f; // In radians.
+    XMFLOAT2 uv = { 0.0f, 0.0f };
+};
+
+PackedVertexError calcPackedVertexErrorBound(const VertexDequantization& dequant);
+
+// Maximum error between the original vertices and the unpacked ones. Note the normals of zero length
+// are skipped and the others are compared after normalized.
+PackedVertexError measurePackedVertexError(const ObjectGeometry* geo, const PackedGeometry* packed);
@@ -0,0 +1,359 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+
+#include "postprocess-graph-utils.h"
+
+namespace {
+
+constexpr UINT NO_NODE = 0xffffffff;
+
+bool fail(const std::string& message, std::string* errorMessage) {
+    if (errorMessage != nullptr) *errorMessage = message;
+    return false;
+}
+
+D3D12_RESOURCE_STATES getInputState(bool isCopy) {
+    return isCopy ? D3D12_RESOURCE_STATE_COPY_SOURCE : D3D12_RESOURCE_STATE_GENERIC_READ;
+}
+
+D3D12_RESOURCE_STATES getOutputState(bool isCopy) {
+    return isCopy ? D3D12_RESOURCE_STATE_COPY_DEST : D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+}
+
+// The writer of each resource, or NO_NODE. Return FALSE if any index is out of range or any resource has 2 writers.
+bool findWriters(const PostProcessGraphDesc& desc, std::vector<UINT>* writers, std::string* errorMessage) {
+    size_t resourceCount = desc.resources.size();
+    writers->assign(resourceCount, NO_NODE);
+    if (desc.finalOutput >= resourceCount) return fail("final output out of range", errorMessage);
+    for (UINT n = 0; n < (UINT)desc.nodes.size(); ++n) {
+        auto& node = desc.nodes[n];
+        if (node.output >= resourceCount) return fail("output of node " + node.name + " out of range", errorMessage);
+        for (UINT r : node.inputs) {
+            if (r >= resourceCount) return fail("input of node " + node.name + " out of range", errorMessage);
+        }
+        if (node.isCopy && node.inputs.size() != 1) return fail("copy node " + node.name + " must have 1 input", errorMessage);
+        if ((*writers)[node.output] != NO_NODE) {
+            return fail("resource " + desc.resources[node.output].name + " is written by both " +
+                desc.nodes[(*writers)[node.output]].name + " and " + node.name, errorMessage);
+        }
+        (*writers)[node.output] = n;
+    }
+    return true;
+}
+
+// Follow the copies to the transient resources back to their sources. Return FALSE if they form a cycle.
+bool resolveCopies(const PostProcessGraphDesc& desc, const std::vector<UINT>& writers,
+    std::vector<UINT>* sources, std::string* errorMessage)
+{
+    size_t resourceCount = desc.resources.size();
+    sources->resize(resourceCount);
+    for (UINT r = 0; r < (UINT)resourceCount; ++r) {
+        UINT source = r;
+        for (size_t step = 0; ; ++step) {
+            UINT writer = writers[source];
+            if (writer == NO_NODE || !desc.nodes[writer].isCopy || desc.resources[source].isExternal) break;
+            if (step == desc.nodes.size()) return fail("copies of " + desc.resources[r].name + " form a cycle", errorMessage);
+            source = desc.nodes[writer].inputs[0];
+        }
+        (*sources)[r] = source;
+    }
+    return true;
+}
+
+std::vector<UINT> resolveInputs(const PostProcessNodeDesc& node, const std::vector<UINT>& sources) {
+    std::vector<UINT> inputs;
+    for (UINT r : node.inputs) {
+        if (std::find(inputs.begin(), inputs.end(), sources[r]) == inputs.end()) inputs.push_back(sources[r]);
+    }
+    return inputs;
+}
+
+} // namespace
+
+bool compilePostProcessGraph(const PostProcessGraphDesc& desc, PostProcessPlan* plan, std::string* errorMessage) {
+    *plan = {};
+    UINT resourceCount = (UINT)desc.resources.size();
+    UINT nodeCount = (UINT)desc.nodes.size();
+    std::vector<UINT> writers, sources;
+    if (!findWriters(desc, &writers, errorMessage)) return false;
+    if (!resolveCopies(desc, writers, &sources, errorMessage)) return false;
+
+    // 1. Drop the copies to the transient resources, whose readers read the sources instead.
+    std::vector<bool> isKept(nodeCount, true);
+    std::vector<std::vector<UINT>> nodeInputs(nodeCount);
+    for (UINT n = 0; n < nodeCount; ++n) {
+        auto& node = desc.nodes[n];
+        if (node.isCopy && !desc.resources[node.output].isExternal) {
+            isKept[n] = false;
+            ++plan->droppedCopyCount;
+        }
+        nodeInputs[n] = resolveInputs(node, sources);
+    }
+    UINT finalOutput = sources[desc.finalOutput];
+
+    auto isWritten = [&](UINT r) { return writers[r] != NO_NODE && isKept[writers[r]]; };
+    for (UINT n = 0; n < nodeCount; ++n) {
+        if (!isKept[n]) continue;
+        for (UINT r : nodeInputs[n]) {
+            if (!desc.resources[r].isExternal && !isWritten(r)) {
+                return fail("resource " + desc.resources[r].name + " is read by " + desc.nodes[n].name +
+                    " but never written", errorMessage);
+            }
+        }
+    }
+    if (!desc.resources[finalOutput].isExternal && !isWritten(finalOutput)) {
+        return fail("final output " + desc.resources[finalOutput].name + " is never written", errorMessage);
+    }
+
+    // Sort the kept nodes by the dependencies, and the ties keep the order of desc.nodes.
+    std::vector<UINT> dependencyCounts(nodeCount, 0);
+    std::vector<std::vector<UINT>> dependents(nodeCount);
+    for (UINT n = 0; n < nodeCount; ++n) {
+        if (!isKept[n]) continue;
+        for (UINT r : nodeInputs[n]) {
+            if (!isWritten(r)) continue;
+            dependents[writers[r]].push_back(n);
+            ++dependencyCounts[n];
+        }
+    }
+    std::priority_queue<UINT, std::vector<UINT>, std::greater<UINT>> readyNodes;
+    for (UINT n = 0; n < nodeCount; ++n) {
+        if (isKept[n] && dependencyCounts[n] == 0) readyNodes.push(n);
+    }
+    std::vector<UINT> sortedNodes;
+    while (!readyNodes.empty()) {
+        UINT n = readyNodes.top();
+        readyNodes.pop();
+        sortedNodes.push_back(n);
+        for (UINT m : dependents[n]) {
+            if (--dependencyCounts[m] == 0) readyNodes.push(m);
+        }
+    }
+    if (sortedNodes.size() != (size_t)std::count(isKept.begin(), isKept.end(), true)) {
+        return fail("the nodes form a cycle", errorMessage);
+    }
+
+    // 2. Drop the nodes whose outputs are never read, from the last one so their inputs may become unread too.
+    std::vector<UINT> readerCounts(resourceCount, 0);
+    for (UINT n : sortedNodes) {
+        for (UINT r : nodeInputs[n]) ++readerCounts[r];
+    }
+    for (auto it = sortedNodes.rbegin(); it != sortedNodes.rend(); ++it) {
+        UINT output = desc.nodes[*it].output;
+        if (readerCounts[output] > 0 || output == finalOutput || desc.resources[output].isExternal) continue;
+        isKept[*it] = false;
+        ++plan->droppedNodeCount;
+        for (UINT r : nodeInputs[*it]) --readerCounts[r];
+    }
+    sortedNodes.erase(std::remove_if(sortedNodes.begin(), sortedNodes.end(),
+        [&](UINT n) { return !isKept[n]; }), sortedNodes.end());
+
+    // 3. Make the passes, and fuse the pointwise nodes into the passes producing their inputs.
+    std::vector<PostProcessPass> passes;
+    std::vector<UINT> passOrder; // Indices into passes, since a fused pass moves to its last node.
+    std::vector<UINT> producerPasses(resourceCount, NO_NODE);
+    for (UINT n : sortedNodes) {
+        auto& node = desc.nodes[n];
+        UINT fusedPass = NO_NODE;
+        UINT fusedInput = 0;
+        const PostProcessFusionRule* fusionRule = nullptr;
+        for (UINT r : nodeInputs[n]) {
+            if (!node.isPointwise) break;
+            if (producerPasses[r] == NO_NODE) continue;
+            auto& pass = passes[producerPasses[r]];
+            if (pass.isCopy || pass.outputResource != r || readerCounts[r] != 1 ||
+                r == finalOutput || desc.resources[r].isExternal) continue;
+            for (auto& rule : desc.fusionRules) {
+                if (rule.producerKind == pass.kind && rule.consumerKind == node.kind) fusionRule = &rule;
+            }
+            if (fusionRule != nullptr) {
+                fusedPass = producerPasses[r];
+                fusedInput = r;
+                break;
+            }
+        }
+
+        if (fusedPass != NO_NODE) {
+            auto& pass = passes[fusedPass];
+            pass.kind = fusionRule->fusedKind;
+            pass.nodes.push_back(n);
+            for (UINT r : nodeInputs[n]) {
+                if (r != fusedInput && std::find(pass.inputResources.begin(), pass.inputResources.end(), r) ==
+                    pass.inputResources.end()) pass.inputResources.push_back(r);
+            }
+            pass.outputResource = node.output;
+            producerPasses[fusedInput] = NO_NODE;
+            producerPasses[node.output] = fusedPass;
+            passOrder.erase(std::find(passOrder.begin(), passOrder.end(), fusedPass));
+            passOrder.push_back(fusedPass);
+            ++plan->fusedNodeCount;
+        }
+        else {
+            PostProcessPass pass = {};
+            pass.kind = node.kind;
+            pass.isCopy = node.isCopy;
+            pass.nodes.push_back(n);
+            pass.inputResources = nodeInputs[n];
+            pass.outputResource = node.output;
+            producerPasses[node.output] = (UINT)passes.size();
+            passOrder.push_back((UINT)passes.size());
+            passes.push_back(pass);
+        }
+    }
+    for (UINT i : passOrder) plan->passes.push_back(std::move(passes[i]));
+    UINT passCount = (UINT)plan->passes.size();
+
+    // 4. Assign the textures by the lifetimes of the resources.
+    plan->resourceTextures.assign(resourceCount, POSTPROCESS_NO_TEXTURE);
+    for (UINT r = 0; r < resourceCount; ++r) {
+        if (desc.resources[r].isExternal) plan->resourceTextures[r] = plan->externalTextureCount++;
+    }
+    std::vector<UINT> lastUses(resourceCount, 0);
+    for (UINT i = 0; i < passCount; ++i) {
+        for (UINT r : plan->passes[i].inputResources) lastUses[r] = i;
+    }
+    lastUses[finalOutput] = passCount;
+
+    std::set<UINT> freeTextures;
+    std::vector<D3D12_RESOURCE_STATES> textureStates(plan->externalTextureCount, D3D12_RESOURCE_STATE_COMMON);
+    for (UINT i = 0; i < passCount; ++i) {
+        auto& pass = plan->passes[i];
+        UINT output = pass.outputResource;
+        if (!desc.resources[output].isExternal) {
+            if (freeTextures.empty()) {
+                plan->resourceTextures[output] = plan->externalTextureCount + plan->transientTextureCount++;
+                textureStates.push_back(D3D12_RESOURCE_STATE_COMMON);
+            }
+            else {
+                plan->resourceTextures[output] = *freeTextures.begin();
+                freeTextures.erase(freeTextures.begin());
+            }
+            ++plan->transientResourceCount;
+        }
+        for (UINT r : pass.inputResources) pass.inputTextures.push_back(plan->resourceTextures[r]);
+        pass.outputTexture = plan->resourceTextures[output];
+
+        // 5. Transition the textures into the states of the pass.
+        auto transition = [&](UINT texture, D3D12_RESOURCE_STATES state) {
+            if (textureStates[texture] == state) return;
+            pass.barriers.push_back({ texture, textureStates[texture], state });
+            textureStates[texture] = state;
+        };
+        for (UINT texture : pass.inputTextures) transition(texture, getInputState(pass.isCopy));
+        transition(pass.outputTexture, getOutputState(pass.isCopy));
+        plan->barrierCount += (UINT)pass.barriers.size();
+
+        for (UINT r : pass.inputResources) {
+            if (lastUses[r] == i && !desc.resources[r].isExternal) freeTextures.insert(plan->resourceTextures[r]);
+        }
+    }
+    for (UINT texture = 0; texture < (UINT)textureStates.size(); ++texture) {
+        if (textureStates[texture] == D3D12_RESOURCE_STATE_COMMON) continue;
+        plan->finalBarriers.push_back({ texture, textureStates[texture], D3D12_RESOURCE_STATE_COMMON });
+    }
+    plan->barrierCount += (UINT)plan->finalBarriers.size();
+
+    // The dropped copies share the textures of their sources.
+    for (UINT r = 0; r < resourceCount; ++r) {
+        if (sources[r] != r) plan->resourceTextures[r] = plan->resourceTextures[sources[r]];
+    }
+    return true;
+}
+
+bool validatePostProcessPlan(const PostProcessGraphDesc& desc, const PostProcessPlan& plan, std::string* errorMessage) {
+    std::vector<UINT> writers, sources;
+    if (!findWriters(desc, &writers, errorMessage)) return false;
+    if (!resolveCopies(desc, writers, &sources, errorMessage)) return false;
+    UINT textureCount = plan.externalTextureCount + plan.transientTextureCount;
+
+    // The resource held by each texture, where the external inputs are held from the start.
+    const UINT NO_RESOURCE = 0xffffffff;
+    std::vector<UINT> contents(textureCount, NO_RESOURCE);
+    std::vector<D3D12_RESOURCE_STATES> states(textureCount, D3D12_RESOURCE_STATE_COMMON);
+    for (UINT r = 0; r < (UINT)desc.resources.size(); ++r) {
+        if (!desc.resources[r].isExternal || writers[r] != NO_NODE) continue;
+        if (plan.resourceTextures[r] >= plan.externalTextureCount) return fail("external texture out of range", errorMessage);
+        contents[plan.resourceTextures[r]] = r;
+    }
+
+    auto applyBarriers = [&](const std::vector<PostProcessBarrier>& barriers) {
+        for (auto& barrier : barriers) {
+            if (barrier.texture >= textureCount) return fail("barrier texture out of range", errorMessage);
+            if (states[barrier.texture] != barrier.stateBefore) {
+                return fail("barrier of texture " + std::to_string(barrier.texture) + " from a wrong state", errorMessage);
+            }
+            states[barrier.texture] = barrier.stateAfter;
+        }
+        return true;
+    };
+
+    std::vector<UINT> runCounts(desc.nodes.size(), 0);
+    std::vector<UINT> readerNodes(desc.resources.size(), 0); // Kept readers, to check the fused intermediates.
+    for (auto& pass : plan.passes) {
+        for (UINT n : pass.nodes) {
+            for (UINT r : resolveInputs(desc.nodes[n], sources)) ++readerNodes[r];
+        }
+    }
+
+    for (size_t i = 0; i < plan.passes.size(); ++i) {
+        auto& pass = plan.passes[i];
+        std::string passName = "pass " + std::to_string(i);
+        if (pass.nodes.empty()) return fail(passName + " has no node", errorMessage);
+        if (pass.inputResources.size() != pass.inputTextures.size()) return fail(passName + " has unpaired inputs", errorMessage);
+        if (!applyBarriers(pass.barriers)) return false;
+
+        // Every input of the nodes is either an input of the pass, or written by an earlier node of the pass.
+        for (size_t k = 0; k < pass.nodes.size(); ++k) {
+            auto& node = desc.nodes[pass.nodes[k]];
+            ++runCounts[pass.nodes[k]];
+            if (k > 0 && !node.isPointwise) return fail(passName + " fuses a node not pointwise", errorMessage);
+            if (node.isCopy != pass.isCopy || (node.isCopy && pass.nodes.size() > 1)) {
+                return fail(passName + " mixes a copy with other nodes", errorMessage);
+            }
+            for (UINT r : resolveInputs(node, sources)) {
+                bool isFused = k > 0 && r == desc.nodes[pass.nodes[k - 1]].output;
+                if (isFused && readerNodes[r] != 1) return fail(passName + " fuses an output read by others", errorMessage);
+                if (!isFused && std::find(pass.inputResources.begin(), pass.inputResources.end(), r) == pass.inputResources.end()) {
+                    return fail(passName + " misses input " + desc.resources[r].name, errorMessage);
+                }
+            }
+        }
+        if (pass.outputResource != desc.nodes[pass.nodes.back()].output) return fail(passName + " has a wrong output", errorMessage);
+
+        for (size_t k = 0; k < pass.inputResources.size(); ++k) {
+            UINT texture = pass.inputTextures[k];
+            if (texture >= textureCount || contents[texture] != pass.inputResources[k]) {
+                return fail(passName + " reads " + desc.resources[pass.inputResources[k]].name + " overwritten or never written", errorMessage);
+            }
+            if (states[texture] != getInputState(pass.isCopy)) return fail(passName + " reads a texture in a wrong state", errorMessage);
+            if (texture == pass.outputTexture) return fail(passName + " reads and writes the same texture", errorMessage);
+        }
+        if (pass.outputTexture >= textureCount) return fail(passName + " writes a texture out of range", errorMessage);
+        if (states[pass.outputTexture] != getOutputState(pass.isCopy)) return fail(passName + " writes a texture in a wrong state", errorMessage);
+        contents[pass.outputTexture] = pass.outputResource;
+    }
+    if (!applyBarriers(plan.finalBarriers)) return false;
+
+    for (size_t n = 0; n < desc.nodes.size(); ++n) {
+        if (runCounts[n] > 1) return fail("node " + desc.nodes[n].name + " runs more than once", errorMessage);
+        bool isExternalOutput = desc.resources[desc.nodes[n].output].isExternal;
+        if (isExternalOutput && runCounts[n] == 0) return fail("node " + desc.nodes[n].name + " writing an external resource never runs", errorMessage);
+    }
+    UINT finalOutput = sources[desc.finalOutput];
+    UINT finalTexture = plan.resourceTextures[desc.finalOutput];
+    if (finalTexture >= textureCount || contents[finalTexture] != finalOutput) return fail("final output is not in its texture", errorMessage);
+    for (auto state : states) {
+        if (state != D3D12_RESOURCE_STATE_COMMON) return fail("a texture is not returned to the common state", errorMessage);
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <string>
+
+#include "d3dcore/postprocess-graph.h"
+
+// These funcs do not depend on D3DCore, see PostProcessGraph in postprocessing/postprocess-graph.h for the usage.
+
+// Compile the graph into the passes to record:
+// 1. The copies to transient resources are dropped, and their readers read the source instead.
+// 2. The nodes whose outputs are never read are dropped, unless the output is external or the final output.
+// 3. The nodes are sorted by the dependencies (the ties keep the order of desc.nodes), and each pointwise node
+//    is fused into the pass producing one of its inputs by desc.fusionRules, if nothing else reads that input.
+// 4. The lifetime of a transient resource is from the pass writing it to the last pass reading it (or the end
+//    for the final output). A pass takes the free texture of the lowest index for its output, and the textures
+//    of the resources last read by the pass are freed after it, so an output never shares a texture with the inputs.
+// 5. The barriers transition each texture from its last state to the state of the pass, and the textures are
+//    returned to D3D12_RESOURCE_STATE_COMMON at the end.
+// Return FALSE if the graph is invalid, e.g. a cycle, a resource of 2 writers, a transient resource read but
+// never written, and the reason is written into errorMessage if it is not nullptr.
+bool compilePostProcessGraph(const PostProcessGraphDesc& desc, PostProcessPlan* plan, std::string* errorMessage = nullptr);
+
+// Simulate the plan and check it against the graph: every kept node runs once after its inputs are written, the
+// inputs still hold their resources (i.e. no texture is overwritten while in use), the textures are in the states
+// of the passes, and the final output is in its texture in D3D12_RESOURCE_STATE_COMMON at the end.
+// Return FALSE at the first violation, see compilePostProcessGraph for errorMessage.
+bool validatePostProcessPlan(const PostProcessGraphDesc& desc, const PostProcessPlan& plan, std::string* errorMessage = nullptr);
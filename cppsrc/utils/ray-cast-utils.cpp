@@ -0,0 +1,367 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "bvh-utils.h"
+#include "culling-utils.h"
+#include "ray-cast-utils.h"
+#include "thread-utils.h"
+
+namespace {
+
+inline bool isEmptyChild(const BvhNode& node, int slot) { return node.childIdx[slot] == BVH_EMPTY_CHILD; }
+inline bool isLeafChild(const BvhNode& node, int slot) { return node.childCount[slot] > 0; }
+
+// Same as the slab test of pickBvh (See bvh-utils.cpp), except that the box is entered only before tBest.
+inline bool intersectRayBox(const float* origin, const float* invDir, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax,
+    float tBest, float* tEnter)
+{
+    const float* bMin = &boxMin.x;
+    const float* bMax = &boxMax.x;
+    float t0 = 0.0f, t1 = tBest;
+    for (int a = 0; a < 3; ++a) {
+        float tNear = (bMin[a] - origin[a]) * invDir[a];
+        float tFar = (bMax[a] - origin[a]) * invDir[a];
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = (std::max)(t0, tNear);
+        t1 = (std::min)(t1, tFar);
+    }
+    *tEnter = t0;
+    return t0 <= t1 && t0 < tBest;
+}
+
+struct PacketRays {
+    XMVECTOR originX, originY, originZ;
+    XMVECTOR dirX, dirY, dirZ;
+    XMVECTOR invDirX, invDirY, invDirZ;
+};
+
+PacketRays prepareRayPacket(const RayPacket& packet) {
+    PacketRays rays;
+    rays.originX = packet.originX;
+    rays.originY = packet.originY;
+    rays.originZ = packet.originZ;
+    rays.dirX = packet.dirX;
+    rays.dirY = packet.dirY;
+    rays.dirZ = packet.dirZ;
+    rays.invDirX = XMVectorReciprocal(packet.dirX);
+    rays.invDirY = XMVectorReciprocal(packet.dirY);
+    rays.invDirZ = XMVectorReciprocal(packet.dirZ);
+    return rays;
+}
+
+// XMVectorMin(a, b) and XMVectorMax(a, b) return b if either is NaN (minps and maxps), so the operands are ordered
+// to ignore the NaN of 0 * inf just like the scalar slab test.
+inline void XM_CALLCONV intersectPacketSlab(FXMVECTOR bMin, FXMVECTOR bMax, FXMVECTOR origin, GXMVECTOR invDir,
+    XMVECTOR* t0, XMVECTOR* t1)
+{
+    XMVECTOR tNear = XMVectorMultiply(XMVectorSubtract(bMin, origin), invDir);
+    XMVECTOR tFar = XMVectorMultiply(XMVectorSubtract(bMax, origin), invDir);
+    *t0 = XMVectorMax(XMVectorMin(tFar, tNear), *t0);
+    *t1 = XMVectorMin(XMVectorMax(tNear, tFar), *t1);
+}
+
+// Return the mask of the lanes entering the box before tBest. The entry distance of the missed lanes is +inf.
+inline XMVECTOR XM_CALLCONV intersectPacketBox(const PacketRays& rays, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax,
+    FXMVECTOR tBest, XMVECTOR* tEnter)
+{
+    XMVECTOR t0 = XMVectorZero(), t1 = tBest;
+    intersectPacketSlab(XMVectorReplicate(boxMin.x), XMVectorReplicate(boxMax.x), rays.originX, rays.invDirX, &t0, &t1);
+    intersectPacketSlab(XMVectorReplicate(boxMin.y), XMVectorReplicate(boxMax.y), rays.originY, rays.invDirY, &t0, &t1);
+    intersectPacketSlab(XMVectorReplicate(boxMin.z), XMVectorReplicate(boxMax.z), rays.originZ, rays.invDirZ, &t0, &t1);
+    XMVECTOR mask = XMVectorAndInt(XMVectorLessOrEqual(t0, t1), XMVectorLess(t0, tBest));
+    *tEnter = XMVectorSelect(XMVectorSplatInfinity(), t0, mask);
+    return mask;
+}
+
+// Same arithmetic as intersectRayTriangle in every lane. Return the mask of the lanes hitting in (0, tBest).
+inline XMVECTOR XM_CALLCONV intersectPacketTriangle(const PacketRays& rays, const TriangleBvhTri& tri, FXMVECTOR tBest,
+    XMVECTOR* pT, XMVECTOR* pU, XMVECTOR* pV)
+{
+    XMVECTOR e1x = XMVectorReplicate(tri.edge1.x), e1y = XMVectorReplicate(tri.edge1.y), e1z = XMVectorReplicate(tri.edge1.z);
+    XMVECTOR e2x = XMVectorReplicate(tri.edge2.x), e2y = XMVectorReplicate(tri.edge2.y), e2z = XMVectorReplicate(tri.edge2.z);
+
+    XMVECTOR px = XMVectorSubtract(XMVectorMultiply(rays.dirY, e2z), XMVectorMultiply(rays.dirZ, e2y));
+    XMVECTOR py = XMVectorSubtract(XMVectorMultiply(rays.dirZ, e2x), XMVectorMultiply(rays.dirX, e2z));
+    XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(rays.dirX, e2y), XMVectorMultiply(rays.dirY, e2x));
+    XMVECTOR det = XMVectorAdd(XMVectorAdd(XMVectorMultiply(e1x, px), XMVectorMultiply(e1y, py)), XMVectorMultiply(e1z, pz));
+    XMVECTOR invDet = XMVectorReciprocal(det);
+
+    XMVECTOR sx = XMVectorSubtract(rays.originX, XMVectorReplicate(tri.v0.x));
+    XMVECTOR sy = XMVectorSubtract(rays.originY, XMVectorReplicate(tri.v0.y));
+    XMVECTOR sz = XMVectorSubtract(rays.originZ, XMVectorReplicate(tri.v0.z));
+    XMVECTOR u = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(sx, px), XMVectorMultiply(sy, py)), XMVectorMultiply(sz, pz)), invDet);
+
+    XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, e1z), XMVectorMultiply(sz, e1y));
+    XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, e1x), XMVectorMultiply(sx, e1z));
+    XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, e1y), XMVectorMultiply(sy, e1x));
+    XMVECTOR v = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(rays.dirX, qx), XMVectorMultiply(rays.dirY, qy)),
+        XMVectorMultiply(rays.dirZ, qz)), invDet);
+    XMVECTOR t = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(e2x, qx), XMVectorMultiply(e2y, qy)),
+        XMVectorMultiply(e2z, qz)), invDet);
+
+    XMVECTOR zero = XMVectorZero();
+    XMVECTOR mask = XMVectorNotEqual(det, zero);
+    mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+    mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+    mask = XMVectorAndInt(mask, XMVectorLessOrEqual(XMVectorAdd(u, v), XMVectorSplatOne()));
+    mask = XMVectorAndInt(mask, XMVectorGreater(t, zero));
+    mask = XMVectorAndInt(mask, XMVectorLess(t, tBest));
+    *pT = t;
+    *pU = u;
+    *pV = v;
+    return mask;
+}
+
+inline bool XM_CALLCONV isAnyLane(FXMVECTOR mask) { return XMVector4NotEqualInt(mask, XMVectorFalseInt()); }
+
+inline int XM_CALLCONV getLaneBits(FXMVECTOR mask) {
+    uint32_t lanes[4];
+    XMStoreInt4(lanes, mask);
+    return (lanes[0] ? 1 : 0) | (lanes[1] ? 2 : 0) | (lanes[2] ? 4 : 0) | (lanes[3] ? 8 : 0);
+}
+
+// Nearest-first traversal shared by castRayClosest and castRayAny.
+template <bool IS_ANY_HIT>
+bool castRay(const TriangleBvh& triBvh, const XMFLOAT3& o, const XMFLOAT3& d, float tMax, RayHit* hit) {
+    const Bvh& bvh = triBvh.bvh;
+    if (bvh.nodes.empty() || !(tMax > 0.0f)) return false;
+    float originArr[3] = { o.x, o.y, o.z };
+    float invDir[3] = { 1.0f / d.x, 1.0f / d.y, 1.0f / d.z };
+
+    struct StackEntry {
+        UINT nodeIdx;
+        float tEnter;
+    };
+    StackEntry stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = { 0, 0.0f };
+
+    bool isHit = false;
+    float tBest = tMax;
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (entry.tEnter >= tBest) continue;
+        const BvhNode& node = bvh.nodes[entry.nodeIdx];
+
+        float tEnter[2];
+        bool isInnerHit[2] = { false, false };
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            if (!intersectRayBox(originArr, invDir, node.childMin[slot], node.childMax[slot], tBest, &tEnter[slot])) continue;
+            if (!isLeafChild(node, slot)) {
+                isInnerHit[slot] = true;
+                continue;
+            }
+            for (UINT k = node.childIdx[slot]; k < node.childIdx[slot] + node.childCount[slot]; ++k) {
+                float t, u, v;
+                if (!intersectRayTriangle(o, d, triBvh.tris[k], tBest, &t, &u, &v)) continue;
+                if constexpr (IS_ANY_HIT) return true;
+                isHit = true;
+                tBest = t;
+                hit->t = t;
+                hit->u = u;
+                hit->v = v;
+                hit->triIdx = bvh.primIdx[k];
+            }
+        }
+        // Push the farther child first, so the nearer one is visited first and shrinks tBest earlier.
+        int nearSlot = isInnerHit[0] && isInnerHit[1] && tEnter[1] < tEnter[0] ? 1 : 0;
+        int farSlot = 1 - nearSlot;
+        if (isInnerHit[farSlot]) stack[stackSize++] = { node.childIdx[farSlot], tEnter[farSlot] };
+        if (isInnerHit[nearSlot]) stack[stackSize++] = { node.childIdx[nearSlot], tEnter[nearSlot] };
+    }
+    return isHit;
+}
+
+inline float XM_CALLCONV getMinLane(FXMVECTOR v) {
+    return (std::min)((std::min)(XMVectorGetX(v), XMVectorGetY(v)), (std::min)(XMVectorGetZ(v), XMVectorGetW(v)));
+}
+
+// Same as castRay with 4 lanes. A lane is retired by setting its tBest to -1, which is also how the inactive lanes
+// start, so that it neither enters a box nor hits a triangle.
+template <bool IS_ANY_HIT>
+int castRayPacket(const TriangleBvh& triBvh, const RayPacket& packet, RayHit hits[4]) {
+    const Bvh& bvh = triBvh.bvh;
+    if (bvh.nodes.empty()) return 0;
+    PacketRays rays = prepareRayPacket(packet);
+    XMVECTOR retired = XMVectorReplicate(-1.0f);
+    XMVECTOR tBest = XMVectorSelect(retired, packet.tMax, XMVectorGreater(packet.tMax, XMVectorZero()));
+    XMVECTOR bestU = XMVectorZero(), bestV = XMVectorZero();
+    UINT bestIdx[4] = { BVH_EMPTY_CHILD, BVH_EMPTY_CHILD, BVH_EMPTY_CHILD, BVH_EMPTY_CHILD };
+    int hitBits = 0;
+
+    struct StackEntry {
+        XMVECTOR tEnter;
+        UINT nodeIdx;
+    };
+    StackEntry stack[2 * BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = { XMVectorZero(), 0 };
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        if (!isAnyLane(XMVectorLess(entry.tEnter, tBest))) continue;
+        const BvhNode& node = bvh.nodes[entry.nodeIdx];
+
+        XMVECTOR tEnter[2];
+        bool isInnerHit[2] = { false, false };
+        for (int slot = 0; slot < 2; ++slot) {
+            if (isEmptyChild(node, slot)) continue;
+            if (!isAnyLane(intersectPacketBox(rays, node.childMin[slot], node.childMax[slot], tBest, &tEnter[slot]))) continue;
+            if (!isLeafChild(node, slot)) {
+                isInnerHit[slot] = true;
+                continue;
+            }
+            for (UINT k = node.childIdx[slot]; k < node.childIdx[slot] + node.childCount[slot]; ++k) {
+                XMVECTOR t, u, v;
+                XMVECTOR mask = intersectPacketTriangle(rays, triBvh.tris[k], tBest, &t, &u, &v);
+                if (!isAnyLane(mask)) continue;
+                int bits = getLaneBits(mask);
+                hitBits |= bits;
+                if constexpr (IS_ANY_HIT) {
+                    tBest = XMVectorSelect(tBest, retired, mask);
+                    if (!isAnyLane(XMVectorGreater(tBest, XMVectorZero()))) return hitBits;
+                    continue;
+                }
+                tBest = XMVectorSelect(tBest, t, mask);
+                bestU = XMVectorSelect(bestU, u, mask);
+                bestV = XMVectorSelect(bestV, v, mask);
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (bits & (1 << lane)) bestIdx[lane] = bvh.primIdx[k];
+                }
+            }
+        }
+        // The child entered first by any lane is visited first.
+        int nearSlot = isInnerHit[0] && isInnerHit[1] && getMinLane(tEnter[1]) < getMinLane(tEnter[0]) ? 1 : 0;
+        int farSlot = 1 - nearSlot;
+        if (isInnerHit[farSlot]) stack[stackSize++] = { tEnter[farSlot], node.childIdx[farSlot] };
+        if (isInnerHit[nearSlot]) stack[stackSize++] = { tEnter[nearSlot], node.childIdx[nearSlot] };
+    }
+
+    if constexpr (!IS_ANY_HIT) {
+        for (int lane = 0; lane < 4; ++lane) {
+            if (!(hitBits & (1 << lane))) continue;
+            hits[lane].t = XMVectorGetByIndex(tBest, lane);
+            hits[lane].u = XMVectorGetByIndex(bestU, lane);
+            hits[lane].v = XMVectorGetByIndex(bestV, lane);
+            hits[lane].triIdx = bestIdx[lane];
+        }
+    }
+    return hitBits;
+}
+
+} // namespace
+
+void buildTriangleBvh(const ObjectGeometry& geo, UINT maxLeafSize, TriangleBvh* triBvh) {
+    size_t triCount = geo.indices.size() / 3;
+    BoundsSoA bounds = {};
+    resizeBoundsSoA(triCount, &bounds);
+    parallelFor(0, triCount, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const XMFLOAT3* corners[3] = { &geo.vertices[geo.indices[3 * i]].pos,
+                &geo.vertices[geo.indices[3 * i + 1]].pos, &geo.vertices[geo.indices[3 * i + 2]].pos };
+            bool isNaN = false;
+            for (auto corner : corners) isNaN = isNaN || std::isnan(corner->x) || std::isnan(corner->y) || std::isnan(corner->z);
+            if (isNaN) {
+                // NaN extents are unbounded to buildBvh.
+                setBoundsSoAEntry(i, { 0.0f, 0.0f, 0.0f }, { NAN, NAN, NAN }, &bounds);
+                continue;
+            }
+            XMVECTOR p0 = XMLoadFloat3(corners[0]);
+            XMVECTOR p1 = XMLoadFloat3(corners[1]);
+            XMVECTOR p2 = XMLoadFloat3(corners[2]);
+            XMVECTOR boxMin = XMVectorMin(XMVectorMin(p0, p1), p2);
+            XMVECTOR boxMax = XMVectorMax(XMVectorMax(p0, p1), p2);
+            XMVECTOR center = XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f);
+            XMVECTOR extents = XMVectorScale(XMVectorSubtract(boxMax, boxMin), 0.5f);
+            // The center and extents are rounded, and the hit points of the rays near the edges are rounded too,
+            // so the boxes are padded a little to make sure they still cover the hits.
+            XMVECTOR magnitude = XMVectorMax(XMVectorMax(boxMax, XMVectorNegate(boxMin)), extents);
+            extents = XMVectorAdd(extents, XMVectorScale(magnitude, 4.0f * FLT_EPSILON));
+            XMFLOAT3 c, e;
+            XMStoreFloat3(&c, center);
+            XMStoreFloat3(&e, extents);
+            setBoundsSoAEntry(i, c, e, &bounds);
+        }
+    });
+    buildBvh(bounds, maxLeafSize, &triBvh->bvh);
+
+    triBvh->tris.resize(triBvh->bvh.primIdx.size());
+    parallelFor(0, triBvh->tris.size(), 4096, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            size_t i = triBvh->bvh.primIdx[k];
+            const XMFLOAT3& p0 = geo.vertices[geo.indices[3 * i]].pos;
+            const XMFLOAT3& p1 = geo.vertices[geo.indices[3 * i + 1]].pos;
+            const XMFLOAT3& p2 = geo.vertices[geo.indices[3 * i + 2]].pos;
+            auto& tri = triBvh->tris[k];
+            tri.v0 = p0;
+            tri.edge1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            tri.edge2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+        }
+    });
+}
+
+bool intersectRayTriangle(const XMFLOAT3& origin, const XMFLOAT3& dir, const TriangleBvhTri& tri,
+    float tMax, float* pT, float* pU, float* pV)
+{
+    const XMFLOAT3& e1 = tri.edge1;
+    const XMFLOAT3& e2 = tri.edge2;
+    float px = dir.y * e2.z - dir.z * e2.y;
+    float py = dir.z * e2.x - dir.x * e2.z;
+    float pz = dir.x * e2.y - dir.y * e2.x;
+    float det = e1.x * px + e1.y * py + e1.z * pz;
+    // The ray is parallel to the triangle, which is never hit even if the ray lies in its plane.
+    if (det == 0.0f) return false;
+    float invDet = 1.0f / det;
+
+    float sx = origin.x - tri.v0.x;
+    float sy = origin.y - tri.v0.y;
+    float sz = origin.z - tri.v0.z;
+    float u = (sx * px + sy * py + sz * pz) * invDet;
+    // Written in the negated form to reject NaN too, and so are the tests below.
+    // u <= 1 is implied by the tests of v below, which only rejects the ray earlier.
+    if (!(u >= 0.0f && u <= 1.0f)) return false;
+
+    float qx = sy * e1.z - sz * e1.y;
+    float qy = sz * e1.x - sx * e1.z;
+    float qz = sx * e1.y - sy * e1.x;
+    float v = (dir.x * qx + dir.y * qy + dir.z * qz) * invDet;
+    if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+
+    float t = (e2.x * qx + e2.y * qy + e2.z * qz) * invDet;
+    if (!(t > 0.0f && t < tMax)) return false;
+    *pT = t;
+    *pU = u;
+    *pV = v;
+    return true;
+}
+
+bool XM_CALLCONV castRayClosest(const TriangleBvh& triBvh, FXMVECTOR origin, FXMVECTOR dir, float tMax, RayHit* hit) {
+    XMFLOAT3 o, d;
+    XMStoreFloat3(&o, origin);
+    XMStoreFloat3(&d, dir);
+    return castRay<false>(triBvh, o, d, tMax, hit);
+}
+
+bool XM_CALLCONV castRayAny(const TriangleBvh& triBvh, FXMVECTOR origin, FXMVECTOR dir, float tMax) {
+    XMFLOAT3 o, d;
+    XMStoreFloat3(&o, origin);
+    XMStoreFloat3(&d, dir);
+    return castRay<true>(triBvh, o, d, tMax, nullptr);
+}
+
+int castRayPacketClosest(const TriangleBvh& triBvh, const RayPacket& packet, RayHit hits[4]) {
+    return castRayPacket<false>(triBvh, packet, hits);
+}
+
+int castRayPacketAny(const TriangleBvh& triBvh, const RayPacket& packet) {
+    return castRayPacket<true>(triBvh, packet, nullptr);
+}
@@ -0,0 +1,38 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "d3dcore/triangle-bvh.h"
+#include "geometry-utils.h"
+
+// These funcs do not depend on D3DCore, see the ray-cast benchmark for the usage.
+// The triangles are two-sided, and a ray hits a triangle at t only if 0 < t < tMax. The edges and corners are
+// included, so a ray through a shared edge hits either of the triangles. All queries run the same arithmetic
+// as intersectRayTriangle, so the single-ray, the packet and the brute force results are exactly the same.
+
+// Build the BVH of the triangles of geo with buildBvh (See bvh-utils.h), which is parallel.
+// The triangles of NaN corners are kept out of the tree and never hit.
+void buildTriangleBvh(const ObjectGeometry& geo, UINT maxLeafSize, TriangleBvh* triBvh);
+
+// Moller-Trumbore test of a single ray. Return FALSE if the ray misses, or the hit is not in (0, tMax).
+bool intersectRayTriangle(const XMFLOAT3& origin, const XMFLOAT3& dir, const TriangleBvhTri& tri,
+    float tMax, float* pT, float* pU, float* pV);
+
+// Get the nearest hit in (0, tMax), and return FALSE if there is none.
+bool XM_CALLCONV castRayClosest(const TriangleBvh& triBvh, FXMVECTOR origin, FXMVECTOR dir, float tMax, RayHit* hit);
+
+// Return TRUE at the first hit in (0, tMax) found, e.g. for the shadow and occlusion tests.
+bool XM_CALLCONV castRayAny(const TriangleBvh& triBvh, FXMVECTOR origin, FXMVECTOR dir, float tMax);
+
+// Same as castRayClosest for each ray of the packet. The nodes are tested with the 4 rays at a time, and a node is
+// entered as long as any of them hits it. Return the hit mask, i.e. bit i is set if ray i hits, and hits[i] is
+// written only if bit i is set.
+int castRayPacketClosest(const TriangleBvh& triBvh, const RayPacket& packet, RayHit hits[4]);
+
+// Same as castRayAny for each ray of the packet, and a ray stops once it hits. Return the hit mask.
+int castRayPacketAny(const TriangleBvh& triBvh, const RayPacket& packet);
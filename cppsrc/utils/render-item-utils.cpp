@@ -6,27 +6,135 @@
 ** yiyaowen (c) 2021 All Rights Reserved.
 */
 
+#include "culling-utils.h"
 #include "frame-async-utils.h"
+#include "geometry-dedup-utils.h"
+#include "geometry-pool-utils.h"
 #include "geometry-utils.h"
 #include "render-item-utils.h"
+#include "upload-ring-utils.h"
 #include "vmesh-utils.h"
 
-void initRitemWithGeoInfo(D3DCore* pCore, ObjectGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem) {
+void initRitemWithGeoInfo(D3DCore* pCore, ObjectGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem,
+    SceneBuilder* builder)
+{
     initEmptyRenderItem(ritem);
     ritem->objConstBuffSeatCount = constBuffSeatCount;
     ritem->constData.resize(constBuffSeatCount);
     ritem->materials.resize(constBuffSeatCount);
     ritem->mesh = std::make_unique<Vmesh>();
     initVmesh(pCore, geo->vertices.data(), geo->vertexDataSize(),
-        geo->indices.data(), geo->indexDataSize(), ritem->mesh.get());
+        geo->indices.data(), geo->indexDataSize(), ritem->mesh.get(), sizeof(Vertex), builder);
+    ritem->mesh->objects["main"] = geo->locationInfo;
+
+    calcVertexBounds(geo->vertices.data(), geo->vertices.size(), &ritem->boundsCenter, &ritem->boundsExtents);
+    ritem->hasBounds = true;
+}
+
+// The regions of a pooled mesh go back to the pool when the last render item sharing the mesh is destroyed.
+static std::shared_ptr<Vmesh> makePooledVmeshHolder() {
+    return std::shared_ptr<Vmesh>(new Vmesh(), [](Vmesh* pMesh) {
+        releasePooledVmesh(pMesh);
+        delete pMesh;
+    });
+}
+
+void initRitemWithPooledGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT constBuffSeatCount,
+    RenderItem* ritem, SceneBuilder* builder)
+{
+    initEmptyRenderItem(ritem);
+    ritem->objConstBuffSeatCount = constBuffSeatCount;
+    ritem->constData.resize(constBuffSeatCount);
+    ritem->materials.resize(constBuffSeatCount);
+    ritem->mesh = makePooledVmeshHolder();
+    if (!initPooledVmesh(pCore, pool, geo->vertices.data(), geo->vertices.size(),
+        geo->indices.data(), geo->indices.size(), ritem->mesh.get(), builder))
+    {
+        initVmesh(pCore, geo->vertices.data(), geo->vertexDataSize(),
+            geo->indices.data(), geo->indexDataSize(), ritem->mesh.get(), sizeof(Vertex), builder);
+    }
+    ritem->mesh->objects["main"] = rebasePooledSubmesh(ritem->mesh.get(), geo->locationInfo);
+
+    calcVertexBounds(geo->vertices.data(), geo->vertices.size(), &ritem->boundsCenter, &ritem->boundsExtents);
+    ritem->hasBounds = true;
+}
+
+void initRitemWithDedupGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT constBuffSeatCount,
+    RenderItem* ritem, SceneBuilder* builder)
+{
+    UINT64 hash = calcObjectGeometryHash(geo);
+    auto mesh = findDedupMesh(geo, hash, &pCore->geometryDedup);
+    if (mesh == nullptr) {
+        initRitemWithPooledGeoInfo(pCore, pool, geo, constBuffSeatCount, ritem, builder);
+        addDedupMesh(geo, hash, ritem->mesh, &pCore->geometryDedup);
+        return;
+    }
+    initEmptyRenderItem(ritem);
+    ritem->objConstBuffSeatCount = constBuffSeatCount;
+    ritem->constData.resize(constBuffSeatCount);
+    ritem->materials.resize(constBuffSeatCount);
+    ritem->mesh = std::move(mesh);
+
+    calcVertexBounds(geo->vertices.data(), geo->vertices.size(), &ritem->boundsCenter, &ritem->boundsExtents);
+    ritem->hasBounds = true;
+}
+
+void setRitemWorldTrans(FXMMATRIX world, RenderItem* ritem) {
+    XMVECTOR det = XMMatrixDeterminant(world);
+    for (auto& seat : ritem->constData) {
+        XMStoreFloat4x4(&seat.worldTrans, XMMatrixTranspose(world));
+        XMStoreFloat4x4(&seat.invTrWorldTrans, XMMatrixInverse(&det, world));
+    }
+}
+
+void initRitemWithInstancedGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT instanceCount,
+    RenderItem* ritem, SceneBuilder* builder)
+{
+    initRitemWithPooledGeoInfo(pCore, pool, geo, 0, ritem, builder);
+    ritem->materials.resize(1);
+    ritem->instances.resize(instanceCount);
+}
+
+void setInstanceWorldTrans(FXMMATRIX world, InstanceData* pInstance) {
+    // The inverse transpose is transposed again, which gives the inverse.
+    XMVECTOR det = XMMatrixDeterminant(world);
+    XMStoreFloat4x4(&pInstance->worldTrans, XMMatrixTranspose(world));
+    XMStoreFloat4x4(&pInstance->invTrWorldTrans, XMMatrixInverse(&det, world));
+}
+
+void initRitemWithPackedGeoInfo(D3DCore* pCore, PackedGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem,
+    SceneBuilder* builder)
+{
+    initEmptyRenderItem(ritem);
+    ritem->objConstBuffSeatCount = constBuffSeatCount;
+    ritem->constData.resize(constBuffSeatCount);
+    ritem->materials.resize(constBuffSeatCount);
+    ritem->mesh = std::make_unique<Vmesh>();
+    initPackedVmesh(pCore, geo->vertices.data(), geo->vertices.size(),
+        geo->indices.data(), geo->indexDataSize(), geo->dequantization, ritem->mesh.get(), builder);
     ritem->mesh->objects["main"] = geo->locationInfo;
+
+    auto& dequant = geo->dequantization;
+    for (auto& seat : ritem->constData) {
+        seat.posDequantScale = { dequant.posScale.x, dequant.posScale.y, dequant.posScale.z, 0.0f };
+        seat.posDequantBias = { dequant.posBias.x, dequant.posBias.y, dequant.posBias.z, 0.0f };
+        seat.uvDequantScaleBias = { dequant.uvScale.x, dequant.uvScale.y, dequant.uvBias.x, dequant.uvBias.y };
+    }
+
+    // The normalized positions are in [-1, 1], so the bounds are given by the dequantization.
+    ritem->boundsCenter = dequant.posBias;
+    ritem->boundsExtents = { fabsf(dequant.posScale.x), fabsf(dequant.posScale.y), fabsf(dequant.posScale.z) };
+    ritem->hasBounds = true;
 }
 
 void updateRitemRangeObjConstBuffIdx(RenderItem** ppRitem, size_t ritemCount) {
-    size_t tmpStartIdx = 0;
+    size_t tmpStartIdx = 0, tmpInstStartIdx = 0;
     for (size_t i = 0; i < ritemCount; ++i) {
         ppRitem[i]->objConstBuffStartIdx = (UINT)tmpStartIdx;
         tmpStartIdx += ppRitem[i]->objConstBuffSeatCount;
+        ppRitem[i]->instBuffStartIdx = (UINT)tmpInstStartIdx;
+        tmpInstStartIdx += ppRitem[i]->instances.size();
+        ppRitem[i]->boundsIdx = (UINT)i;
     }
 }
 
@@ -36,6 +144,9 @@ void updateRitemRangeMaterialDataIdx(RenderItem** ppRitem, size_t ritemCount) {
             // It is temporarily assumed that each render item only holds one material object.
             objBuff.materialIndex = (UINT)ppRitem[i]->materials[0]->matStructBuffIdx;
         }
+        for (auto& instance : ppRitem[i]->instances) {
+            instance.materialIndex = (UINT)ppRitem[i]->materials[0]->matStructBuffIdx;
+        }
     }
 }
 
@@ -47,9 +158,44 @@ UINT calcRitemRangeTotalObjConstBuffSeatCount(RenderItem** ppRitem, size_t ritem
     return seatCount;
 }
 
+UINT calcRitemRangeTotalInstanceCount(RenderItem** ppRitem, size_t ritemCount) {
+    UINT instanceCount = 0;
+    for (size_t i = 0; i < ritemCount; ++i) {
+        instanceCount += (UINT)ppRitem[i]->instances.size();
+    }
+    return instanceCount;
+}
+
 void moveNamedRitemToAllRitems(D3DCore* pCore, std::string name, std::unique_ptr<RenderItem>&& movedRitem) {
     pCore->ritems.insert({ name, std::move(movedRitem) });
     pCore->allRitems.push_back(pCore->ritems[name].get());
+    invalidateDrawLists(pCore);
+}
+
+void removeNamedRitem(D3DCore* pCore, const std::string& name) {
+    auto target = pCore->ritems.find(name);
+    if (target == pCore->ritems.end()) return;
+    RenderItem* ritem = target->second.get();
+
+    // The frames in flight may still draw the render item.
+    flushCmdQueue(pCore);
+
+    auto eraseRitem = [&](std::vector<RenderItem*>& ritems) {
+        ritems.erase(std::remove(ritems.begin(), ritems.end(), ritem), ritems.end());
+    };
+    for (auto& layer : pCore->ritemLayers) eraseRitem(layer.second);
+    eraseRitem(pCore->allRitems);
+    eraseRitem(pCore->objConstsShadow.dirtyRitems);
+    pCore->ritems.erase(target);
+    invalidateDrawLists(pCore);
+
+    // The seats, the instances and the bounds of the rest render items are laid out again.
+    updateRitemRangeObjConstBuffIdx(pCore->allRitems.data(), pCore->allRitems.size());
+    beginUploadBatch(pCore);
+    pCore->frameResources.clear();
+    createFrameResources(pCore);
+    endUploadBatch(pCore);
+    pCore->currFrameResource = pCore->frameResources[pCore->currFrameResourceIdx].get();
 }
 
 std::vector<RenderItem*>& findRitemLayerWithName(const std::string& name,
@@ -70,4 +216,5 @@ void bindRitemReferenceWithLayers(D3DCore* pCore,
         pCore->ritems[ritemName]->boundLayerSeatOffsetTable[info.first] = info.second;
         findRitemLayerWithName(info.first, pCore->ritemLayers).push_back(pCore->ritems[ritemName].get());
     }
+    invalidateDrawLists(pCore);
 }
@@ -10,19 +10,63 @@
 #include <unordered_set>
 
 #include "d3dcore/d3dcore.h"
+#include "packed-vertex-utils.h"
 
-void initRitemWithGeoInfo(D3DCore* pCore, ObjectGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem);
+class SceneBuilder;
+
+// If builder is not nullptr, the mesh data is uploaded in SceneBuilder::commit. See scene-builder.h.
+void initRitemWithGeoInfo(D3DCore* pCore, ObjectGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem,
+    SceneBuilder* builder = nullptr);
+
+// The mesh is suballocated from the pool (see geometry-pool-utils.h), and the main submesh is offset to
+// address into the pool buffers. If the pool is full, the mesh is created with the buffers of its own.
+// Note the dynamic render items should not be pooled, since the frame resource copies are not.
+void initRitemWithPooledGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT constBuffSeatCount,
+    RenderItem* ritem, SceneBuilder* builder = nullptr);
+
+// Same as initRitemWithPooledGeoInfo, but if a render item of the same geometry was initialized by this func
+// before, its mesh is shared instead of allocating another one (see geometry-dedup-utils.h). The geometry
+// should be placed at the origin, and the render item is positioned with setRitemWorldTrans.
+void initRitemWithDedupGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT constBuffSeatCount,
+    RenderItem* ritem, SceneBuilder* builder = nullptr);
+
+// The world matrix is written into every object constants seat, stored the same as setInstanceWorldTrans.
+void setRitemWorldTrans(FXMMATRIX world, RenderItem* ritem);
+
+// The mesh is created with the packed vertices (see packed-vertex-utils.h), and the dequantization
+// parameters are written into every object constants seat. Note the render item must be bound to
+// the layers of packed PSOs, e.g. "solid_packed".
+void initRitemWithPackedGeoInfo(D3DCore* pCore, PackedGeometry* geo, UINT constBuffSeatCount, RenderItem* ritem,
+    SceneBuilder* builder = nullptr);
+
+// The render item is instanced (see RenderItem::instances), i.e. the mesh is drawn instanceCount times with one draw
+// call and holds no object constants buffer seats. The mesh is pooled just like initRitemWithPooledGeoInfo.
+// Note the render item must be bound to the layers of instanced PSOs, e.g. "solid_instanced".
+void initRitemWithInstancedGeoInfo(D3DCore* pCore, GeometryPool* pool, ObjectGeometry* geo, UINT instanceCount,
+    RenderItem* ritem, SceneBuilder* builder = nullptr);
+
+// The world matrix and its inverse transpose are stored transposed, which is what the shaders expect.
+void setInstanceWorldTrans(FXMMATRIX world, InstanceData* pInstance);
 
 // When a render item is initialized, its objConstBuffStartIdx is set to 0 by default. However we need
 // the indices to match their actual orders in the render item collection, which is done by this func.
+// The same goes for instBuffStartIdx of the instanced render items and boundsIdx.
 void updateRitemRangeObjConstBuffIdx(RenderItem** ppRitem, size_t ritemCount);
 
 void updateRitemRangeMaterialDataIdx(RenderItem** ppRitem, size_t ritemCount);
 
 UINT calcRitemRangeTotalObjConstBuffSeatCount(RenderItem** ppRitem, size_t ritemCount);
 
+UINT calcRitemRangeTotalInstanceCount(RenderItem** ppRitem, size_t ritemCount);
+
 void moveNamedRitemToAllRitems(D3DCore* pCore, std::string name, std::unique_ptr<RenderItem>&& movedRitem);
 
+// The render item is unbound from its layers and destroyed after the GPU is idle, and the frame resources are
+// created again for the rest render items. Its mesh is released when no other render item shares it, e.g. the
+// regions of a pooled mesh go back to the pool. Note the geometry dedup table also holds the shared meshes
+// until it is cleared (see clearGeometryDedupTable).
+void removeNamedRitem(D3DCore* pCore, const std::string& name);
+
 std::vector<RenderItem*>& findRitemLayerWithName(const std::string& name,
     std::vector<std::pair<std::string, std::vector<RenderItem*>>>& layers);
 
@@ -0,0 +1,81 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "ring-allocator.h"
+
+static inline uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+void RingAllocator::reset(uint64_t capacity) {
+    _capacity = capacity;
+    _head = _tail = 0;
+    _usedSize = _pendingSize = 0;
+    _batches.clear();
+}
+
+uint64_t RingAllocator::allocate(uint64_t size, uint64_t alignment) {
+    if (size == 0 || size > _capacity || _usedSize == _capacity) return INVALID_OFFSET;
+    if (alignment == 0) alignment = 1;
+
+    // Rewind to the beginning when empty, which gives the largest contiguous free space.
+    if (_usedSize == 0) _head = _tail = 0;
+
+    uint64_t offset = INVALID_OFFSET;
+    uint64_t newHead = 0;
+    if (_head >= _tail) {
+        // Free space: [head, capacity) and [0, tail).
+        uint64_t aligned = alignUp(_head, alignment);
+        if (aligned + size <= _capacity) {
+            offset = aligned;
+            newHead = aligned + size;
+        }
+        // Skip the rest bytes at the end and wrap around. Offset 0 is always aligned.
+        else if (size <= _tail) {
+            offset = 0;
+            newHead = size;
+        }
+    }
+    else {
+        // Free space: [head, tail).
+        uint64_t aligned = alignUp(_head, alignment);
+        if (aligned + size <= _tail) {
+            offset = aligned;
+            newHead = aligned + size;
+        }
+    }
+    if (offset == INVALID_OFFSET) return INVALID_OFFSET;
+
+    // The consumed bytes include the alignment padding and the skipped bytes at the end (if wrapped).
+    uint64_t consumed = newHead >= _head ? newHead - _head : (_capacity - _head) + newHead;
+    _usedSize += consumed;
+    _pendingSize += consumed;
+    _head = newHead == _capacity ? 0 : newHead;
+    return offset;
+}
+
+void RingAllocator::submit(uint64_t fenceValue) {
+    if (_pendingSize == 0) return;
+    // Regions of the same fence value are merged into one batch.
+    if (!_batches.empty() && _batches.back().fenceValue == fenceValue) {
+        _batches.back().endOffset = _head;
+        _batches.back().size += _pendingSize;
+    }
+    else {
+        _batches.push_back({ fenceValue, _head, _pendingSize });
+    }
+    _pendingSize = 0;
+}
+
+void RingAllocator::retire(uint64_t completedFenceValue) {
+    while (!_batches.empty() && _batches.front().fenceValue <= completedFenceValue) {
+        _tail = _batches.front().endOffset;
+        _usedSize -= _batches.front().size;
+        _batches.pop_front();
+    }
+}
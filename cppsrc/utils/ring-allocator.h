@@ -0,0 +1,65 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Linear ring allocator of offsets in [0, capacity) with fence-based reclamation.
+// It only does the offset math, so it does not depend on D3DCore or any Windows API, and the backing
+// memory (e.g. an upload heap, see d3dcore/upload-ring.h) is managed by the caller.
+//
+// Usage: allocate some regions, then call submit with the fence value that will be signaled after
+// the GPU consumes them. Later, call retire with the completed fence value to reclaim the regions.
+// Regions are always freed in the order they are allocated, since the GPU finishes in order.
+//
+// ... [tail ====== live ====== head) ... free ... (or wrapped around the end)
+class RingAllocator {
+public:
+    constexpr static uint64_t INVALID_OFFSET = UINT64_MAX;
+
+    RingAllocator() = default;
+    explicit RingAllocator(uint64_t capacity) { reset(capacity); }
+
+    // Drop all regions (submitted or not) and change the capacity.
+    void reset(uint64_t capacity);
+
+    // Return the offset of a region of size bytes aligned to alignment (must be a power of 2),
+    // or INVALID_OFFSET if there is no enough contiguous free space. Note a region never wraps
+    // around the end, so the skipped bytes at the end are also held until the region is retired.
+    uint64_t allocate(uint64_t size, uint64_t alignment = 1);
+
+    // Tag all regions allocated since the last submit with fenceValue, which must not decrease.
+    void submit(uint64_t fenceValue);
+
+    // Free all submitted regions whose fence values are not greater than completedFenceValue.
+    void retire(uint64_t completedFenceValue);
+
+    inline uint64_t capacity() const { return _capacity; }
+    // Bytes held by the live regions, alignment paddings and skipped bytes included.
+    inline uint64_t usedSize() const { return _usedSize; }
+    // Bytes allocated since the last submit.
+    inline uint64_t pendingSize() const { return _pendingSize; }
+    inline size_t submittedBatchCount() const { return _batches.size(); }
+
+private:
+    struct Batch {
+        uint64_t fenceValue = 0;
+        uint64_t endOffset = 0; // _head when submitted, which becomes _tail when retired.
+        uint64_t size = 0;
+    };
+
+    uint64_t _capacity = 0;
+    uint64_t _head = 0; // Where the next region starts (before aligned).
+    uint64_t _tail = 0; // Where the oldest live region starts.
+    uint64_t _usedSize = 0;
+    uint64_t _pendingSize = 0;
+
+    std::deque<Batch> _batches = {};
+};
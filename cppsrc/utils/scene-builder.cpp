@@ -0,0 +1,106 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <d3dcompiler.h>
+#include <unordered_set>
+
+#include "debugger.h"
+#include "scene-builder.h"
+
+void SceneBuilder::queueDefaultBuffs(const void* initData, UINT64 byteSize,
+    ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU)
+{
+    // Create CPU data block.
+    checkHR(D3DCreateBlob(byteSize, ppBuffCPU));
+    memcpy((*ppBuffCPU)->GetBufferPointer(), initData, byteSize);
+
+    // Create GPU buffer, which waits for the copy in commit.
+    checkHR(_pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(ppBuffGPU)));
+
+    queueBuffCopy(*ppBuffCPU, *ppBuffGPU, 0, D3D12_RESOURCE_STATE_COPY_DEST);
+}
+
+void SceneBuilder::queueBuffCopy(ID3DBlob* data, ID3D12Resource* dest, UINT64 destOffset, D3D12_RESOURCE_STATES destState) {
+    QueuedBuff buff = {};
+    buff.data = data;
+    buff.dest = dest;
+    buff.destOffset = destOffset;
+    buff.destState = destState;
+    buff.arenaOffset = _arenaSize;
+    _queuedBuffs.push_back(buff);
+
+    // Keep every region aligned as the upload ring does.
+    UINT64 byteSize = data->GetBufferSize();
+    _arenaSize += (byteSize + D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT - 1) & ~(UINT64)(D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT - 1);
+}
+
+void SceneBuilder::commit() {
+    if (_queuedBuffs.empty()) return;
+
+    ComPtr<ID3D12Resource> arena = nullptr;
+    checkHR(_pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(_arenaSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&arena)));
+    BYTE* mappedData = nullptr;
+    checkHR(arena->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+    for (auto& buff : _queuedBuffs) {
+        memcpy(mappedData + buff.arenaOffset, buff.data->GetBufferPointer(), buff.data->GetBufferSize());
+    }
+    arena->Unmap(0, nullptr);
+
+    bool isOwnBatch = !_pCore->isUploadBatchOpen;
+    if (isOwnBatch) {
+        checkHR(_pCore->cmdAlloc->Reset());
+        checkHR(_pCore->cmdList->Reset(_pCore->cmdAlloc.Get(), nullptr));
+    }
+
+    // Several copies can share one dest (e.g. the geometry pool), which is only transitioned once.
+    std::vector<D3D12_RESOURCE_BARRIER> beginBarriers, endBarriers;
+    std::unordered_set<ID3D12Resource*> transitionedDests;
+    for (auto& buff : _queuedBuffs) {
+        if (!transitionedDests.insert(buff.dest.Get()).second) continue;
+        if (buff.destState != D3D12_RESOURCE_STATE_COPY_DEST) {
+            beginBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(buff.dest.Get(),
+                buff.destState, D3D12_RESOURCE_STATE_COPY_DEST));
+        }
+        endBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(buff.dest.Get(),
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+    }
+
+    if (!beginBarriers.empty()) _pCore->cmdList->ResourceBarrier((UINT)beginBarriers.size(), beginBarriers.data());
+    for (auto& buff : _queuedBuffs) {
+        _pCore->cmdList->CopyBufferRegion(buff.dest.Get(), buff.destOffset,
+            arena.Get(), buff.arenaOffset, buff.data->GetBufferSize());
+    }
+    _pCore->cmdList->ResourceBarrier((UINT)endBarriers.size(), endBarriers.data());
+
+    if (isOwnBatch) {
+        checkHR(_pCore->cmdList->Close());
+        ID3D12CommandList* cmdLists[] = { _pCore->cmdList.Get() };
+        _pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+        ++_pCore->cmdSubmissionCount;
+        flushCmdQueue(_pCore);
+    }
+    else {
+        // The arena must be kept until the batch is executed.
+        _pCore->uploadBatchTempBuffs.push_back(arena);
+    }
+
+    _queuedBuffs.clear();
+    _arenaSize = 0;
+}
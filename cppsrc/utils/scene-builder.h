@@ -0,0 +1,50 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "d3dcore/d3dcore.h"
+
+// Deferred uploader of the scene geometry. The GPU buffers are created when queued, but their data is
+// not uploaded until commit, which packs all queued data into one staging arena (an upload buffer of
+// the exact total size) and records all copies and barriers at once.
+//
+// Usage: pass the builder to initVmesh, initRitemWithGeoInfo etc. (see vmesh-utils.h), then call commit
+// before any queued buffer is used by the GPU. Note the queued buffers are in COPY_DEST until commit.
+class SceneBuilder {
+public:
+    explicit SceneBuilder(D3DCore* pCore) : _pCore(pCore) {}
+
+    // Same as createDefaultBuffs except the upload. The data is copied into *ppBuffCPU, which
+    // is read again in commit, so the buffers must stay alive until then.
+    void queueDefaultBuffs(const void* initData, UINT64 byteSize, ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU);
+
+    // Queue a copy of the whole data block to dest (starting at destOffset), e.g. a region of the geometry
+    // pool. dest is in destState before commit, and in D3D12_RESOURCE_STATE_GENERIC_READ after commit.
+    void queueBuffCopy(ID3DBlob* data, ID3D12Resource* dest, UINT64 destOffset, D3D12_RESOURCE_STATES destState);
+
+    // If an upload batch is open (see upload-ring-utils.h), the copies are submitted with the batch,
+    // otherwise they are executed and waited at once, i.e. one submission and one stall in total.
+    void commit();
+
+    inline size_t queuedBuffCount() const { return _queuedBuffs.size(); }
+    inline UINT64 queuedDataSize() const { return _arenaSize; }
+
+private:
+    struct QueuedBuff {
+        ComPtr<ID3DBlob> data = nullptr;
+        ComPtr<ID3D12Resource> dest = nullptr;
+        UINT64 destOffset = 0;
+        D3D12_RESOURCE_STATES destState = D3D12_RESOURCE_STATE_COPY_DEST;
+        UINT64 arenaOffset = 0;
+    };
+
+    D3DCore* _pCore = nullptr;
+
+    std::vector<QueuedBuff> _queuedBuffs = {};
+    UINT64 _arenaSize = 0;
+};
@@ -0,0 +1,154 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread-utils.h"
+
+namespace {
+
+struct ParallelJob {
+    const std::function<void(size_t, size_t)>* func = nullptr;
+    size_t begin = 0, end = 0, grainSize = 1;
+    size_t chunkCount = 0;
+    std::atomic<size_t> nextChunk = 0;
+    std::atomic<size_t> finishedChunkCount = 0;
+    // Count of workers holding this job, which is guarded by the state mutex of the pool.
+    // The job object lives on the stack of the submitting thread, so it must outlive them.
+    unsigned int activeWorkerCount = 0;
+};
+
+// Only the worker threads and the thread that is running a job set this flag,
+// which is used to detect nested parallelFor calls and run them serially.
+thread_local bool t_isInsideParallelJob = false;
+
+class WorkerPool {
+public:
+    WorkerPool() {
+        unsigned int hc = std::thread::hardware_concurrency();
+        threadCount = hc > 0 ? hc : 1;
+        for (unsigned int i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            isStopping = true;
+        }
+        jobPosted.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    void run(ParallelJob* job) {
+        // Only one job can be processed by the pool at a time.
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            currJob = job;
+            ++jobGeneration;
+        }
+        jobPosted.notify_all();
+
+        t_isInsideParallelJob = true;
+        processChunks(job);
+        t_isInsideParallelJob = false;
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        jobFinished.wait(lock, [&] {
+            return job->finishedChunkCount.load() == job->chunkCount && job->activeWorkerCount == 0; });
+        currJob = nullptr;
+    }
+
+    unsigned int threadCount = 1;
+
+private:
+    void workerLoop() {
+        t_isInsideParallelJob = true;
+        size_t seenGeneration = 0;
+        while (true) {
+            ParallelJob* job = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                jobPosted.wait(lock, [&] { return isStopping || (currJob != nullptr && jobGeneration != seenGeneration); });
+                if (isStopping) return;
+                seenGeneration = jobGeneration;
+                job = currJob;
+                ++job->activeWorkerCount;
+            }
+            processChunks(job);
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                --job->activeWorkerCount;
+            }
+            jobFinished.notify_all();
+        }
+    }
+
+    void processChunks(ParallelJob* job) {
+        size_t chunkIdx;
+        while ((chunkIdx = job->nextChunk.fetch_add(1)) < job->chunkCount) {
+            size_t chunkBegin = job->begin + chunkIdx * job->grainSize;
+            size_t chunkEnd = std::min(chunkBegin + job->grainSize, job->end);
+            (*job->func)(chunkBegin, chunkEnd);
+            if (job->finishedChunkCount.fetch_add(1) + 1 == job->chunkCount) {
+                // Lock before notifying to avoid the waiting thread missing the wake-up.
+                { std::lock_guard<std::mutex> lock(stateMutex); }
+                jobFinished.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers = {};
+
+    std::mutex submitMutex;
+    std::mutex stateMutex;
+    std::condition_variable jobPosted;
+    std::condition_variable jobFinished;
+
+    ParallelJob* currJob = nullptr;
+    size_t jobGeneration = 0;
+    bool isStopping = false;
+};
+
+WorkerPool& globalWorkerPool() {
+    static WorkerPool pool;
+    return pool;
+}
+
+}
+
+unsigned int workerThreadCount() {
+    return globalWorkerPool().threadCount;
+}
+
+void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& func) {
+    if (end <= begin) return;
+    grainSize = std::max<size_t>(grainSize, 1);
+    size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+    // It is not worth waking the workers up for a single chunk.
+    if (chunkCount == 1 || t_isInsideParallelJob || workerThreadCount() == 1) {
+        func(begin, end);
+        return;
+    }
+
+    ParallelJob job;
+    job.func = &func;
+    job.begin = begin;
+    job.end = end;
+    job.grainSize = grainSize;
+    job.chunkCount = chunkCount;
+    globalWorkerPool().run(&job);
+}
@@ -0,0 +1,20 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include <functional>
+
+// The count of threads (the calling thread included) which take part in parallelFor.
+unsigned int workerThreadCount();
+
+// Split [begin, end) into chunks of (at least) grainSize elements and invoke func(chunkBegin, chunkEnd)
+// for every chunk on a lazily created worker pool. The calling thread also processes chunks, and this
+// func returns only after all chunks are finished. Note the chunks are executed in no particular order,
+// so func must NOT write any data shared between different chunks without synchronization.
+// Nested calls (i.e. calling parallelFor inside func) are executed serially on the current thread.
+void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)>& func);
@@ -0,0 +1,101 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+#include "debugger.h"
+#include "upload-ring-utils.h"
+
+void initUploadRing(D3DCore* pCore, UINT64 capacity, UploadRing* ring) {
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(capacity),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&ring->buff)));
+    // An upload heap can be kept mapped during its whole lifetime.
+    checkHR(ring->buff->Map(0, nullptr, reinterpret_cast<void**>(&ring->mappedData)));
+    ring->allocator.reset(capacity);
+}
+
+bool copyBuffWithUploadRing(D3DCore* pCore, UploadRing* ring,
+    ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize)
+{
+    UINT64 offset = ring->allocator.allocate(byteSize, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+    if (offset == RingAllocator::INVALID_OFFSET) return false;
+
+    memcpy(ring->mappedData + offset, data, byteSize);
+    pCore->cmdList->CopyBufferRegion(dest, destOffset, ring->buff.Get(), offset, byteSize);
+    return true;
+}
+
+bool uploadStatedBuffWithRing(D3DCore* pCore, UploadRing* ring,
+    ID3D12Resource* dest, D3D12_RESOURCE_STATES destState, const void* data, UINT64 byteSize)
+{
+    UINT64 offset = ring->allocator.allocate(byteSize, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+    if (offset == RingAllocator::INVALID_OFFSET) return false;
+
+    memcpy(ring->mappedData + offset, data, byteSize);
+    if (destState != D3D12_RESOURCE_STATE_COPY_DEST) {
+        pCore->cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dest,
+            destState, D3D12_RESOURCE_STATE_COPY_DEST));
+    }
+    pCore->cmdList->CopyBufferRegion(dest, 0, ring->buff.Get(), offset, byteSize);
+    if (destState != D3D12_RESOURCE_STATE_COPY_DEST) {
+        pCore->cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dest,
+            D3D12_RESOURCE_STATE_COPY_DEST, destState));
+    }
+    return true;
+}
+
+void beginUploadBatch(D3DCore* pCore) {
+    checkHR(pCore->cmdAlloc->Reset());
+    checkHR(pCore->cmdList->Reset(pCore->cmdAlloc.Get(), nullptr));
+    pCore->isUploadBatchOpen = true;
+}
+
+void endUploadBatch(D3DCore* pCore) {
+    checkHR(pCore->cmdList->Close());
+    ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
+    pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+    ++pCore->cmdSubmissionCount;
+    flushCmdQueue(pCore);
+
+    // All copies of the batch have been executed after the flush.
+    pCore->uploadRing.allocator.submit(pCore->currFenceValue);
+    pCore->uploadRing.allocator.retire(pCore->fence->GetCompletedValue());
+    pCore->uploadBatchTempBuffs.clear();
+    pCore->isUploadBatchOpen = false;
+}
+
+void uploadBuffInBatch(D3DCore* pCore, ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize) {
+    auto ring = &pCore->uploadRing;
+    if (copyBuffWithUploadRing(pCore, ring, dest, destOffset, data, byteSize)) return;
+
+    if (byteSize <= ring->allocator.capacity()) {
+        // The ring is full of the copies not executed yet.
+        endUploadBatch(pCore);
+        beginUploadBatch(pCore);
+        if (copyBuffWithUploadRing(pCore, ring, dest, destOffset, data, byteSize)) return;
+    }
+
+    ComPtr<ID3D12Resource> tempBuff = nullptr;
+    checkHR(pCore->device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&tempBuff)));
+    BYTE* mappedData = nullptr;
+    checkHR(tempBuff->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+    memcpy(mappedData, data, byteSize);
+    tempBuff->Unmap(0, nullptr);
+
+    pCore->cmdList->CopyBufferRegion(dest, destOffset, tempBuff.Get(), 0, byteSize);
+    pCore->uploadBatchTempBuffs.push_back(tempBuff);
+}
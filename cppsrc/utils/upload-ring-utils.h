@@ -0,0 +1,34 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+#pragma once
+
+#include "d3dcore/d3dcore.h"
+
+void initUploadRing(D3DCore* pCore, UINT64 capacity, UploadRing* ring);
+
+// Copy data into the ring and record a copy to dest (starting at destOffset) on pCore->cmdList.
+// dest must be in D3D12_RESOURCE_STATE_COPY_DEST when the copy is executed. Note the region is
+// pending until ring->allocator.submit is called, and it must not be retired before executed.
+// Return FALSE if there is no enough free space in the ring, in which case nothing is recorded.
+bool copyBuffWithUploadRing(D3DCore* pCore, UploadRing* ring,
+    ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize);
+
+// Same as copyBuffWithUploadRing, but dest is transitioned from destState to COPY_DEST and back.
+bool uploadStatedBuffWithRing(D3DCore* pCore, UploadRing* ring,
+    ID3D12Resource* dest, D3D12_RESOURCE_STATES destState, const void* data, UINT64 byteSize);
+
+// All createDefaultBuffs calls between beginUploadBatch and endUploadBatch record their copies into
+// pCore->cmdList, which is executed and waited only once in endUploadBatch. Calling createDefaultBuffs
+// outside a batch is the same as wrapping it with a batch of its own.
+void beginUploadBatch(D3DCore* pCore);
+void endUploadBatch(D3DCore* pCore);
+
+// Upload data to dest (in COPY_DEST state, starting at destOffset) within the current batch with pCore->uploadRing.
+// If the ring is full, the batch is ended and begun again to reclaim the ring, and the data
+// larger than the whole ring is staged in a temporary upload buffer released in endUploadBatch.
+void uploadBuffInBatch(D3DCore* pCore, ID3D12Resource* dest, UINT64 destOffset, const void* data, UINT64 byteSize);
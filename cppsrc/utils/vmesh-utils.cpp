@@ -9,18 +9,20 @@
 #include <d3dcompiler.h>
 
 #include "debugger.h"
+#include "scene-builder.h"
+#include "upload-ring-utils.h"
 #include "vmesh-utils.h"
 
 void initVmesh(D3DCore* pCore, const void* vertexData, UINT64 vertexDataSize,
-    const void* indexData, UINT64 indexDataSize, Vmesh* pMesh)
+    const void* indexData, UINT64 indexDataSize, Vmesh* pMesh, UINT vertexStride, SceneBuilder* builder)
 {
     createDefaultBuffs(pCore, vertexData, vertexDataSize,
-        &pMesh->vertexBuffCPU, &pMesh->vertexBuffGPU, &pMesh->vertexUploadBuff);
+        &pMesh->vertexBuffCPU, &pMesh->vertexBuffGPU, builder);
     createDefaultBuffs(pCore, indexData, indexDataSize,
-        &pMesh->indexBuffCPU, &pMesh->indexBuffGPU, &pMesh->indexUploadBuff);
+        &pMesh->indexBuffCPU, &pMesh->indexBuffGPU, builder);
 
     pMesh->vertexBuffView.BufferLocation = pMesh->vertexBuffGPU->GetGPUVirtualAddress();
-    pMesh->vertexBuffView.StrideInBytes = sizeof(Vertex);
+    pMesh->vertexBuffView.StrideInBytes = vertexStride;
     pMesh->vertexBuffView.SizeInBytes = (UINT)vertexDataSize;
 
     pMesh->indexBuffView.BufferLocation = pMesh->indexBuffGPU->GetGPUVirtualAddress();
@@ -28,54 +30,65 @@ void initVmesh(D3DCore* pCore, const void* vertexData, UINT64 vertexDataSize,
     pMesh->indexBuffView.SizeInBytes = (UINT)indexDataSize;
 }
 
+void initPackedVmesh(D3DCore* pCore, const PackedVertex* vertexData, UINT64 vertexCount,
+    const void* indexData, UINT64 indexDataSize, const VertexDequantization& dequant, Vmesh* pMesh,
+    SceneBuilder* builder)
+{
+    initVmesh(pCore, vertexData, vertexCount * sizeof(PackedVertex),
+        indexData, indexDataSize, pMesh, sizeof(PackedVertex), builder);
+    pMesh->vertexFormat = Vmesh::PACKED_VERTEX;
+    pMesh->dequantization = dequant;
+}
+
 void createDefaultBuffs(D3DCore* pCore, const void* initData, UINT64 byteSize,
-    ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU, ID3D12Resource** ppUploadBuff)
+    ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU, SceneBuilder* builder)
 {
-    pCore->cmdAlloc->Reset();
-    pCore->cmdList->Reset(pCore->cmdAlloc.Get(), nullptr);
+    if (builder != nullptr) {
+        builder->queueDefaultBuffs(initData, byteSize, ppBuffCPU, ppBuffGPU);
+        return;
+    }
+
+    // Record the copy into the current upload batch, or submit it at once if there is no batch.
+    bool isOwnBatch = !pCore->isUploadBatchOpen;
+    if (isOwnBatch) beginUploadBatch(pCore);
 
     // Create CPU data block.
     checkHR(D3DCreateBlob(byteSize, ppBuffCPU));
     memcpy((*ppBuffCPU)->GetBufferPointer(), initData, byteSize);
 
-    // Create GPU buffer and upload buffer.
+    // Create GPU buffer. The data is staged in the upload ring of D3DCore instead of an upload buffer of its own.
     checkHR(pCore->device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
         &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-        D3D12_RESOURCE_STATE_COMMON,
+        D3D12_RESOURCE_STATE_COPY_DEST,
         nullptr,
         IID_PPV_ARGS(ppBuffGPU)));
 
-    checkHR(pCore->device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(ppUploadBuff)));
-
-    uploadStatedResource(pCore,
-        *ppBuffGPU, D3D12_RESOURCE_STATE_COMMON,
-        *ppUploadBuff, D3D12_RESOURCE_STATE_GENERIC_READ,
-        initData, byteSize);
+    uploadBuffInBatch(pCore, *ppBuffGPU, 0, initData, byteSize);
 
     pCore->cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(*ppBuffGPU,
-        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_GENERIC_READ));
+        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
 
-    checkHR(pCore->cmdList->Close());
-    ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
-    pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
-    flushCmdQueue(pCore);
+    if (isOwnBatch) endUploadBatch(pCore);
 }
 
 Vmesh* copyVmesh(D3DCore* pCore, const Vmesh* source) {
     std::unique_ptr<Vmesh> mesh = std::make_unique<Vmesh>();
 
-    initVmesh(pCore,
-        source->vertexBuffCPU->GetBufferPointer(), source->vertexBuffCPU->GetBufferSize(),
-        source->indexBuffCPU->GetBufferPointer(), source->indexBuffCPU->GetBufferSize(),
-        mesh.get());
+    if (source->vertexFormat == Vmesh::PACKED_VERTEX) {
+        initPackedVmesh(pCore,
+            (const PackedVertex*)source->vertexBuffCPU->GetBufferPointer(),
+            source->vertexBuffCPU->GetBufferSize() / sizeof(PackedVertex),
+            source->indexBuffCPU->GetBufferPointer(), source->indexBuffCPU->GetBufferSize(),
+            source->dequantization, mesh.get());
+    }
+    else {
+        initVmesh(pCore,
+            source->vertexBuffCPU->GetBufferPointer(), source->vertexBuffCPU->GetBufferSize(),
+            source->indexBuffCPU->GetBufferPointer(), source->indexBuffCPU->GetBufferSize(),
+            mesh.get());
+    }
 
     return mesh.release();
 }
@@ -118,5 +131,6 @@ void createDefaultTexs(D3DCore* pCore, const void* initData, UINT64 byteSize,
     checkHR(pCore->cmdList->Close());
     ID3D12CommandList* cmdLists[] = { pCore->cmdList.Get() };
     pCore->cmdQueue->ExecuteCommandLists(1, cmdLists);
+    ++pCore->cmdSubmissionCount;
     flushCmdQueue(pCore);
 }
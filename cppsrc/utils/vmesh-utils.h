@@ -9,11 +9,22 @@
 
 #include "d3dcore/d3dcore.h"
 
+class SceneBuilder;
+
+// If builder is not nullptr, the uploads of the buffers are queued into it. See scene-builder.h.
 void initVmesh(D3DCore* pCore, const void* vertexData, UINT64 vertexDataSize,
-    const void* indexData, UINT64 indexDataSize, Vmesh* pMesh);
+    const void* indexData, UINT64 indexDataSize, Vmesh* pMesh, UINT vertexStride = sizeof(Vertex),
+    SceneBuilder* builder = nullptr);
+
+// Create a PACKED_VERTEX mesh.
+void initPackedVmesh(D3DCore* pCore, const PackedVertex* vertexData, UINT64 vertexCount,
+    const void* indexData, UINT64 indexDataSize, const VertexDequantization& dequant, Vmesh* pMesh,
+    SceneBuilder* builder = nullptr);
 
+// The copy is recorded into the current upload batch if there is one. See upload-ring-utils.h.
+// If builder is not nullptr, the copy is queued into it instead, see SceneBuilder::queueDefaultBuffs.
 void createDefaultBuffs(D3DCore* pCore, const void* initData, UINT64 byteSize,
-    ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU, ID3D12Resource** ppUploadBuff);
+    ID3DBlob** ppBuffCPU, ID3D12Resource** ppBuffGPU, SceneBuilder* builder = nullptr);
 
 Vmesh* copyVmesh(D3DCore* pCore, const Vmesh* source);
 
@@ -9,6 +9,7 @@
 // This is the default shader for render station program.
 
 #include "light-utils.hlsl"
+#include "packed-vertex.hlsl"
 
 #define SCENE_MATERIAL_COUNT 14
 
@@ -22,6 +23,17 @@ cbuffer cbPerObject : register(b0)
 	int gHasNormalMap;
 
 	uint gMaterialIndex;
+
+	// Only used by VSPacked.
+	float4 gPosDequantScale;
+	float4 gPosDequantBias;
+	float4 gUvDequantScaleBias;
+};
+
+// Only used by VSInstanced.
+cbuffer cbPerDraw : register(b2)
+{
+	uint gInstanceBaseIndex;
 };
 
 cbuffer cbGlobalProc : register(b1)
@@ -54,6 +66,18 @@ struct MaterialData
 
 StructuredBuffer<MaterialData> gMaterialData : register(t0, space1);
 
+// Same as InstanceData in cppsrc/graphics/shader.h.
+struct InstanceData
+{
+	float4x4 world;
+	float4x4 invTrWorld;
+	float4x4 texTrans;
+	uint materialIndex;
+	uint3 _placeholder;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t1, space1);
+
 Texture2D gDiffuseMap[SCENE_MATERIAL_COUNT]: register(t0);
 
 Texture2D gDisplacementMap : register(t0, space2);
@@ -82,40 +106,102 @@ struct VertexOut
 	float3 posW : POSITION;
 	float3 normalW : NORMAL;
 	float2 uv : TEXCOORD;
+	nointerpolation uint materialIndex : MATERIAL;
 };
 
-VertexOut VS(VertexIn vin)
+// Object data of the vertex, which is read from cbPerObject or from the instance buffer.
+struct ObjectData
+{
+	float4x4 world;
+	float4x4 invTrWorld;
+	float4x4 texTrans;
+	int hasDisplacementMap;
+	int hasNormalMap;
+	uint materialIndex;
+};
+
+ObjectData loadPerObjectData()
+{
+	ObjectData obj;
+	obj.world = gWorld;
+	obj.invTrWorld = gInvTrWorld;
+	obj.texTrans = gTexTrans;
+	obj.hasDisplacementMap = gHasDisplacementMap;
+	obj.hasNormalMap = gHasNormalMap;
+	obj.materialIndex = gMaterialIndex;
+	return obj;
+}
+
+// The instances have no displacement and normal maps.
+ObjectData loadInstanceData(uint instanceID)
+{
+	InstanceData inst = gInstanceData[gInstanceBaseIndex + instanceID];
+
+	ObjectData obj;
+	obj.world = inst.world;
+	obj.invTrWorld = inst.invTrWorld;
+	obj.texTrans = inst.texTrans;
+	obj.hasDisplacementMap = 0;
+	obj.hasNormalMap = 0;
+	obj.materialIndex = inst.materialIndex;
+	return obj;
+}
+
+VertexOut transformVertex(VertexIn vin, ObjectData obj)
 {
 	VertexOut vout = (VertexOut)0.0f;
 	
 	// Get material data.
-	MaterialData matData = gMaterialData[gMaterialIndex];
+	MaterialData matData = gMaterialData[obj.materialIndex];
 
 	// Apply displacement and normal map (If has).
-	if (gHasDisplacementMap == 1)
+	if (obj.hasDisplacementMap == 1)
 	{
 		vin.posL += gDisplacementMap.SampleLevel(gsamLinearWrap, vin.uv, 1.0f);
 	}
-	if (gHasNormalMap == 1)
+	if (obj.hasNormalMap == 1)
 	{
 		vin.normalL = gNormalMap.SampleLevel(gsamLinearWrap, vin.uv, 1.0f);
 	}
 
 	// General VS works.
-	float4 posW = mul(mul(float4(vin.posL, 1.0f), gWorld), gReflectTrans);
+	float4 posW = mul(mul(float4(vin.posL, 1.0f), obj.world), gReflectTrans);
 	vout.posH = mul(mul(posW, gView), gProj);
 	vout.posW = posW.xyz;
-	vout.normalW = mul(mul(vin.normalL, (float3x3)gInvTrWorld), (float3x3)gInvTrReflectTrans);
-	float4 uv = mul(float4(vin.uv, 0.0f, 1.0f), gTexTrans);
+	vout.normalW = mul(mul(vin.normalL, (float3x3)obj.invTrWorld), (float3x3)gInvTrReflectTrans);
+	float4 uv = mul(float4(vin.uv, 0.0f, 1.0f), obj.texTrans);
 	vout.uv = mul(uv, matData.matTrans).xy;
+	vout.materialIndex = obj.materialIndex;
 
 	return vout;
 }
 
+VertexOut VS(VertexIn vin)
+{
+	return transformVertex(vin, loadPerObjectData());
+}
+
+// Entry of the instanced render items, see RenderItem::instances in cppsrc/d3dcore/frame-async.h.
+VertexOut VSInstanced(VertexIn vin, uint instanceID : SV_InstanceID)
+{
+	return transformVertex(vin, loadInstanceData(instanceID));
+}
+
+// Entry of the meshes of packed vertices, which must be used with the packed input layout.
+VertexOut VSPacked(PackedVertexIn pvin)
+{
+	VertexIn vin = (VertexIn)0.0f;
+	vin.posL = dequantizePosition(pvin.posN.xyz, gPosDequantScale.xyz, gPosDequantBias.xyz);
+	vin.normalL = decodeOctahedralNormal(pvin.normalOct);
+	vin.uv = dequantizeTexcoord(pvin.uvN, gUvDequantScaleBias);
+
+	return transformVertex(vin, loadPerObjectData());
+}
+
 float4 PS(VertexOut pin) : SV_Target
 {
 	// Get material data.
-	MaterialData matData = gMaterialData[gMaterialIndex];
+	MaterialData matData = gMaterialData[pin.materialIndex];
 
 	pin.normalW = normalize(pin.normalW);
 	float3 eyeVecW = gEyePosW - pin.posW;
@@ -0,0 +1,39 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+// Decode helpers of PackedVertex (see cppsrc/utils/packed-vertex-utils.h).
+// The snorm16 and unorm16 components have already been normalized by the input assembler.
+
+struct PackedVertexIn
+{
+	float4 posN : POSITION; // [-1, 1] relative to the mesh AABB. w is only a padding.
+	float2 normalOct : NORMAL; // Octahedral-encoded normal in [-1, 1]^2.
+	float2 uvN : TEXCOORD; // [0, 1] relative to the mesh UV bounds.
+};
+
+float3 decodeOctahedralNormal(float2 code)
+{
+	float3 n = float3(code.xy, 1.0f - abs(code.x) - abs(code.y));
+	if (n.z < 0.0f)
+	{
+		// Note the sign of 0 is treated as positive, which must match the CPU encoder.
+		float2 s = float2(code.x >= 0.0f ? 1.0f : -1.0f, code.y >= 0.0f ? 1.0f : -1.0f);
+		n.xy = (1.0f - abs(code.yx)) * s;
+	}
+	return normalize(n);
+}
+
+float3 dequantizePosition(float3 posN, float3 scale, float3 bias)
+{
+	return bias + scale * posN;
+}
+
+float2 dequantizeTexcoord(float2 uvN, float4 scaleBias)
+{
+	return scaleBias.zw + scaleBias.xy * uvN;
+}
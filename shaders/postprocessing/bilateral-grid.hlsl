@@ -0,0 +1,109 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+// Bilateral grid, the GRID mode of BilateralBlur. See bilateralGridBlurImage in image-filter.h, which is the CPU
+// version, for the layout of the grid. Each cell holds (r, g, b, 1) summed over the pixels splatted to it.
+
+cbuffer cbGridConfigs : register(b0)
+{
+    float gCellSize;
+    float gInvCellSize;
+    float gGrayOrigin;
+    float gInvGrayCellSize;
+    int gGridWidth;
+    int gGridHeight;
+    int gGridDepth;
+
+    // 0 for x, 1 for y and 2 for gray.
+    int gBlurAxis;
+};
+
+// Same as MAX_BILATERAL_GRID_DEPTH in image-filter.h.
+#define MAX_GRID_DEPTH 24
+
+Texture2D gInput : register(t0);
+Texture3D gGridInput : register(t1);
+RWTexture2D<float4> gOutput : register(u0);
+RWTexture3D<float4> gGridOutput : register(u1);
+
+float calcGray(float4 color)
+{
+    return color.x * 0.299f + color.y * 0.587f + color.z * 0.114f;
+}
+
+// One thread per column of cells, which gathers the pixels nearest to it. As each pixel belongs to a single
+// column, no atomic operation is needed.
+[numthreads(8, 8, 1)]
+void SplatCS(int3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int2 cell = dispatchThreadID.xy;
+    if (cell.x >= gGridWidth || cell.y >= gGridHeight) return;
+
+    float4 sums[MAX_GRID_DEPTH];
+    for (int z = 0; z < gGridDepth; ++z)
+    {
+        sums[z] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    // The pixels whose nearest cell is this one, plus one more on each side for the rounding of the bounds.
+    int2 first = max((int2)floor((cell - 1.5f) * gCellSize) - 1, 0);
+    int2 last = min((int2)ceil((cell - 0.5f) * gCellSize) + 1, gInput.Length.xy - 1);
+    for (int y = first.y; y <= last.y; ++y)
+    {
+        for (int x = first.x; x <= last.x; ++x)
+        {
+            if (any((int2)(float2(x, y) * gInvCellSize + 1.5f) != cell)) continue;
+
+            float4 color = gInput[int2(x, y)];
+            int z = (int)((calcGray(color) - gGrayOrigin) * gInvGrayCellSize + 1.5f);
+            sums[min(z, gGridDepth - 1)] += float4(color.rgb, 1.0f);
+        }
+    }
+
+    for (int k = 0; k < gGridDepth; ++k)
+    {
+        gGridOutput[int3(cell, k)] = sums[k];
+    }
+}
+
+// [1 2 1] / 4 along gBlurAxis. The loads beyond the grid return 0.
+[numthreads(4, 4, 4)]
+void BlurCS(int3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int3 cell = dispatchThreadID;
+    if (any(cell >= int3(gGridWidth, gGridHeight, gGridDepth))) return;
+
+    int3 offset = int3(gBlurAxis == 0, gBlurAxis == 1, gBlurAxis == 2);
+    gGridOutput[cell] = 0.5f * gGridInput[cell] +
+        0.25f * (gGridInput[cell - offset] + gGridInput[cell + offset]);
+}
+
+// Read the grid at (x, y, gray) of each pixel with trilinear interpolation, and divide the colors by the weight.
+[numthreads(16, 16, 1)]
+void SliceCS(int3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int2 xy = dispatchThreadID.xy;
+    if (any(xy >= gInput.Length.xy)) return;
+
+    float4 color = gInput[xy];
+    float3 f = float3(xy * gInvCellSize + 1.0f, (calcGray(color) - gGrayOrigin) * gInvGrayCellSize + 1.0f);
+    int3 c = (int3)f;
+    float3 t = f - c;
+
+    float4 sums[2][2];
+    for (int j = 0; j < 2; ++j)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            sums[j][i] = lerp(gGridInput[c + int3(i, j, 0)], gGridInput[c + int3(i, j, 1)], t.z);
+        }
+    }
+    float4 sum = lerp(lerp(sums[0][0], sums[0][1], t.x), lerp(sums[1][0], sums[1][1], t.x), t.y);
+
+    gOutput[xy] = float4(sum.rgb / sum.w, color.a);
+}
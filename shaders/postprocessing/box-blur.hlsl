@@ -0,0 +1,84 @@
+/*
+** Render Station @ https://github.com/yiyaowen/render-station
+**
+** Create fantastic animation and game.
+**
+** yiyaowen (c) 2021 All Rights Reserved.
+*/
+
+// Box filter of (2 * gBoxRadius + 1) pixels with the edge pixels clamped. GaussianBlur runs 3 of them in each
+// direction to approximate the Gaussian (See boxCascadeBlurImage in image-filter.h, which is the CPU version).
+//
+// Each row (or column) is split into segments of gSegmentLength pixels, and each thread walks one segment with a
+// running sum, which adds the pixel entering the window and subtracts the one leaving it. The window of the first
+// pixel of a segment is summed directly, so GaussianBlur keeps the segments at least as long as the window, i.e.
+// the cost per pixel still does not depend on the radius, while a 1080p frame is spread over tens of thousands
+// of threads instead of one thread per row.
+//
+// The N threads of a group walk the same segment of N adjacent rows (or columns) in lockstep, so each step
+// reads a run of N neighbouring pixels across the rows instead of N pixels a segment apart.
+
+cbuffer cbBoxConfigs : register(b0)
+{
+    int gBoxRadius;
+    int gSegmentLength;
+};
+
+Texture2D gInput : register(t0);
+RWTexture2D<float4> gOutput : register(u0);
+
+#define N 64
+
+[numthreads(1, N, 1)]
+void HorzBoxBlurCS(int3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int x0 = dispatchThreadID.x * gSegmentLength;
+    int y = dispatchThreadID.y;
+    int width = gInput.Length.x;
+    if (x0 >= width || y >= gInput.Length.y) return;
+
+    float scale = 1.0f / (gBoxRadius * 2 + 1);
+
+    // The window of the first pixel of the segment, clamped to the edge pixels.
+    float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int i = -gBoxRadius; i <= gBoxRadius; ++i)
+    {
+        sum += gInput[int2(clamp(x0 + i, 0, width - 1), y)];
+    }
+
+    int x1 = min(x0 + gSegmentLength, width);
+    for (int x = x0; x < x1; ++x)
+    {
+        gOutput[int2(x, y)] = sum * scale;
+
+        sum += gInput[int2(min(x + gBoxRadius + 1, width - 1), y)];
+        sum -= gInput[int2(max(x - gBoxRadius, 0), y)];
+    }
+}
+
+// Vertical Box Blur Compute Shader. See the comments of Horizontal Box Blur Compute Shader above.
+[numthreads(N, 1, 1)]
+void VertBoxBlurCS(int3 dispatchThreadID : SV_DispatchThreadID)
+{
+    int x = dispatchThreadID.x;
+    int y0 = dispatchThreadID.y * gSegmentLength;
+    int height = gInput.Length.y;
+    if (x >= gInput.Length.x || y0 >= height) return;
+
+    float scale = 1.0f / (gBoxRadius * 2 + 1);
+
+    float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int i = -gBoxRadius; i <= gBoxRadius; ++i)
+    {
+        sum += gInput[int2(x, clamp(y0 + i, 0, height - 1))];
+    }
+
+    int y1 = min(y0 + gSegmentLength, height);
+    for (int y = y0; y < y1; ++y)
+    {
+        gOutput[int2(x, y)] = sum * scale;
+
+        sum += gInput[int2(x, min(y + gBoxRadius + 1, height - 1))];
+        sum -= gInput[int2(x, max(y - gBoxRadius, 0))];
+    }
+}